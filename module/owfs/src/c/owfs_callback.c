@@ -16,6 +16,9 @@
 #include "owfs.h"
 #include "ow_pid.h"
 
+/* libfuse3 builds use the low-level interface in owfs_lowlevel.c instead */
+#ifndef OWFS_LOWLEVEL
+
 /* There was a major change in the function prototypes at FUSE 2.2, we'll make a flag */
 #undef FUSE22PLUS
 #undef FUSE1X
@@ -252,6 +255,11 @@ static void *FS_init(void)
 #endif							/* FUSE_VERSION > 25 */
 	PIDstart();
 	Announce_Systemd();
+	Poll_Start();
+	Cache_Snapshot_Start();
+	Cache_Reaper_Start();
 	return VOID_RETURN;
 }
 #endif							/* FUSE_VERSION > 22 */
+
+#endif							/* OWFS_LOWLEVEL */
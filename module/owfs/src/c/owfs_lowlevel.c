@@ -0,0 +1,683 @@
+/*
+    OW -- One-Wire filesystem
+
+    libfuse3 low-level interface
+
+    The kernel talks in inodes, not paths. Each path it has looked up gets a
+    node here with the attributes from its parse, so getattr doesn't parse
+    the path again until the attributes are stale. Reads and writes parse
+    through the owlib parse cache.
+
+    The kernel is told how long names and attributes stay valid from the
+    property's fc_change and the cache timeouts:
+      static properties (address, type, family...) for a day
+      stable and volatile properties for timeout_stable and timeout_volatile
+      directories (device lists) for timeout_directory
+      statistics, timers and uncached paths not at all
+
+    Written 2003 Paul H Alfille
+*/
+
+#include "owfs.h"
+#include "ow_pid.h"
+
+#ifdef OWFS_LOWLEVEL
+
+#define LL_STATIC_TIMEOUT  86400.0	/* a day */
+
+/* readdir inode when the kernel doesn't know it yet (as libfuse uses) */
+#define LL_UNKNOWN_INO     0xffffffff
+
+struct ll_attr {
+	struct stat st;
+	double attr_timeout;
+	double entry_timeout;
+	time_t checked;				// when st was filled (0 = never)
+};
+
+struct ll_node {
+	fuse_ino_t ino;
+	uint64_t nlookup;			// kernel references (lookups less forgets)
+	struct ll_attr attr;
+	const char *path;			// follows the structure
+};
+
+#define LL_NODE_PATH(node)  ( (char *)(node) + sizeof(struct ll_node) )
+
+/* directory listing made at opendir and handed out by readdir */
+struct ll_dir {
+	fuse_req_t req;
+	char *buf;
+	size_t size;
+	size_t allocated;
+	int error;
+};
+
+/* Node table -- found by inode and by path */
+static void *ll_ino_tree = NULL;
+static void *ll_path_tree = NULL;
+static pthread_mutex_t ll_node_mutex;
+static fuse_ino_t ll_next_ino = FUSE_ROOT_ID + 1;
+
+static void LL_init(void *userdata, struct fuse_conn_info *conn);
+static void LL_lookup(fuse_req_t req, fuse_ino_t parent, const char *name);
+static void LL_forget(fuse_req_t req, fuse_ino_t ino, uint64_t nlookup);
+static void LL_forget_multi(fuse_req_t req, size_t count, struct fuse_forget_data *forgets);
+static void LL_getattr(fuse_req_t req, fuse_ino_t ino, struct fuse_file_info *file_info);
+static void LL_setattr(fuse_req_t req, fuse_ino_t ino, struct stat *attr, int to_set, struct fuse_file_info *file_info);
+static void LL_open(fuse_req_t req, fuse_ino_t ino, struct fuse_file_info *file_info);
+static void LL_read(fuse_req_t req, fuse_ino_t ino, size_t size, off_t offset, struct fuse_file_info *file_info);
+static void LL_write(fuse_req_t req, fuse_ino_t ino, const char *buf, size_t size, off_t offset, struct fuse_file_info *file_info);
+static void LL_release(fuse_req_t req, fuse_ino_t ino, struct fuse_file_info *file_info);
+static void LL_opendir(fuse_req_t req, fuse_ino_t ino, struct fuse_file_info *file_info);
+static void LL_readdir(fuse_req_t req, fuse_ino_t ino, size_t size, off_t offset, struct fuse_file_info *file_info);
+static void LL_releasedir(fuse_req_t req, fuse_ino_t ino, struct fuse_file_info *file_info);
+
+static int LL_ino_compare(const void *a, const void *b);
+static int LL_path_compare(const void *a, const void *b);
+static GOOD_OR_BAD LL_node_setup(void);
+static void LL_node_keep(void *node);
+static void LL_node_cleanup(void);
+static struct ll_node *LL_node_find(fuse_ino_t ino);
+static void LL_node_forget(fuse_ino_t ino, uint64_t nlookup);
+static ZERO_OR_ERROR LL_parse(const char *path, struct ll_attr *attr);
+static ZERO_OR_ERROR LL_refresh(struct ll_node *node, struct ll_attr *attr);
+static double LL_timeout(const struct parsedname *pn);
+static void LL_dir_add(struct ll_dir *dir, const char *name, mode_t mode);
+static void LL_dir_callback(void *v, const struct parsedname *pn_entry);
+
+static const struct fuse_lowlevel_ops owfs_ll_oper = {
+	.init = LL_init,
+	.lookup = LL_lookup,
+	.forget = LL_forget,
+	.forget_multi = LL_forget_multi,
+	.getattr = LL_getattr,
+	.setattr = LL_setattr,
+	.open = LL_open,
+	.read = LL_read,
+	.write = LL_write,
+	.release = LL_release,
+	.opendir = LL_opendir,
+	.readdir = LL_readdir,
+	.releasedir = LL_releasedir,
+};
+
+/* ---------------------------------------------- */
+/* Session setup and loop                         */
+/* ---------------------------------------------- */
+/* fo holds the command line built in owfs.c (mount point, -f, -d, -o ...) */
+int Fuse_lowlevel_main(struct Fuse_option *fo)
+{
+	struct fuse_args args = FUSE_ARGS_INIT(fo->argc, fo->argv);
+	struct fuse_cmdline_opts opts;
+	struct fuse_session *se;
+	int ret = 1;
+
+	if (fuse_parse_cmdline(&args, &opts) != 0) {
+		return 1;
+	}
+	if (opts.mountpoint == NULL) {
+		LEVEL_DEFAULT("No FUSE mount point");
+		fuse_opt_free_args(&args);
+		return 1;
+	}
+	if ( BAD( LL_node_setup() ) ) {
+		free(opts.mountpoint);
+		fuse_opt_free_args(&args);
+		return 1;
+	}
+
+	se = fuse_session_new(&args, &owfs_ll_oper, sizeof(owfs_ll_oper), NULL);
+	if (se == NULL) {
+		LEVEL_DEFAULT("Cannot start FUSE session");
+	} else {
+		if (fuse_set_signal_handlers(se) != 0) {
+			LEVEL_DEFAULT("Cannot set FUSE signal handlers");
+		} else {
+			if (fuse_session_mount(se, opts.mountpoint) != 0) {
+				LEVEL_DEFAULT("Cannot mount FUSE at %s", opts.mountpoint);
+			} else {
+				fuse_daemonize(opts.foreground);
+				if (opts.singlethread || Globals.fuse_threads < 2) {
+					ret = fuse_session_loop(se);
+				} else {
+#if FUSE_USE_VERSION >= 312
+					struct fuse_loop_config *config = fuse_loop_cfg_create();
+					fuse_loop_cfg_set_clone_fd(config, opts.clone_fd);
+					fuse_loop_cfg_set_idle_threads(config, opts.max_idle_threads);
+					fuse_loop_cfg_set_max_threads(config, Globals.fuse_threads);
+					ret = fuse_session_loop_mt(se, config);
+					fuse_loop_cfg_destroy(config);
+#else							/* FUSE_USE_VERSION < 312 */
+					// thread limit needs libfuse 3.12
+					ret = fuse_session_loop_mt(se, opts.clone_fd);
+#endif							/* FUSE_USE_VERSION */
+				}
+				fuse_session_unmount(se);
+			}
+			fuse_remove_signal_handlers(se);
+		}
+		fuse_session_destroy(se);
+	}
+
+	LL_node_cleanup();
+	free(opts.mountpoint);
+	fuse_opt_free_args(&args);
+	return ret;
+}
+
+/* ---------------------------------------------- */
+/* Filesystem callback functions                  */
+/* ---------------------------------------------- */
+static void LL_init(void *userdata, struct fuse_conn_info *conn)
+{
+	(void) userdata;
+	(void) conn;
+	PIDstart();
+	Announce_Systemd();
+	Poll_Start();
+	Cache_Snapshot_Start();
+	Cache_Reaper_Start();
+}
+
+static void LL_lookup(fuse_req_t req, fuse_ino_t parent, const char *name)
+{
+	struct ll_node *parent_node = LL_node_find(parent);
+	struct ll_node *node;
+	struct ll_node key;
+	void *found;
+	struct fuse_entry_param entry;
+	struct ll_attr attr;
+	char path[PATH_MAX + 1];
+	ZERO_OR_ERROR return_code;
+
+	if (parent_node == NULL) {
+		fuse_reply_err(req, ENOENT);
+		return;
+	}
+	if (snprintf(path, sizeof(path), "%s%s%s", parent_node->path, (parent_node->path[1] == '\0') ? "" : "/", name) >= (int) sizeof(path)) {
+		fuse_reply_err(req, ENAMETOOLONG);
+		return;
+	}
+	LEVEL_CALL("LOOKUP path=%s", path);
+
+	return_code = LL_parse(path, &attr);
+	if (return_code != 0) {
+		fuse_reply_err(req, -return_code);
+		return;
+	}
+
+	memset(&entry, 0, sizeof(entry));
+	key.path = path;
+
+	_MUTEX_LOCK(ll_node_mutex);
+	found = tfind(&key, &ll_path_tree, LL_path_compare);
+	if (found != NULL) {
+		node = *(struct ll_node **) found;
+	} else {
+		size_t path_length = strlen(path);
+		node = owmalloc(sizeof(struct ll_node) + path_length + 1);
+		if (node != NULL) {
+			memcpy(LL_NODE_PATH(node), path, path_length + 1);
+			node->path = LL_NODE_PATH(node);
+			node->ino = ll_next_ino++;
+			node->nlookup = 0;
+			if (tsearch(node, &ll_path_tree, LL_path_compare) == NULL) {
+				owfree(node);
+				node = NULL;
+			} else if (tsearch(node, &ll_ino_tree, LL_ino_compare) == NULL) {
+				tdelete(node, &ll_path_tree, LL_path_compare);
+				owfree(node);
+				node = NULL;
+			}
+		}
+	}
+	if (node != NULL) {
+		++node->nlookup;
+		memcpy(&node->attr, &attr, sizeof(struct ll_attr));
+		entry.ino = node->ino;
+	}
+	_MUTEX_UNLOCK(ll_node_mutex);
+
+	if (node == NULL) {
+		fuse_reply_err(req, ENOMEM);
+		return;
+	}
+	entry.attr = attr.st;
+	entry.attr.st_ino = entry.ino;
+	entry.attr_timeout = attr.attr_timeout;
+	entry.entry_timeout = attr.entry_timeout;
+	fuse_reply_entry(req, &entry);
+}
+
+static void LL_forget(fuse_req_t req, fuse_ino_t ino, uint64_t nlookup)
+{
+	LL_node_forget(ino, nlookup);
+	fuse_reply_none(req);
+}
+
+static void LL_forget_multi(fuse_req_t req, size_t count, struct fuse_forget_data *forgets)
+{
+	size_t i;
+
+	for (i = 0; i < count; ++i) {
+		LL_node_forget(forgets[i].ino, forgets[i].nlookup);
+	}
+	fuse_reply_none(req);
+}
+
+static void LL_getattr(fuse_req_t req, fuse_ino_t ino, struct fuse_file_info *file_info)
+{
+	struct ll_node *node = LL_node_find(ino);
+	struct ll_attr attr;
+	ZERO_OR_ERROR return_code;
+
+	(void) file_info;
+	if (node == NULL) {
+		fuse_reply_err(req, ENOENT);
+		return;
+	}
+	LEVEL_CALL("GETATTR path=%s", node->path);
+
+	return_code = LL_refresh(node, &attr);
+	if (return_code != 0) {
+		fuse_reply_err(req, -return_code);
+		return;
+	}
+	attr.st.st_ino = ino;
+	fuse_reply_attr(req, &attr.st, attr.attr_timeout);
+}
+
+/* Needed for truncate, chmod, chown and utime -- all ignored as before */
+static void LL_setattr(fuse_req_t req, fuse_ino_t ino, struct stat *stbuf, int to_set, struct fuse_file_info *file_info)
+{
+	(void) stbuf;
+	(void) to_set;
+	LL_getattr(req, ino, file_info);
+}
+
+/* Device opened/closed with every read/write, but the kernel mustn't buffer */
+static void LL_open(fuse_req_t req, fuse_ino_t ino, struct fuse_file_info *file_info)
+{
+	struct ll_node *node = LL_node_find(ino);
+	mode_t mode;
+
+	if (node == NULL) {
+		fuse_reply_err(req, ENOENT);
+		return;
+	}
+	LEVEL_CALL("OPEN path=%s", node->path);
+	_MUTEX_LOCK(ll_node_mutex);
+	mode = node->attr.st.st_mode;
+	_MUTEX_UNLOCK(ll_node_mutex);
+	if (S_ISDIR(mode)) {
+		fuse_reply_err(req, EISDIR);
+		return;
+	}
+	file_info->direct_io = 1;
+	fuse_reply_open(req, file_info);
+}
+
+static void LL_read(fuse_req_t req, fuse_ino_t ino, size_t size, off_t offset, struct fuse_file_info *file_info)
+{
+	struct ll_node *node = LL_node_find(ino);
+	char *buffer;
+	SIZE_OR_ERROR return_size;
+	OWQ_allocate_struct_and_pointer(owq);
+
+	(void) file_info;
+	if (node == NULL) {
+		fuse_reply_err(req, ENOENT);
+		return;
+	}
+
+	if ( BAD( OWQ_create(node->path, owq) ) ) {	/* Can we parse the input string */
+		fuse_reply_err(req, ENOENT);
+		return;
+	}
+
+	if ( IsDir( PN(owq) ) ) { /* A directory of some kind */
+		OWQ_destroy(owq);
+		fuse_reply_err(req, EISDIR);
+		return;
+	}
+	if ( offset >= (off_t) FullFileLength( PN(owq) ) ) {
+		// useless read at end of file -- just return ok.
+		OWQ_destroy(owq);
+		fuse_reply_buf(req, NULL, 0);
+		return;
+	}
+
+	if ( size > MAX_OWSERVER_PROTOCOL_PAYLOAD_SIZE ) {
+		LEVEL_DEBUG( "Requested read length %ld will be trimmed to owfs max %ld",(long int) size, (long int) MAX_OWSERVER_PROTOCOL_PAYLOAD_SIZE ) ;
+		size = MAX_OWSERVER_PROTOCOL_PAYLOAD_SIZE ;
+	}
+	buffer = owmalloc(size);
+	if (buffer == NULL) {
+		OWQ_destroy(owq);
+		fuse_reply_err(req, ENOMEM);
+		return;
+	}
+	OWQ_assign_read_buffer(buffer, size, offset, owq);
+	return_size = FS_read_postparse(owq);
+	OWQ_destroy(owq);
+
+	if (return_size < 0) {
+		fuse_reply_err(req, -return_size);
+	} else {
+		fuse_reply_buf(req, buffer, return_size);
+	}
+	owfree(buffer);
+}
+
+static void LL_write(fuse_req_t req, fuse_ino_t ino, const char *buf, size_t size, off_t offset, struct fuse_file_info *file_info)
+{
+	struct ll_node *node = LL_node_find(ino);
+	SIZE_OR_ERROR return_size;
+
+	(void) file_info;
+	if (node == NULL) {
+		fuse_reply_err(req, ENOENT);
+		return;
+	}
+
+	return_size = FS_write(node->path, buf, size, offset);
+	if (return_size < 0) {
+		fuse_reply_err(req, -return_size);
+	} else {
+		fuse_reply_write(req, return_size);
+	}
+}
+
+static void LL_release(fuse_req_t req, fuse_ino_t ino, struct fuse_file_info *file_info)
+{
+	(void) ino;
+	(void) file_info;
+	fuse_reply_err(req, 0);
+}
+
+/* The whole listing is made at opendir, so readdir offsets stay consistent */
+static void LL_opendir(fuse_req_t req, fuse_ino_t ino, struct fuse_file_info *file_info)
+{
+	struct ll_node *node = LL_node_find(ino);
+	struct ll_dir *dir;
+	struct parsedname pn;
+
+	if (node == NULL) {
+		fuse_reply_err(req, ENOENT);
+		return;
+	}
+	LEVEL_CALL("OPENDIR path=%s", node->path);
+
+	if (FS_ParsedName(node->path, &pn) != 0) {
+		fuse_reply_err(req, ENOENT);
+		return;
+	}
+	if (pn.selected_filetype != NO_FILETYPE && !IsDir(&pn)) {
+		FS_ParsedName_destroy(&pn);
+		fuse_reply_err(req, ENOTDIR);
+		return;
+	}
+
+	dir = owcalloc(1, sizeof(struct ll_dir));
+	if (dir == NULL) {
+		FS_ParsedName_destroy(&pn);
+		fuse_reply_err(req, ENOMEM);
+		return;
+	}
+	dir->req = req;
+	LL_dir_add(dir, ".", S_IFDIR);
+	LL_dir_add(dir, "..", S_IFDIR);
+	/* Call directory spanning function */
+	FS_dir(LL_dir_callback, dir, &pn);
+	FS_ParsedName_destroy(&pn);
+
+	if (dir->error) {
+		SAFEFREE(dir->buf);
+		owfree(dir);
+		fuse_reply_err(req, ENOMEM);
+		return;
+	}
+	file_info->fh = (uint64_t) (uintptr_t) dir;
+	fuse_reply_open(req, file_info);
+}
+
+static void LL_readdir(fuse_req_t req, fuse_ino_t ino, size_t size, off_t offset, struct fuse_file_info *file_info)
+{
+	struct ll_dir *dir = (struct ll_dir *) (uintptr_t) file_info->fh;
+
+	(void) ino;
+	if (offset < 0 || (size_t) offset >= dir->size) {
+		fuse_reply_buf(req, NULL, 0);
+	} else {
+		// entries hold the offset of the next, so the kernel resumes at an entry
+		size_t remaining = dir->size - offset;
+		fuse_reply_buf(req, dir->buf + offset, (remaining < size) ? remaining : size);
+	}
+}
+
+static void LL_releasedir(fuse_req_t req, fuse_ino_t ino, struct fuse_file_info *file_info)
+{
+	struct ll_dir *dir = (struct ll_dir *) (uintptr_t) file_info->fh;
+
+	(void) ino;
+	SAFEFREE(dir->buf);
+	owfree(dir);
+	fuse_reply_err(req, 0);
+}
+
+/* ---------------------------------------------- */
+/* Directory listing                              */
+/* ---------------------------------------------- */
+	/* Callback function to FS_dir */
+	/* Adds this directory element (not the whole path) */
+static void LL_dir_callback(void *v, const struct parsedname *pn_entry)
+{
+	struct ll_dir *dir = v;
+
+	LL_dir_add(dir, FS_DirName(pn_entry), IsDir(pn_entry) ? S_IFDIR : S_IFREG);
+}
+
+static void LL_dir_add(struct ll_dir *dir, const char *name, mode_t mode)
+{
+	struct stat st;
+	size_t entry_size;
+
+	if (dir->error) {
+		return;
+	}
+
+	memset(&st, 0, sizeof(st));
+	st.st_ino = LL_UNKNOWN_INO;
+	st.st_mode = mode;
+
+	entry_size = fuse_add_direntry(dir->req, NULL, 0, name, NULL, 0);
+	if (dir->size + entry_size > dir->allocated) {
+		size_t allocated = dir->allocated + 4096 + entry_size;
+		char *buf = owrealloc(dir->buf, allocated);
+		if (buf == NULL) {
+			dir->error = 1;
+			return;
+		}
+		dir->buf = buf;
+		dir->allocated = allocated;
+	}
+	fuse_add_direntry(dir->req, dir->buf + dir->size, entry_size, name, &st, dir->size + entry_size);
+	dir->size += entry_size;
+}
+
+/* ---------------------------------------------- */
+/* Node table                                     */
+/* ---------------------------------------------- */
+static int LL_ino_compare(const void *a, const void *b)
+{
+	fuse_ino_t ino_a = ((const struct ll_node *) a)->ino;
+	fuse_ino_t ino_b = ((const struct ll_node *) b)->ino;
+
+	return (ino_a < ino_b) ? -1 : (ino_a > ino_b);
+}
+
+static int LL_path_compare(const void *a, const void *b)
+{
+	return strcmp(((const struct ll_node *) a)->path, ((const struct ll_node *) b)->path);
+}
+
+/* The root is never forgotten */
+static GOOD_OR_BAD LL_node_setup(void)
+{
+	struct ll_node *root = owcalloc(1, sizeof(struct ll_node) + 2);
+
+	if (root == NULL) {
+		return gbBAD;
+	}
+	_MUTEX_INIT(ll_node_mutex);
+	strcpy(LL_NODE_PATH(root), "/");
+	root->path = LL_NODE_PATH(root);
+	root->ino = FUSE_ROOT_ID;
+	root->nlookup = 1;
+	if (tsearch(root, &ll_path_tree, LL_path_compare) == NULL || tsearch(root, &ll_ino_tree, LL_ino_compare) == NULL) {
+		return gbBAD;
+	}
+	return gbGOOD;
+}
+
+/* tdestroy for the tree that doesn't own the nodes */
+static void LL_node_keep(void *node)
+{
+	(void) node;
+}
+
+static void LL_node_cleanup(void)
+{
+	// the path tree shares the nodes
+	SAFETDESTROY(ll_path_tree, LL_node_keep);
+	SAFETDESTROY(ll_ino_tree, owfree_func);
+	_MUTEX_DESTROY(ll_node_mutex);
+}
+
+/* The kernel holds a reference, so the node stays while it is used */
+static struct ll_node *LL_node_find(fuse_ino_t ino)
+{
+	struct ll_node key;
+	void *found;
+
+	key.ino = ino;
+	_MUTEX_LOCK(ll_node_mutex);
+	found = tfind(&key, &ll_ino_tree, LL_ino_compare);
+	_MUTEX_UNLOCK(ll_node_mutex);
+
+	return (found == NULL) ? NULL : *(struct ll_node **) found;
+}
+
+static void LL_node_forget(fuse_ino_t ino, uint64_t nlookup)
+{
+	struct ll_node key;
+	struct ll_node *node = NULL;
+	void *found;
+
+	key.ino = ino;
+	_MUTEX_LOCK(ll_node_mutex);
+	found = tfind(&key, &ll_ino_tree, LL_ino_compare);
+	if (found != NULL) {
+		node = *(struct ll_node **) found;
+		if (node->nlookup > nlookup) {
+			node->nlookup -= nlookup;
+			node = NULL;
+		} else if (node->ino == FUSE_ROOT_ID) {
+			node = NULL;
+		} else {
+			tdelete(node, &ll_ino_tree, LL_ino_compare);
+			tdelete(node, &ll_path_tree, LL_path_compare);
+		}
+	}
+	_MUTEX_UNLOCK(ll_node_mutex);
+
+	if (node != NULL) {
+		owfree(node);
+	}
+}
+
+/* Attributes from the node, parsing again if they are stale */
+static ZERO_OR_ERROR LL_refresh(struct ll_node *node, struct ll_attr *attr)
+{
+	_MUTEX_LOCK(ll_node_mutex);
+	memcpy(attr, &node->attr, sizeof(struct ll_attr));
+	_MUTEX_UNLOCK(ll_node_mutex);
+
+	if (attr->checked == 0 || difftime(NOW_TIME, attr->checked) >= attr->attr_timeout) {
+		ZERO_OR_ERROR return_code = LL_parse(node->path, attr);
+		if (return_code != 0) {
+			return return_code;
+		}
+		_MUTEX_LOCK(ll_node_mutex);
+		memcpy(&node->attr, attr, sizeof(struct ll_attr));
+		_MUTEX_UNLOCK(ll_node_mutex);
+	}
+	return 0;
+}
+
+static ZERO_OR_ERROR LL_parse(const char *path, struct ll_attr *attr)
+{
+	struct parsedname pn;
+	ZERO_OR_ERROR return_code;
+
+	if (FS_ParsedName(path, &pn) != 0) {
+		return -ENOENT;
+	}
+	return_code = FS_fstat_postparse(&attr->st, &pn);
+	attr->attr_timeout = LL_timeout(&pn);
+	if (pn.selected_filetype == NO_FILETYPE || IsUncachedDir(&pn)) {
+		// root, bus and device directories come and go with the device list
+		attr->entry_timeout = attr->attr_timeout;
+	} else {
+		// a device's property names don't change
+		attr->entry_timeout = LL_STATIC_TIMEOUT;
+	}
+	attr->checked = NOW_TIME;
+	FS_ParsedName_destroy(&pn);
+	return return_code;
+}
+
+/* How long the kernel may keep attributes, from the property's volatility */
+static double LL_timeout(const struct parsedname *pn)
+{
+	if (IsUncachedDir(pn)) {
+		return 0.;
+	}
+	if (pn->selected_filetype == NO_FILETYPE) {
+		return (double) Globals.timeout_directory;
+	}
+	switch (pn->selected_filetype->format) {
+	case ft_directory:
+	case ft_subdir:
+		return LL_STATIC_TIMEOUT;
+	default:
+		break;
+	}
+	switch (pn->selected_filetype->change) {
+	case fc_static:
+	case fc_link:
+	case fc_page:
+	case fc_subdir:
+		return LL_STATIC_TIMEOUT;
+	case fc_stable:
+	case fc_read_stable:
+		return (double) Globals.timeout_stable;
+	case fc_volatile:
+	case fc_simultaneous_temperature:
+	case fc_simultaneous_voltage:
+		return (double) Globals.timeout_volatile;
+	case fc_directory:
+		return (double) Globals.timeout_directory;
+	case fc_presence:
+		return (double) Globals.timeout_presence;
+	case fc_uncached:
+	case fc_second:
+	case fc_statistic:
+	case fc_persistent:
+	default:
+		return 0.;
+	}
+}
+
+#endif							/* OWFS_LOWLEVEL */
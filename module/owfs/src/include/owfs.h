@@ -22,7 +22,13 @@
 
 //#define FUSE_USE_VERSION 26
 // FUSE_USE_VERSION is set from configure script
+#if FUSE_USE_VERSION >= 30
+/* libfuse3 -- low-level (inode) interface, see owfs_lowlevel.c */
+#define OWFS_LOWLEVEL
+#include <fuse_lowlevel.h>
+#else							/* FUSE_USE_VERSION < 30 */
 #include <fuse.h>
+#endif							/* FUSE_USE_VERSION */
 #ifndef FUSE_VERSION
 #ifndef FUSE_MAJOR_VERSION
 #define FUSE_VERSION 11
@@ -33,7 +39,9 @@
 #endif							/* FUSE_MAJOR_VERSION */
 #endif							/* FUSE_VERSION */
 
+#ifndef OWFS_LOWLEVEL
 extern struct fuse_operations owfs_oper;
+#endif							/* OWFS_LOWLEVEL */
 
 struct Fuse_option {
 	int allocated_slots;
@@ -47,4 +55,8 @@ int Fuse_parse(char *opts, struct Fuse_option *fo);
 int Fuse_add(char *opt, struct Fuse_option *fo);
 char *Fuse_arg(char *opt_arg, char *entryname);
 
+#ifdef OWFS_LOWLEVEL
+int Fuse_lowlevel_main(struct Fuse_option *fo);
+#endif							/* OWFS_LOWLEVEL */
+
 #endif							/* OWFS_H */
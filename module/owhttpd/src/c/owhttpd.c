@@ -105,12 +105,39 @@ int main(int argc, char *argv[])
 	return 0;
 }
 
+/* Serve requests on one connection until the client or a limit closes it.
+ * Requests are read through stdio; responses are written straight to the socket */
 static void Acceptor(int listenfd)
 {
-	FILE *fp = fdopen(listenfd, "w+");
-	if (fp) {
-		handle_socket(fp);
-		fflush(fp);
-		fclose(fp);
+	// separate descriptor for the stream, the server closes listenfd itself
+	FILE_DESCRIPTOR_OR_ERROR readfd = dup(listenfd);
+	FILE *fp;
+	int requests = 0;
+
+	if ( FILE_DESCRIPTOR_NOT_VALID(readfd) ) {
+		return;
+	}
+	fp = fdopen(readfd, "r");
+	if (fp == NULL) {
+		close(readfd);
+		return;
+	}
+
+	while ( handle_socket(fp, listenfd, Globals.http_keepalive > 0 && ++requests < Globals.http_max_requests) ) {
+		int c;
+
+		if ( requests == 1 ) {
+			// idle timeout between requests
+			struct timeval tv = { Globals.http_keepalive, 0, };
+			setsockopt(listenfd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+		}
+		// wait for the next request (pipelined ones are already buffered)
+		c = getc(fp);
+		if (c == EOF) {
+			LEVEL_DEBUG("http connection closed or idle after %d requests", requests);
+			break;
+		}
+		ungetc(c, fp);
 	}
+	fclose(fp);
 }
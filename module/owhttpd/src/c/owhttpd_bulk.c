@@ -0,0 +1,336 @@
+/*
+ * http.c for owhttpd (1-wire web server)
+ * By Paul Alfille 2003, using libow
+ * offshoot of the owfs ( 1wire file system )
+ *
+ * GPL license ( Gnu Public Lincense )
+ *
+ * Based on chttpd. copyright(c) 0x7d0 greg olszewski <noop@nwonknu.org>
+ *
+ */
+
+/* Bulk read: /json/bulk/path?depth=n
+ * Every readable property under path, as one JSON object of path : value
+ * Each slice handed to FS_read_many takes properties from every bus in turn,
+ * so reads on different buses run at the same time (on the library's read pool)
+ * and the document is sent in chunks as the values come in */
+
+#include "owhttpd.h"
+
+/* Reads handed to FS_read_many at a time (and output between chunks)
+ * FS_read_many sorts them by bus and device again */
+#define BULK_SLICE 16
+
+struct bulk_entry {
+	char * path ;
+	int bus ;					// bus index, -1 if not known
+} ;
+
+struct bulk_control {
+	struct OutputControl * oc ;
+	struct bulk_entry * entry ;
+	int count ;
+	int allocated ;
+	struct parsedname * pn_start ;	// top of the walk
+} ;
+
+struct bulk_bus {
+	int first ;					// run of entries for this bus
+	int count ;
+	int done ;					// entries already put in a slice
+} ;
+
+struct bulk_dir {
+	struct bulk_control * bc ;
+	char ** path ;				// subdirectories to walk next
+	int count ;
+	int allocated ;
+	int descend ;
+	int bus ;					// where the directory itself was found
+} ;
+
+static void BulkWalk( struct bulk_control * bc, const char * path, int depth ) ;
+static void BulkWalkCallback( void * v, const struct parsedname * pn_entry ) ;
+static int BulkDescend( const struct parsedname * pn_start, const struct parsedname * pn_entry ) ;
+static void BulkAdd( struct bulk_control * bc, const struct parsedname * pn_entry, int bus ) ;
+static int BulkOrder( const void * a, const void * b ) ;
+static void BulkSlice( struct bulk_control * bc, struct bulk_entry ** entry, int slice ) ;
+static void BulkShow( struct OutputControl * oc, const char * path, struct one_wire_query * owq, SIZE_OR_ERROR read_or_error ) ;
+static void BulkString( FILE * out, const char * data, size_t length ) ;
+
+/* The path part of a bulk request URL, or NULL if it isn't one */
+const char * BulkPath( const char * file )
+{
+	if ( file == NULL || strncasecmp( file, "/json/bulk", 10 ) != 0 ) {
+		return NULL ;
+	}
+	switch ( file[10] ) {
+		case '\0':
+			return "/" ;
+		case '/':
+			return &file[10] ;
+		default:
+			return NULL ;
+	}
+}
+
+void ShowBulk( struct OutputControl * oc, struct parsedname * pn, int depth )
+{
+	struct bulk_control bc ;
+	struct bulk_bus * bus ;
+	int buses = 0 ;
+	int i ;
+
+	memset( &bc, 0, sizeof(struct bulk_control) ) ;
+	bc.oc = oc ;
+	bc.pn_start = pn ;
+
+	HTTPstart( oc, "200 OK", ct_json ) ;
+	JSON_dir_init( oc ) ;
+	fprintf( oc->out, "{\n" ) ;
+	// headers out now, the reads may take a while
+	HTTPflush( oc ) ;
+
+	if ( IsDir( pn ) ) {
+		BulkWalk( &bc, pn->path, depth ) ;
+	} else {
+		BulkAdd( &bc, pn, -1 ) ;
+	}
+	LEVEL_DEBUG( "Bulk read of %d properties under %s", bc.count, pn->path ) ;
+
+	// one run of entries per bus
+	qsort( bc.entry, bc.count, sizeof(struct bulk_entry), BulkOrder ) ;
+	bus = owcalloc( bc.count + 1, sizeof(struct bulk_bus) ) ;
+	if ( bus != NULL ) {
+		int left = bc.count ;
+
+		for ( i = 0 ; i < bc.count ; ++i ) {
+			if ( i == 0 || bc.entry[i].bus != bc.entry[i-1].bus ) {
+				bus[buses].first = i ;
+				++buses ;
+			}
+			++bus[buses-1].count ;
+		}
+
+		// each slice takes from every bus in turn
+		while ( left > 0 ) {
+			struct bulk_entry * slice_entry[BULK_SLICE] ;
+			int slice = 0 ;
+
+			while ( slice < BULK_SLICE && slice < left ) {
+				for ( i = 0 ; i < buses && slice < BULK_SLICE ; ++i ) {
+					if ( bus[i].done < bus[i].count ) {
+						slice_entry[slice++] = &bc.entry[bus[i].first + bus[i].done] ;
+						++bus[i].done ;
+					}
+				}
+			}
+			BulkSlice( &bc, slice_entry, slice ) ;
+			left -= slice ;
+		}
+		owfree( bus ) ;
+	}
+
+	JSON_dir_finish( oc ) ;
+	fprintf( oc->out, "}\n" ) ;
+
+	for ( i = 0 ; i < bc.count ; ++i ) {
+		owfree( bc.entry[i].path ) ;
+	}
+	SAFEFREE( bc.entry ) ;
+}
+
+/* Collect the properties under path, and below for depth levels */
+static void BulkWalk( struct bulk_control * bc, const char * path, int depth )
+{
+	struct parsedname s_pn ;
+	struct bulk_dir bd ;
+	int i ;
+
+	if ( FS_ParsedName( path, &s_pn ) != 0 ) {
+		return ;
+	}
+	memset( &bd, 0, sizeof(struct bulk_dir) ) ;
+	bd.bc = bc ;
+	bd.descend = ( depth > 1 ) ;
+	// entries listed by an owserver don't carry the bus, but the device was located while parsing
+	bd.bus = KnownBus(&s_pn) ? s_pn.selected_connection->index : -1 ;
+	FS_dir( BulkWalkCallback, &bd, &s_pn ) ;
+	FS_ParsedName_destroy( &s_pn ) ;
+
+	// FS_dir isn't reentrant, so subdirectories are walked afterward
+	for ( i = 0 ; i < bd.count ; ++i ) {
+		BulkWalk( bc, bd.path[i], depth - 1 ) ;
+		owfree( bd.path[i] ) ;
+	}
+	SAFEFREE( bd.path ) ;
+}
+
+static void BulkWalkCallback( void * v, const struct parsedname * pn_entry )
+{
+	struct bulk_dir * bd = v ;
+
+	if ( ! IsDir( pn_entry ) ) {
+		if ( pn_entry->selected_filetype->read != NO_READ_FUNCTION ) {
+			BulkAdd( bd->bc, pn_entry, bd->bus ) ;
+		}
+		return ;
+	}
+
+	if ( ! bd->descend || ! BulkDescend( bd->bc->pn_start, pn_entry ) ) {
+		return ;
+	}
+	if ( bd->count == bd->allocated ) {
+		int allocated = bd->allocated + 32 ;
+		char ** path = owrealloc( bd->path, allocated * sizeof(char *) ) ;
+		if ( path == NULL ) {
+			return ;
+		}
+		bd->path = path ;
+		bd->allocated = allocated ;
+	}
+	bd->path[bd->count] = owstrdup( pn_entry->path ) ;
+	if ( bd->path[bd->count] != NULL ) {
+		++bd->count ;
+	}
+}
+
+/* Stay within the kind of directory asked for.
+ * From the root that means devices, not statistics, settings, uncached copies, the bus.n views or the simultaneous triggers */
+static int BulkDescend( const struct parsedname * pn_start, const struct parsedname * pn_entry )
+{
+	if ( pn_entry->type != pn_start->type ) {
+		return 0 ;
+	}
+	if ( (pn_entry->state & (ePS_uncached | ePS_alarm)) != (pn_start->state & (ePS_uncached | ePS_alarm)) ) {
+		return 0 ;
+	}
+	if ( pn_entry->selected_device == NO_DEVICE && SpecifiedBus(pn_entry) && ! SpecifiedBus(pn_start) ) {
+		return 0 ;
+	}
+	if ( pn_entry->selected_device == DeviceSimultaneous ) {
+		return 0 ;
+	}
+	return 1 ;
+}
+
+static void BulkAdd( struct bulk_control * bc, const struct parsedname * pn_entry, int bus )
+{
+	if ( bc->count == bc->allocated ) {
+		int allocated = bc->allocated + 128 ;
+		struct bulk_entry * entry = owrealloc( bc->entry, allocated * sizeof(struct bulk_entry) ) ;
+		if ( entry == NULL ) {
+			return ;
+		}
+		bc->entry = entry ;
+		bc->allocated = allocated ;
+	}
+	bc->entry[bc->count].path = owstrdup( pn_entry->path ) ;
+	if ( bc->entry[bc->count].path == NULL ) {
+		return ;
+	}
+	bc->entry[bc->count].bus = KnownBus(pn_entry) ? pn_entry->selected_connection->index : bus ;
+	++bc->count ;
+}
+
+/* qsort order: bus, then path (keeps each device's properties together) */
+static int BulkOrder( const void * a, const void * b )
+{
+	const struct bulk_entry * entry_a = a ;
+	const struct bulk_entry * entry_b = b ;
+
+	if ( entry_a->bus != entry_b->bus ) {
+		return entry_a->bus < entry_b->bus ? -1 : 1 ;
+	}
+	return strcmp( entry_a->path, entry_b->path ) ;
+}
+
+/* Read a slice of properties together and send them */
+static void BulkSlice( struct bulk_control * bc, struct bulk_entry ** entry, int slice )
+{
+	struct one_wire_query * owq[BULK_SLICE] ;
+	struct one_wire_query * owq_read[BULK_SLICE] ;
+	SIZE_OR_ERROR result[BULK_SLICE] ;
+	int reads = 0 ;
+	int i ;
+
+	for ( i = 0 ; i < slice ; ++i ) {
+		owq[i] = HTTPquery( bc->oc, entry[i]->path ) ; // for read
+		if ( owq[i] != NULL && BAD( OWQ_allocate_read_buffer( owq[i] ) ) ) {
+			OWQ_destroy( owq[i] ) ;
+			owq[i] = NULL ;
+		}
+		if ( owq[i] != NULL ) {
+			owq_read[reads++] = owq[i] ;
+		}
+	}
+
+	// through the cache, so fresh values don't touch the bus
+	FS_read_many( owq_read, result, reads ) ;
+
+	for ( i = 0, reads = 0 ; i < slice ; ++i ) {
+		BulkShow( bc->oc, entry[i]->path, owq[i], owq[i] == NULL ? -ENOENT : result[reads++] ) ;
+	}
+	HTTPflush( bc->oc ) ;
+
+	for ( i = 0 ; i < slice ; ++i ) {
+		if ( owq[i] != NULL ) {
+			OWQ_destroy( owq[i] ) ;
+		}
+	}
+}
+
+/* "path":{"value":"..."} or "path":{"error":"..."} */
+static void BulkShow( struct OutputControl * oc, const char * path, struct one_wire_query * owq, SIZE_OR_ERROR read_or_error )
+{
+	FILE * out = oc->out ;
+
+	JSON_dir_entry( oc, "%s", "" ) ;
+	BulkString( out, path, strlen(path) ) ;
+	if ( read_or_error < 0 ) {
+		const char * error = strerror( -read_or_error ) ;
+		fprintf( out, ":{\"error\":" ) ;
+		BulkString( out, error, strlen(error) ) ;
+	} else if ( PN(owq)->selected_filetype->format == ft_binary ) {
+		int i ;
+		fprintf( out, ":{\"value\":\"" ) ;
+		for ( i = 0 ; i < read_or_error ; ++i ) {
+			fprintf( out, "%.2hhX", OWQ_buffer(owq)[i] ) ;
+		}
+		fprintf( out, "\"" ) ;
+	} else {
+		fprintf( out, ":{\"value\":" ) ;
+		BulkString( out, OWQ_buffer(owq), read_or_error ) ;
+	}
+	if ( read_or_error >= 0 && ( PN(owq)->control_flags & STALE_SERVED ) ) {
+		// expired value (?stale), being refreshed
+		fprintf( out, ",\"stale\":true" ) ;
+	}
+	fprintf( out, "}" ) ;
+}
+
+/* JSON string with escapes */
+static void BulkString( FILE * out, const char * data, size_t length )
+{
+	size_t i ;
+
+	fputc( '"', out ) ;
+	for ( i = 0 ; i < length ; ++i ) {
+		unsigned char c = data[i] ;
+		switch ( c ) {
+			case '"':
+			case '\\':
+				fputc( '\\', out ) ;
+				fputc( c, out ) ;
+				break ;
+			default:
+				if ( c < 0x20 ) {
+					fprintf( out, "\\u%.4X", c ) ;
+				} else {
+					fputc( c, out ) ;
+				}
+				break ;
+		}
+	}
+	fputc( '"', out ) ;
+}
@@ -22,9 +22,13 @@ struct urlparse {
 	char *version;
 	char *request;
 	char *value;
+	int stale;		// ?stale -- expired values are acceptable
 };
 
-enum http_return { http_ok, http_dir, http_icon, http_400, http_404 } ;
+enum http_return { http_ok, http_dir, http_icon, http_bulk, http_400, http_404 } ;
+
+/* Default levels read by /json/bulk */
+#define BULK_DEPTH 2
 
 	/* Error page functions */
 enum content_type PoorMansParser( char * bad_url ) ;
@@ -33,6 +37,7 @@ static void Bad404( struct OutputControl * oc, const enum content_type ct);
 
 /* URL parsing function */
 static void URLparse(struct urlparse *up);
+static int StaleParameter( char * query ) ;
 static enum http_return handle_GET( struct OutputControl * oc, struct urlparse * up) ;
 static enum http_return handle_POST( struct OutputControl * oc, struct urlparse * up) ;
 static void ReadToCRLF( struct OutputControl * oc ) ;
@@ -40,25 +45,42 @@ static void TrimBoundary( char ** boundary ) ;
 static int GetPostData( char * boundary, struct memblob * mb, struct OutputControl * oct ) ;
 static char * GetPostPath(  struct OutputControl * oc ) ;
 static GOOD_OR_BAD GetHostURL( struct OutputControl * oc ) ;
+static void ConnectionHeader( struct OutputControl * oc, const char * line ) ;
 
 /* --------------- Functions ---------------- */
 
-/* Main handler for a web page */
-int handle_socket(FILE * out)
+/* Main handler for a web page
+ * keep_alive -- the connection may be kept for another request
+ * returns non-zero if the client can send another request on this connection */
+int handle_socket(FILE * in, FILE_DESCRIPTOR_OR_ERROR file_descriptor, int keep_alive)
 {
 	enum http_return http_code ;
 	enum content_type pmp = ct_html;
+	int bulk_depth = BULK_DEPTH ;
 
 	struct urlparse up;
 	
-	struct OutputControl s_oc = { out, 0, NULL, NULL, } ;
+	struct OutputControl s_oc ;
 	struct OutputControl * oc = &s_oc ;
 
 	struct parsedname s_pn;
 	struct parsedname * pn = &s_pn ;
 	
+	memset( oc, 0, sizeof(struct OutputControl) ) ;
+	oc->in = in ;
+	oc->file_descriptor = file_descriptor ;
+	oc->status = "500 Internal Server Error" ;
+	oc->ct = ct_text ;
+
+	// The response body is built in memory so it can be sent with its length
+	oc->out = open_memstream( &(oc->body), &(oc->body_length) ) ;
+	if ( oc->out == NULL ) {
+		LEVEL_DEBUG("Cannot buffer the http response");
+		return 0 ;
+	}
+
 	up.line = NULL ; // prep for getline with null. Will be allocated by getline.
-	if ( getline(&(up.line), &(up.line_length), out) >= 0 ) {
+	if ( getline(&(up.line), &(up.line_length), in) >= 0 ) {
 		LEVEL_CALL("PreParse line=%s", up.line);
 		URLparse(&up);				/* Break up URL */
 		httpunescape((BYTE *) up.file    );
@@ -71,6 +93,8 @@ int handle_socket(FILE * out)
 		);
 
 		oc->base_url = owstrdup( up.file==NULL ? "" : up.file ) ;
+		oc->control_flags = up.stale ? STALE_OK : 0 ;
+		oc->http_1_1 = ( up.version != NULL && strncmp( up.version, "HTTP/1.", 7 ) == 0 && strcmp( up.version, "HTTP/1.0" ) != 0 ) ;
 
 		if ( BAD( GetHostURL(oc) ) ) {
 			// No command line in request
@@ -90,6 +114,19 @@ int handle_socket(FILE * out)
 			ReadToCRLF(oc) ;
 			pn = NO_PARSEDNAME ;
 			http_code = http_icon ;
+		} else if (BulkPath(up.file) != NULL) {
+			// every property under a path
+			LEVEL_DEBUG("http bulk request.");
+			ReadToCRLF(oc) ;
+			if ( up.request != NULL && strcasecmp(up.request, "depth") == 0 && up.value != NULL ) {
+				bulk_depth = atoi(up.value) ;
+			}
+			if (FS_ParsedName(BulkPath(up.file), pn) != 0) {
+				pn = NO_PARSEDNAME ;
+				http_code = http_404 ;
+			} else {
+				http_code = http_bulk ;
+			}
 		} else 	if (FS_ParsedName(up.file, pn) != 0) {
 			// Can't understand the file name = URL
 			LEVEL_DEBUG("http %s not understood.",up.file);
@@ -136,6 +173,28 @@ int handle_socket(FILE * out)
 				// not an error
 				break ;
 		}
+
+		// Persistent connection? HTTP/1.1 by default, HTTP/1.0 only if asked.
+		// A bad request or POST upload may leave unread data, so close after those.
+		switch ( http_code ) {
+			case http_400:
+				break ;
+			default:
+				if ( up.version == NULL || strcmp(up.cmd, "POST") == 0 ) {
+					break ;
+				}
+				switch ( oc->connection ) {
+					case connection_close:
+						break ;
+					case connection_keep_alive:
+						oc->keep_alive = keep_alive ;
+						break ;
+					case connection_default:
+						oc->keep_alive = keep_alive && oc->http_1_1 ;
+						break ;
+				}
+				break ;
+		}
 		// allocated by getline
 		free(up.line) ;
 	} else {
@@ -144,9 +203,6 @@ int handle_socket(FILE * out)
 		http_code = http_400 ;
 	}
 
-	// This is necessary for SunOS
-	fflush(out);
-	
 	switch ( http_code ) {
 		case http_icon:
 			Favicon(oc);
@@ -160,6 +216,9 @@ int handle_socket(FILE * out)
 		case http_dir:
 			ShowDir(oc, pn);
 			break ;
+		case http_bulk:
+			ShowBulk(oc, pn, bulk_depth);
+			break ;
 		case http_ok:
 			ShowDevice(oc, pn);
 			break ;
@@ -168,6 +227,10 @@ int handle_socket(FILE * out)
 		FS_ParsedName_destroy(pn);
 	}
 	
+	HTTPfinish(oc) ;
+	fclose( oc->out ) ;
+	free( oc->body ) ; // allocated by open_memstream with malloc, not owmalloc
+
 	if ( oc->base_url != NULL ) {
 		owfree( oc->base_url ) ;
 	}
@@ -175,7 +238,7 @@ int handle_socket(FILE * out)
 		owfree( oc->host ) ;
 	}
 	
-	return 0 ;
+	return oc->keep_alive ;
 }	
 
 /* The HTTP request is a GET message */
@@ -235,7 +298,7 @@ static enum http_return handle_GET( struct OutputControl * oc, struct urlparse *
 /* The HTTP request is a POST message */
 static enum http_return handle_POST( struct OutputControl * oc, struct urlparse * up)
 {
-	FILE* out = oc->out ;
+	FILE* in = oc->in ;
 	enum http_return http_code = http_404 ; // default error mode
 
 	char * boundary = NULL ;
@@ -247,7 +310,7 @@ static enum http_return handle_POST( struct OutputControl * oc, struct urlparse
 	}
 	
 	// use getline because it handles null chars
-	if ( getline(&boundary,&boundary_length,out) > 2 ) {
+	if ( getline(&boundary,&boundary_length,in) > 2 ) {
 		char * post_path  = GetPostPath( oc ) ;
 
 		TrimBoundary( &boundary) ;
@@ -291,6 +354,7 @@ static void URLparse(struct urlparse *up)
 	char * extension ;
 
 	up->cmd = up->version = up->file = up->request = up->value = NULL;
+	up->stale = 0 ;
 	
 	/* Special case for sparse array
 	 * Substitute "/" for "?EXTENSION=" 
@@ -342,6 +406,14 @@ static void URLparse(struct urlparse *up)
 			*str = '\0';
 	}
 
+	/* "stale" can go along with any other FORM field, so take it out first */
+	if (up->request) {
+		up->stale = StaleParameter( up->request ) ;
+		if ( up->request[0] == '\0' ) {
+			up->request = NULL ;
+		}
+	}
+
 	/* Separate out the FORM field and value */
 	if (up->request) {
 		for (str = up->request; *str; str++) {
@@ -370,6 +442,37 @@ static void URLparse(struct urlparse *up)
 	LEVEL_DEBUG("URL parse file=%s, request=%s, value=%s", SAFESTRING(up->file), SAFESTRING(up->request), SAFESTRING(up->value));
 }
 
+/* Remove "stale" or "stale=value" from the '&' separated query
+ * returns 1 if it was there (and not "stale=0") */
+static int StaleParameter( char * query )
+{
+	char * field = query ;
+	int stale = 0 ;
+
+	while ( field[0] != '\0' ) {
+		char * next = strchr( field, '&' ) ;
+		size_t length = ( next == NULL ) ? strlen( field ) : (size_t) ( next - field ) ;
+
+		if ( ( length == 5 || ( length > 5 && field[5] == '=' ) ) && strncasecmp( field, "stale", 5 ) == 0 ) {
+			stale = ( length <= 6 || field[6] != '0' ) ;
+			// close up the gap (with its '&')
+			if ( next == NULL ) {
+				if ( field > query ) {
+					--field ; // the '&' before
+				}
+				field[0] = '\0' ;
+			} else {
+				memmove( field, &next[1], strlen( &next[1] ) + 1 ) ;
+			}
+			continue ;
+		}
+		if ( next == NULL ) {
+			break ;
+		}
+		field = &next[1] ;
+	}
+	return stale ;
+}
 
 static void Bad400(struct OutputControl * oc, const enum content_type ct)
 {
@@ -420,17 +523,18 @@ static void Bad404(struct OutputControl * oc, const enum content_type ct)
 
 static void ReadToCRLF( struct OutputControl * oc )
 {
-	FILE * out = oc->out ;
+	FILE * in = oc->in ;
 	char * text_in = NULL ;
 	size_t length_in = 0 ;
 	ssize_t getline_length ;
 
 	/* read lines until blank */
-	while ( (getline_length = getline(&text_in, &length_in, out)) > 0 )  {
+	while ( (getline_length = getline(&text_in, &length_in, in)) > 0 )  {
 		LEVEL_DEBUG("More (%d) data:%s",(int)getline_length,text_in);
 		if ( strcmp(text_in, "\r\n")==0 || strcmp(text_in, "\n")==0 ) {
 			break ;
 		}
+		ConnectionHeader( oc, text_in ) ;
 	}
 	
 	
@@ -456,13 +560,13 @@ static void TrimBoundary( char ** boundary )
 
 static char * GetPostPath(struct OutputControl * oc )
 {
-	FILE * out = oc->out ;
+	FILE * in = oc->in ;
 	char * text_in = NULL ;
 	size_t length_in = 0 ;
 	char * path_found = NO_PATH ;
 	
 	/* read lines until blank */
-	while (getline(&text_in, &length_in, out)>-1)  {
+	while (getline(&text_in, &length_in, in)>-1)  {
 		char * namestart ;
 		LEVEL_DEBUG("Post data:%s",SAFESTRING(text_in));
 		if ( strcmp(text_in, "\r\n")==0 || strcmp(text_in, "\n")==0 ) {
@@ -493,14 +597,14 @@ static char * GetPostPath(struct OutputControl * oc )
 // read data from file upload
 static int GetPostData( char * boundary, struct memblob * mb, struct OutputControl * oc )
 {
-	FILE * out = oc->out ;
+	FILE * in = oc->in ;
 	char * data = NULL ;
 	size_t data_length ;
 
 	ssize_t read_this_pass ;
 
 	MemblobInit( mb, 1000 ) ; // increqment in 1K amounts (arbitrary)
-	while ( (read_this_pass = getline(&data, &data_length, out)) > -1 ) {
+	while ( (read_this_pass = getline(&data, &data_length, in)) > -1 ) {
 		Debug_Bytes(boundary,(BYTE *)data,(size_t)read_this_pass);
 		if ( strstr( data, boundary ) != NULL ) {
 			free(data) ; // allocated by getline with malloc, not owmalloc
@@ -546,7 +650,7 @@ enum content_type PoorMansParser( char * bad_url )
 			
 static GOOD_OR_BAD GetHostURL( struct OutputControl * oc )
 {
-	FILE * out = oc->out ;
+	FILE * in = oc->in ;
 	char * line = NULL ;
 	static regex_t rx_host ;
 	struct ow_regmatch orm ;
@@ -558,7 +662,8 @@ static GOOD_OR_BAD GetHostURL( struct OutputControl * oc )
 	do {
 		size_t s ;
 
-		if ( getline( &line, &s, out ) < 0 ) {
+		if ( getline( &line, &s, in ) < 0 || strcmp(line, "\r\n")==0 || strcmp(line, "\n")==0 ) {
+			// end of headers -- don't read into the next request
 			free( line ) ;
 			LEVEL_DEBUG("Couldn't find Host: line in HTTP header") ;
 			return gbBAD ;
@@ -566,6 +671,7 @@ static GOOD_OR_BAD GetHostURL( struct OutputControl * oc )
 		LEVEL_DEBUG("Test line <%s>",line ) ;
 		if ( ow_regexec( &rx_host, line, &orm ) != 0 ) {
 			LEVEL_DEBUG("No match <%s>",line) ;
+			ConnectionHeader( oc, line ) ;
 			continue ;
 		}
 		oc->host = owstrdup( orm.match[1] ) ;
@@ -574,3 +680,19 @@ static GOOD_OR_BAD GetHostURL( struct OutputControl * oc )
 		return gbGOOD ;				
 	} while (1) ;
 }
+
+// Note a "Connection: close" or "Connection: keep-alive" header line
+static void ConnectionHeader( struct OutputControl * oc, const char * line )
+{
+	static regex_t rx_close ;
+	static regex_t rx_keep_alive ;
+
+	ow_regcomp( &rx_close, "^connection *:.*close", REG_ICASE | REG_NOSUB ) ;
+	ow_regcomp( &rx_keep_alive, "^connection *:.*keep-alive", REG_ICASE | REG_NOSUB ) ;
+
+	if ( ow_regexec( &rx_close, line, NULL ) == 0 ) {
+		oc->connection = connection_close ;
+	} else if ( ow_regexec( &rx_keep_alive, line, NULL ) == 0 ) {
+		oc->connection = connection_keep_alive ;
+	}
+}
@@ -15,38 +15,152 @@
 
 /* ------------ Protoypes ---------------- */
 
+#define HTTP_HEADER_LENGTH 512
+
+static size_t HTTPheaders( struct OutputControl * oc, char * header, size_t header_size ) ;
+static void HTTPsend( struct OutputControl * oc, int last ) ;
+static void HTTPwritev( struct OutputControl * oc, struct iovec * io, int nio ) ;
+
 	/* Utility HTML page display functions */
+/* The response is only started here. Headers go out with the body
+ * (HTTPfinish) once its length is known, or with the first chunk (HTTPflush) */
 void HTTPstart(struct OutputControl * oc, const char *status, const enum content_type ct)
 {
-	FILE * out = oc->out ;
+	oc->status = status ;
+	oc->ct = ct ;
+}
+
+/* Send the body so far as a chunk, for responses that take a while to build.
+ * An HTTP/1.0 client can't take chunks, so its response is ended by closing the connection */
+void HTTPflush(struct OutputControl * oc)
+{
+	HTTPsend( oc, 0 ) ;
+}
+
+/* Send the rest of the response */
+void HTTPfinish(struct OutputControl * oc)
+{
+	HTTPsend( oc, 1 ) ;
+}
+
+static void HTTPsend( struct OutputControl * oc, int last )
+{
+	char header[HTTP_HEADER_LENGTH] ;
+	size_t header_length = 0 ;
+	char trailer[8] = "" ;
+	struct iovec io[3] ;
+
+	fflush( oc->out ) ;
+
+	if ( oc->header_sent == 0 ) {
+		if ( last ) {
+			// whole body in hand
+			oc->chunked = 0 ;
+		} else if ( oc->http_1_1 ) {
+			oc->chunked = 1 ;
+		} else {
+			oc->chunked = 0 ;
+			oc->keep_alive = 0 ;
+		}
+		header_length = HTTPheaders( oc, header, sizeof(header) ) ;
+		if ( last ) {
+			header_length += snprintf( &header[header_length], sizeof(header) - header_length, "Content-Length: %lu\r\n\r\n", (unsigned long) oc->body_length ) ;
+		} else if ( oc->chunked ) {
+			header_length += snprintf( &header[header_length], sizeof(header) - header_length, "Transfer-Encoding: chunked\r\n\r\n" ) ;
+		} else {
+			header_length += snprintf( &header[header_length], sizeof(header) - header_length, "\r\n" ) ;
+		}
+		oc->header_sent = 1 ;
+	}
+
+	if ( oc->chunked ) {
+		// an empty chunk would end the response early
+		if ( oc->body_length > 0 ) {
+			header_length += snprintf( &header[header_length], sizeof(header) - header_length, "%lx\r\n", (unsigned long) oc->body_length ) ;
+			strcpy( trailer, last ? "\r\n0\r\n\r\n" : "\r\n" ) ;
+		} else if ( last ) {
+			strcpy( trailer, "0\r\n\r\n" ) ;
+		}
+	}
+
+	io[0].iov_base = header ;
+	io[0].iov_len = header_length ;
+	io[1].iov_base = oc->body ;
+	io[1].iov_len = oc->body_length ;
+	io[2].iov_base = trailer ;
+	io[2].iov_len = strlen( trailer ) ;
+	HTTPwritev( oc, io, 3 ) ;
+
+	// reuse the buffer for the next chunk
+	fseek( oc->out, 0, SEEK_SET ) ;
+}
+
+/* Status line and headers except the body framing */
+static size_t HTTPheaders( struct OutputControl * oc, char * header, size_t header_size )
+{
 	char d[44];
 	time_t t = NOW_TIME;
 	size_t l = strftime(d, sizeof(d), "%a, %d %b %Y %T GMT", gmtime(&t));
+	const char * content_type = "" ;
+	int header_length ;
 
-	fprintf(out, "HTTP/1.0 %s\r\n", status);
-	fprintf(out, "Date: %*s\n", (int) l, d);
-	fprintf(out, "Server: %s\r\n", SVERSION);
-	fprintf(out, "Last-Modified: %*s\r\n", (int) l, d);
-	/*
-	 * fprintf( out, "MIME-version: 1.0\r\n" );
-	 */
-	switch (ct) {
+	switch (oc->ct) {
 	case ct_html:
-		fprintf(out, "Content-Type: text/html\r\n");
+		content_type = "Content-Type: text/html\r\n" ;
 		break;
 	case ct_icon:
-		fprintf(out, "Content-Length: 894\r\n");
-		fprintf(out, "Connection: close\r\n");
+		content_type = "Content-Type: image/x-icon\r\n" ;
 		break ;
 	case ct_text:
-		fprintf(out, "Content-Type: text/plain\r\n");
+		content_type = "Content-Type: text/plain\r\n" ;
 		break ;
 	case ct_json:
-		fprintf(out, "Access-Control-Allow-Origin: *\r\n");
-		fprintf(out, "Content-Type: application/json\r\n");
+		content_type = "Access-Control-Allow-Origin: *\r\nContent-Type: application/json\r\n" ;
 		break ;
 	}
-	fprintf(out, "\r\n");
+
+	header_length = snprintf( header, header_size,
+		"HTTP/1.1 %s\r\n"
+		"Date: %*s\r\n"
+		"Server: %s\r\n"
+		"Last-Modified: %*s\r\n"
+		"%s"
+		"Connection: %s\r\n",
+		oc->status, (int) l, d, SVERSION, (int) l, d, content_type, oc->keep_alive ? "keep-alive" : "close" ) ;
+	if ( header_length < 0 || (size_t) header_length >= header_size ) {
+		// can't happen with the fixed strings above
+		return 0 ;
+	}
+	if ( oc->stale ) {
+		// some value shown is past its cache time (?stale)
+		header_length += snprintf( &header[header_length], header_size - header_length, "Warning: 110 - \"Response is Stale\"\r\n" ) ;
+	}
+	return header_length ;
+}
+
+/* Write everything, even if the socket takes it a piece at a time */
+static void HTTPwritev( struct OutputControl * oc, struct iovec * io, int nio )
+{
+	while ( nio > 0 ) {
+		ssize_t written = writev( oc->file_descriptor, io, nio ) ;
+		if ( written < 0 ) {
+			if ( errno == EINTR ) {
+				continue ;
+			}
+			LEVEL_DEBUG("Cannot send http response");
+			oc->keep_alive = 0 ;
+			return ;
+		}
+		while ( nio > 0 && (size_t) written >= io->iov_len ) {
+			written -= io->iov_len ;
+			++io ;
+			--nio ;
+		}
+		if ( nio > 0 ) {
+			io->iov_base = (char *) io->iov_base + written ;
+			io->iov_len -= written ;
+		}
+	}
 }
 
 void HTTPtitle(struct OutputControl * oc, const char *title)
@@ -41,11 +41,31 @@ static void StructureDetailJson(struct OutputControl * oc, const char * structur
 
 /* --------------- Functions ---------------- */
 
+/* A read for this request, carrying its own flags (e.g. ?stale) */
+struct one_wire_query * HTTPquery( struct OutputControl * oc, const char * path )
+{
+	struct one_wire_query * owq = OWQ_create_from_path( path ) ; // for read or dir
+
+	if ( owq != NO_ONE_WIRE_QUERY ) {
+		PN(owq)->control_flags |= oc->control_flags ;
+	}
+	return owq ;
+}
+
+/* Note an expired value for the response headers, and free the query */
+void HTTPquery_done( struct OutputControl * oc, struct one_wire_query * owq )
+{
+	if ( owq != NO_ONE_WIRE_QUERY && ( PN(owq)->control_flags & STALE_SERVED ) ) {
+		oc->stale = 1 ;
+	}
+	OWQ_destroy( owq ) ;
+}
+
 /* Device entry -- table line for a filetype */
 static void Show(struct OutputControl * oc, const struct parsedname *pn_entry)
 {
 	FILE * out = oc->out ;
-	struct one_wire_query *owq = OWQ_create_from_path(pn_entry->path); // for read or dir
+	struct one_wire_query *owq = HTTPquery(oc, pn_entry->path); // for read or dir
 	struct filetype * ft = pn_entry->selected_filetype ;
 	/* Left column */
 	fprintf(out, "<TR><TD><B>%s</B></TD><TD>", FS_DirName(pn_entry));
@@ -78,7 +98,7 @@ static void Show(struct OutputControl * oc, const struct parsedname *pn_entry)
 		}
 	}
 	fprintf(out, "</TD></TR>\r\n");
-	OWQ_destroy(owq);
+	HTTPquery_done(oc, owq);
 }
 
 
@@ -335,7 +355,7 @@ static void ShowDirectory(struct OutputControl * oc, const struct parsedname *pn
 static void ShowText(struct OutputControl * oc, const struct parsedname *pn_entry)
 {
 	FILE * out = oc->out ;
-	struct one_wire_query *owq = OWQ_create_from_path(pn_entry->path); // for read or dir
+	struct one_wire_query *owq = HTTPquery(oc, pn_entry->path); // for read or dir
 	struct filetype * ft = pn_entry->selected_filetype ;
 
 	/* Left column */
@@ -363,7 +383,7 @@ static void ShowText(struct OutputControl * oc, const struct parsedname *pn_entr
 		}
 	}
 	fprintf(out, "\r\n");
-	OWQ_destroy(owq);
+	HTTPquery_done(oc, owq);
 }
 
 /* Device entry -- table line for a filetype */
@@ -461,7 +481,7 @@ static void ShowDeviceText(struct OutputControl * oc, struct parsedname *pn)
 static void ShowJson(struct OutputControl * oc, const struct parsedname *pn_entry)
 {
 	FILE * out = oc->out ;
-	struct one_wire_query *owq = OWQ_create_from_path(pn_entry->path); // for read or dir
+	struct one_wire_query *owq = HTTPquery(oc, pn_entry->path); // for read or dir
 	struct filetype * ft = pn_entry->selected_filetype ;
 
 	if (owq == NO_ONE_WIRE_QUERY) {
@@ -486,7 +506,7 @@ static void ShowJson(struct OutputControl * oc, const struct parsedname *pn_entr
 			ShowJsonReadWrite(oc, owq);
 		}
 	}
-	OWQ_destroy(owq);
+	HTTPquery_done(oc, owq);
 }
 
 /* Device entry -- table line for a filetype */
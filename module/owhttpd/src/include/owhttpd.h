@@ -34,21 +34,40 @@
  * deals with a conncection
  */
 /* in owhttpd_handler.c */
-int handle_socket(FILE * out);
+int handle_socket(FILE * in, FILE_DESCRIPTOR_OR_ERROR file_descriptor, int keep_alive);
+
+enum content_type { ct_text, ct_html, ct_icon, ct_json, };
+
+/* What the client asked for in a "Connection:" header */
+enum connection_header { connection_default, connection_close, connection_keep_alive, };
 
 struct OutputControl {
-	FILE * out ;
+	FILE * out ;			// response body, built in memory (open_memstream)
 	int not_first ;
 	char * base_url ;
 	char * host ;
+	FILE * in ;				// request from the client
+	FILE_DESCRIPTOR_OR_ERROR file_descriptor ;	// response goes straight to the socket
+	char * body ;			// memory behind out
+	size_t body_length ;
+	const char * status ;
+	enum content_type ct ;
+	enum connection_header connection ;
+	int http_1_1 ;			// client understands chunked responses
+	int keep_alive ;		// connection stays open for another request
+	int header_sent ;		// response is being streamed in chunks
+	int chunked ;
+	uint32_t control_flags ;	// added to each read (STALE_OK from ?stale)
+	int stale ;				// an expired value was shown
 } ;
 
 /* in owhttpd_present */
-enum content_type { ct_text, ct_html, ct_icon, ct_json, };
 void HTTPstart( struct OutputControl * oc, const char *status, const enum content_type ct);
 void HTTPtitle( struct OutputControl * oc, const char *title);
 void HTTPheader( struct OutputControl * oc, const char *head);
 void HTTPfoot( struct OutputControl * oc);
+void HTTPflush( struct OutputControl * oc);
+void HTTPfinish( struct OutputControl * oc);
 
 /* in owhttpd_write.c */
 void PostData(struct one_wire_query *owq);
@@ -56,6 +75,8 @@ void ChangeData(struct one_wire_query *owq);
 
 /* in owhttpd_read.c */
 void ShowDevice( struct OutputControl * oc, struct parsedname *const pn);
+struct one_wire_query * HTTPquery( struct OutputControl * oc, const char * path ) ;
+void HTTPquery_done( struct OutputControl * oc, struct one_wire_query * owq ) ;
 
 /* in owhttpd_dir.c */
 struct JsonCBstruct {
@@ -69,6 +90,10 @@ void JSON_dir_init(  struct OutputControl * oc ) ;
 void JSON_dir_entry(  struct OutputControl * oc, const char * format, const char * data ) ;
 void JSON_dir_finish(  struct OutputControl * oc ) ;
 
+/* in owhttpd_bulk.c */
+const char * BulkPath( const char * file ) ;
+void ShowBulk( struct OutputControl * oc, struct parsedname * pn, int depth ) ;
+
 /* in ow_favicon.c */
 void Favicon( struct OutputControl * oc);
 
@@ -53,8 +53,17 @@ struct global Globals = {
 
 	.readonly = 0,
 	.max_clients = 250,
+	.fuse_threads = 10,
+	.server_threads = 16,
+	.server_pool = 4,
+	.http_keepalive = 5,
+	.http_max_requests = 100,
 
 	.cache_size = 0,
+	.parse_cache_size = 4096,
+	.full_search = 0,
+	.cache_snapshot = NULL,
+	.cache_snapshot_period = 300,
 
 	.one_device = 0,
 
@@ -75,6 +84,8 @@ struct global Globals = {
 	.timeout_ftp = 900,
 	.timeout_ha7 = 60,
 	.timeout_w1 = 30,
+	.timeout_detect = 10,
+	.timeout_external = 5,
 	.timeout_persistent_low = 600,
 	.timeout_persistent_high = 3600,
 	.clients_persistent_low = 10,
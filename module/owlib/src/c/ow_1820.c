@@ -325,7 +325,7 @@ static GOOD_OR_BAD OW_temperature_ready( enum temperature_problem_flag accept_85
 
 static GOOD_OR_BAD OW_read_piostate(UINT * piostate, const struct parsedname *pn) ;
 static _FLOAT OW_masked_temperature( BYTE * data, struct tempresolution * Resolution ) ;
-static GOOD_OR_BAD OW_poll_convert(const struct parsedname *pn) ;
+static GOOD_OR_BAD OW_poll_convert(UINT delay, const struct parsedname *pn) ;
 
 static GOOD_OR_BAD OW_r_mem(BYTE * data, size_t size, off_t offset, struct parsedname *pn) ;
 static GOOD_OR_BAD OW_w_mem( BYTE * data, size_t size, off_t offset, struct parsedname * pn ) ;
@@ -821,11 +821,6 @@ static GOOD_OR_BAD OW_temperature_ready( enum temperature_problem_flag accept_85
 		TRXN_POWER(convert, delay),
 		TRXN_END,
 	};
-	struct transaction_log tpowered[] = {
-		TRXN_START,
-		TRXN_WRITE1(convert),
-		TRXN_END,
-	};
 	// failsafe
 	struct transaction_log tunpowered_long[] = {
 		TRXN_START,
@@ -854,20 +849,10 @@ static GOOD_OR_BAD OW_temperature_ready( enum temperature_problem_flag accept_85
 		RETURN_BAD_IF_BAD(BUS_transaction(tunpowered, pn)) ;
 	} else if ( must_convert || !simul_good ) {
 		// No Simultaneous active, so need to "convert"
-		if ( pn->selected_connection->iroutines.flags & ADAP_FLAG_unlock_during_delay ) {
-			// better to put in delay on this channel and allow other channels to work
-			LEVEL_DEBUG("Powered temperature conversion just one channel -- %d msec", delay);
-			// If not powered, no Simultaneous for this chip
-			RETURN_BAD_IF_BAD(BUS_transaction(tunpowered, pn)) ;
-		} else {
-			// powered, so poll bus for faster conversion
-			GOOD_OR_BAD ret;
-			LEVEL_DEBUG("Powered temperature conversion -- poll for completion");
-			BUSLOCK(pn);
-			ret = BUS_transaction_nolock(tpowered, pn) || OW_poll_convert(pn);
-			BUSUNLOCK(pn);
-			RETURN_BAD_IF_BAD(ret)
-		}
+		// Powered chips don't need the bus while converting:
+		// other devices' reads and conversions run between looks at the line
+		LEVEL_DEBUG("Powered temperature conversion -- poll for completion");
+		RETURN_BAD_IF_BAD(OW_poll_convert(delay, pn)) ;
 	} else {
 		// valid simultaneous, just delay if needed
 		RETURN_BAD_IF_BAD( FS_Test_Simultaneous( SlaveSpecificTag(S_T), delay, pn)) ;
@@ -1201,29 +1186,70 @@ static enum eDie OW_die(const struct parsedname *pn)
 
 /* Powered temperature measurements -- need to poll line since it is held low during measurement */
 /* We check every 10 msec (arbitrary) up to 1.25 seconds */
-static GOOD_OR_BAD OW_poll_convert(const struct parsedname *pn)
+/* The bus is let go between checks. The chip only answers read slots until the next reset,
+ * so once another device has used the bus just wait out the conversion time */
+static GOOD_OR_BAD OW_poll_convert(UINT delay, const struct parsedname *pn)
 {
+	struct connection_in * in = pn->selected_connection ;
 	int i;
+	UINT waited = 0 ;
+	UINT locks ;
+	UINT poll_delay = 10 ;
+	GOOD_OR_BAD ret ;
+	BYTE convert[] = { _1W_CONVERT_T, };
 	BYTE p[1];
+	struct transaction_log tpowered[] = {
+		TRXN_START,
+		TRXN_WRITE1(convert),
+		TRXN_END,
+	};
 	struct transaction_log t[] = {
-		{NULL, NULL, 10, trxn_delay,},
 		TRXN_READ1(p),
 		TRXN_END,
 	};
 
+	BUSLOCK(pn);
+	ret = BUS_transaction_nolock(tpowered, pn) ;
+	// changed only with the bus locked, so a jump means someone else had it
+	locks = STAT_GET( in->bus_stat[e_bus_locks] ) ;
+	BUSUNLOCK(pn);
+	RETURN_BAD_IF_BAD(ret) ;
+
+	if ( in->iroutines.flags & ADAP_FLAG_unlock_during_delay ) {
+		// never polled on these bus masters, just the delay
+		UT_delay(delay) ;
+		return gbGOOD ;
+	}
+
 	// the first test is faster for just DS2438 (10 msec)
 	// subsequent polling is slower since the DS18x20 is a slower converter
 	for (i = 0; i < 22; ++i) {
-		//LEVEL_DEBUG("TEST polling %d",i);
-		if ( BAD( BUS_transaction_nolock(t, pn) )) {
+		UT_delay(poll_delay) ;
+		waited += poll_delay ;
+		poll_delay = 50 ;			// 50 msec for rest of delays
+
+		BUSLOCK(pn);
+		if ( STAT_GET( in->bus_stat[e_bus_locks] ) != locks + 1 ) {
+			// the chip won't answer now -- the full conversion time is all we know
+			BUSUNLOCK(pn);
+			if ( waited < delay ) {
+				UT_delay( delay - waited ) ;
+			}
+			LEVEL_DEBUG("Bus used meanwhile, waited %d msec", waited < delay ? delay : waited);
+			return gbGOOD ;
+		}
+		locks = STAT_GET( in->bus_stat[e_bus_locks] ) ;
+		ret = BUS_transaction_nolock(t, pn) ;
+		BUSUNLOCK(pn);
+
+		if ( BAD( ret ) ) {
 			LEVEL_DEBUG("BUS_transaction failed");
 			break;
 		}
 		if (p[0] != 0) {
-			LEVEL_DEBUG("BUS_transaction done after %dms", (i + 1) * 10);
+			LEVEL_DEBUG("BUS_transaction done after %dms", waited);
 			return gbGOOD;
 		}
-		t[0].size = 50;			// 50 msec for rest of delays
 	}
 	LEVEL_DEBUG("Temperature measurement failed");
 	return gbBAD;
@@ -159,9 +159,11 @@ void FS_dir_entry_aliased(void (*dirfunc) (void *, const struct parsedname *), v
 
 		ASCII path[PATH_MAX+3] ;
 		ASCII * path_pointer = path ; // current location in original path
+		ASCII alias_path[PATH_MAX+3] ;
 
-		// Shallow copy
+		// Shallow copy, but with its own path
 		memcpy( pn_copy, pn, sizeof(struct parsedname) ) ;
+		pn_copy->path = alias_path ;
 		pn_copy->path[0] = '\0' ;
 
 		// path copy to use for separation
@@ -381,6 +381,22 @@ GOOD_OR_BAD ARG_Mock(const char *arg)
 	return gbGOOD;
 }
 
+GOOD_OR_BAD ARG_Sim(const char *arg)
+{
+	struct port_in * pin = NewPort( NULL ) ;
+	struct connection_in * in ;
+	if ( pin == NULL ) {
+		return gbBAD;
+	}
+	in = pin->first ;
+	if (in == NO_CONNECTION) {
+		return gbBAD;
+	}
+	arg_data(arg,pin) ;
+	pin->busmode = bus_sim;
+	return gbGOOD;
+}
+
 GOOD_OR_BAD ARG_W1_monitor(void)
 {
 	struct port_in * pin = NewPort( NULL ) ;
@@ -21,6 +21,9 @@ void BUS_lock(const struct parsedname *pn)
 	if (pn) {
 		struct connection_in * in = pn->selected_connection ;
 		BUSLOCKIN(in);
+		if (in) {
+			Latency_device( e_latency_lock_wait, in->lock_wait, pn ) ;
+		}
 	}
 }
 
@@ -28,14 +31,25 @@ void BUS_unlock(const struct parsedname *pn)
 {
 	if (pn) {
 		struct connection_in * in = pn->selected_connection ;
+		if (in) {
+			Latency_device( e_latency_lock_held, Latency_since( &(in->last_lock) ), pn ) ;
+		}
 		BUSUNLOCKIN(in);
 	}
 }
 
 void BUS_lock_in(struct connection_in *in)
 {
+	struct timeval start ;
+
+	timernow( &start ) ;
 	PORTLOCKIN(in) ;
 	CHANNELLOCKIN(in) ;
+	if (in) {
+		// lock_wait is only changed here, with the bus locked
+		in->lock_wait = Latency_since( &start ) ;
+		Latency_bus( e_latency_lock_wait, in->lock_wait, in ) ;
+	}
 }
 
 void BUS_unlock_in(struct connection_in *in)
@@ -72,10 +86,10 @@ void CHANNEL_unlock_in(struct connection_in *in)
 	}
 	timersub( &tv, &(in->last_lock), &tv ) ;
 
-	STATLOCK;
+	// bus_time is only changed here, with the bus still locked
 	timeradd( &tv, &(in->bus_time), &(in->bus_time) ) ;
-	++in->bus_stat[e_bus_unlocks];
-	STATUNLOCK;
+	STAT_ADD1(in->bus_stat[e_bus_unlocks]);
+	Latency_bus( e_latency_lock_held, Latency_usec( &tv ), in ) ;
 
 	_MUTEX_UNLOCK(in->bus_mutex);
 }
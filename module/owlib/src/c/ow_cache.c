@@ -43,16 +43,38 @@ int AliasMarkerLoc ;
 void * Alias_Marker = &AliasMarkerLoc ;
 
 
+/* Temporary (timed) cache elements are held in a lock-striped hash table
+	-- CACHE_SHARDS independent shards, each with its own mutex
+	-- the shard is chosen from the high bits of the key hash, the bucket from the low bits
+	-- each shard's bucket array is a power of 2 and doubles as the shard fills
+	-- each shard keeps its elements on an LRU list (newest at the head)
+	-- Globals.cache_size is split evenly among the shards, and the coldest
+	   elements are evicted to make room rather than refusing new ones
+	-- expired elements that drift to the LRU tail are reclaimed on the next add
+*/
+#define CACHE_SHARDS             64
+#define CACHE_SHARD_MIN_BUCKETS  16
+#define CACHE_EXPIRED_REAP        4
+
+struct tree_node ;
+
+struct cache_shard {
+	pthread_mutex_t mutex;
+	struct tree_node **bucket;			// hash chains
+	UINT buckets;						// size of bucket array (power of 2)
+	UINT count;							// elements in this shard
+	size_t ram_size;					// bytes held by this shard
+	struct tree_node *newest;			// LRU head
+	struct tree_node *oldest;			// LRU tail
+};
+
 /* Put the globals into a struct to declutter the namespace */
 struct cache_data {
-	void *temporary_tree_new;			// current cache database
-	void *temporary_tree_old;			// older cache database
+	struct cache_shard shard[CACHE_SHARDS];	// temporary cache database
 	void *persistent_tree;				// persistent database
 	void *temporary_alias_tree_new;		// current cache database
 	void *temporary_alias_tree_old;		// older cache database
 	void *persistent_alias_tree;		// persistent database
-	size_t old_ram_size;				// cache size
-	size_t new_ram_size;				// cache size
 	time_t time_retired;				// start time of older
 	time_t time_to_kill;				// deathtime of older
 	time_t retired_lifespan;			// lifetime of older
@@ -60,7 +82,26 @@ struct cache_data {
 };
 static struct cache_data cache;
 
-/* Cache elements are placed in a Red/Black binary tree
+/* Retired alias trees are freed by a background reaper, not under CACHE_WLOCK */
+struct cache_retired {
+	struct cache_retired *next;
+	void *alias_tree;
+};
+
+static struct {
+	struct cache_retired *head;			// oldest first
+	struct cache_retired *tail;
+	pthread_mutex_t mutex;
+	pthread_cond_t cond;
+	pthread_t thread;
+	int started;
+	int stopping;
+} reaper_control;
+
+/* Elements freed between yields */
+#define CACHE_REAP_BATCH    256
+
+/* Persistent elements are placed in a Red/Black binary tree
 	-- standard glibc implementation
 	-- use gnu tdestroy extension
 	-- compatibility implementation included
@@ -72,6 +113,7 @@ static struct cache_data cache;
 	key -- sorted component as above
 	expires -- the time that the element is no longer valid
 	dsize -- length in bytes of trailing data
+	chain, newer, older, hash -- hash table bookkeeping (unused in the persistent tree)
   Cache data is the actual data
 	allocated at same call as cache node
 	access via macro TREE_DATA
@@ -91,16 +133,21 @@ struct tree_key {
 	int extension;
 };
 
-/* How we organize the data in the binary tree used for cache storage
+/* How we organize the data in the cache storage
    A key (see above)
    An expiration time
    And a size in bytes
+   Hash chain and LRU links
    Actaully size bytes follows with the data
 */
 struct tree_node {
 	struct tree_key tk;
 	time_t expires;
 	size_t dsize;
+	struct tree_node *chain;	// next in hash bucket
+	struct tree_node *newer;	// LRU list
+	struct tree_node *older;	// LRU list
+	UINT hash;
 };
 
 struct alias_tree_node {
@@ -126,9 +173,22 @@ struct tree_opaque {
 #define ALIAS_TREE_DATA(atn)    ( (ASCII *)(atn) + sizeof(struct alias_tree_node) )
 #define CONST_ALIAS_TREE_DATA(atn)    ( (const ASCII *)(atn) + sizeof(struct alias_tree_node) )
 
-enum cache_task_return { ctr_ok, ctr_not_found, ctr_expired, ctr_size_mismatch, } ;
+enum cache_task_return { ctr_ok, ctr_not_found, ctr_expired, ctr_size_mismatch, ctr_stale, } ;
 
 static void FlipTree( void ) ;
+static void Cache_Retire(void *alias_tree);
+static void *Cache_Reaper_Thread(void *v);
+static void Cache_Reap_Tree(void *alias_tree);
+
+static UINT tree_hash(const struct tree_key *tk);
+static struct cache_shard * Shard_Of(const struct tree_node *tn);
+static struct tree_node * Shard_Find(struct cache_shard *shard, const struct tree_node *tn);
+static GOOD_OR_BAD Shard_Link(struct cache_shard *shard, struct tree_node *tn);
+static void Shard_Unlink(struct cache_shard *shard, struct tree_node *tn);
+static void Shard_Touch(struct cache_shard *shard, struct tree_node *tn);
+static void Shard_Grow(struct cache_shard *shard);
+static struct tree_node * Shard_Empty(struct cache_shard *shard);
+static UINT Cache_Free_List(struct tree_node *tn);
 
 static int IsThisPersistent( const struct parsedname * pn ) ;
 
@@ -136,13 +196,16 @@ static GOOD_OR_BAD Cache_Add(const void *data, const size_t datasize, const stru
 static GOOD_OR_BAD Cache_Add_Common(struct tree_node *tn);
 static GOOD_OR_BAD Cache_Add_Persistent(struct tree_node *tn);
 
-static enum cache_task_return Cache_Get_Common(void *data, size_t * dsize, time_t * duration, const struct tree_node *tn);
+static enum cache_task_return Cache_Get_Common(void *data, size_t * dsize, time_t * duration, time_t grace, const struct tree_node *tn);
 static enum cache_task_return Cache_Get_Common_Dir(struct dirblob *db, time_t * duration, const struct tree_node *tn);
 static enum cache_task_return Cache_Get_Persistent(void *data, size_t * dsize, time_t * duration, const struct tree_node *tn);
 
 static GOOD_OR_BAD Cache_Get_Simultaneous(const struct internal_prop *ip, struct one_wire_query *owq) ;
 static GOOD_OR_BAD Cache_Get_Internal(void *data, size_t * dsize, const struct internal_prop *ip, const struct parsedname *pn);
-static GOOD_OR_BAD Cache_Get_Strict(void *data, size_t dsize, const struct parsedname *pn);
+static GOOD_OR_BAD OWQ_Cache_Get_Aged(struct one_wire_query *owq, time_t grace);
+static GOOD_OR_BAD Cache_Get_Aged(void *data, size_t * dsize, time_t grace, const struct parsedname *pn);
+static GOOD_OR_BAD Cache_Get_Strict(void *data, size_t dsize, time_t grace, const struct parsedname *pn);
+static GOOD_OR_BAD Cache_Get_Stale(void *data, size_t * dsize, time_t grace, const struct parsedname *pn);
 
 static void Cache_Del(const struct parsedname *pn) ;
 static GOOD_OR_BAD Cache_Del_Common(const struct tree_node *tn);
@@ -214,6 +277,172 @@ static time_t TimeOut(const enum fc_change change)
 	}
 }
 
+/* Hash of the whole (zero padded -- see LoadTK) key */
+/* FNV-1a with a final mix so both the high (shard) and low (bucket) bits are usable */
+static UINT tree_hash(const struct tree_key *tk)
+{
+	const BYTE *b = (const BYTE *) tk;
+	UINT h = 2166136261u;
+	size_t i;
+
+	for (i = 0; i < sizeof(struct tree_key); ++i) {
+		h ^= b[i];
+		h *= 16777619u;
+	}
+	h ^= h >> 16;
+	h *= 0x85EBCA6Bu;
+	h ^= h >> 13;
+	return h;
+}
+
+static struct cache_shard * Shard_Of(const struct tree_node *tn)
+{
+	return &cache.shard[(tn->hash >> 24) % CACHE_SHARDS];
+}
+
+/* Find a matching element in the shard (shard locked) */
+static struct tree_node * Shard_Find(struct cache_shard *shard, const struct tree_node *tn)
+{
+	struct tree_node *found;
+
+	if (shard->bucket == NULL) {
+		return NULL;
+	}
+	for (found = shard->bucket[tn->hash & (shard->buckets - 1)]; found != NULL; found = found->chain) {
+		if (found->hash == tn->hash && tree_compare(found, tn) == 0) {
+			return found;
+		}
+	}
+	return NULL;
+}
+
+/* Double the bucket array (shard locked) */
+/* On memory failure just keep the longer chains */
+static void Shard_Grow(struct cache_shard *shard)
+{
+	UINT buckets = (shard->bucket == NULL) ? CACHE_SHARD_MIN_BUCKETS : 2 * shard->buckets;
+	struct tree_node **bucket = (struct tree_node **) owcalloc(buckets, sizeof(struct tree_node *));
+	struct tree_node *tn;
+
+	if (bucket == NULL) {
+		return;
+	}
+	// rehash by walking the LRU list -- every element is on it
+	for (tn = shard->newest; tn != NULL; tn = tn->older) {
+		UINT b = tn->hash & (buckets - 1);
+		tn->chain = bucket[b];
+		bucket[b] = tn;
+	}
+	SAFEFREE(shard->bucket);
+	shard->bucket = bucket;
+	shard->buckets = buckets;
+}
+
+/* Add to hash chain and as newest in LRU (shard locked) */
+static GOOD_OR_BAD Shard_Link(struct cache_shard *shard, struct tree_node *tn)
+{
+	UINT b;
+
+	if (shard->bucket == NULL || shard->count >= 2 * shard->buckets) {
+		Shard_Grow(shard);
+		if (shard->bucket == NULL) {
+			return gbBAD;
+		}
+	}
+	b = tn->hash & (shard->buckets - 1);
+	tn->chain = shard->bucket[b];
+	shard->bucket[b] = tn;
+
+	tn->newer = NULL;
+	tn->older = shard->newest;
+	if (shard->newest != NULL) {
+		shard->newest->newer = tn;
+	} else {
+		shard->oldest = tn;
+	}
+	shard->newest = tn;
+
+	++shard->count;
+	shard->ram_size += sizeof(struct tree_node) + tn->dsize;
+	return gbGOOD;
+}
+
+/* Remove from hash chain and LRU (shard locked) */
+static void Shard_Unlink(struct cache_shard *shard, struct tree_node *tn)
+{
+	struct tree_node **link = &shard->bucket[tn->hash & (shard->buckets - 1)];
+
+	while (*link != tn) {
+		link = &((*link)->chain);
+	}
+	*link = tn->chain;
+
+	if (tn->newer != NULL) {
+		tn->newer->older = tn->older;
+	} else {
+		shard->newest = tn->older;
+	}
+	if (tn->older != NULL) {
+		tn->older->newer = tn->newer;
+	} else {
+		shard->oldest = tn->newer;
+	}
+	tn->chain = tn->newer = tn->older = NULL;
+
+	--shard->count;
+	shard->ram_size -= sizeof(struct tree_node) + tn->dsize;
+}
+
+/* Mark as most recently used (shard locked) */
+static void Shard_Touch(struct cache_shard *shard, struct tree_node *tn)
+{
+	if (shard->newest == tn) {
+		return;
+	}
+	// remove from current LRU position (not newest, so tn->newer exists)
+	tn->newer->older = tn->older;
+	if (tn->older != NULL) {
+		tn->older->newer = tn->newer;
+	} else {
+		shard->oldest = tn->newer;
+	}
+	// place at head
+	tn->newer = NULL;
+	tn->older = shard->newest;
+	shard->newest->newer = tn;
+	shard->newest = tn;
+}
+
+/* Detach every element (shard locked) */
+/* returns the former LRU list (linked through "older") to be freed outside the lock */
+static struct tree_node * Shard_Empty(struct cache_shard *shard)
+{
+	struct tree_node *list = shard->newest;
+
+	if (shard->bucket != NULL) {
+		memset(shard->bucket, 0, shard->buckets * sizeof(struct tree_node *));
+	}
+	shard->newest = shard->oldest = NULL;
+	shard->count = 0;
+	shard->ram_size = 0;
+	return list;
+}
+
+/* Free a list of elements linked through "older" */
+/* returns number freed */
+static UINT Cache_Free_List(struct tree_node *tn)
+{
+	UINT freed = 0;
+
+	while (tn != NULL) {
+		struct tree_node *older = tn->older;
+		owfree(tn);
+		tn = older;
+		++freed;
+	}
+	return freed;
+}
+
 #ifdef CACHE_DEBUG
 /* debug routine -- shows a table */
 /* Run it as twalk(dababase, tree_show ) */
@@ -249,8 +478,16 @@ static void tree_show(const void *node, const VISIT which, const int depth)
 }
 static void new_tree(void)
 {
-	fprintf(stderr,"Walk the new tree:\n");
-	twalk(cache.temporary_tree_new, tree_show);
+	int shard_index;
+	fprintf(stderr,"Walk the cache shards:\n");
+	for (shard_index = 0; shard_index < CACHE_SHARDS; ++shard_index) {
+		struct tree_node *tn;
+		_MUTEX_LOCK(cache.shard[shard_index].mutex);
+		for (tn = cache.shard[shard_index].newest; tn != NULL; tn = tn->older) {
+			node_show(tn);
+		}
+		_MUTEX_UNLOCK(cache.shard[shard_index].mutex);
+	}
 }
 #else							/* CACHE_DEBUG */
 #define new_tree()
@@ -266,7 +503,15 @@ static int IsThisPersistent( const struct parsedname * pn )
 /* Note: done in single-threaded mode so locking not yet needed */
 void Cache_Open(void)
 {
+	int shard_index;
+
 	memset(&cache, 0, sizeof(struct cache_data));
+	ParseCache_Open();
+	_MUTEX_INIT(reaper_control.mutex);
+	my_pthread_cond_init(&(reaper_control.cond), NULL);
+	for (shard_index = 0; shard_index < CACHE_SHARDS; ++shard_index) {
+		_MUTEX_INIT(cache.shard[shard_index].mutex);
+	}
 
 	cache.retired_lifespan = TimeOut(fc_stable);
 	if (cache.retired_lifespan > 3600) {
@@ -280,53 +525,205 @@ void Cache_Open(void)
 /* Note: done in a simgle single thread mode so locking not needed */
 void Cache_Close(void)
 {
+	int shard_index;
+
 	Cache_Clear() ;
+	Cache_Reaper_Stop() ;
+	my_pthread_cond_destroy(&(reaper_control.cond));
+	_MUTEX_DESTROY(reaper_control.mutex);
+	for (shard_index = 0; shard_index < CACHE_SHARDS; ++shard_index) {
+		SAFEFREE(cache.shard[shard_index].bucket);
+		_MUTEX_DESTROY(cache.shard[shard_index].mutex);
+	}
 	SAFETDESTROY( cache.persistent_tree, owfree_func);
 	SAFETDESTROY( cache.persistent_alias_tree, owfree_func);
+	ParseCache_Close();
 }
 
-/* Moves new to old tree, initializes new tree, and clears former old tree location */
+/* Moves new alias tree to old, initializes new tree, and retires the former old tree */
+/* The hash cache isn't flipped (elements expire individually) but its statistics roll over */
+/* Called with CACHE_WLOCK -- takes the same time whatever the cache size,
+ * the caller flushes the parse cache once the lock is released */
 static void FlipTree( void )
 {
-	void * flip = cache.temporary_tree_old; // old old saved for later clearing
 	void * flip_alias = cache.temporary_alias_tree_old; // old old saved for later clearing
+	struct timeval start;
+
+	timernow( &start );
 
 	/* Flip caches! old = new. New truncated, reset time and counters and flag */
-	LEVEL_DEBUG("Flipping cache tree (purging timed-out data)");
+	LEVEL_DEBUG("Flipping alias cache tree (purging timed-out data)");
 
 	// move "new" pointers to "old"
-	cache.temporary_tree_old = cache.temporary_tree_new;
-	cache.old_ram_size = cache.new_ram_size;
 	cache.temporary_alias_tree_old = cache.temporary_alias_tree_new;
 
 	// New cache setup
-	cache.temporary_tree_new = NULL;
 	cache.temporary_alias_tree_new = NULL;
-	cache.new_ram_size = 0;
 	cache.added = 0;
 
 	// set up "old" cache times
 	cache.time_retired = NOW_TIME;
 	cache.time_to_kill = cache.time_retired + cache.retired_lifespan;
 
-	// delete really old tree
+	// really old tree is freed in the background
+	Cache_Retire( flip_alias ) ;
+	STAT_ADD1(cache_flips);			/* statistics */
+	STAT_SET(old_avg.current, STAT_GET(new_avg.current));
+	STAT_SET(old_avg.sum, STAT_GET(new_avg.sum));
+	STAT_SET(old_avg.count, STAT_GET(new_avg.count));
+	STAT_SET(old_avg.max, STAT_GET(new_avg.max));
+	// elements carry over in the hash cache, only the running totals restart
+	STAT_SET(new_avg.sum, 0);
+	STAT_SET(new_avg.count, 0);
+	STAT_SET(new_avg.max, STAT_GET(new_avg.current));
+	STAT_MAX(cache_flip_max, Latency_since( &start ));
+}
+
+/* Hand a retired alias tree to the reaper (called with CACHE_WLOCK)
+ * Without a reaper (not started yet, or stopping) it's freed at once */
+static void Cache_Retire(void *alias_tree)
+{
+	struct cache_retired *retired;
+
+	if (alias_tree == NULL) {
+		return;
+	}
+
+	retired = owmalloc(sizeof(struct cache_retired));
+	_MUTEX_LOCK(reaper_control.mutex);
+	if (retired != NULL && reaper_control.started && !reaper_control.stopping) {
+		retired->next = NULL;
+		retired->alias_tree = alias_tree;
+		if (reaper_control.tail == NULL) {
+			reaper_control.head = retired;
+		} else {
+			reaper_control.tail->next = retired;
+		}
+		reaper_control.tail = retired;
+		my_pthread_cond_signal(&(reaper_control.cond));
+		_MUTEX_UNLOCK(reaper_control.mutex);
+		return;
+	}
+	_MUTEX_UNLOCK(reaper_control.mutex);
+
+	SAFEFREE(retired);
 	LEVEL_DEBUG("flip cache. tdestroy() will be called.");
-	SAFETDESTROY( flip, owfree_func);
-	SAFETDESTROY( flip_alias, owfree_func);
-	STATLOCK;
-	++cache_flips;			/* statistics */
-	memcpy(&old_avg, &new_avg, sizeof(struct average));
-	AVERAGE_CLEAR(&new_avg);
-	STATUNLOCK;
+	tdestroy(alias_tree, owfree_func);
+}
+
+/* Start the reaper
+ * Called once we are in the background (threads don't survive a fork) */
+void Cache_Reaper_Start(void)
+{
+	_MUTEX_LOCK(reaper_control.mutex);
+	if (reaper_control.started) {
+		_MUTEX_UNLOCK(reaper_control.mutex);
+		return;
+	}
+	reaper_control.stopping = 0;
+	if (pthread_create(&(reaper_control.thread), DEFAULT_THREAD_ATTR, Cache_Reaper_Thread, NULL) != 0) {
+		LEVEL_DEBUG("Cannot create cache reaper thread -- retired trees are freed when flipped");
+	} else {
+		reaper_control.started = 1;
+	}
+	_MUTEX_UNLOCK(reaper_control.mutex);
+}
+
+/* End the reaper once every retired tree is freed */
+void Cache_Reaper_Stop(void)
+{
+	_MUTEX_LOCK(reaper_control.mutex);
+	if (!reaper_control.started) {
+		_MUTEX_UNLOCK(reaper_control.mutex);
+		return;
+	}
+	reaper_control.stopping = 1;
+	my_pthread_cond_broadcast(&(reaper_control.cond));
+	_MUTEX_UNLOCK(reaper_control.mutex);
+
+	pthread_join(reaper_control.thread, NULL);
+
+	_MUTEX_LOCK(reaper_control.mutex);
+	reaper_control.started = 0;
+	reaper_control.stopping = 0;
+	_MUTEX_UNLOCK(reaper_control.mutex);
+}
+
+static void *Cache_Reaper_Thread(void *v)
+{
+	(void) v;
+
+	_MUTEX_LOCK(reaper_control.mutex);
+	while (1) {
+		struct cache_retired *retired = reaper_control.head;
+
+		if (retired == NULL) {
+			if (reaper_control.stopping) {
+				break;
+			}
+			my_pthread_cond_wait(&(reaper_control.cond), &(reaper_control.mutex));
+			continue;
+		}
+		reaper_control.head = retired->next;
+		if (reaper_control.head == NULL) {
+			reaper_control.tail = NULL;
+		}
+		_MUTEX_UNLOCK(reaper_control.mutex);
+
+		Cache_Reap_Tree(retired->alias_tree);
+		owfree(retired);
+
+		_MUTEX_LOCK(reaper_control.mutex);
+	}
+	_MUTEX_UNLOCK(reaper_control.mutex);
+	return VOID_RETURN;
+}
+
+/* Free a retired tree a node at a time -- nobody else can see it any more
+ * Yields every CACHE_REAP_BATCH elements so a big tree doesn't hog the allocator */
+static void Cache_Reap_Tree(void *alias_tree)
+{
+	UINT reaped = 0;
+
+	while (alias_tree != NULL) {
+		// the root's key, see struct tree_opaque
+		struct alias_tree_node *atn = (struct alias_tree_node *) ((struct tree_opaque *) alias_tree)->key;
+
+		tdelete(atn, &alias_tree, alias_tree_compare);
+		owfree(atn);
+		if (++reaped == CACHE_REAP_BATCH) {
+			STAT_ADD(cache_reaped, reaped);
+			reaped = 0;
+			sched_yield();
+		}
+	}
+	STAT_ADD(cache_reaped, reaped);
 }
 
 /* Clear the cache (a change was made that might give stale information) */
 void Cache_Clear(void)
 {
+	int shard_index;
+	UINT freed = 0;
+
 	CACHE_WLOCK;
 	FlipTree() ;
 	FlipTree() ;
 	CACHE_WUNLOCK;
+	// parsed paths hold alias and device locations
+	ParseCache_Flush();
+
+	for (shard_index = 0; shard_index < CACHE_SHARDS; ++shard_index) {
+		struct cache_shard *shard = &cache.shard[shard_index];
+		struct tree_node *list;
+
+		_MUTEX_LOCK(shard->mutex);
+		list = Shard_Empty(shard);
+		_MUTEX_UNLOCK(shard->mutex);
+		freed += Cache_Free_List(list);
+	}
+
+	STAT_SUB(new_avg.current, freed);
 }
 
 /* Wrapper to perform a cache function and add statistics */
@@ -620,58 +1017,111 @@ GOOD_OR_BAD Cache_Add_Alias(const ASCII *name, const BYTE * sn)
 	tn->dsize = size;
 	memcpy((ASCII *)TREE_DATA(tn), name, size+1 ); // includes NULL
 	Cache_Add_Alias_SN( name, sn ) ;
+	ParseCache_Flush();
 	return Add_Stat(&cache_pst, Cache_Add_Persistent(tn));
 }
 
 /* Add an item to the cache */
-/* retire the cache (flip) if too old, and start a new one (keep the old one for a while) */
+/* replaces any matching element, then reclaims expired elements and
+   evicts the least recently used ones if the shard is over its share of cache_size */
 /* return 0 if good, 1 if not */
 static GOOD_OR_BAD Cache_Add_Common(struct tree_node *tn)
 {
-	struct tree_opaque *opaque;
+	struct cache_shard *shard = Shard_Of(tn);
+	struct tree_node *old_tn;
+	struct tree_node *retired = NULL; // removed elements, freed outside the lock
+	size_t budget = 0;
+	time_t now = NOW_TIME;
+	time_t stale_grace = Stale_Grace_Max();
+	UINT dropped = 0;
+	UINT evicted = 0;
+	int reap;
 	enum { no_add, yes_add, just_update } state = no_add;
 
 	node_show(tn);
 	LEVEL_DEBUG("Add to cache sn " SNformat " pointer=%p index=%d size=%d", SNvar(tn->tk.sn), tn->tk.p, tn->tk.extension, tn->dsize);
-	CACHE_WLOCK;
-	if (cache.time_to_kill < NOW_TIME) {	// old database has timed out
-		FlipTree() ;
+
+	if (cache.time_to_kill < now) {	// old alias database has timed out
+		int flipped = 0;
+
+		CACHE_WLOCK;
+		if (cache.time_to_kill < now) {
+			FlipTree() ;
+			flipped = 1;
+		}
+		CACHE_WUNLOCK;
+		if (flipped) {
+			ParseCache_Flush();
+		}
 	}
-	if (Globals.cache_size && (cache.old_ram_size + cache.new_ram_size > Globals.cache_size)) {
-		// failed size test
-		owfree(tn);
-	} else if ((opaque = tsearch(tn, &cache.temporary_tree_new, tree_compare))) {
-		//printf("Cache_Add_Common to %p\n",opaque);
-		if (tn != opaque->key) {
-			cache.new_ram_size += sizeof(tn) - sizeof(opaque->key);
-			owfree(opaque->key);
-			opaque->key = tn;
-			state = just_update;
-		} else {
-			state = yes_add;
-			cache.new_ram_size += sizeof(tn);
+
+	if (Globals.cache_size) {
+		budget = Globals.cache_size / CACHE_SHARDS;
+		if (budget == 0) {
+			budget = 1;
 		}
-	} else {					// nothing found or added?!? free our memory segment
+	}
+
+	_MUTEX_LOCK(shard->mutex);
+	old_tn = Shard_Find(shard, tn);
+	if (old_tn != NULL) {
+		Shard_Unlink(shard, old_tn);
+		old_tn->older = retired;
+		retired = old_tn;
+	}
+	if (GOOD(Shard_Link(shard, tn))) {
+		state = (old_tn == NULL) ? yes_add : just_update;
+
+		// reclaim expired elements from the cold end (beyond any stale window)
+		for (reap = CACHE_EXPIRED_REAP; reap > 0 && shard->oldest != tn && shard->oldest->expires + stale_grace < now; --reap) {
+			struct tree_node *cold = shard->oldest;
+			Shard_Unlink(shard, cold);
+			cold->older = retired;
+			retired = cold;
+			++dropped;
+		}
+
+		// enforce the size limit -- the new element itself is never evicted
+		while (budget > 0 && shard->ram_size > budget && shard->oldest != tn) {
+			struct tree_node *cold = shard->oldest;
+			Shard_Unlink(shard, cold);
+			cold->older = retired;
+			retired = cold;
+			++dropped;
+			++evicted;
+		}
+	} else {
+		// no room for even a bucket array
 		owfree(tn);
+		if (old_tn != NULL) {
+			++dropped;
+		}
 	}
-	CACHE_WUNLOCK;
+	_MUTEX_UNLOCK(shard->mutex);
+
+	Cache_Free_List(retired);
+
 	/* Added or updated, update statistics */
+	if ( dropped > 0 ) {
+		STAT_SUB(new_avg.current, dropped);
+	}
+	if ( evicted > 0 ) {
+		STAT_ADD(cache_evictions, evicted);
+	}
 	switch (state) {
 		case yes_add: // add new entry
-			STATLOCK;
 			AVERAGE_IN(&new_avg);
-			++cache_adds;			/* statistics */
-			STATUNLOCK;
-			return gbGOOD;
+			STAT_ADD1(cache_adds);			/* statistics */
+			break;
 		case just_update: // update the time mark and data
-			STATLOCK;
 			AVERAGE_MARK(&new_avg);
-			++cache_adds;			/* statistics */
-			STATUNLOCK;
-			return gbGOOD;
+			STAT_ADD1(cache_adds);			/* statistics */
+			break;
 		default: // unable to add
-			return gbBAD;
+			break;
 	}
+
+	return (state == no_add) ? gbBAD : gbGOOD;
 }
 
 /* Add an item to the cache */
@@ -701,14 +1151,10 @@ static GOOD_OR_BAD Cache_Add_Persistent(struct tree_node *tn)
 
 	switch (state) {
 	case yes_add:
-		STATLOCK;
 		AVERAGE_IN(&store_avg);
-		STATUNLOCK;
 		return gbGOOD;
 	case just_update:
-		STATLOCK;
 		AVERAGE_MARK(&store_avg);
-		STATUNLOCK;
 		return gbGOOD;
 	default:
 		return gbBAD;
@@ -719,35 +1165,40 @@ static GOOD_OR_BAD Get_Stat(struct cache_stats *scache, const enum cache_task_re
 {
 	GOOD_OR_BAD gbret = gbBAD ; // default
 	
-	STATLOCK;
-	++scache->tries;
+	STAT_ADD1(scache->tries);
 	switch ( result ) {
 		case ctr_expired:
-			++scache->expires;
+			STAT_ADD1(scache->expires);
 			break ;
 		case ctr_ok:
-			++scache->hits;
+			STAT_ADD1(scache->hits);
 			gbret = gbGOOD ;
 			break ;
 		default:
 			break ;
 	}	
-	STATUNLOCK;
 	return gbret ;
 }
 
 /* Does cache get, but doesn't allow play in data size */
-static GOOD_OR_BAD Cache_Get_Strict(void *data, size_t dsize, const struct parsedname *pn)
+static GOOD_OR_BAD Cache_Get_Strict(void *data, size_t dsize, time_t grace, const struct parsedname *pn)
 {
 	size_t size = dsize;
-	RETURN_BAD_IF_BAD( Cache_Get(data, &size, pn) ) ;
+	RETURN_BAD_IF_BAD( Cache_Get_Aged(data, &size, grace, pn) ) ;
 	return ( dsize == size) ? gbGOOD : gbBAD ;
 }
 
+/* Fresh values only, or (grace > 0) expired ones inside the stale window as well */
+static GOOD_OR_BAD Cache_Get_Aged(void *data, size_t * dsize, time_t grace, const struct parsedname *pn)
+{
+	return ( grace > 0 ) ? Cache_Get_Stale(data, dsize, grace, pn) : Cache_Get(data, dsize, pn) ;
+}
+
 
 GOOD_OR_BAD OWQ_Cache_Get(struct one_wire_query *owq)
 {
 	struct parsedname *pn = PN(owq);
+	time_t grace ;
 
 	// do check here to avoid needless processing
 	if (IsUncachedDir(pn) || IsAlarmDir(pn)) {
@@ -756,13 +1207,38 @@ GOOD_OR_BAD OWQ_Cache_Get(struct one_wire_query *owq)
 
 	switch (pn->selected_filetype->change) {
 	case fc_simultaneous_temperature:
-		return Cache_Get_Simultaneous(SlaveSpecificTag(S_T), owq) ;
 	case fc_simultaneous_voltage:
-		return Cache_Get_Simultaneous(SlaveSpecificTag(S_T), owq) ;
+		if ( GOOD( Cache_Get_Simultaneous(SlaveSpecificTag(S_T), owq) ) ) {
+			return gbGOOD ;
+		}
+		if ( OWQ_SIMUL_TEST(owq) ) {
+			// a newer conversion is waiting to be read, better than a stale value
+			return gbBAD ;
+		}
+		break ;
 	default:
+		if ( GOOD( OWQ_Cache_Get_Aged(owq, 0) ) ) {
+			return gbGOOD ;
+		}
 		break ;
 	}
 
+	// Not fresh -- the client may take an expired value (and it gets refreshed)
+	grace = Stale_Grace(pn) ;
+	if ( grace <= 0 || BAD( OWQ_Cache_Get_Aged(owq, grace) ) ) {
+		return gbBAD ;
+	}
+	LEVEL_DEBUG("Stale value of %s served", SAFESTRING(pn->path) );
+	pn->control_flags |= STALE_SERVED ;
+	Stale_Refresh(pn) ;
+	return gbGOOD ;
+}
+
+/* Cached value of a one-wire-query object, up to grace seconds past expiry */
+static GOOD_OR_BAD OWQ_Cache_Get_Aged(struct one_wire_query *owq, time_t grace)
+{
+	struct parsedname *pn = PN(owq);
+
 	if (pn->extension == EXTENSION_ALL) {
 		switch (pn->selected_filetype->format) {
 		case ft_ascii:
@@ -778,7 +1254,7 @@ GOOD_OR_BAD OWQ_Cache_Get(struct one_wire_query *owq)
 		case ft_pressure:
 		case ft_temperature:
 		case ft_tempgap:
-			return Cache_Get_Strict(OWQ_array(owq), (pn->selected_filetype->ag->elements) * sizeof(union value_object), pn);
+			return Cache_Get_Strict(OWQ_array(owq), (pn->selected_filetype->ag->elements) * sizeof(union value_object), grace, pn);
 		default:
 			return gbBAD;
 		}
@@ -792,7 +1268,7 @@ GOOD_OR_BAD OWQ_Cache_Get(struct one_wire_query *owq)
 				return gbBAD;
 			}
 			OWQ_length(owq) = OWQ_size(owq);
-			return Cache_Get(OWQ_buffer(owq), &OWQ_length(owq), pn);
+			return Cache_Get_Aged(OWQ_buffer(owq), &OWQ_length(owq), grace, pn);
 		case ft_integer:
 		case ft_unsigned:
 		case ft_yesno:
@@ -801,7 +1277,7 @@ GOOD_OR_BAD OWQ_Cache_Get(struct one_wire_query *owq)
 		case ft_pressure:
 		case ft_temperature:
 		case ft_tempgap:
-			return Cache_Get_Strict(&OWQ_val(owq), sizeof(union value_object), pn);
+			return Cache_Get_Strict(&OWQ_val(owq), sizeof(union value_object), grace, pn);
 		default:
 			return gbBAD;
 		}
@@ -836,7 +1312,29 @@ GOOD_OR_BAD Cache_Get(void *data, size_t * dsize, const struct parsedname *pn)
 	LoadTK( pn->sn, pn->selected_filetype, pn->extension, &tn );
 	return persistent ?
 		Get_Stat(&cache_pst, Cache_Get_Persistent(data, dsize, &duration, &tn)) :
-		Get_Stat(&cache_ext, Cache_Get_Common(data, dsize, &duration, &tn));
+		Get_Stat(&cache_ext, Cache_Get_Common(data, dsize, &duration, 0, &tn));
+}
+
+/* Look in the temporary cache for a value, fresh or up to grace seconds past expiry */
+/* Persistent values never expire, so never need this */
+/* No statistics -- this follows an unsuccessful Cache_Get */
+static GOOD_OR_BAD Cache_Get_Stale(void *data, size_t * dsize, time_t grace, const struct parsedname *pn)
+{
+	time_t duration;
+	struct tree_node tn;
+
+	if (IsThisPersistent(pn) || TimeOut(pn->selected_filetype->change) <= 0) {
+		return gbBAD;
+	}
+
+	LoadTK( pn->sn, pn->selected_filetype, pn->extension, &tn );
+	switch ( Cache_Get_Common(data, dsize, &duration, grace, &tn) ) {
+		case ctr_ok:
+		case ctr_stale:
+			return gbGOOD;
+		default:
+			return gbBAD;
+	}
 }
 
 /* Look in caches, 0=found and valid, 1=not or uncachable in the first place */
@@ -862,32 +1360,24 @@ static enum cache_task_return Cache_Get_Common_Dir(struct dirblob *db, time_t *
 	enum cache_task_return ctr_ret;
 	time_t now = NOW_TIME;
 	size_t size;
-	struct tree_opaque *opaque;
+	struct cache_shard *shard = Shard_Of(tn);
+	struct tree_node *found;
 	LEVEL_DEBUG("Get from cache sn " SNformat " pointer=%p extension=%d", SNvar(tn->tk.sn), tn->tk.p, tn->tk.extension);
-	CACHE_RLOCK;
-	opaque = tfind(tn, &cache.temporary_tree_new, tree_compare) ;
-	if ( opaque == NULL ) {
-		// not found in new tree
-		if ( cache.time_retired + duration[0] > now ) {
-			// old tree could be new enough
-			opaque = tfind(tn, &cache.temporary_tree_old, tree_compare) ;
-		}
-	}
-	if ( opaque != NULL ) {
-		duration[0] = opaque->key->expires - now ;
+	_MUTEX_LOCK(shard->mutex);
+	found = Shard_Find(shard, tn);
+	if ( found != NULL ) {
+		duration[0] = found->expires - now;
 		if (duration[0] >= 0) {
 			LEVEL_DEBUG("Dir found in cache");
-			size = opaque->key->dsize;
-			if (DirblobRecreate(TREE_DATA(opaque->key), size, db) == 0) {
+			size = found->dsize;
+			Shard_Touch(shard, found);
+			if (DirblobRecreate(TREE_DATA(found), size, db) == 0) {
 				//printf("Cache: snlist=%p, devices=%lu, size=%lu\n",*snlist,devices[0],size) ;
 				ctr_ret = ctr_ok;
 			} else {
 				ctr_ret = ctr_size_mismatch;
 			}
 		} else {
-			//char b[26];
-			//printf("GOT DEAD now:%s",ctime_r(&now,b)) ;
-			//printf("        then:%s",ctime_r(&opaque->key->expires,b)) ;
 			LEVEL_DEBUG("Dir expired in cache");
 			ctr_ret = ctr_expired;
 		}
@@ -895,7 +1385,7 @@ static enum cache_task_return Cache_Get_Common_Dir(struct dirblob *db, time_t *
 		LEVEL_DEBUG("Dir not found in cache");
 		ctr_ret = ctr_not_found;
 	}
-	CACHE_RUNLOCK;
+	_MUTEX_UNLOCK(shard->mutex);
 	return ctr_ret;
 }
 
@@ -911,7 +1401,7 @@ GOOD_OR_BAD Cache_Get_Device(void *bus_nr, const struct parsedname *pn)
 
 	LEVEL_DEBUG("Looking for device "SNformat, SNvar(pn->sn));
 	LoadTK( pn->sn, Device_Marker, 0, &tn ) ;
-	return Get_Stat(&cache_dev, Cache_Get_Common(bus_nr, &size, &duration, &tn));
+	return Get_Stat(&cache_dev, Cache_Get_Common(bus_nr, &size, &duration, 0, &tn));
 }
 
 /* Does cache get, but doesn't allow play in data size */
@@ -944,7 +1434,7 @@ static GOOD_OR_BAD Cache_Get_Internal(void *data, size_t * dsize, const struct i
 		case fc_persistent:
 			return Get_Stat(&cache_pst, Cache_Get_Persistent(data, dsize, &duration, &tn));
 		default:
-			return Get_Stat(&cache_int, Cache_Get_Common(data, dsize, &duration, &tn));
+			return Get_Stat(&cache_int, Cache_Get_Common(data, dsize, &duration, 0, &tn));
 	}
 }
 
@@ -971,7 +1461,7 @@ GOOD_OR_BAD Cache_Get_Simul_Time(const struct internal_prop *ip, time_t * dwell_
 	
 	FS_LoadDirectoryOnly(&pn_directory, pn);
 	LoadTK(pn_directory.sn, ip->name, 0, &tn ) ;
-	if ( Get_Stat(&cache_int, Cache_Get_Common(NULL, &dsize_simul, &duration, &tn)) ) {
+	if ( Get_Stat(&cache_int, Cache_Get_Common(NULL, &dsize_simul, &duration, 0, &tn)) ) {
 		return gbBAD ;
 	}
 	// duration_simul is time left
@@ -1002,7 +1492,7 @@ static GOOD_OR_BAD Cache_Get_Simultaneous(const struct internal_prop *ip, struct
 	
 	LoadTK( pn->sn, pn->selected_filetype, pn->extension, &tn ) ;
 	
-	if ( Get_Stat(&cache_ext, Cache_Get_Common( &OWQ_val(owq), &dsize, &time_left, &tn)) == 0 ) {
+	if ( Get_Stat(&cache_ext, Cache_Get_Common( &OWQ_val(owq), &dsize, &time_left, 0, &tn)) == 0 ) {
 		// valid cached primary data -- see if a simultaneous conversion should be used instead
 		time_t dwell_time_data = duration - time_left ;
 		
@@ -1058,43 +1548,37 @@ ASCII * Cache_Get_Alias(const BYTE * sn)
 
 /* Look in caches */
 /* duration is time left */
-/* inputs: dsize, duration, tn
+/* an expired value up to grace seconds old is also returned (ctr_stale) */
+/* inputs: dsize, duration, grace, tn
  * outputs: return value, data, dsize (updated), duration (updated)
  * */
-static enum cache_task_return Cache_Get_Common(void *data, size_t * dsize, time_t * duration, const struct tree_node *tn)
+static enum cache_task_return Cache_Get_Common(void *data, size_t * dsize, time_t * duration, time_t grace, const struct tree_node *tn)
 {
 	enum cache_task_return ctr_ret;
 	time_t now = NOW_TIME;
-	struct tree_opaque *opaque;
+	struct cache_shard *shard = Shard_Of(tn);
+	struct tree_node *found;
 	
 	LEVEL_DEBUG("Search in cache sn " SNformat " pointer=%p index=%d size=%d", SNvar(tn->tk.sn), tn->tk.p, tn->tk.extension, (int) dsize[0]);
 	//node_show(tn);
 	//new_tree();
-	CACHE_RLOCK;
-	opaque = tfind(tn, &cache.temporary_tree_new, tree_compare) ;
-	if ( opaque == NULL ) {
-		// not found in new tree
-		if ( cache.time_retired + duration[0] > now ) {
-			// retired time isn't too old for this data item
-			opaque = tfind(tn, &cache.temporary_tree_old, tree_compare) ;
-		}
-	}
-	if ( opaque != NULL ) {
+	_MUTEX_LOCK(shard->mutex);
+	found = Shard_Find(shard, tn);
+	if ( found != NULL ) {
 		// modify duration to time left (can be negative if expired)
-		duration[0] = opaque->key->expires - now ;
-		if (duration[0] > 0) {
+		duration[0] = found->expires - now;
+		if (duration[0] > 0 || -duration[0] < grace) {
 			LEVEL_DEBUG("Value found in cache. Remaining life: %d seconds.",duration[0]);
 			// Compared with >= before, but fc_second(1) always cache for 2 seconds in that case.
 			// Very noticable when reading time-data like "/26.80A742000000/date" for example.
-			if ( dsize[0] >= opaque->key->dsize) {
+			if ( dsize[0] >= found->dsize) {
 				// lower data size if stored value is shorter
-				dsize[0] = opaque->key->dsize;
-				//tree_show(opaque,leaf,0);
+				dsize[0] = found->dsize;
 				if (dsize[0] > 0) {
-					memcpy(data, TREE_DATA(opaque->key), dsize[0]);
+					memcpy(data, TREE_DATA(found), dsize[0]);
 				}
-				ctr_ret = ctr_ok;
-				//twalk(cache.temporary_tree_new,tree_show) ;
+				Shard_Touch(shard, found);
+				ctr_ret = (duration[0] > 0) ? ctr_ok : ctr_stale;
 			} else {
 				ctr_ret = ctr_size_mismatch;
 			}
@@ -1106,7 +1590,7 @@ static enum cache_task_return Cache_Get_Common(void *data, size_t * dsize, time_
 		LEVEL_DEBUG("Value not found in cache");
 		ctr_ret = ctr_not_found;
 	}
-	CACHE_RUNLOCK;
+	_MUTEX_UNLOCK(shard->mutex);
 	return ctr_ret;
 }
 
@@ -1210,7 +1694,9 @@ void Cache_Del_Alias(const BYTE * sn)
 		LoadTK( sn, Alias_Marker, 0, tn ) ;
 		Del_Stat(&cache_pst, Cache_Del_Persistent(tn));
 		Cache_Del_Alias_SN( alias_name ) ;
+		owfree(tn) ;
 	}
+	ParseCache_Flush();
 	owfree( alias_name ) ;
 }
 
@@ -1327,6 +1813,8 @@ void Cache_Del_Device(const struct parsedname *pn)
 
 	LoadTK(pn->sn, Device_Marker, 0, &tn) ;
 	Del_Stat(&cache_dev, Cache_Del_Common(&tn));
+	// this device's parsed paths may still point to the old bus
+	ParseCache_Flush_Device(pn->sn);
 }
 
 void Cache_Del_Internal(const struct internal_prop *ip, const struct parsedname *pn)
@@ -1356,27 +1844,24 @@ void Cache_Del_Internal(const struct internal_prop *ip, const struct parsedname
 
 static GOOD_OR_BAD Cache_Del_Common(const struct tree_node *tn)
 {
-	struct tree_opaque *opaque;
-	time_t now = NOW_TIME;
-	GOOD_OR_BAD ret = gbBAD;
+	struct cache_shard *shard = Shard_Of(tn);
+	struct tree_node *found;
 	LEVEL_DEBUG("Delete from cache sn " SNformat " in=%p index=%d", SNvar(tn->tk.sn), tn->tk.p, tn->tk.extension);
 
-	CACHE_WLOCK;
-	opaque = tfind(tn, &cache.temporary_tree_new, tree_compare) ;
-	if ( opaque == NULL ) {
-		// not in new tree
-		if ( cache.time_to_kill > now ) {
-			// old tree still alive
-			opaque = tfind(tn, &cache.temporary_tree_old, tree_compare) ;
-		}
+	_MUTEX_LOCK(shard->mutex);
+	found = Shard_Find(shard, tn);
+	if ( found != NULL ) {
+		Shard_Unlink(shard, found);
 	}
-	if ( opaque != NULL ) {
-		opaque->key->expires = now - 1;
-		ret = gbGOOD;
+	_MUTEX_UNLOCK(shard->mutex);
+
+	if ( found == NULL ) {
+		return gbBAD;
 	}
-	CACHE_WUNLOCK;
 
-	return ret;
+	owfree(found);
+	AVERAGE_OUT(&new_avg);
+	return gbGOOD;
 }
 
 static GOOD_OR_BAD Cache_Del_Persistent(const struct tree_node *tn)
@@ -1397,9 +1882,7 @@ static GOOD_OR_BAD Cache_Del_Persistent(const struct tree_node *tn)
 	}
 
 	owfree(tn_found);
-	STATLOCK;
 	AVERAGE_OUT(&store_avg);
-	STATUNLOCK;
 	return gbGOOD;
 }
 
@@ -1409,6 +1892,7 @@ static void LoadTK( const BYTE * sn, void * p, int extension, struct tree_node *
 	memcpy(tn->tk.sn, sn, SERIAL_NUMBER_SIZE);
 	tn->tk.p = p;
 	tn->tk.extension = extension;
+	tn->hash = tree_hash(&(tn->tk));
 }
 
 // Alias list from persistent cache
@@ -1457,6 +1941,60 @@ void Aliaslist( struct memblob * mb  )
 	PERSISTENT_RUNLOCK ;
 }
 
+/* Hand the device locations and directory lists to the snapshot writer (ow_cache_snapshot.c) */
+/* only unexpired elements, one shard locked at a time */
+void Cache_Snapshot_Walk( void (*record)(void * v, enum cache_snapshot_kind kind, const BYTE * sn, int bus_nr, const BYTE * data, size_t length), void * v )
+{
+	int shard_index;
+	time_t now = NOW_TIME;
+
+	for (shard_index = 0; shard_index < CACHE_SHARDS; ++shard_index) {
+		struct cache_shard *shard = &cache.shard[shard_index];
+		struct tree_node *tn;
+
+		_MUTEX_LOCK(shard->mutex);
+		for (tn = shard->newest; tn != NULL; tn = tn->older) {
+			if (tn->expires < now) {
+				continue;
+			}
+			if (tn->tk.p == Device_Marker && tn->dsize == sizeof(int)) {
+				int bus_nr;
+				memcpy(&bus_nr, CONST_TREE_DATA(tn), sizeof(int));
+				record(v, cache_snapshot_device, tn->tk.sn, bus_nr, NULL, 0);
+			} else if (tn->tk.p == Directory_Marker) {
+				record(v, cache_snapshot_directory, tn->tk.sn, tn->tk.extension, CONST_TREE_DATA(tn), tn->dsize);
+			}
+		}
+		_MUTEX_UNLOCK(shard->mutex);
+	}
+}
+
+/* Restore a directory list from the snapshot */
+/* sn is the directory (0 for root, else the branch) as stored by Cache_Add_Dir */
+GOOD_OR_BAD Cache_Snapshot_Add_Dir(const BYTE * sn, int bus_nr, const BYTE * snlist, size_t length)
+{
+	time_t duration = TimeOut(fc_directory);
+	struct tree_node *tn;
+
+	if (duration <= 0) {
+		return gbGOOD;				/* in case timeout set to 0 */
+	}
+	if (length == 0 || length % SERIAL_NUMBER_SIZE != 0) {
+		return gbBAD;
+	}
+
+	tn = (struct tree_node *) owmalloc(sizeof(struct tree_node) + length);
+	if (!tn) {
+		return gbBAD;
+	}
+
+	LoadTK( sn, Directory_Marker, bus_nr, tn );
+	tn->expires = duration + NOW_TIME;
+	tn->dsize = length;
+	memcpy(TREE_DATA(tn), snlist, length);
+	return Add_Stat(&cache_dir, Cache_Add_Common(tn));
+}
+
 /* Add an alias to the temporary database of name->bus */
 /* alias_name is a null-terminated string */
 void Cache_Add_Alias_Bus(const ASCII * alias_name, INDEX_OR_ERROR bus)
@@ -1489,26 +2027,26 @@ void Cache_Add_Alias_Bus(const ASCII * alias_name, INDEX_OR_ERROR bus)
 static void Cache_Add_Alias_Common(struct alias_tree_node *atn)
 {
 	struct tree_opaque *opaque;
+	int flipped = 0;
 
 	CACHE_WLOCK;
 	if (cache.time_to_kill < NOW_TIME) {	// old database has timed out
 		FlipTree() ;
+		flipped = 1;
 	}
-	if (Globals.cache_size && (cache.old_ram_size + cache.new_ram_size > Globals.cache_size)) {
-		// failed size test
-		owfree(atn);
-	} else if ((opaque = tsearch(atn, &cache.temporary_alias_tree_new, alias_tree_compare))) {
+	if ((opaque = tsearch(atn, &cache.temporary_alias_tree_new, alias_tree_compare))) {
 		if ( (void *)atn != (void *) (opaque->key) ) {
-			cache.new_ram_size += sizeof(atn) - sizeof(opaque->key);
 			owfree(opaque->key);
 			opaque->key = (void *) atn;
-		} else {
-			cache.new_ram_size += sizeof(atn);
 		}
 	} else {					// nothing found or added?!? free our memory segment
 		owfree(atn);
 	}
 	CACHE_WUNLOCK;
+	if (flipped) {
+		// parsed paths hold alias and device locations
+		ParseCache_Flush();
+	}
 }
 
 /* Add an alias/sn to the persistent database of name->sn */
@@ -1672,13 +2210,15 @@ static void Cache_Del_Alias_Persistent( struct alias_tree_node * atn)
 	struct tree_opaque *opaque;
 	struct alias_tree_node *atn_found = NULL;
 
-	PERSISTENT_RLOCK;
+	PERSISTENT_WLOCK;
 	opaque = tfind(atn, &cache.persistent_alias_tree, alias_tree_compare) ;
 	if ( opaque != NULL ) {
 		atn_found = (struct alias_tree_node *) (opaque->key);
+		tdelete(atn, &cache.persistent_alias_tree, alias_tree_compare);
 	}
-	PERSISTENT_RUNLOCK;
-	owfree(atn_found) ;
+	PERSISTENT_WUNLOCK;
+	SAFEFREE(atn_found) ;
+	owfree(atn) ;
 }
 
 /* Delete bus from alias name */
@@ -1688,4 +2228,5 @@ void Cache_Del_Alias_Bus(const ASCII * alias_name)
 	// Cheat -- just change to a bad bus value
 	LEVEL_DEBUG("Hide %s",alias_name) ;
 	Cache_Add_Alias_Bus( alias_name, INDEX_BAD ) ;
+	ParseCache_Flush();
 }
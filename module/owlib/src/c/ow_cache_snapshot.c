@@ -0,0 +1,469 @@
+/*
+    OWFS -- One-Wire filesystem
+    OWHTTPD -- One-Wire Web Server
+    Written 2003 Paul H Alfille
+    email: paul.alfille@gmail.com
+    Released under the GPL
+    See the header file: ow.h for full attribution
+    1wire/iButton system from Dallas Semiconductor
+*/
+
+/* Cache snapshot for a warm restart
+ * --cache_snapshot=FILE[ --cache_snapshot_period=SECONDS]
+ *
+ * The file holds what is expensive to learn again after a restart:
+ *   device locations (which bus each device was found on),
+ *   directory lists (the last search of each bus and branch),
+ *   and the alias assignments.
+ * It is written at shutdown and every period seconds (to FILE.tmp, then renamed)
+ * and read (mmap) once the buses are set up.
+ *
+ * Restored elements are treated as freshly added and go through the usual checks:
+ *   a moved device is found again when the cached bus doesn't answer,
+ *   directories are searched again when they time out.
+ * Records for a bus are only used if the same bus (index and device name) exists now.
+ * Aliases already assigned (--alias file) take precedence.
+ *
+ * The format is native (same machine) -- a header, then records of
+ *   struct cache_snapshot_record followed by length bytes of data.
+ * */
+
+#include <config.h>
+#include "owfs_config.h"
+#include "ow.h"
+#include "ow_connection.h"
+
+#ifdef HAVE_SYS_MMAN_H
+#include <sys/mman.h>
+#endif							/* HAVE_SYS_MMAN_H */
+
+#define CACHE_SNAPSHOT_MAGIC     "OWCACHE1"
+
+struct cache_snapshot_header {
+	char magic[8];
+	UINT record_size;			// sizeof(struct cache_snapshot_record) -- catches a foreign file
+	UINT records;
+	time_t written;
+};
+
+struct cache_snapshot_record {
+	int kind;					// enum cache_snapshot_kind
+	int bus_nr;
+	BYTE sn[SERIAL_NUMBER_SIZE];
+	UINT length;				// bytes of data following
+};
+
+/* buses of the snapshot that match a current bus */
+struct cache_snapshot_bus {
+	int bus_nr;
+	int matches;
+};
+
+struct cache_snapshot_count {
+	struct memblob *mb;
+	UINT records;
+	UINT devices;
+	UINT directories;
+};
+
+static struct {
+	pthread_t thread;
+	pthread_mutex_t mutex;
+	pthread_cond_t cond;
+	int started;
+	int stopping;
+} snapshot_control;
+
+static void Cache_Snapshot_Record(void *v, enum cache_snapshot_kind kind, const BYTE * sn, int bus_nr, const BYTE * data, size_t length);
+static void Cache_Snapshot_Restore(const BYTE * map, size_t size);
+static void Cache_Snapshot_Restore_Aliases(const BYTE * data, size_t length);
+static int Cache_Snapshot_Bus_Matches(const struct cache_snapshot_bus *buses, int count, int bus_nr);
+static GOOD_OR_BAD Cache_Snapshot_Save(const char *file, struct memblob *mb);
+static void *Cache_Snapshot_Thread(void *v);
+
+/* ------- Writing ------------ */
+
+static void Cache_Snapshot_Record(void *v, enum cache_snapshot_kind kind, const BYTE * sn, int bus_nr, const BYTE * data, size_t length)
+{
+	struct cache_snapshot_count *count = v;
+	struct cache_snapshot_record record;
+
+	memset(&record, 0, sizeof(record));
+	record.kind = kind;
+	record.bus_nr = bus_nr;
+	if (sn != NULL) {
+		memcpy(record.sn, sn, SERIAL_NUMBER_SIZE);
+	}
+	record.length = length;
+
+	MemblobAdd((const BYTE *) &record, sizeof(record), count->mb);
+	if (length > 0) {
+		MemblobAdd(data, length, count->mb);
+	}
+	++count->records;
+	switch (kind) {
+	case cache_snapshot_device:
+		++count->devices;
+		break;
+	case cache_snapshot_directory:
+		++count->directories;
+		break;
+	default:
+		break;
+	}
+}
+
+/* Write the snapshot file (if one was requested) */
+GOOD_OR_BAD Cache_Snapshot_Write(void)
+{
+	struct memblob mb;
+	struct memblob aliases;
+	struct cache_snapshot_header header;
+	struct cache_snapshot_count count = { &mb, 0, 0, 0, };
+	struct port_in *pin;
+	GOOD_OR_BAD ret;
+
+	if (Globals.cache_snapshot == NULL) {
+		return gbGOOD;
+	}
+
+	MemblobInit(&mb, 4096);
+	memset(&header, 0, sizeof(header));
+	MemblobAdd((const BYTE *) &header, sizeof(header), &mb);
+
+	// bus table first, so the reader knows which buses still match
+	CONNIN_RLOCK;
+	for (pin = Inbound_Control.head_port; pin != NULL; pin = pin->next) {
+		struct connection_in *in;
+		for (in = pin->first; in != NO_CONNECTION; in = in->next) {
+			const char *name = SAFESTRING(DEVICENAME(in));
+			Cache_Snapshot_Record(&count, cache_snapshot_bus, NULL, in->index, (const BYTE *) name, strlen(name));
+		}
+	}
+	CONNIN_RUNLOCK;
+
+	Cache_Snapshot_Walk(Cache_Snapshot_Record, &count);
+
+	// aliases in alias file format
+	MemblobInit(&aliases, 1024);
+	Aliaslist(&aliases);
+	if (MemblobPure(&aliases) && MemblobLength(&aliases) > 0) {
+		Cache_Snapshot_Record(&count, cache_snapshot_aliases, NULL, 0, MemblobData(&aliases), MemblobLength(&aliases));
+	}
+	MemblobClear(&aliases);
+
+	if (!MemblobPure(&mb)) {
+		LEVEL_DEBUG("Out of memory for the cache snapshot");
+		MemblobClear(&mb);
+		return gbBAD;
+	}
+
+	memcpy(header.magic, CACHE_SNAPSHOT_MAGIC, sizeof(header.magic));
+	header.record_size = sizeof(struct cache_snapshot_record);
+	header.records = count.records;
+	header.written = NOW_TIME;
+	memcpy(MemblobData(&mb), &header, sizeof(header));
+
+	ret = Cache_Snapshot_Save(Globals.cache_snapshot, &mb);
+	if (GOOD(ret)) {
+		LEVEL_DEBUG("Cache snapshot %s: %u devices, %u directories", Globals.cache_snapshot, count.devices, count.directories);
+	}
+	MemblobClear(&mb);
+	return ret;
+}
+
+/* Write to FILE.tmp and rename, so a reader never sees half a file */
+static GOOD_OR_BAD Cache_Snapshot_Save(const char *file, struct memblob *mb)
+{
+	size_t length = MemblobLength(mb);
+	const BYTE *data = MemblobData(mb);
+	char *tmp = owmalloc(strlen(file) + 5);
+	int fd;
+
+	if (tmp == NULL) {
+		return gbBAD;
+	}
+	strcpy(tmp, file);
+	strcat(tmp, ".tmp");
+
+	fd = open(tmp, O_WRONLY | O_CREAT | O_TRUNC, 0600);
+	if (fd < 0) {
+		ERROR_DEFAULT("Cannot write cache snapshot %s", tmp);
+		owfree(tmp);
+		return gbBAD;
+	}
+	while (length > 0) {
+		ssize_t written = write(fd, data, length);
+		if (written < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+			break;
+		}
+		data += written;
+		length -= written;
+	}
+	if (close(fd) != 0 || length > 0) {
+		ERROR_DEFAULT("Cannot write cache snapshot %s", tmp);
+		unlink(tmp);
+		owfree(tmp);
+		return gbBAD;
+	}
+	if (rename(tmp, file) != 0) {
+		ERROR_DEFAULT("Cannot rename cache snapshot %s to %s", tmp, file);
+		unlink(tmp);
+		owfree(tmp);
+		return gbBAD;
+	}
+	owfree(tmp);
+	return gbGOOD;
+}
+
+/* ------- Reading ------------ */
+
+/* Load the snapshot file (if one was requested and exists)
+ * Called once the buses are set up (single threaded) */
+void Cache_Snapshot_Load(void)
+{
+	struct stat st;
+	BYTE *map;
+	int fd;
+
+	if (Globals.cache_snapshot == NULL) {
+		return;
+	}
+
+	fd = open(Globals.cache_snapshot, O_RDONLY);
+	if (fd < 0) {
+		LEVEL_DEBUG("No cache snapshot %s to load", Globals.cache_snapshot);
+		return;
+	}
+	if (fstat(fd, &st) != 0 || st.st_size < (off_t) sizeof(struct cache_snapshot_header)) {
+		LEVEL_DEBUG("Cache snapshot %s is too short", Globals.cache_snapshot);
+		close(fd);
+		return;
+	}
+
+#ifdef HAVE_SYS_MMAN_H
+	map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	if (map == MAP_FAILED) {
+		ERROR_DEBUG("Cannot map cache snapshot %s", Globals.cache_snapshot);
+		close(fd);
+		return;
+	}
+	Cache_Snapshot_Restore(map, st.st_size);
+	munmap(map, st.st_size);
+#else							/* HAVE_SYS_MMAN_H */
+	map = owmalloc(st.st_size);
+	if (map == NULL) {
+		close(fd);
+		return;
+	}
+	if (read(fd, map, st.st_size) == st.st_size) {
+		Cache_Snapshot_Restore(map, st.st_size);
+	}
+	owfree(map);
+#endif							/* HAVE_SYS_MMAN_H */
+	close(fd);
+}
+
+static int Cache_Snapshot_Bus_Matches(const struct cache_snapshot_bus *buses, int count, int bus_nr)
+{
+	int i;
+
+	for (i = 0; i < count; ++i) {
+		if (buses[i].bus_nr == bus_nr) {
+			return buses[i].matches;
+		}
+	}
+	return 0;
+}
+
+static void Cache_Snapshot_Restore(const BYTE * map, size_t size)
+{
+	struct cache_snapshot_header header;
+	struct cache_snapshot_bus *buses;
+	int bus_count = 0;
+	size_t offset = sizeof(header);
+	UINT devices = 0;
+	UINT directories = 0;
+	UINT record_index;
+
+	memcpy(&header, map, sizeof(header));
+	if (memcmp(header.magic, CACHE_SNAPSHOT_MAGIC, sizeof(header.magic)) != 0 || header.record_size != sizeof(struct cache_snapshot_record)) {
+		LEVEL_DEFAULT("Cache snapshot %s is not in a usable format", Globals.cache_snapshot);
+		return;
+	}
+
+	buses = owcalloc(header.records + 1, sizeof(struct cache_snapshot_bus));
+	if (buses == NULL) {
+		return;
+	}
+
+	for (record_index = 0; record_index < header.records; ++record_index) {
+		struct cache_snapshot_record record;
+		const BYTE *data;
+
+		if (size - offset < sizeof(record)) {
+			break;
+		}
+		memcpy(&record, &map[offset], sizeof(record));
+		offset += sizeof(record);
+		if (size - offset < record.length) {
+			break;
+		}
+		data = &map[offset];
+		offset += record.length;
+
+		switch (record.kind) {
+		case cache_snapshot_bus:
+			{
+				struct connection_in *in;
+				buses[bus_count].bus_nr = record.bus_nr;
+				CONNIN_RLOCK;
+				in = find_connection_in(record.bus_nr);
+				if (in != NO_CONNECTION) {
+					const char *name = SAFESTRING(DEVICENAME(in));
+					buses[bus_count].matches = (strlen(name) == record.length) && (memcmp(name, data, record.length) == 0);
+				}
+				CONNIN_RUNLOCK;
+				if (!buses[bus_count].matches) {
+					LEVEL_DEBUG("Cache snapshot bus.%d has changed, its entries are skipped", record.bus_nr);
+				}
+				++bus_count;
+			}
+			break;
+		case cache_snapshot_device:
+			if (Cache_Snapshot_Bus_Matches(buses, bus_count, record.bus_nr) && GOOD(Cache_Add_Device(record.bus_nr, record.sn))) {
+				++devices;
+			}
+			break;
+		case cache_snapshot_directory:
+			if (Cache_Snapshot_Bus_Matches(buses, bus_count, record.bus_nr) && GOOD(Cache_Snapshot_Add_Dir(record.sn, record.bus_nr, data, record.length))) {
+				++directories;
+			}
+			break;
+		case cache_snapshot_aliases:
+			Cache_Snapshot_Restore_Aliases(data, record.length);
+			break;
+		default:
+			break;
+		}
+	}
+	owfree(buses);
+
+	if (record_index < header.records) {
+		LEVEL_DEFAULT("Cache snapshot %s is truncated", Globals.cache_snapshot);
+	}
+	LEVEL_CONNECT("Cache snapshot %s (%ld seconds old): %u devices, %u directories restored", Globals.cache_snapshot, (long) (NOW_TIME - header.written), devices, directories);
+}
+
+/* Alias file format lines (SERIALNUMBER=name) */
+/* Names and serial numbers already assigned are left alone */
+static void Cache_Snapshot_Restore_Aliases(const BYTE * data, size_t length)
+{
+	char *text = owmalloc(length + 1);
+	char *rest = text;
+	char *line;
+
+	if (text == NULL) {
+		return;
+	}
+	memcpy(text, data, length);
+	text[length] = '\0';
+
+	while ((line = strsep(&rest, "\r\n")) != NULL) {
+		BYTE sn[SERIAL_NUMBER_SIZE];
+		BYTE sn_stored[SERIAL_NUMBER_SIZE];
+		char *name = strchr(line, '=');
+		ASCII *alias_name;
+
+		if (name == NULL) {
+			continue;
+		}
+		name[0] = '\0';
+		++name;
+		if (Parse_SerialNumber(line, sn) != sn_valid || name[0] == '\0') {
+			continue;
+		}
+		if (GOOD(Cache_Get_Alias_SN(name, sn_stored))) {
+			continue;
+		}
+		alias_name = Cache_Get_Alias(sn);
+		if (alias_name != NULL) {
+			owfree(alias_name);
+			continue;
+		}
+		Test_and_Add_Alias(name, sn);
+	}
+	owfree(text);
+}
+
+/* ------- Periodic writer ------------ */
+
+/* Start the periodic writer
+ * Called once we are in the background (threads don't survive a fork) */
+void Cache_Snapshot_Start(void)
+{
+	if (Globals.cache_snapshot == NULL || Globals.cache_snapshot_period <= 0 || snapshot_control.started) {
+		return;
+	}
+
+	_MUTEX_INIT(snapshot_control.mutex);
+	my_pthread_cond_init(&(snapshot_control.cond), NULL);
+	snapshot_control.stopping = 0;
+	if (pthread_create(&(snapshot_control.thread), DEFAULT_THREAD_ATTR, Cache_Snapshot_Thread, NULL) != 0) {
+		LEVEL_DEBUG("Cannot create cache snapshot thread");
+		my_pthread_cond_destroy(&(snapshot_control.cond));
+		_MUTEX_DESTROY(snapshot_control.mutex);
+		return;
+	}
+	snapshot_control.started = 1;
+}
+
+/* End the periodic writer and write a final snapshot */
+void Cache_Snapshot_Stop(void)
+{
+	if (snapshot_control.started) {
+		_MUTEX_LOCK(snapshot_control.mutex);
+		snapshot_control.stopping = 1;
+		my_pthread_cond_broadcast(&(snapshot_control.cond));
+		_MUTEX_UNLOCK(snapshot_control.mutex);
+
+		pthread_join(snapshot_control.thread, NULL);
+		my_pthread_cond_destroy(&(snapshot_control.cond));
+		_MUTEX_DESTROY(snapshot_control.mutex);
+		snapshot_control.started = 0;
+	}
+	Cache_Snapshot_Write();
+}
+
+static void *Cache_Snapshot_Thread(void *v)
+{
+	(void) v;
+	LEVEL_DEBUG("Cache snapshot every %d seconds to %s", Globals.cache_snapshot_period, Globals.cache_snapshot);
+
+	while (1) {
+		struct timespec ts;
+		int stopping;
+
+		ts.tv_sec = time(NULL) + Globals.cache_snapshot_period;
+		ts.tv_nsec = 0;
+
+		_MUTEX_LOCK(snapshot_control.mutex);
+		while (!snapshot_control.stopping) {
+			// ETIMEDOUT is the usual wakeup
+			if (pthread_cond_timedwait(&(snapshot_control.cond), &(snapshot_control.mutex), &ts) == ETIMEDOUT) {
+				break;
+			}
+		}
+		stopping = snapshot_control.stopping;
+		_MUTEX_UNLOCK(snapshot_control.mutex);
+
+		if (stopping) {
+			break;
+		}
+		Cache_Snapshot_Write();
+	}
+	return VOID_RETURN;
+}
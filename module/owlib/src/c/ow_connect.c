@@ -14,6 +14,7 @@
 #include "ow_connection.h"
 
 static struct connection_in *AllocIn(const struct connection_in *old_in) ;
+static void RemovePort_low( struct port_in * pin, int linked ) ;
 
 /* Routines for handling a linked list of connections in*/
 /* typical connection in would be the serial port or USB */
@@ -26,6 +27,7 @@ struct inbound_control Inbound_Control = {
 	.next_fake = 0,
 	.next_tester = 0,
 	.next_mock = 0,
+	.next_sim = 0,
 	.w1_monitor = NO_CONNECTION ,
 	.external = NO_CONNECTION ,
 };
@@ -115,13 +117,19 @@ static struct connection_in *AllocIn(const struct connection_in *old_in)
 		new_in->branch.branch = eBranch_bad ;
 		/* Arbitrary guess at root directory size for allocating cache blob */
 		new_in->last_root_devs = 10;
+		/* No full search yet (the list isn't shared with a copied bus) */
+		DirblobInit(&(new_in->last_root_dir));
+		new_in->last_full_search = 0;
 		new_in->AnyDevices = anydevices_unknown ;
 
+		INBOUNDLOCK ;
 		++Inbound_Control.active ;
 		new_in->index = Inbound_Control.next_index++;
+		INBOUNDUNLOCK ;
 		_MUTEX_INIT(new_in->bus_mutex);
 		_MUTEX_INIT(new_in->dev_mutex);
 		new_in->dev_db = NULL;
+		DeviceLockTableInit(new_in);
 	} else {
 		LEVEL_DEFAULT("Cannot allocate memory for bus master structure");
 	}
@@ -148,6 +156,8 @@ struct port_in * AllocPort( const struct port_in * old_pin )
 		
 		// never copy file_descriptor (it's unique to port)
 		new_pin->file_descriptor = FILE_DESCRIPTOR_BAD ;
+		// nor the fan-out worker (set up in LinkPort)
+		memset( &(new_pin->worker), 0, sizeof(struct port_worker) ) ;
 		new_pin->type = ct_unknown ;
 		new_pin->state = cs_virgin ;
 
@@ -181,6 +191,7 @@ struct port_in *LinkPort(struct port_in *pin)
 		Inbound_Control.head_port = pin ;
 
 		_MUTEX_INIT(pin->port_mutex);
+		PortWorker_Init(pin);
 	}
 	return pin;
 }
@@ -216,6 +227,7 @@ void RemoveIn( struct connection_in * conn )
 	pin = conn->pown ;
 
 	/* First unlink from list */
+	INBOUNDLOCK ;
 	if ( pin == NULL ) {
 		// free-floating
 	} else if ( pin->first == conn ) {
@@ -236,15 +248,20 @@ void RemoveIn( struct connection_in * conn )
 			}
 		}
 	}
-
 	if ( conn->index == Inbound_Control.next_index-1 ) {
 		Inbound_Control.next_index-- ;
 	}
+	INBOUNDUNLOCK ;
+
+	/* parsed paths may point to this bus */
+	ParseCache_Flush() ;
 
 	/* Now free up thread-sync resources */
 	_MUTEX_DESTROY(conn->bus_mutex);
 	_MUTEX_DESTROY(conn->dev_mutex);
 	SAFETDESTROY( conn->dev_db, owfree_func);
+	DeviceLockTableClear(conn);
+	DirblobClear(&(conn->last_root_dir));
 
 	/* Free port */
 	COM_free( conn ) ;
@@ -257,19 +274,36 @@ void RemoveIn( struct connection_in * conn )
 }
 
 void RemovePort( struct port_in * pin )
+{
+	RemovePort_low( pin, 1 ) ;
+}
+
+/* A port known not to be in the list (e.g. given up on while detected off the list)
+ * The list isn't touched, so no CONNIN lock is needed */
+void RemoveUnlinkedPort( struct port_in * pin )
+{
+	RemovePort_low( pin, 0 ) ;
+}
+
+static void RemovePort_low( struct port_in * pin, int linked )
 {
 	/* NULL safe */
 	if ( pin == NULL ) {
 		return ;
 	}
 
+	/* Fan-out worker can't have jobs for a port being removed */
+	PortWorker_Stop( pin ) ;
+
 	/* First delete connections */
 	while ( pin->first != NO_CONNECTION ) {
 		RemoveIn( pin->first ) ;
 	}
 
 	/* Next unlink from list */
-	if ( pin == Inbound_Control.head_port ) {
+	if ( ! linked ) {
+		// nothing to do
+	} else if ( pin == Inbound_Control.head_port ) {
 		/* Head of list, easy */
 		Inbound_Control.head_port = pin->next ;
 	} else {
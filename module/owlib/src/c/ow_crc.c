@@ -75,12 +75,10 @@ BYTE CRC8(const BYTE * bytes, const size_t length)
 BYTE CRC8seeded(const BYTE * bytes, const size_t length, const UINT seed)
 {
 	BYTE r = CRC8compute(bytes, length, seed);
-	STATLOCK;
-	++CRC8_tries;				/* statistics */
+	STAT_ADD1(CRC8_tries);				/* statistics */
 	if (r) {
-		++CRC8_errors;			/* statistics */
+		STAT_ADD1(CRC8_errors);			/* statistics */
 	}
-	STATUNLOCK;
 	return r;
 }
 
@@ -91,11 +89,10 @@ int CRC16(const BYTE * bytes, const size_t length)
 	return CRC16seeded(bytes, length, 0);
 }
 
-/* Returns 0 for good match */
-int CRC16seeded(const BYTE * bytes, const size_t length, const UINT seed)
+/* Raw CRC16 accumulator -- a slave sends the inverse, low byte first */
+UINT CRC16compute(const BYTE * bytes, const size_t length, const UINT seed)
 {
 	UINT sd = seed;
-	int ret;
 	size_t i;
 
 	for (i = 0; i < length; ++i) {
@@ -107,14 +104,21 @@ int CRC16seeded(const BYTE * bytes, const size_t length, const UINT seed)
 		sd ^= (c <<= 6);
 		sd ^= (c << 1);
 	}
-	STATLOCK;
-	++CRC16_tries;				/* statistics */
+	return sd;
+}
+
+/* Returns 0 for good match */
+int CRC16seeded(const BYTE * bytes, const size_t length, const UINT seed)
+{
+	UINT sd = CRC16compute(bytes, length, seed);
+	int ret;
+
+	STAT_ADD1(CRC16_tries);				/* statistics */
 	if (sd == 0xB001) {
 		ret = 0;				/* good */
 	} else {
 		ret = -1;				/* error */
-		++CRC16_errors;			/* statistics */
+		STAT_ADD1(CRC16_errors);			/* statistics */
 	}
-	STATUNLOCK;
 	return ret;
 }
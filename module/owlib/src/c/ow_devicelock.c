@@ -19,14 +19,39 @@ struct devlock {
 	pthread_mutex_t lock;
 	BYTE sn[SERIAL_NUMBER_SIZE];
 	UINT users;
+	struct devlock_bucket * bucket ; // owning bucket of the table, NULL for a tree devlock
 };
 
+/*
+Each bus has a fixed table of devlock slots, made once with the bus.
+A serial number hashes to one bucket, and is looked for among that bucket's
+slots (open addressing within the bucket). A slot with no users is free.
+The slot mutexes are made once, so the common path allocates nothing and
+only takes the bucket's mutex for an instant.
+
+When every slot of a bucket is busy, the device gets a devlock from the old
+tree instead. While any such overflow devlock exists for a bucket, devices
+that aren't already in its slots keep using the tree, so a device never has
+two devlocks at once.
+*/
+#define DEVLOCK_BUCKETS  16
+#define DEVLOCK_WAYS     4
+
+struct devlock_bucket {
+	pthread_mutex_t mutex ;
+	UINT overflow ; // users of tree devlocks that hash to this bucket
+	struct devlock slot[DEVLOCK_WAYS] ;
+} ;
+
+struct devlock_table {
+	struct devlock_bucket bucket[DEVLOCK_BUCKETS] ;
+} ;
 
 /*
-We keep all the devlocks, organized in a tree for faster searching.
+We keep the overflow devlocks, organized in a tree for faster searching.
 */
-#define DEVTREE_LOCK(pn)           _MUTEX_LOCK(   ((pn)->selected_connection)->dev_mutex )
-#define DEVTREE_UNLOCK(pn)         _MUTEX_UNLOCK( ((pn)->selected_connection)->dev_mutex )
+#define DEVTREE_LOCK(in)           _MUTEX_LOCK(   (in)->dev_mutex )
+#define DEVTREE_UNLOCK(in)         _MUTEX_UNLOCK( (in)->dev_mutex )
 
 /* Bad bad C library */
 /* implementation of tfind, tsearch returns an opaque structure */
@@ -47,22 +72,147 @@ static int dev_compare(const void *a, const void *b)
 	return memcmp(&((const struct devlock *) a)->sn, &((const struct devlock *) b)->sn, SERIAL_NUMBER_SIZE);
 }
 
-/* Grabs a device lock, either one already matching, or creates one */
-/* called per-adapter */
-/* The device locks (devlock) are kept in a tree */
-ZERO_OR_ERROR DeviceLockGet(struct parsedname *pn)
+void DeviceLockTableInit(struct connection_in *in)
+{
+	struct devlock_table * table = owmalloc( sizeof(struct devlock_table) ) ;
+	int b, w ;
+
+	in->dev_table = table ;
+	if ( table == NULL ) {
+		// Still works, all devlocks come from the tree
+		LEVEL_DEBUG("Cannot allocate device lock table, using the tree alone");
+		STAT_SET( in->bus_stat[e_bus_devlock_slots], 0 ) ;
+		return ;
+	}
+	for ( b = 0 ; b < DEVLOCK_BUCKETS ; ++b ) {
+		struct devlock_bucket * bucket = &(table->bucket[b]) ;
+		_MUTEX_INIT(bucket->mutex);
+		bucket->overflow = 0 ;
+		for ( w = 0 ; w < DEVLOCK_WAYS ; ++w ) {
+			_MUTEX_INIT(bucket->slot[w].lock);
+			bucket->slot[w].users = 0 ;
+			bucket->slot[w].bucket = bucket ;
+		}
+	}
+	STAT_SET( in->bus_stat[e_bus_devlock_slots], DEVLOCK_BUCKETS * DEVLOCK_WAYS ) ;
+	STAT_SET( in->bus_stat[e_bus_devlock_in_use], 0 ) ;
+	STAT_SET( in->bus_stat[e_bus_devlock_peak], 0 ) ;
+	STAT_SET( in->bus_stat[e_bus_devlock_overflows], 0 ) ;
+}
+
+// Only when the bus is being removed, with no devlocks held
+void DeviceLockTableClear(struct connection_in *in)
+{
+	struct devlock_table * table = in->dev_table ;
+	int b, w ;
+
+	if ( table == NULL ) {
+		return ;
+	}
+	for ( b = 0 ; b < DEVLOCK_BUCKETS ; ++b ) {
+		struct devlock_bucket * bucket = &(table->bucket[b]) ;
+		for ( w = 0 ; w < DEVLOCK_WAYS ; ++w ) {
+			_MUTEX_DESTROY(bucket->slot[w].lock);
+		}
+		_MUTEX_DESTROY(bucket->mutex);
+	}
+	owfree(table) ;
+	in->dev_table = NULL ;
+}
+
+static struct devlock_bucket * DeviceLockBucket( const BYTE * sn, struct connection_in *in )
+{
+	UINT hash = 0 ;
+	int i ;
+
+	if ( in->dev_table == NULL ) {
+		return NULL ;
+	}
+	for ( i = 0 ; i < SERIAL_NUMBER_SIZE ; ++i ) {
+		hash = hash * 31 + sn[i] ;
+	}
+	return &(in->dev_table->bucket[ ( hash ^ ( hash >> 8 ) ) % DEVLOCK_BUCKETS ]) ;
+}
+
+/* Find the slot in use by this device, or a free slot for it */
+/* NULL means use the tree. Called with the bucket mutex held */
+static struct devlock * DeviceLockSlot( const BYTE * sn, struct devlock_bucket * bucket )
+{
+	struct devlock * free_slot = NULL ;
+	int w ;
+
+	for ( w = 0 ; w < DEVLOCK_WAYS ; ++w ) {
+		struct devlock * slot = &(bucket->slot[w]) ;
+		if ( slot->users == 0 ) {
+			if ( free_slot == NULL ) {
+				free_slot = slot ;
+			}
+		} else if ( memcmp( slot->sn, sn, SERIAL_NUMBER_SIZE ) == 0 ) {
+			return slot ;
+		}
+	}
+	if ( bucket->overflow > 0 ) {
+		// The device might already have a tree devlock
+		return NULL ;
+	}
+	return free_slot ;
+}
+
+/* Find or create the devlock in the tree, and claim it */
+/* called with the bucket mutex (if any) held */
+static struct devlock * DeviceLockTree( const BYTE * sn, struct connection_in *in )
 {
 	struct devlock *local_devicelock;
 	struct devlock *tree_devicelock;
 	struct dev_opaque *opaque;
 
+	// Create a devlock block to add to the tree
+	local_devicelock = owmalloc(sizeof(struct devlock)) ;
+	if ( local_devicelock == NULL ) {
+		return NULL ;
+	}
+	memcpy(local_devicelock->sn, sn, SERIAL_NUMBER_SIZE);
+	local_devicelock->bucket = NULL ;
+
+	DEVTREE_LOCK(in);
+	/* in->dev_db points to the root of a tree of queries that are using this device */
+	opaque = (struct dev_opaque *)tsearch(local_devicelock, &(in->dev_db), dev_compare) ;
+	if ( opaque == NULL ) {	// unfound and uncreatable
+		DEVTREE_UNLOCK(in);
+		owfree(local_devicelock); // kill the allocated devlock
+		return NULL ;
+	}
+	
+	tree_devicelock = opaque->key ;
+	if ( local_devicelock == tree_devicelock) {	// new device slot
+		// No longer "local" -- the local_device lock now belongs to the device_tree
+		// It will need to be freed later, when the user count returns to zero.
+		_MUTEX_INIT(tree_devicelock->lock);	// create a mutex
+		tree_devicelock->users = 0 ;
+	} else {					// existing device slot
+		owfree(local_devicelock); // kill the locally allocated devlock (since there already is a matching devlock)	
+	}
+	++(tree_devicelock->users); // add our claim to the device
+	DEVTREE_UNLOCK(in);
+	return tree_devicelock ;
+}
+
+/* Grabs a device lock, either one already matching, or a free one */
+/* called per-adapter */
+/* The device locks (devlock) are kept in a table, with a tree for overflow */
+ZERO_OR_ERROR DeviceLockGet(struct parsedname *pn)
+{
+	struct connection_in * in = pn->selected_connection ;
+	struct devlock_bucket * bucket ;
+	struct devlock * devicelock ;
+
 	if (pn->selected_device == DeviceSimultaneous) {
 		/* Shouldn't call DeviceLockGet() on DeviceSimultaneous. No sn exists */
 		return 0;
 	}
 
 	/* Cannot lock without knowing which bus since the device trees are bus-specific */
-	if (pn->selected_connection == NO_CONNECTION) {
+	if (in == NO_CONNECTION) {
 		return -EINVAL ;
 	}
 
@@ -90,55 +240,85 @@ ZERO_OR_ERROR DeviceLockGet(struct parsedname *pn)
 			break;
 	}
 
-	// Create a devlock block to add to the tree
-	local_devicelock = owmalloc(sizeof(struct devlock)) ;
-	if ( local_devicelock == NULL ) {
-		return -ENOMEM;
+	bucket = DeviceLockBucket( pn->sn, in ) ;
+	if ( bucket == NULL ) {
+		// No table
+		devicelock = DeviceLockTree( pn->sn, in ) ;
+	} else {
+		_MUTEX_LOCK(bucket->mutex);
+		devicelock = DeviceLockSlot( pn->sn, bucket ) ;
+		if ( devicelock != NULL ) {
+			if ( devicelock->users == 0 ) {
+				// newly claimed slot
+				UINT in_use ;
+				memcpy(devicelock->sn, pn->sn, SERIAL_NUMBER_SIZE);
+				STAT_ADD1_BUS(e_bus_devlock_in_use, in);
+				in_use = STAT_GET( in->bus_stat[e_bus_devlock_in_use] ) ;
+				STAT_MAX( in->bus_stat[e_bus_devlock_peak], in_use ) ;
+			}
+			++(devicelock->users); // add our claim to the device
+		} else {
+			devicelock = DeviceLockTree( pn->sn, in ) ;
+			if ( devicelock != NULL ) {
+				++bucket->overflow ;
+				STAT_ADD1_BUS(e_bus_devlock_overflows, in);
+			}
+		}
+		_MUTEX_UNLOCK(bucket->mutex);
 	}
-	memcpy(local_devicelock->sn, pn->sn, SERIAL_NUMBER_SIZE);
 
-	DEVTREE_LOCK(pn);
-	/* in->dev_db points to the root of a tree of queries that are using this device */
-	opaque = (struct dev_opaque *)tsearch(local_devicelock, &(pn->selected_connection->dev_db), dev_compare) ;
-	if ( opaque == NULL ) {	// unfound and uncreatable
-		DEVTREE_UNLOCK(pn);
-		owfree(local_devicelock); // kill the allocated devlock
+	if ( devicelock == NULL ) {
 		return -ENOMEM;
 	}
-	
-	tree_devicelock = opaque->key ;
-	if ( local_devicelock == tree_devicelock) {	// new device slot
-		// No longer "local" -- the local_device lock now belongs to the device_tree
-		// It will need to be freed later, when the user count returns to zero.
-		_MUTEX_INIT(tree_devicelock->lock);	// create a mutex
-		tree_devicelock->users = 0 ;
-	} else {					// existing device slot
-		owfree(local_devicelock); // kill the locally allocated devlock (since there already is a matching devlock)	
-	}
-	++(tree_devicelock->users); // add our claim to the device
-	DEVTREE_UNLOCK(pn);
-	_MUTEX_LOCK(tree_devicelock->lock);	// now grab the device
-	pn->lock = tree_devicelock; // use this new devlock
+	_MUTEX_LOCK(devicelock->lock);	// now grab the device
+	pn->lock = devicelock; // use this devlock
 	return 0;
 }
 
 // Unlock the device
 void DeviceLockRelease(struct parsedname *pn)
 {
-	if (pn->lock) { // this is the stored pointer to the device in the appropriate device tree
-		// Free the device
-		_MUTEX_UNLOCK(pn->lock->lock);		/* Serg: This coredump on his 64-bit server */
-
-		// Now mark our disinterest in the device tree (and possibly reap the node))
-		DEVTREE_LOCK(pn);
-		--pn->lock->users; // remove our interest
-		if (pn->lock->users == 0) {
-			// Nobody's interested!
-			tdelete(pn->lock, &(pn->selected_connection->dev_db), dev_compare); /* Serg: Address 0x5A0D750 is 0 bytes inside a block of size 32 free'd */
-			_MUTEX_DESTROY(pn->lock->lock);
-			owfree(pn->lock);
+	struct devlock * devicelock = pn->lock ; // this is the stored pointer to the device's devlock
+	struct connection_in * in = pn->selected_connection ;
+	struct devlock_bucket * bucket ;
+
+	if ( devicelock == NULL ) {
+		return ;
+	}
+
+	// Free the device
+	_MUTEX_UNLOCK(devicelock->lock);		/* Serg: This coredump on his 64-bit server */
+	pn->lock = NULL;
+
+	// Now mark our disinterest in the device
+	bucket = devicelock->bucket ;
+	if ( bucket != NULL ) {
+		// Table slot -- it's free once the users are gone
+		_MUTEX_LOCK(bucket->mutex);
+		--devicelock->users ;
+		if ( devicelock->users == 0 ) {
+			STAT_SUB( in->bus_stat[e_bus_devlock_in_use], 1 ) ;
 		}
-		DEVTREE_UNLOCK(pn);
-		pn->lock = NULL;
+		_MUTEX_UNLOCK(bucket->mutex);
+		return ;
+	}
+
+	// Tree devlock (and possibly reap the node)
+	bucket = DeviceLockBucket( devicelock->sn, in ) ;
+	if ( bucket != NULL ) {
+		_MUTEX_LOCK(bucket->mutex);
+	}
+	DEVTREE_LOCK(in);
+	--devicelock->users; // remove our interest
+	if (devicelock->users == 0) {
+		// Nobody's interested!
+		tdelete(devicelock, &(in->dev_db), dev_compare); /* Serg: Address 0x5A0D750 is 0 bytes inside a block of size 32 free'd */
+		_MUTEX_DESTROY(devicelock->lock);
+		owfree(devicelock);
+	}
+	DEVTREE_UNLOCK(in);
+	if ( bucket != NULL ) {
+		--bucket->overflow ;
+		_MUTEX_UNLOCK(bucket->mutex);
 	}
 }
@@ -28,6 +28,8 @@ static ZERO_OR_ERROR FS_structdevdir(void (*dirfunc) (void *, const struct parse
 static ZERO_OR_ERROR FS_alarmdir(void (*dirfunc) (void *, const struct parsedname * const), void *v, const struct parsedname *pn2);
 static ZERO_OR_ERROR FS_typedir(void (*dirfunc) (void *, const struct parsedname * const), void *v, const struct parsedname *pn_type_directory);
 static ZERO_OR_ERROR FS_realdir(void (*dirfunc) (void *, const struct parsedname * const), void *v, const struct parsedname *pn2, uint32_t * flags);
+static GOOD_OR_BAD FS_verifydir(struct dirblob *db, const struct parsedname *pn_whole_directory);
+static void FS_dir_changes(struct dirblob *db, const struct parsedname *pn_whole_directory);
 static ZERO_OR_ERROR FS_cache_or_real(void (*dirfunc) (void *, const struct parsedname * const), void *v, const struct parsedname *pn2, uint32_t * flags);
 static ZERO_OR_ERROR FS_busdir(void (*dirfunc) (void *, const struct parsedname *), void *v, const struct parsedname *pn_directory);
 
@@ -103,10 +105,8 @@ static ZERO_OR_ERROR FS_dir_both(void (*dirfunc) (void *, const struct parsednam
 	
 	LEVEL_CALL("path=%s", SAFESTRING(pn_raw_directory->path));
 
-	STATLOCK;
 	AVERAGE_IN(&dir_avg);
 	AVERAGE_IN(&all_avg);
-	STATUNLOCK;
 
 	FSTATLOCK;
 	StateInfo.dir_time = NOW_TIME;	// protected by mutex
@@ -191,10 +191,8 @@ static ZERO_OR_ERROR FS_dir_both(void (*dirfunc) (void *, const struct parsednam
 
 	}
 
-	STATLOCK;
 	AVERAGE_OUT(&dir_avg);
 	AVERAGE_OUT(&all_avg);
-	STATUNLOCK;
 
 	LEVEL_DEBUG("ret=%d", ret);
 	return ret;
@@ -246,8 +244,9 @@ static void FS_simultaneous_entry(void (*dirfunc) (void *, const struct parsedna
 /* path is the path which "pn_directory" parses */
 /* FS_dir_all_connections produces the data that can vary: device lists, etc. */
 
+/* One job per port, run on the port's worker. Results are merged. */
 struct dir_all_connections_struct {
-	struct port_in * pin ;
+	struct port_job job ;	// must be first
 	struct connection_in * cin ;
 	struct parsedname pn_directory;
 	void (*dirfunc) (void *, const struct parsedname *);
@@ -283,70 +282,60 @@ static void FS_dir_all_connections_callback_conn( struct dir_all_connections_str
 	FS_dir_all_connections_callback_conn( dacs ) ;
 }
 
-/* Callback (thread) once per port */
+/* Job once per port */
 /* Will need  to probe each connection (channel) on this port */
-static void *FS_dir_all_connections_callback_port(void *v)
+static void FS_dir_all_connections_callback_port( struct port_job * job )
 {
-	struct dir_all_connections_struct *dacs = v;
-	struct dir_all_connections_struct dacs_next ;
-	pthread_t thread;
-	int threadbad = 0;
+	struct dir_all_connections_struct *dacs = (struct dir_all_connections_struct *) job ;
 	
-	if ( dacs->pin == NULL ) {
-		return VOID_RETURN;
-	}
-
-	// set up structure
-	dacs_next.pin = dacs->pin->next ;
-
-	if ( dacs_next.pin == NULL ) {
-		threadbad = 1 ;
-	} else {
-		dacs_next.dirfunc = dacs->dirfunc ;
-		memcpy( &(dacs_next.pn_directory), &(dacs->pn_directory), sizeof(struct parsedname));	// shallow copy
-		dacs_next.v = dacs->v ;
-		dacs_next.flags = dacs->flags ;
-		dacs_next.ret = dacs->ret ;
-		threadbad = pthread_create(&thread, DEFAULT_THREAD_ATTR, FS_dir_all_connections_callback_port, (void *) (&dacs_next));
-	}
-
 	// First channel
-	dacs->cin = dacs->pin->first ;
-	FS_dir_all_connections_callback_conn( v ) ;
-		
-	//printf("FS_dir_all_connections4 pid=%ld adapter=%d ret=%d\n",pthread_self(), dacs->pn_directory->selected_connection->index,ret);
-	/* See if next bus was also queried */
-	if (threadbad == 0) {		/* was a thread created? */
-		if (pthread_join(thread, NULL)!= 0) {
-			return VOID_RETURN ;			/* cannot join, so return only this result */
-		}
-		if (dacs_next.ret >= 0) {
-			dacs->ret = dacs_next.ret;	/* is it an error return? Then return this one */
-		} else {
-			dacs->flags |= dacs_next.flags ;
-		}		
-	}
-	return VOID_RETURN;
+	dacs->cin = job->pin->first ;
+	FS_dir_all_connections_callback_conn( dacs ) ;
 }
 
 static ZERO_OR_ERROR
 FS_dir_all_connections(void (*dirfunc) (void *, const struct parsedname *), void *v, const struct parsedname *pn_directory, uint32_t * flags)
 {
-	struct dir_all_connections_struct dacs ;
+	int ports = PortCount() ;
+	int port ;
+	struct port_in * pin ;
+	struct port_batch batch ;
+	struct dir_all_connections_struct * dacs ;
+	ZERO_OR_ERROR ret ;
 		
-	// set up structure
-	dacs.pin = Inbound_Control.head_port ; 
-	dacs.dirfunc = dirfunc ;
-	memcpy( &(dacs.pn_directory), pn_directory, sizeof(struct parsedname));	// shallow copy
-	dacs.v = v ;
-	dacs.flags = 0 ;
-	dacs.ret = 0 ;
+	*flags = 0 ;
+	if ( ports == 0 ) {
+		return 0 ;
+	}
+
+	dacs = owcalloc( ports, sizeof(struct dir_all_connections_struct) ) ;
+	if ( dacs == NULL ) {
+		return -ENOMEM ;
+	}
 	
-	// Start iterating through buses
-	FS_dir_all_connections_callback_port(  (void *) (& dacs) ) ;
+	// Start all buses
+	PortBatch_Init( &batch ) ;
+	for ( pin = Inbound_Control.head_port, port = 0 ; pin != NULL && port < ports ; pin = pin->next, ++port ) {
+		dacs[port].dirfunc = dirfunc ;
+		memcpy( &(dacs[port].pn_directory), pn_directory, sizeof(struct parsedname));	// shallow copy
+		dacs[port].v = v ;
+		dacs[port].flags = 0 ;
+		dacs[port].ret = 0 ;
+		PortBatch_Submit( &batch, &(dacs[port].job), pin, FS_dir_all_connections_callback_port ) ;
+	}
+	PortBatch_Wait( &batch ) ;
 	
-	*flags = dacs.flags ;	
-	return dacs.ret ;
+	// Merge: flags from every port, error only if no port succeeded
+	ret = dacs[0].ret ;
+	for ( port = 0 ; port < ports ; ++port ) {
+		*flags |= dacs[port].flags ;
+		if ( ret < 0 && dacs[port].ret >= 0 ) {
+			ret = dacs[port].ret ;
+		}
+	}
+	owfree( dacs ) ;
+
+	return ret ;
 }
 
 /* Device directory (i.e. show the properties) -- all from memory */
@@ -631,6 +620,29 @@ static ZERO_OR_ERROR FS_realdir(void (*dirfunc) (void *, const struct parsedname
 	/* STATISTICS */
 	STAT_ADD1(dir_main.calls);
 
+	/* Between full searches just check the known devices are still there */
+	if ( GOOD( FS_verifydir(&db, pn_whole_directory) ) ) {
+		BYTE sn[SERIAL_NUMBER_SIZE];
+		int dindex;
+
+		for (dindex = 0; DirblobGet(dindex, sn, &db) == 0; ++dindex) {
+			char dev[PROPERTY_LENGTH_ALIAS + 1];
+
+			Cache_Add_Device(pn_whole_directory->selected_connection->index, sn) ;
+			FS_devicename(dev, PROPERTY_LENGTH_ALIAS, sn, pn_whole_directory);
+			if ( FS_dir_plus(dirfunc, v, flags, pn_whole_directory, dev) != 0 ) {
+				DirblobPoison(&db);
+				break ;
+			}
+		}
+		STAT_ADD(dir_main.entries, dindex);
+		if ( DirblobPure(&db) ) {
+			Cache_Add_Dir(&db, pn_whole_directory);
+		}
+		DirblobClear(&db);
+		return 0 ;
+	}
+
 	DirblobInit(&db);			// set up a fresh dirblob
 
 	ret = PossiblyLockedBusCall( BUS_first, &ds, pn_whole_directory) ;
@@ -658,9 +670,7 @@ static ZERO_OR_ERROR FS_realdir(void (*dirfunc) (void *, const struct parsedname
 		ret = PossiblyLockedBusCall( BUS_next, &ds, pn_whole_directory) ;
 	} 
 
-	STATLOCK;
-	dir_main.entries += devices;
-	STATUNLOCK;
+	STAT_ADD(dir_main.entries, devices);
 
 	switch ( ret ) {
 		case search_done:
@@ -670,6 +680,7 @@ static ZERO_OR_ERROR FS_realdir(void (*dirfunc) (void *, const struct parsedname
 			/* Add to the cache (full list as a single element */
 			if (DirblobPure(&db) && (ret == search_done) ) {
 				Cache_Add_Dir(&db, pn_whole_directory);
+				FS_dir_changes(&db, pn_whole_directory);
 			}
 			DirblobClear(&db);
 			return 0 ;
@@ -681,6 +692,144 @@ static ZERO_OR_ERROR FS_realdir(void (*dirfunc) (void *, const struct parsedname
 	}
 }
 
+/* Delta enumeration of a root directory (--full_search)
+ * Instead of searching the whole bus again, verify each device the last full search found
+ * (a reset and one search pass with the serial number known -- no triplet round trips).
+ * A full search is still needed when
+ *   there is no earlier list,
+ *   a device doesn't verify (it left, or the bus is in trouble),
+ *   or full_search seconds have passed -- arrivals don't announce themselves when other devices answer the presence pulse.
+ * Fills db and returns gbGOOD if all the known devices are present
+ * */
+static GOOD_OR_BAD FS_verifydir(struct dirblob *db, const struct parsedname *pn_whole_directory)
+{
+	struct connection_in * in = pn_whole_directory->selected_connection ;
+	struct parsedname s_pn_verify ;
+	struct parsedname * pn_verify = &s_pn_verify ;
+	BYTE sn[SERIAL_NUMBER_SIZE] ;
+	int dindex ;
+	GOOD_OR_BAD ret = gbGOOD ;
+
+	DirblobInit(db) ;
+
+	if ( Globals.full_search <= 0 || Globals.one_device ) {
+		return gbBAD ;
+	}
+	if ( IsUncachedDir(pn_whole_directory) || ! RootNotBranch(pn_whole_directory) ) {
+		// explicit request for a real search, or a DS2409 branch
+		return gbBAD ;
+	}
+	if ( in->iroutines.flags & ADAP_FLAG_dirgulp ) {
+		// whole directory in one transaction anyway
+		return gbBAD ;
+	}
+	switch ( get_busmode(in) ) {
+		case bus_fake:
+		case bus_tester:
+		case bus_mock:
+		case bus_w1:
+		case bus_bad:
+		case bus_unknown:
+			return gbBAD ;
+		default:
+			break ;
+	}
+
+	memmove(pn_verify, pn_whole_directory, sizeof(struct parsedname)) ; // shallow copy
+	pn_verify->selected_device = NO_DEVICE ; // select just resets (and clears branches)
+
+	if ( NotReconnect(pn_verify) ) {
+		BUSLOCK(pn_verify);
+	}
+	if ( DirblobElements( &(in->last_root_dir) ) == 0 || in->last_full_search + Globals.full_search < NOW_TIME ) {
+		ret = gbBAD ;
+	} else {
+		for ( dindex = 0 ; DirblobGet(dindex, sn, &(in->last_root_dir)) == 0 ; ++dindex ) {
+			memcpy(pn_verify->sn, sn, SERIAL_NUMBER_SIZE) ;
+			if ( BAD( BUS_select(pn_verify) ) || BAD( BUS_verify(_1W_SEARCH_ROM, pn_verify) ) ) {
+				LEVEL_DEBUG("Device "SNformat" didn't verify on bus.%d -- full search", SNvar(sn), in->index) ;
+				STAT_ADD1(dir_verify_failures);
+				ret = gbBAD ;
+				break ;
+			}
+		}
+		if ( GOOD(ret) && DirblobRecreate(in->last_root_dir.snlist, DirblobElements( &(in->last_root_dir) ) * SERIAL_NUMBER_SIZE, db) != 0 ) {
+			ret = gbBAD ;
+		}
+	}
+	if ( NotReconnect(pn_verify) ) {
+		BUSUNLOCK(pn_verify);
+	}
+
+	if ( GOOD(ret) ) {
+		STAT_ADD1(dir_verified);
+	} else {
+		DirblobClear(db) ;
+	}
+	return ret ;
+}
+
+/* A full root search is done -- keep it for FS_verifydir and compare with the last one
+ * Devices that left lose their cached location (if it was this bus) */
+static void FS_dir_changes(struct dirblob *db, const struct parsedname *pn_whole_directory)
+{
+	struct connection_in * in = pn_whole_directory->selected_connection ;
+	struct parsedname s_pn_device ;
+	struct parsedname * pn_device = &s_pn_device ;
+	struct dirblob db_new ;
+	struct dirblob db_old ;
+	time_t last_full_search ;
+	BYTE sn[SERIAL_NUMBER_SIZE] ;
+	int dindex ;
+
+	if ( ! RootNotBranch(pn_whole_directory) ) {
+		return ;
+	}
+	if ( DirblobRecreate(db->snlist, DirblobElements(db) * SERIAL_NUMBER_SIZE, &db_new) != 0 ) {
+		DirblobClear(&db_new) ;
+		return ;
+	}
+
+	if ( NotReconnect(pn_whole_directory) ) {
+		BUSLOCK(pn_whole_directory);
+	}
+	db_old = in->last_root_dir ;
+	in->last_root_dir = db_new ;
+	last_full_search = in->last_full_search ;
+	in->last_full_search = NOW_TIME ;
+	if ( NotReconnect(pn_whole_directory) ) {
+		BUSUNLOCK(pn_whole_directory);
+	}
+
+	if ( last_full_search == 0 ) {
+		// first search, nothing to compare
+		DirblobClear(&db_old) ;
+		return ;
+	}
+
+	for ( dindex = 0 ; DirblobGet(dindex, sn, db) == 0 ; ++dindex ) {
+		if ( DirblobSearch(sn, &db_old) < 0 ) {
+			LEVEL_CONNECT("Device "SNformat" arrived on bus.%d", SNvar(sn), in->index) ;
+			STAT_ADD1(dir_arrivals);
+		}
+	}
+
+	memmove(pn_device, pn_whole_directory, sizeof(struct parsedname)) ; // shallow copy
+	for ( dindex = 0 ; DirblobGet(dindex, sn, &db_old) == 0 ; ++dindex ) {
+		int bus_nr ;
+		if ( DirblobSearch(sn, db) >= 0 ) {
+			continue ;
+		}
+		LEVEL_CONNECT("Device "SNformat" left bus.%d", SNvar(sn), in->index) ;
+		STAT_ADD1(dir_departures);
+		memcpy(pn_device->sn, sn, SERIAL_NUMBER_SIZE) ;
+		if ( GOOD( Cache_Get_Device(&bus_nr, pn_device) ) && bus_nr == in->index ) {
+			Cache_Del_Device(pn_device) ;
+		}
+	}
+	DirblobClear(&db_old) ;
+}
+
 /* points "serial number" to directory
    -- 0 for root
    -- DS2409/main|aux for branch
@@ -740,11 +889,7 @@ static ZERO_OR_ERROR FS_cache_or_real(void (*dirfunc) (void *, const struct pars
 	}
 	DirblobClear(&db);			/* allocated in Cache_Get_Dir */
 
-	STATLOCK;
-
-	dir_main.entries += dindex;
-
-	STATUNLOCK;
+	STAT_ADD(dir_main.entries, dindex);
 	return 0;
 }
 
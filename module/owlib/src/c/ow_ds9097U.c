@@ -209,6 +209,7 @@
 #include "ow.h"
 #include "ow_counters.h"
 #include "ow_connection.h"
+#include "ow_codes.h"
 
 static RESET_TYPE DS2480_reset(const struct parsedname *pn);
 static enum search_status DS2480_next_both(struct device_search *ds, const struct parsedname *pn);
@@ -216,6 +217,7 @@ static GOOD_OR_BAD DS2480_PowerByte(const BYTE byte, BYTE * resp, const UINT del
 static GOOD_OR_BAD DS2480_PowerBit(const BYTE byte, BYTE * resp, const UINT delay, const struct parsedname *pn);
 static GOOD_OR_BAD DS2480_ProgramPulse(const struct parsedname *pn);
 static GOOD_OR_BAD DS2480_sendback_data(const BYTE * data, BYTE * resp, const size_t len, const struct parsedname *pn);
+static GOOD_OR_BAD DS2480_select_and_sendback(const BYTE * data, BYTE * resp, const size_t len, const struct parsedname *pn);
 static GOOD_OR_BAD DS2480_sendback_bits(const BYTE * databits, BYTE * respbits, const size_t len, const struct parsedname * pn);
 static GOOD_OR_BAD DS2480_reconnect(const struct parsedname * pn);
 static void DS2480_close(struct connection_in *in) ;
@@ -237,6 +239,7 @@ static GOOD_OR_BAD DS2480_configuration_write(BYTE parameter_code, BYTE value_co
 static GOOD_OR_BAD DS2480_configuration_read(BYTE parameter_code, BYTE value_code, struct connection_in * in);
 static GOOD_OR_BAD DS2480_stop_pulse(BYTE * response, struct connection_in * in);
 static RESET_TYPE DS2480_reset_once(struct connection_in * in) ;
+static RESET_TYPE DS2480_reset_response(BYTE reset_response, struct connection_in * in) ;
 static GOOD_OR_BAD DS2480_set_baud(struct connection_in * in) ;
 static void DS2480_set_baud_control(struct connection_in * in) ;
 static BYTE DS2480b_speed_byte( struct connection_in * in ) ;
@@ -255,13 +258,13 @@ static void DS2480_setroutines(struct connection_in *in)
 	in->iroutines.sendback_data = DS2480_sendback_data;
     in->iroutines.sendback_bits = DS2480_sendback_bits;
 	in->iroutines.select = NO_SELECT_ROUTINE;
-	in->iroutines.select_and_sendback = NO_SELECTANDSENDBACK_ROUTINE;
+	in->iroutines.select_and_sendback = DS2480_select_and_sendback;
 	in->iroutines.set_config = NO_SET_CONFIG_ROUTINE;
 	in->iroutines.get_config = NO_GET_CONFIG_ROUTINE;
 	in->iroutines.reconnect = DS2480_reconnect ;
 	in->iroutines.close = DS2480_close;
 	in->iroutines.verify = NO_VERIFY_ROUTINE ;
-	in->iroutines.flags = ADAP_FLAG_default;
+	in->iroutines.flags = ADAP_FLAG_bundle | ADAP_FLAG_bundle_bytes ;
 	in->bundling_length = UART_FIFO_SIZE;
 }
 
@@ -790,6 +793,20 @@ static RESET_TYPE DS2480_reset_once(struct connection_in * in)
 		return BUS_RESET_ERROR;
 	}
 
+	switch (reset_response & RB_RESET_MASK) {
+	case RB_PRESENCE:
+	case RB_ALARMPRESENCE:
+		DS2480_flush(in);
+		break;
+	default:
+		break;
+	}
+	return DS2480_reset_response( reset_response, in ) ;
+}
+
+/* Interpret the reset response byte */
+static RESET_TYPE DS2480_reset_response(BYTE reset_response, struct connection_in * in)
+{
 	/* The adapter type is encoded in this response byte */
 	/* The known values correspond to the types in enum adapter_type */
 	/* Other values are assigned for adapters that don't have this hardcoded value */
@@ -806,7 +823,6 @@ static RESET_TYPE DS2480_reset_once(struct connection_in * in)
 		in->AnyDevices = anydevices_yes ;
 		// check if programming voltage available
 		in->ProgramAvailable = ((reset_response & PARMSEL_12VPULSE) == PARMSEL_12VPULSE);
-		DS2480_flush(in);
 		return BUS_RESET_OK;
 	default:
 		return BUS_RESET_ERROR; // should never happen
@@ -1214,6 +1230,73 @@ static GOOD_OR_BAD DS2480_sendback_data(const BYTE * data, BYTE * resp, const si
 	return gbGOOD ;
 }
 
+//
+// DS2480_select_and_sendback
+//  Reset, match ROM and data in one write and one read
+//  The reset goes out in command mode, then a switch to data mode, the select and the data
+//  Response is the reset byte, then the echo of select and data
+// return 0=good
+static GOOD_OR_BAD DS2480_select_and_sendback(const BYTE * data, BYTE * resp, const size_t len, const struct parsedname *pn)
+{
+	struct connection_in * in = pn->selected_connection ;
+	BYTE select[1+SERIAL_NUMBER_SIZE] ;
+	BYTE sendout[MAX_SEND_SIZE] ;
+	BYTE readin[1+1+SERIAL_NUMBER_SIZE+MAX_SEND_SIZE] ;
+	size_t bytes_this_segment = 0 ;
+	size_t bytes_from_list = 0 ;
+	size_t select_index ;
+
+	// branches, single device, new bus settings -- the long way
+	if ( ! BUS_select_plain(pn) || in->changed_bus_settings != 0 || in->ds2404_found ) {
+		RETURN_BAD_IF_BAD( BUS_select(pn) ) ;
+		return DS2480_sendback_data( data, resp, len, pn ) ;
+	}
+
+	select[0] = in->overdrive ? _1W_OVERDRIVE_MATCH_ROM : _1W_MATCH_ROM ;
+	memcpy( &select[1], pn->sn, SERIAL_NUMBER_SIZE ) ;
+
+	// reset in command mode
+	if (in->master.serial.mode != ds2480b_command_mode) {
+		sendout[bytes_this_segment++] = MODE_COMMAND ;
+	}
+	sendout[bytes_this_segment++] = (BYTE) ( CMD_COMM | FUNCTSEL_RESET | DS2480b_speed_byte(in) ) ;
+
+	// select and as much data as fits in data mode, "doubling" MODE_COMMAND
+	sendout[bytes_this_segment++] = MODE_DATA ;
+	for ( select_index = 0 ; select_index < sizeof(select) ; ++select_index ) {
+		sendout[ bytes_this_segment++ ] = select[select_index] ;
+		if ( select[select_index] == MODE_COMMAND ) {
+			sendout[ bytes_this_segment++ ] = MODE_COMMAND ;
+		}
+	}
+	while ( bytes_from_list < len && bytes_this_segment <= MAX_SEND_SIZE-2 ) {
+		BYTE current_char = data[bytes_from_list++] ;
+		sendout[ bytes_this_segment++ ] = current_char ;
+		if ( current_char == MODE_COMMAND ) {
+			sendout[ bytes_this_segment++ ] = current_char ;
+		}
+	}
+	in->master.serial.mode = ds2480b_data_mode ;
+
+	DS2480_flush(in);
+	if ( BAD( DS2480_write( sendout, bytes_this_segment, in ) )
+		|| BAD( DS2480_read( readin, 1 + sizeof(select) + bytes_from_list, in ) ) ) {
+		BUS_reset_bundled( BUS_RESET_ERROR, in ) ;
+		return gbBAD ;
+	}
+	RETURN_BAD_IF_BAD( BUS_reset_bundled( DS2480_reset_response( readin[0], in ), in ) ) ;
+
+	if ( memcmp( &readin[1], select, sizeof(select) ) != 0 ) {
+		STAT_ADD1_BUS(e_bus_select_errors, in);
+		LEVEL_CONNECT("Select error for %s on bus %s", pn->selected_device->readable_name, DEVICENAME(in));
+		return gbBAD ;
+	}
+	memcpy( resp, &readin[1+sizeof(select)], bytes_from_list ) ;
+
+	// rest of a long transfer, still in data mode
+	return DS2480_sendback_data( &data[bytes_from_list], &resp[bytes_from_list], len - bytes_from_list, pn ) ;
+}
+
 static void DS2480_close(struct connection_in *in)
 {
 	// the standard COM_free cleans up the connection
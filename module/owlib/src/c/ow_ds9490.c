@@ -47,6 +47,7 @@ static GOOD_OR_BAD DS9490_setup_adapter(struct connection_in * in) ;
 
 static enum search_status DS9490_next_both(struct device_search *ds, const struct parsedname *pn);
 static GOOD_OR_BAD DS9490_sendback_data(const BYTE * data, BYTE * resp, size_t len, const struct parsedname *pn);
+static GOOD_OR_BAD DS9490_select_and_sendback(const BYTE * data, BYTE * resp, const size_t len, const struct parsedname *pn);
 static GOOD_OR_BAD DS9490_HaltPulse(const struct parsedname *pn);
 static GOOD_OR_BAD DS9490_PowerByte(BYTE byte, BYTE * resp, UINT delay, const struct parsedname *pn);
 static GOOD_OR_BAD DS9490_ProgramPulse(const struct parsedname *pn);
@@ -69,13 +70,13 @@ static void DS9490_setroutines(struct connection_in *in)
 	in->iroutines.sendback_data = DS9490_sendback_data;
 	in->iroutines.sendback_bits = NO_SENDBACKBITS_ROUTINE;
 	in->iroutines.select = NO_SELECT_ROUTINE;
-	in->iroutines.select_and_sendback = NO_SELECTANDSENDBACK_ROUTINE;
+	in->iroutines.select_and_sendback = DS9490_select_and_sendback;
 	in->iroutines.set_config = NO_SET_CONFIG_ROUTINE;
 	in->iroutines.get_config = NO_GET_CONFIG_ROUTINE;
 	in->iroutines.reconnect = DS9490_reconnect;
 	in->iroutines.close = DS9490_close;
 	in->iroutines.verify = NO_VERIFY_ROUTINE ;
-	in->iroutines.flags = ADAP_FLAG_default;
+	in->iroutines.flags = ADAP_FLAG_bundle | ADAP_FLAG_bundle_bytes ;
 
 	in->bundling_length = USB_FIFO_SIZE;
 }
@@ -892,6 +893,87 @@ static GOOD_OR_BAD DS9490_sendback_data(const BYTE * const_data, BYTE * resp, si
 }
 
 
+/* Reset, match ROM and data as one queued command sequence
+ * ROM and first data block go to EP2 in one bulk write, then MATCH ACCESS (with reset)
+ * and BLOCK I/O are queued back to back and a single status wait covers both */
+static GOOD_OR_BAD DS9490_select_and_sendback(const BYTE * data, BYTE * resp, const size_t len, const struct parsedname *pn)
+{
+	struct connection_in * in = pn->selected_connection ;
+	BYTE sendout[USB_FIFO_EACH] ;
+	BYTE buffer[ DS9490_getstatus_BUFFER_LENGTH + 1 ];
+	BYTE select_byte = in->overdrive ? _1W_OVERDRIVE_MATCH_ROM : _1W_MATCH_ROM ;
+	size_t block = len ;
+	int readlen ;
+	int i ;
+
+	// branches, single device, new bus settings, DS2404 delay -- the long way
+	if ( ! BUS_select_plain(pn) || in->changed_bus_settings > 0 || in->ds2404_found || in->master.usb.lusb_handle == NULL ) {
+		RETURN_BAD_IF_BAD( BUS_select(pn) ) ;
+		return DS9490_sendback_data( data, resp, len, pn ) ;
+	}
+
+	if ( block > USB_FIFO_EACH - SERIAL_NUMBER_SIZE ) {
+		block = USB_FIFO_EACH - SERIAL_NUMBER_SIZE ;
+	}
+	memcpy( sendout, pn->sn, SERIAL_NUMBER_SIZE ) ;
+	memcpy( &sendout[SERIAL_NUMBER_SIZE], data, block ) ;
+
+	if ( DS9490_write( sendout, SERIAL_NUMBER_SIZE + block, pn) < (int) (SERIAL_NUMBER_SIZE + block) ) {
+		LEVEL_DATA("USB select bulk write problem");
+		return gbBAD;
+	}
+
+	// COMM_MATCH_ACCESS | COMM_IM | COMM_RST == 0x0165
+	// COMM_BLOCK_IO | COMM_IM | COMM_F == 0x0075
+	if ( BAD( USB_Control_Msg(COMM_CMD, COMM_MATCH_ACCESS | COMM_IM | COMM_RST, select_byte, pn) )
+		|| ( block > 0 && BAD( USB_Control_Msg(COMM_CMD, COMM_BLOCK_IO | COMM_IM | COMM_F, block, pn) ) )
+		) {
+		LEVEL_DATA("USB select control error");
+		STAT_ADD1_BUS(e_bus_errors, in);
+		BUS_ERROR_fix(pn) ;
+		BUS_reset_bundled( BUS_RESET_ERROR, in ) ;
+		return gbBAD;
+	}
+
+	readlen = block ;
+	switch ( DS9490_getstatus(buffer, &readlen, pn) ) {	// wait for block bytes
+		case BUS_RESET_OK:
+			break ;
+		case BUS_RESET_SHORT:
+			BUS_reset_bundled( BUS_RESET_SHORT, in ) ;
+			return gbBAD ;
+		case BUS_RESET_ERROR:
+		default:
+			BUS_ERROR_fix(pn) ;
+			BUS_reset_bundled( BUS_RESET_ERROR, in ) ;
+			return gbBAD ;
+	}
+	BUS_reset_bundled( BUS_RESET_OK, in ) ;
+
+	in->AnyDevices = anydevices_yes ;
+	for (i = DS9490_getstatus_BUFFER; i < readlen; i++) {
+		BYTE val = buffer[i];
+		if (val != ONEWIREDEVICEDETECT && (val & COMMCMDERRORRESULT_NRS) ) {
+			// empty bus detected, no presence pulse detected
+			in->AnyDevices = anydevices_no;
+			LEVEL_DATA("no presense pulse detected");
+			STAT_ADD1_BUS(e_bus_select_errors, in);
+			return gbBAD ;
+		}
+	}
+
+	if ( block > 0 && DS9490_read( resp, block, pn) < 0) {
+		LEVEL_DATA("USB select bulk read error");
+		return gbBAD;
+	}
+
+	if ( block < len ) {
+		// rest of a long transfer
+		return DS9490_sendback_data( &data[block], &resp[block], len - block, pn ) ;
+	}
+	return gbGOOD ;
+}
+
 /* ------------------------------------------------------------ */
 /* --- USB Power byte for temperature conversion ---------------*/
 
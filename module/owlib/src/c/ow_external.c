@@ -17,6 +17,7 @@
 #include "ow_external.h"
 
 static void External_setroutines(struct connection_in *in);
+static void External_close(struct connection_in *in);
 
 /* External program link
  * Use programs instead of 1-wire slave
@@ -39,7 +40,7 @@ static void External_setroutines(struct connection_in *in)
 	in->iroutines.set_config = NO_SET_CONFIG_ROUTINE;
 	in->iroutines.get_config = NO_GET_CONFIG_ROUTINE;
 	in->iroutines.reconnect = NO_RECONNECT_ROUTINE;
-	in->iroutines.close = NO_CLOSE_ROUTINE;
+	in->iroutines.close = External_close;
 	in->iroutines.verify = NO_VERIFY_ROUTINE ;
 	in->iroutines.flags = 0 ;
 	in->bundling_length = 1;
@@ -53,3 +54,10 @@ GOOD_OR_BAD External_detect(struct port_in *pin)
 	in->adapter_name = "External";
 	return gbGOOD ;
 }
+
+/* End the long-lived helpers (COPROCESS lines) */
+static void External_close(struct connection_in *in)
+{
+	(void) in ;
+	Coprocess_close_all() ;
+}
@@ -0,0 +1,441 @@
+/*
+    OWFS -- One-Wire filesystem
+    OWHTTPD -- One-Wire Web Server
+    Written 2003 Paul H Alfille
+    email: paul.alfille@gmail.com
+    Released under the GPL
+    See the header file: ow.h for full attribution
+    1wire/iButton system from Dallas Semiconductor
+*/
+
+#include <config.h>
+#include "owfs_config.h"
+#include "ow.h"
+#include "ow_external.h"
+
+#include <sys/wait.h>
+
+/* External co-process (COPROCESS lines)
+ * The helper is started once (sh -c "exec command", no added arguments, own process group)
+ * and kept running.
+ * Requests and replies are framed lines on its stdin and stdout:
+ *   request: "tag length sensor property extension mode size offset sensor_data property_data\n"
+ *            followed by length bytes (the data to write, 0 for reads)
+ *   reply:   "tag status length\n" followed by length bytes (the data read)
+ *            status is 0 or a negative errno
+ * Tags let several requests be in flight, replies may come in any order.
+ * One reader thread per helper hands replies to the waiting requests.
+ *
+ * A request waits timeout_external seconds. If the helper hasn't replied to anything
+ * in that time it is taken to be stuck and killed.
+ * A helper that exits (crash or kill) fails its pending requests and is restarted by the next request.
+ * While a helper can't be run (fork failure, or waiting to restart after
+ * repeated failures) the caller falls back to running the command per request (popen). */
+
+#define COPROCESS_RESTART_MIN	1	// seconds
+#define COPROCESS_RESTART_MAX	64
+
+struct coprocess_request {
+	struct coprocess_request * next ;
+	UINT tag ;
+	BYTE * data ;				// reply buffer
+	size_t size ;
+	size_t length ;				// reply length
+	ZERO_OR_ERROR status ;
+	int done ;
+} ;
+
+struct coprocess {
+	struct coprocess * next ;
+	char * command ;
+	char * exec ;				// "exec command" for the shell
+	pid_t pid ;
+	FILE_DESCRIPTOR_OR_ERROR to_helper ;
+	FILE * from_helper ;
+	pthread_t reader ;
+	int running ;				// helper up and reader thread reading
+	int joinable ;				// reader thread to join before a restart
+	pthread_mutex_t mutex ;		// state and pending list
+	pthread_cond_t cond ;
+	pthread_mutex_t write_mutex ;	// one request on the pipe at a time
+	struct coprocess_request * pending ;
+	UINT next_tag ;
+	time_t last_start ;
+	time_t last_reply ;
+	int restart_delay ;			// seconds, grows while the helper keeps failing
+} ;
+
+static pthread_mutex_t coprocess_list_mutex = PTHREAD_MUTEX_INITIALIZER ;
+static struct coprocess * coprocess_head = NULL ;
+
+static struct coprocess * Coprocess_find( const char * command ) ;
+static GOOD_OR_BAD Coprocess_start( struct coprocess * cp ) ;
+static void * Coprocess_reader( void * v ) ;
+static void Coprocess_unlink_request( struct coprocess * cp, struct coprocess_request * request ) ;
+static GOOD_OR_BAD Coprocess_write( struct coprocess * cp, const char * header, const BYTE * data, size_t length ) ;
+
+/* Send one request and wait for its reply.
+ * Returns -ECHILD if the helper can't be used now (caller falls back to popen) */
+ZERO_OR_ERROR Coprocess_request( const char * command, const char * fields, const BYTE * out, size_t out_length, BYTE * in, size_t * in_length )
+{
+	struct coprocess * cp = Coprocess_find( command ) ;
+	struct coprocess_request request ;
+	char header[PATH_MAX+64] ;
+	struct timeval until ;
+	struct timespec ts ;
+
+	if ( cp == NULL ) {
+		return -ECHILD ;
+	}
+
+	memset( &request, 0, sizeof(request) ) ;
+	request.data = in ;
+	request.size = ( in_length == NULL ) ? 0 : *in_length ;
+
+	_MUTEX_LOCK( cp->mutex ) ;
+	if ( ! cp->running ) {
+		time_t now = time(NULL) ;
+		if ( cp->last_start != 0 && now - cp->last_start < cp->restart_delay ) {
+			// too soon after a failure
+			_MUTEX_UNLOCK( cp->mutex ) ;
+			return -ECHILD ;
+		}
+		if ( BAD( Coprocess_start( cp ) ) ) {
+			_MUTEX_UNLOCK( cp->mutex ) ;
+			return -ECHILD ;
+		}
+	}
+	request.tag = ++cp->next_tag ;
+	request.next = cp->pending ;
+	cp->pending = &request ;
+	_MUTEX_UNLOCK( cp->mutex ) ;
+
+	UCLIBCLOCK ;
+	snprintf( header, sizeof(header), "%u %lu %s\n", request.tag, (unsigned long) out_length, fields ) ;
+	UCLIBCUNLOCK ;
+
+	if ( BAD( Coprocess_write( cp, header, out, out_length ) ) ) {
+		_MUTEX_LOCK( cp->mutex ) ;
+		Coprocess_unlink_request( cp, &request ) ;
+		_MUTEX_UNLOCK( cp->mutex ) ;
+		LEVEL_DEBUG("Cannot send request to %s", command ) ;
+		return -EIO ;
+	}
+
+	timernow( &until ) ;
+	until.tv_sec += Globals.timeout_external ;
+	ts.tv_sec = until.tv_sec ;
+	ts.tv_nsec = until.tv_usec * 1000 ;
+
+	_MUTEX_LOCK( cp->mutex ) ;
+	while ( ! request.done ) {
+		struct timeval now ;
+		timernow( &now ) ;
+		if ( ! timercmp( &now, &until, < ) ) {
+			Coprocess_unlink_request( cp, &request ) ;
+			request.status = -ETIMEDOUT ;
+			if ( cp->running && time(NULL) - cp->last_reply >= Globals.timeout_external ) {
+				LEVEL_DEFAULT("External helper %s isn't answering -- restarting it", command ) ;
+				kill( -cp->pid, SIGKILL ) ;
+			} else {
+				LEVEL_DEBUG("Request %u to %s timed out", request.tag, command ) ;
+			}
+			break ;
+		}
+		pthread_cond_timedwait( &(cp->cond), &(cp->mutex), &ts ) ;
+	}
+	_MUTEX_UNLOCK( cp->mutex ) ;
+
+	if ( in_length != NULL ) {
+		*in_length = request.length ;
+	}
+	return request.status ;
+}
+
+/* Helper for this command, added on first use */
+static struct coprocess * Coprocess_find( const char * command )
+{
+	struct coprocess * cp ;
+
+	_MUTEX_LOCK( coprocess_list_mutex ) ;
+	for ( cp = coprocess_head ; cp != NULL ; cp = cp->next ) {
+		if ( strcmp( cp->command, command ) == 0 ) {
+			_MUTEX_UNLOCK( coprocess_list_mutex ) ;
+			return cp ;
+		}
+	}
+
+	cp = owcalloc( 1, sizeof(struct coprocess) ) ;
+	if ( cp != NULL ) {
+		size_t exec_length = strlen( command ) + 6 ;
+		cp->command = owstrdup( command ) ;
+		cp->exec = owmalloc( exec_length ) ;
+		if ( cp->command == NULL || cp->exec == NULL ) {
+			SAFEFREE( cp->command ) ;
+			SAFEFREE( cp->exec ) ;
+			owfree( cp ) ;
+			cp = NULL ;
+		} else {
+			UCLIBCLOCK ;
+			snprintf( cp->exec, exec_length, "exec %s", command ) ;
+			UCLIBCUNLOCK ;
+			cp->to_helper = FILE_DESCRIPTOR_BAD ;
+			cp->restart_delay = COPROCESS_RESTART_MIN ;
+			_MUTEX_INIT( cp->mutex ) ;
+			_MUTEX_INIT( cp->write_mutex ) ;
+			my_pthread_cond_init( &(cp->cond), NULL ) ;
+			cp->next = coprocess_head ;
+			coprocess_head = cp ;
+		}
+	}
+	_MUTEX_UNLOCK( coprocess_list_mutex ) ;
+	return cp ;
+}
+
+/* Start (or restart) the helper -- cp->mutex held */
+static GOOD_OR_BAD Coprocess_start( struct coprocess * cp )
+{
+	int to_pipe[2] ;
+	int from_pipe[2] ;
+	pid_t pid ;
+
+	if ( cp->joinable ) {
+		// previous reader has finished with the old helper
+		pthread_join( cp->reader, NULL ) ;
+		cp->joinable = 0 ;
+	}
+
+	cp->last_start = time(NULL) ;
+	if ( pipe( to_pipe ) != 0 ) {
+		ERROR_DEBUG("Cannot create pipe for %s", cp->command ) ;
+		return gbBAD ;
+	}
+	if ( pipe( from_pipe ) != 0 ) {
+		ERROR_DEBUG("Cannot create pipe for %s", cp->command ) ;
+		close( to_pipe[fd_pipe_read] ) ;
+		close( to_pipe[fd_pipe_write] ) ;
+		return gbBAD ;
+	}
+
+	pid = fork() ;
+	if ( pid < 0 ) {
+		ERROR_DEBUG("Cannot start external helper %s", cp->command ) ;
+		close( to_pipe[fd_pipe_read] ) ;
+		close( to_pipe[fd_pipe_write] ) ;
+		close( from_pipe[fd_pipe_read] ) ;
+		close( from_pipe[fd_pipe_write] ) ;
+		return gbBAD ;
+	}
+	if ( pid == 0 ) {
+		// child: stdin and stdout are the pipes
+		dup2( to_pipe[fd_pipe_read], STDIN_FILENO ) ;
+		dup2( from_pipe[fd_pipe_write], STDOUT_FILENO ) ;
+		close( to_pipe[fd_pipe_read] ) ;
+		close( to_pipe[fd_pipe_write] ) ;
+		close( from_pipe[fd_pipe_read] ) ;
+		close( from_pipe[fd_pipe_write] ) ;
+		// signals reach the helper (and anything it starts), not just the shell
+		setpgid( 0, 0 ) ;
+		execl( "/bin/sh", "sh", "-c", cp->exec, (char *) NULL ) ;
+		_exit( 127 ) ;
+	}
+
+	setpgid( pid, pid ) ;		// as the child does, whichever runs first
+	close( to_pipe[fd_pipe_read] ) ;
+	close( from_pipe[fd_pipe_write] ) ;
+	// keep other children (popen scripts, other helpers) off these pipes
+	fcntl( to_pipe[fd_pipe_write], F_SETFD, FD_CLOEXEC ) ;
+	fcntl( from_pipe[fd_pipe_read], F_SETFD, FD_CLOEXEC ) ;
+
+	cp->from_helper = fdopen( from_pipe[fd_pipe_read], "r" ) ;
+	if ( cp->from_helper == NULL ) {
+		close( from_pipe[fd_pipe_read] ) ;
+		close( to_pipe[fd_pipe_write] ) ;
+		kill( pid, SIGKILL ) ;
+		waitpid( pid, NULL, 0 ) ;
+		return gbBAD ;
+	}
+
+	_MUTEX_LOCK( cp->write_mutex ) ;
+	cp->to_helper = to_pipe[fd_pipe_write] ;
+	_MUTEX_UNLOCK( cp->write_mutex ) ;
+	cp->pid = pid ;
+	cp->last_reply = cp->last_start ;
+	cp->running = 1 ;
+
+	if ( pthread_create( &(cp->reader), DEFAULT_THREAD_ATTR, Coprocess_reader, cp ) != 0 ) {
+		ERROR_DEBUG("Cannot create reader thread for %s", cp->command ) ;
+		cp->running = 0 ;
+		_MUTEX_LOCK( cp->write_mutex ) ;
+		close( cp->to_helper ) ;
+		cp->to_helper = FILE_DESCRIPTOR_BAD ;
+		_MUTEX_UNLOCK( cp->write_mutex ) ;
+		fclose( cp->from_helper ) ;
+		cp->from_helper = NULL ;
+		kill( pid, SIGKILL ) ;
+		waitpid( pid, NULL, 0 ) ;
+		return gbBAD ;
+	}
+	cp->joinable = 1 ;
+	LEVEL_DEBUG("External helper %s started (pid %d)", cp->command, (int) pid ) ;
+	return gbGOOD ;
+}
+
+/* Request header and data, whole or not at all as far as other requests are concerned */
+static GOOD_OR_BAD Coprocess_write( struct coprocess * cp, const char * header, const BYTE * data, size_t length )
+{
+	GOOD_OR_BAD ret = gbGOOD ;
+	const BYTE * part[2] = { (const BYTE *) header, data, } ;
+	size_t part_length[2] = { strlen(header), length, } ;
+	int i ;
+
+	_MUTEX_LOCK( cp->write_mutex ) ;
+	for ( i = 0 ; i < 2 && GOOD( ret ) ; ++i ) {
+		size_t written = 0 ;
+		while ( written < part_length[i] ) {
+			ssize_t w ;
+			if ( FILE_DESCRIPTOR_NOT_VALID( cp->to_helper ) ) {
+				ret = gbBAD ;
+				break ;
+			}
+			w = write( cp->to_helper, &part[i][written], part_length[i] - written ) ;
+			if ( w < 0 && errno == EINTR ) {
+				continue ;
+			}
+			if ( w <= 0 ) {
+				ret = gbBAD ;
+				break ;
+			}
+			written += w ;
+		}
+	}
+	_MUTEX_UNLOCK( cp->write_mutex ) ;
+	return ret ;
+}
+
+/* cp->mutex held */
+static void Coprocess_unlink_request( struct coprocess * cp, struct coprocess_request * request )
+{
+	struct coprocess_request ** prev ;
+	for ( prev = &(cp->pending) ; *prev != NULL ; prev = &((*prev)->next) ) {
+		if ( *prev == request ) {
+			*prev = request->next ;
+			return ;
+		}
+	}
+}
+
+/* Hand replies to the waiting requests until the helper goes away */
+static void * Coprocess_reader( void * v )
+{
+	struct coprocess * cp = v ;
+	char line[128] ;
+	int status = 0 ;
+
+	while ( fgets( line, sizeof(line), cp->from_helper ) != NULL ) {
+		UINT tag ;
+		int reply_status ;
+		unsigned long length ;
+		BYTE * data = NULL ;
+		struct coprocess_request * request ;
+
+		if ( sscanf( line, "%u %d %lu", &tag, &reply_status, &length ) != 3 ) {
+			LEVEL_DEBUG("Bad reply line from %s: %s", cp->command, line ) ;
+			continue ;
+		}
+		if ( length > 0 ) {
+			data = owmalloc( length ) ;
+			if ( data == NULL || fread( data, length, 1, cp->from_helper ) != 1 ) {
+				SAFEFREE( data ) ;
+				break ;
+			}
+		}
+
+		_MUTEX_LOCK( cp->mutex ) ;
+		cp->last_reply = time(NULL) ;
+		cp->restart_delay = COPROCESS_RESTART_MIN ;
+		for ( request = cp->pending ; request != NULL ; request = request->next ) {
+			if ( request->tag == tag ) {
+				break ;
+			}
+		}
+		if ( request == NULL ) {
+			// timed out already
+			LEVEL_DEBUG("Late reply %u from %s", tag, cp->command ) ;
+		} else {
+			request->length = length < request->size ? length : request->size ;
+			if ( request->length > 0 ) {
+				memcpy( request->data, data, request->length ) ;
+			}
+			request->status = reply_status ;
+			request->done = 1 ;
+			Coprocess_unlink_request( cp, request ) ;
+			my_pthread_cond_broadcast( &(cp->cond) ) ;
+		}
+		_MUTEX_UNLOCK( cp->mutex ) ;
+		SAFEFREE( data ) ;
+	}
+
+	// helper closed its output (exit, crash, kill) or garbled it
+	_MUTEX_LOCK( cp->write_mutex ) ;
+	if ( FILE_DESCRIPTOR_VALID( cp->to_helper ) ) {
+		close( cp->to_helper ) ;
+		cp->to_helper = FILE_DESCRIPTOR_BAD ;
+	}
+	_MUTEX_UNLOCK( cp->write_mutex ) ;
+	fclose( cp->from_helper ) ;
+	cp->from_helper = NULL ;
+	kill( -cp->pid, SIGTERM ) ;
+	waitpid( cp->pid, &status, 0 ) ;
+	LEVEL_CONNECT("External helper %s ended (status %d)", cp->command, status ) ;
+
+	_MUTEX_LOCK( cp->mutex ) ;
+	cp->running = 0 ;
+	if ( cp->last_reply == cp->last_start ) {
+		// nothing answered by this run, wait longer before the next
+		cp->restart_delay = cp->restart_delay < COPROCESS_RESTART_MAX ? 2 * cp->restart_delay : COPROCESS_RESTART_MAX ;
+	}
+	while ( cp->pending != NULL ) {
+		struct coprocess_request * request = cp->pending ;
+		cp->pending = request->next ;
+		request->status = -EIO ;
+		request->done = 1 ;
+	}
+	my_pthread_cond_broadcast( &(cp->cond) ) ;
+	_MUTEX_UNLOCK( cp->mutex ) ;
+	return VOID_RETURN ;
+}
+
+/* End all helpers (external bus closed) */
+void Coprocess_close_all( void )
+{
+	_MUTEX_LOCK( coprocess_list_mutex ) ;
+	while ( coprocess_head != NULL ) {
+		struct coprocess * cp = coprocess_head ;
+		coprocess_head = cp->next ;
+
+		// closing stdin asks the helper to leave, the reader cleans up after it
+		_MUTEX_LOCK( cp->write_mutex ) ;
+		if ( FILE_DESCRIPTOR_VALID( cp->to_helper ) ) {
+			close( cp->to_helper ) ;
+			cp->to_helper = FILE_DESCRIPTOR_BAD ;
+		}
+		_MUTEX_UNLOCK( cp->write_mutex ) ;
+		_MUTEX_LOCK( cp->mutex ) ;
+		if ( cp->running ) {
+			kill( -cp->pid, SIGTERM ) ;
+		}
+		_MUTEX_UNLOCK( cp->mutex ) ;
+		if ( cp->joinable ) {
+			pthread_join( cp->reader, NULL ) ;
+		}
+
+		my_pthread_cond_destroy( &(cp->cond) ) ;
+		_MUTEX_DESTROY( cp->write_mutex ) ;
+		_MUTEX_DESTROY( cp->mutex ) ;
+		owfree( cp->command ) ;
+		owfree( cp->exec ) ;
+		owfree( cp ) ;
+	}
+	_MUTEX_UNLOCK( coprocess_list_mutex ) ;
+}
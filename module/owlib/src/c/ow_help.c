@@ -114,6 +114,12 @@ void ow_help_cache(void)
 	"  --uncached          Implicit /uncached in all requests\n"
 	"  --cached            Explicit /uncached needed. (Default action)\n"
 	"  --cache_size n   Size in bytes of max cache memory. 0 for no limit.\n"
+	"  --parse_cache n     Parsed paths remembered [4096]. 0 to parse every request.\n"
+	"  --cache_snapshot=file  Keep device locations, directories and aliases for a warm restart\n"
+	"  --cache_snapshot_period n  Seconds between snapshot writes [300]. 0 for only at exit.\n"
+	"  --full_search n     Seconds between full bus searches, known devices are verified in between. 0 to always search.\n"
+	"  --poll=glob[,n]     Refresh matching properties (e.g. /28.*/temperature) every n seconds\n"
+	"  --stale=glob[,n]    Clients may get matching values up to n seconds past expiry while they're refreshed\n"
 	"\n"
 	" Cache timing         [default] (in seconds)\n"
 	"  --timeout_volatile  [%3d] Expiration time for changing data (e.g. temperature)\n"
@@ -129,6 +135,8 @@ void ow_help_cache(void)
 	"  --timeout_ftp       [%3d] Timeout for FTP session\n"
 	"  --timeout_ha7       [%3d] Timeout for HA7Net bus master\n"
 	"  --timeout_w1        [%3d] Timeout for w1 kernel netlink\n"
+	"  --timeout_detect    [%3d] Startup wait for each bus master, retried in background. 0 for one try.\n"
+	"  --timeout_external  [%3d] Reply from a long-lived external helper (COPROCESS)\n"
 	, Globals.timeout_volatile
 	, Globals.timeout_stable
 	, Globals.timeout_directory
@@ -140,6 +148,8 @@ void ow_help_cache(void)
 	, Globals.timeout_ftp
 	, Globals.timeout_ha7
 	, Globals.timeout_w1
+	, Globals.timeout_detect
+	, Globals.timeout_external
 		   );
 }
 
@@ -161,15 +171,19 @@ void ow_help_program(void)
 	"  --fuse_open_opt args  Special arguments to pass to FUSE (Quoted and escaped)\n"
 	"  --allow_other         Allow other users to see owfs file system\n"
 	"                         needs /etc/fuse.conf setting\n"
+	"  --fuse_threads n      Threads answering the kernel, 1 for one (libfuse3, default 10)\n"
 	"\n"
 	" owhttpd (web server)\n"
 	"  -p --port [ip:]port   TCP address and port number for access\n"
 	"  --zero                Announce service via zeroconf\n"
 	"  --announce name       Name for service given in zeroconf broadcast\n"
 	"  --nozero              Don't announce service via zeroconf\n"
+	"  --http_keepalive n    Seconds an idle connection is kept open (default 5, 0 closes after each page)\n"
+	"  --http_max_requests n Requests served on one connection (default 100)\n"
 	"\n"
 	" owserver (OWFS server)\n"
 	"  -p --port [ip:]port   TCP address and port number for access\n"
+	"  --server_threads n    Worker threads serving client requests (default 16)\n"
 	"\n"
 	" Development tests (owserver only)\n"
 	"  --pingcrazy      Add lots of keep-alive messages to the owserver protocol\n"
@@ -228,6 +242,7 @@ void ow_help_device(void)
 	"\n"
 	" Network (address is form [ip:]port, ip DNS name or n.n.n.n, port is port number)\n"
 	"  -s address      owserver\n"
+	"  --server_pool n Idle connections kept open to each owserver (default 4)\n"
 	"  --LINK=address  LINK-HUB-E network LINK\n"
 	"  --HA7NET=address HA7NET bus master\n"
 	"  --HA7NET        HA7NET bus master address auto-discovered\n"
@@ -243,6 +258,8 @@ void ow_help_device(void)
 	"                   use family codes in hex\n"
 	"                   e.g. 1F,10,21 for DS2409,DS18S20,DS1921\n"
 	"  --tester=list   List of devices to simulate (non-random ID, non-random data)\n"
+	"  --sim=list      Devices to simulate down to the 1-wire timing (benchmarks)\n"
+	"                   e.g. DS18B20*8,DS2438,29,23,latency=200\n"
 	"  --temperature_low=0.0   --temperature_high=100.0 temperature range for fake readings\n"
 	"\n"
 	" Linux Kernel Device\n"
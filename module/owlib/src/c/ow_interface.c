@@ -48,6 +48,7 @@ READ_FUNCTION(FS_r_ds2490status);
 /* Statistics reporting */
 READ_FUNCTION(FS_stat_p);
 READ_FUNCTION(FS_bustime);
+READ_FUNCTION(FS_latency_p);
 READ_FUNCTION(FS_elapsed);
 
 #if OW_USB
@@ -256,6 +257,18 @@ static struct filetype interface_statistics[] = {
 	{"overdrive", PROPERTY_LENGTH_SUBDIR, NON_AGGREGATE, ft_subdir, fc_subdir, NO_READ_FUNCTION, NO_WRITE_FUNCTION, VISIBLE, NO_FILETYPE_DATA, },
 	{"overdrive/attempts", PROPERTY_LENGTH_UNSIGNED, NON_AGGREGATE, ft_unsigned, fc_statistic, FS_stat_p, NO_WRITE_FUNCTION, VISIBLE, {.i=e_bus_try_overdrive}, },
 	{"overdrive/failures", PROPERTY_LENGTH_UNSIGNED, NON_AGGREGATE, ft_unsigned, fc_statistic, FS_stat_p, NO_WRITE_FUNCTION, VISIBLE, {.i=e_bus_failed_overdrive}, },
+
+	{"device_locks", PROPERTY_LENGTH_SUBDIR, NON_AGGREGATE, ft_subdir, fc_subdir, NO_READ_FUNCTION, NO_WRITE_FUNCTION, VISIBLE, NO_FILETYPE_DATA, },
+	{"device_locks/slots", PROPERTY_LENGTH_UNSIGNED, NON_AGGREGATE, ft_unsigned, fc_statistic, FS_stat_p, NO_WRITE_FUNCTION, VISIBLE, {.i=e_bus_devlock_slots}, },
+	{"device_locks/in_use", PROPERTY_LENGTH_UNSIGNED, NON_AGGREGATE, ft_unsigned, fc_statistic, FS_stat_p, NO_WRITE_FUNCTION, VISIBLE, {.i=e_bus_devlock_in_use}, },
+	{"device_locks/peak", PROPERTY_LENGTH_UNSIGNED, NON_AGGREGATE, ft_unsigned, fc_statistic, FS_stat_p, NO_WRITE_FUNCTION, VISIBLE, {.i=e_bus_devlock_peak}, },
+	{"device_locks/overflows", PROPERTY_LENGTH_UNSIGNED, NON_AGGREGATE, ft_unsigned, fc_statistic, FS_stat_p, NO_WRITE_FUNCTION, VISIBLE, {.i=e_bus_devlock_overflows}, },
+
+	{"latency", PROPERTY_LENGTH_SUBDIR, NON_AGGREGATE, ft_subdir, fc_subdir, NO_READ_FUNCTION, NO_WRITE_FUNCTION, VISIBLE, NO_FILETYPE_DATA, },
+	{"latency/read", 128, NON_AGGREGATE, ft_vascii, fc_statistic, FS_latency_p, NO_WRITE_FUNCTION, VISIBLE, {.i=e_latency_read}, },
+	{"latency/lock_wait", 128, NON_AGGREGATE, ft_vascii, fc_statistic, FS_latency_p, NO_WRITE_FUNCTION, VISIBLE, {.i=e_latency_lock_wait}, },
+	{"latency/lock_held", 128, NON_AGGREGATE, ft_vascii, fc_statistic, FS_latency_p, NO_WRITE_FUNCTION, VISIBLE, {.i=e_latency_lock_held}, },
+	{"latency/cache", 128, NON_AGGREGATE, ft_vascii, fc_statistic, FS_latency_p, NO_WRITE_FUNCTION, VISIBLE, {.i=e_latency_cache}, },
 };
 
 struct device d_interface_statistics = { 
@@ -750,7 +763,7 @@ static ZERO_OR_ERROR FS_stat_p(struct one_wire_query *owq)
 {
 	struct parsedname *pn = PN(owq);
 
-	OWQ_U(owq) = pn->selected_connection->bus_stat[pn->selected_filetype->data.i];
+	OWQ_U(owq) = STAT_GET( pn->selected_connection->bus_stat[pn->selected_filetype->data.i] );
 	return 0;
 }
 
@@ -760,6 +773,14 @@ static ZERO_OR_ERROR FS_bustime(struct one_wire_query *owq)
 	return 0;
 }
 
+static ZERO_OR_ERROR FS_latency_p(struct one_wire_query *owq)
+{
+	struct parsedname *pn = PN(owq);
+	char summary[128];
+	Latency_summary( summary, sizeof(summary), &(pn->selected_connection->latency.h[pn->selected_filetype->data.i]) ) ;
+	return OWQ_format_output_offset_and_size_z( summary, owq ) ;
+}
+
 static ZERO_OR_ERROR FS_elapsed(struct one_wire_query *owq)
 {
 	OWQ_U(owq) = NOW_TIME - StateInfo.start_time;
@@ -0,0 +1,350 @@
+/*
+    OWFS -- One-Wire filesystem
+    OWHTTPD -- One-Wire Web Server
+    Written 2003 Paul H Alfille
+    email: paul.alfille@gmail.com
+    Released under the GPL
+    See the header file: ow.h for full attribution
+    1wire/iButton system from Dallas Semiconductor
+*/
+
+/* Latency histograms
+ * Read time, bus lock wait, bus lock hold and cache lookup time are kept as
+ * log-bucketed histograms (4 buckets per power of 2 microseconds, so any
+ * value is within 25%), recorded with the same atomic adds as the other
+ * statistics -- no lock is taken to record.
+ * One set is kept for the whole program, one per bus (in connection_in),
+ * one per family code and one per property (filetype), the last two made
+ * on first use.
+ * */
+
+#include <config.h>
+#include "owfs_config.h"
+#include "ow.h"
+#include "ow_counters.h"
+#include "ow_connection.h"
+
+struct latency_set latency_all;
+
+static const char * latency_names[e_latency_last_marker] = {
+	"read",
+	"lock_wait",
+	"lock_held",
+	"cache",
+} ;
+
+/* Per family code */
+static struct latency_set * latency_family[256] ;
+
+/* Per property, open addressing on the filetype pointer. Entries are never removed */
+#define LATENCY_PROPERTIES	1024
+static struct latency_property {
+	const struct filetype * ft ;
+	struct latency_set * set ;
+} latency_property[LATENCY_PROPERTIES] ;
+
+#ifdef __ATOMIC_RELAXED
+#define LATENCY_LOAD(p)          __atomic_load_n( &(p), __ATOMIC_ACQUIRE )
+#define LATENCY_CLAIM(p,old,new) __atomic_compare_exchange_n( &(p), &(old), (new), 0, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE )
+#else /* __ATOMIC_RELAXED */
+#define LATENCY_LOAD(p)          (p)
+static int Latency_claim( void ** p, void ** old, void * new )
+{
+	int claimed ;
+	STATLOCK ;
+	claimed = ( *p == *old ) ;
+	if ( claimed ) {
+		*p = new ;
+	} else {
+		*old = *p ;
+	}
+	STATUNLOCK ;
+	return claimed ;
+}
+#define LATENCY_CLAIM(p,old,new) Latency_claim( (void **) &(p), (void **) &(old), (void *) (new) )
+#endif /* __ATOMIC_RELAXED */
+
+static int Latency_log2( UINT usec )
+{
+#ifdef __GNUC__
+	return 31 - __builtin_clz( usec ) ;
+#else /* __GNUC__ */
+	int exponent = 0 ;
+	while ( usec >>= 1 ) {
+		++exponent ;
+	}
+	return exponent ;
+#endif /* __GNUC__ */
+}
+
+static int Latency_bucket( UINT usec )
+{
+	int exponent ;
+	if ( usec < LATENCY_SUB ) {
+		return usec ;
+	}
+	exponent = Latency_log2( usec ) ;
+	return ( ( exponent - LATENCY_SUB_BITS + 1 ) << LATENCY_SUB_BITS )
+		+ ( ( usec >> ( exponent - LATENCY_SUB_BITS ) ) & ( LATENCY_SUB - 1 ) ) ;
+}
+
+/* Smallest value that lands in the bucket */
+static UINT Latency_low( int bucket )
+{
+	int shift ;
+	if ( bucket < LATENCY_SUB ) {
+		return bucket ;
+	}
+	shift = ( bucket >> LATENCY_SUB_BITS ) - 1 ;
+	return (UINT) ( LATENCY_SUB + ( bucket & ( LATENCY_SUB - 1 ) ) ) << shift ;
+}
+
+/* Largest value that lands in the bucket */
+static UINT Latency_high( int bucket )
+{
+	if ( bucket < LATENCY_SUB ) {
+		return bucket ;
+	}
+	return Latency_low( bucket ) + ( ( 1U << ( ( bucket >> LATENCY_SUB_BITS ) - 1 ) ) - 1 ) ;
+}
+
+static void Latency_add( struct latency_histogram * h, UINT usec )
+{
+	STAT_ADD1( h->bucket[ Latency_bucket( usec ) ] ) ;
+	STAT_ADD1( h->count ) ;
+	STAT_MAX( h->max, usec ) ;
+}
+
+/* Set for a slot, made on first use. The loser of a race frees its copy */
+static struct latency_set * Latency_set( struct latency_set ** slot )
+{
+	struct latency_set * set = LATENCY_LOAD( *slot ) ;
+	struct latency_set * none = NULL ;
+
+	if ( set != NULL ) {
+		return set ;
+	}
+	set = owcalloc( 1, sizeof( struct latency_set ) ) ;
+	if ( set == NULL ) {
+		return NULL ;
+	}
+	if ( LATENCY_CLAIM( *slot, none, set ) ) {
+		return set ;
+	}
+	owfree( set ) ;
+	return none ;
+}
+
+static struct latency_property * Latency_property( const struct filetype * ft )
+{
+	size_t start = ( ( (size_t) ft ) >> 4 ) % LATENCY_PROPERTIES ;
+	size_t probe ;
+
+	for ( probe = 0 ; probe < LATENCY_PROPERTIES ; ++probe ) {
+		struct latency_property * lp = &latency_property[ ( start + probe ) % LATENCY_PROPERTIES ] ;
+		const struct filetype * found = LATENCY_LOAD( lp->ft ) ;
+		if ( found == NULL ) {
+			const struct filetype * none = NULL ;
+			if ( LATENCY_CLAIM( lp->ft, none, ft ) ) {
+				return lp ;
+			}
+			found = none ;
+		}
+		if ( found == ft ) {
+			return lp ;
+		}
+	}
+	// table full, this property goes uncounted
+	return NULL ;
+}
+
+/* Interval in microseconds, saturating */
+UINT Latency_usec( const struct timeval * tv )
+{
+	if ( tv->tv_sec < 0 ) {
+		return 0 ;
+	}
+	if ( tv->tv_sec >= 4000 ) {
+		return (UINT) -1 ;
+	}
+	return tv->tv_sec * 1000000 + tv->tv_usec ;
+}
+
+/* Microseconds from start until now */
+UINT Latency_since( const struct timeval * start )
+{
+	struct timeval now ;
+
+	timernow( &now ) ;
+	if ( timercmp( &now, start, < ) ) {
+		return 0 ; // clock moved backward
+	}
+	timersub( &now, start, &now ) ;
+	return Latency_usec( &now ) ;
+}
+
+/* Count in the program's and bus's histograms */
+void Latency_bus( enum e_latency kind, UINT usec, struct connection_in * in )
+{
+	Latency_add( &latency_all.h[kind], usec ) ;
+	if ( in != NO_CONNECTION ) {
+		Latency_add( &in->latency.h[kind], usec ) ;
+	}
+}
+
+/* Count in the family's and property's histograms */
+void Latency_device( enum e_latency kind, UINT usec, const struct parsedname * pn )
+{
+	struct latency_set * set ;
+	struct latency_property * lp ;
+
+	if ( pn == NULL || pn->type != ePN_real || pn->selected_device == NO_DEVICE ) {
+		return ;
+	}
+	set = Latency_set( &latency_family[ pn->sn[0] ] ) ;
+	if ( set != NULL ) {
+		Latency_add( &set->h[kind], usec ) ;
+	}
+	if ( pn->selected_filetype == NO_FILETYPE ) {
+		return ;
+	}
+	lp = Latency_property( pn->selected_filetype ) ;
+	if ( lp == NULL ) {
+		return ;
+	}
+	set = Latency_set( &lp->set ) ;
+	if ( set != NULL ) {
+		if ( LATENCY_LOAD( set->device ) == NO_DEVICE ) {
+			set->device = pn->selected_device ; // name for the dump, any writer is right
+		}
+		Latency_add( &set->h[kind], usec ) ;
+	}
+}
+
+/* A stable copy of the buckets; count is taken from the copy */
+static void Latency_copy( struct latency_histogram * copy, const struct latency_histogram * h )
+{
+	int bucket ;
+
+	copy->count = 0 ;
+	copy->max = STAT_GET( h->max ) ;
+	for ( bucket = 0 ; bucket < LATENCY_BUCKETS ; ++bucket ) {
+		copy->bucket[bucket] = STAT_GET( h->bucket[bucket] ) ;
+		copy->count += copy->bucket[bucket] ;
+	}
+}
+
+/* Value at or below which the fraction of the counts lie (top of that bucket) */
+static UINT Latency_percentile( const struct latency_histogram * copy, double fraction )
+{
+	double target = fraction * copy->count ;
+	UINT seen = 0 ;
+	int bucket ;
+
+	for ( bucket = 0 ; bucket < LATENCY_BUCKETS ; ++bucket ) {
+		seen += copy->bucket[bucket] ;
+		if ( seen > 0 && seen >= target ) {
+			UINT high = Latency_high( bucket ) ;
+			return high < copy->max ? high : copy->max ;
+		}
+	}
+	return copy->max ;
+}
+
+/* One line: count and percentiles in microseconds */
+void Latency_summary( char * buffer, size_t size, const struct latency_histogram * h )
+{
+	struct latency_histogram copy ;
+
+	Latency_copy( &copy, h ) ;
+	UCLIBCLOCK ;
+	snprintf( buffer, size, "count=%u p50=%u p90=%u p99=%u p999=%u max=%u",
+		copy.count,
+		Latency_percentile( &copy, .50 ),
+		Latency_percentile( &copy, .90 ),
+		Latency_percentile( &copy, .99 ),
+		Latency_percentile( &copy, .999 ),
+		copy.max ) ;
+	UCLIBCUNLOCK ;
+}
+
+/* Dump lines: key kind count=N max=M buckets=low:count,... (nonzero buckets only) */
+static void Latency_dump_set( const char * key, const struct latency_set * set, struct memblob * mb )
+{
+	int kind ;
+
+	for ( kind = 0 ; kind < e_latency_last_marker ; ++kind ) {
+		struct latency_histogram copy ;
+		char line[64] ;
+		int bucket ;
+		int first = 1 ;
+
+		Latency_copy( &copy, &set->h[kind] ) ;
+		if ( copy.count == 0 ) {
+			continue ;
+		}
+		UCLIBCLOCK ;
+		snprintf( line, sizeof(line), " %s count=%u max=%u buckets=", latency_names[kind], copy.count, copy.max ) ;
+		UCLIBCUNLOCK ;
+		MemblobAdd( (const BYTE *) key, strlen(key), mb ) ;
+		MemblobAdd( (const BYTE *) line, strlen(line), mb ) ;
+		for ( bucket = 0 ; bucket < LATENCY_BUCKETS ; ++bucket ) {
+			if ( copy.bucket[bucket] == 0 ) {
+				continue ;
+			}
+			UCLIBCLOCK ;
+			snprintf( line, sizeof(line), "%s%u:%u", first ? "" : ",", Latency_low( bucket ), copy.bucket[bucket] ) ;
+			UCLIBCUNLOCK ;
+			MemblobAdd( (const BYTE *) line, strlen(line), mb ) ;
+			first = 0 ;
+		}
+		MemblobAddChar( '\n', 1, mb ) ;
+	}
+}
+
+/* All histograms as text, keys "all", "bus.N", "family.FF" and "property.FF/name" */
+void Latency_dump( struct memblob * mb )
+{
+	struct port_in * pin ;
+	char key[PATH_MAX] ;
+	int family ;
+	int index ;
+
+	Latency_dump_set( "all", &latency_all, mb ) ;
+
+	CONNIN_RLOCK ;
+	for ( pin = Inbound_Control.head_port ; pin != NULL ; pin = pin->next ) {
+		struct connection_in * in ;
+		for ( in = pin->first ; in != NO_CONNECTION ; in = in->next ) {
+			UCLIBCLOCK ;
+			snprintf( key, sizeof(key), "bus.%d", in->index ) ;
+			UCLIBCUNLOCK ;
+			Latency_dump_set( key, &in->latency, mb ) ;
+		}
+	}
+	CONNIN_RUNLOCK ;
+
+	for ( family = 0 ; family < 256 ; ++family ) {
+		struct latency_set * set = LATENCY_LOAD( latency_family[family] ) ;
+		if ( set != NULL ) {
+			UCLIBCLOCK ;
+			snprintf( key, sizeof(key), "family.%.2X", family ) ;
+			UCLIBCUNLOCK ;
+			Latency_dump_set( key, set, mb ) ;
+		}
+	}
+
+	for ( index = 0 ; index < LATENCY_PROPERTIES ; ++index ) {
+		const struct filetype * ft = LATENCY_LOAD( latency_property[index].ft ) ;
+		struct latency_set * set = LATENCY_LOAD( latency_property[index].set ) ;
+		struct device * dev ;
+		if ( ft == NULL || set == NULL ) {
+			continue ;
+		}
+		dev = LATENCY_LOAD( set->device ) ;
+		UCLIBCLOCK ;
+		snprintf( key, sizeof(key), "property.%s/%s", dev == NO_DEVICE ? "" : dev->family_code, ft->name ) ;
+		UCLIBCUNLOCK ;
+		Latency_dump_set( key, set, mb ) ;
+	}
+}
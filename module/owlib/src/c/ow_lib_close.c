@@ -47,5 +47,6 @@ void LibClose(void)
 
 	SAFEFREE(Globals.announce_name) ;
 	SAFEFREE(Globals.fatal_debug_file) ;
+	SAFEFREE(Globals.cache_snapshot) ;
 	LEVEL_DEBUG("Libraries closed");
 }
@@ -19,8 +19,21 @@
 void LibStop(void)
 {
 	char *argv[1] = { NULL };
+
+	LEVEL_CALL("Stop polling");
+	Poll_Stop();
+	LEVEL_CALL("Stop stale value refresh");
+	Stale_Stop();
+	LEVEL_CALL("Stop read pool");
+	FS_read_many_stop();
+	LEVEL_CALL("Stop bus master detection");
+	Detect_Stop();
+	LEVEL_CALL("Write cache snapshot");
+	Cache_Snapshot_Stop();
 	LEVEL_CALL("Clear Cache");
 	Cache_Clear();
+	LEVEL_CALL("Stop cache reaper");
+	Cache_Reaper_Stop();
 	LEVEL_CALL("Closing input devices");
 	FreeInAll();
 	LEVEL_CALL("Closing output devices");
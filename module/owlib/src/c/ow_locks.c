@@ -79,6 +79,8 @@ void LockSetup(void)
 	_MUTEX_INIT(Mutex.externalcount_mutex);
 	_MUTEX_INIT(Mutex.timegm_mutex);
 	_MUTEX_INIT(Mutex.detail_mutex);
+	_MUTEX_INIT(Mutex.readflight_mutex);
+	_MUTEX_INIT(Mutex.inbound_mutex);
 
 	RWLOCK_INIT(Mutex.lib);
 	RWLOCK_INIT(Mutex.cache);
@@ -39,6 +39,7 @@ static void ProcessListenSocket( struct connection_out * out ) ;
 static void *ProcessAcceptSocket(void *arg) ;
 static void ProcessListenSet( fd_set * listenset ) ;
 static GOOD_OR_BAD ListenCycle( void ) ;
+static void ServerProcessLoop(void (*HandlerRoutine) (FILE_DESCRIPTOR_OR_ERROR file_descriptor), void (*EventLoop) (void)) ;
 
 static GOOD_OR_BAD ServerAddr(const char * default_port, struct connection_out *out)
 {
@@ -318,6 +319,30 @@ static void ProcessListenSocket( struct connection_out * out )
  * basically, this is the main loop of the owserver and owhttpd program
  * */
 void ServerProcess(void (*HandlerRoutine) (FILE_DESCRIPTOR_OR_ERROR file_descriptor))
+{
+	ServerProcessLoop( HandlerRoutine, NULL ) ;
+}
+
+/* Setup Servers, but hand the listening sockets to an event loop
+ * that accepts and services connections itself (owserver epoll reactor)
+ * The loop returns when InterruptListening is called (see ListeningInterrupted) or on error
+ * */
+void ServerProcessEvents(void (*EventLoop) (void))
+{
+	ServerProcessLoop( NULL, EventLoop ) ;
+}
+
+/* Report if InterruptListening has been called -- for event loops to poll */
+int ListeningInterrupted( void )
+{
+	int interrupted ;
+	RWLOCK_RLOCK( shutdown_mutex_rw ) ;
+	interrupted = shutdown_in_progress ;
+	RWLOCK_RUNLOCK( shutdown_mutex_rw ) ;
+	return interrupted ;
+}
+
+static void ServerProcessLoop(void (*HandlerRoutine) (FILE_DESCRIPTOR_OR_ERROR file_descriptor), void (*EventLoop) (void))
 {
 	/* Locking for thread work */
 	int need_to_read_pipe ;
@@ -336,7 +361,11 @@ void ServerProcess(void (*HandlerRoutine) (FILE_DESCRIPTOR_OR_ERROR file_descrip
 		
 	if ( GOOD( SetupListenSockets( HandlerRoutine ) ) ) {
 		Announce_Systemd() ; // systemd mode -- ready for business
-		while (	GOOD( ListenCycle() ) ) {
+		if ( EventLoop != NULL ) {
+			EventLoop() ;
+		} else {
+			while (	GOOD( ListenCycle() ) ) {
+			}
 		}
 
 		// Make sure all the handler threads are complete before closing down
@@ -114,15 +114,35 @@ const struct option owopts_long[] = {
 	{"cache_size", required_argument, NO_LINKED_VAR, e_cache_size},	/* max cache size */
 	{"cache-size", required_argument, NO_LINKED_VAR, e_cache_size},	/* max cache size */
 	{"cachesize", required_argument, NO_LINKED_VAR, e_cache_size},	/* max cache size */
+	{"parse_cache", required_argument, NO_LINKED_VAR, e_parse_cache},	/* parsed paths kept */
+	{"parse-cache", required_argument, NO_LINKED_VAR, e_parse_cache},	/* parsed paths kept */
+	{"cache_snapshot", required_argument, NO_LINKED_VAR, e_cache_snapshot},	/* warm restart file */
+	{"cache-snapshot", required_argument, NO_LINKED_VAR, e_cache_snapshot},	/* warm restart file */
+	{"cache_snapshot_period", required_argument, NO_LINKED_VAR, e_cache_snapshot_period},	/* seconds between snapshots */
+	{"cache-snapshot-period", required_argument, NO_LINKED_VAR, e_cache_snapshot_period},	/* seconds between snapshots */
+	{"full_search", required_argument, NO_LINKED_VAR, e_full_search},	/* seconds between full directory searches */
+	{"full-search", required_argument, NO_LINKED_VAR, e_full_search},	/* seconds between full directory searches */
 	{"fuse_opt", required_argument, NO_LINKED_VAR, e_fuse_opt},	/* owfs, fuse mount option */
 	{"fuse-opt", required_argument, NO_LINKED_VAR, e_fuse_opt},	/* owfs, fuse mount option */
 	{"fuseopt", required_argument, NO_LINKED_VAR, e_fuse_opt},	/* owfs, fuse mount option */
 	{"fuse_open_opt", required_argument, NO_LINKED_VAR, e_fuse_open_opt},	/* owfs, fuse open option */
 	{"fuse-open-opt", required_argument, NO_LINKED_VAR, e_fuse_open_opt},	/* owfs, fuse open option */
 	{"fuseopenopt", required_argument, NO_LINKED_VAR, e_fuse_open_opt},	/* owfs, fuse open option */
+	{"fuse_threads", required_argument, NO_LINKED_VAR, e_fuse_threads},	/* owfs, request threads */
+	{"fuse-threads", required_argument, NO_LINKED_VAR, e_fuse_threads},	/* owfs, request threads */
 	{"max_clients", required_argument, NO_LINKED_VAR, e_max_clients},	/* ftp max connections */
 	{"max-clients", required_argument, NO_LINKED_VAR, e_max_clients},	/* ftp max connections */
 	{"maxclients", required_argument, NO_LINKED_VAR, e_max_clients},	/* ftp max connections */
+	{"server_threads", required_argument, NO_LINKED_VAR, e_server_threads},	/* owserver worker threads */
+	{"server-threads", required_argument, NO_LINKED_VAR, e_server_threads},	/* owserver worker threads */
+	{"server_pool", required_argument, NO_LINKED_VAR, e_server_pool},	/* idle connections to each owserver */
+	{"server-pool", required_argument, NO_LINKED_VAR, e_server_pool},	/* idle connections to each owserver */
+	{"http_keepalive", required_argument, NO_LINKED_VAR, e_http_keepalive},	/* owhttpd idle connection timeout */
+	{"http-keepalive", required_argument, NO_LINKED_VAR, e_http_keepalive},	/* owhttpd idle connection timeout */
+	{"http_max_requests", required_argument, NO_LINKED_VAR, e_http_max_requests},	/* owhttpd requests per connection */
+	{"http-max-requests", required_argument, NO_LINKED_VAR, e_http_max_requests},	/* owhttpd requests per connection */
+	{"poll", required_argument, NO_LINKED_VAR, e_poll},	/* keep matching properties fresh in the cache */
+	{"stale", required_argument, NO_LINKED_VAR, e_stale},	/* serve expired values while refreshing them */
 
 	{"passive", required_argument, NO_LINKED_VAR, e_passive},	/* DS9097 passive */
 	{"PASSIVE", required_argument, NO_LINKED_VAR, e_passive},	/* DS9097 passive */
@@ -171,6 +191,9 @@ const struct option owopts_long[] = {
 	{"TESTER", required_argument, NO_LINKED_VAR, e_tester},	/* Tester */
 	{"Tester", required_argument, NO_LINKED_VAR, e_tester},	/* Tester */
 	{"tester", required_argument, NO_LINKED_VAR, e_tester},	/* Tester */
+	{"SIM", required_argument, NO_LINKED_VAR, e_sim},	/* Simulated with line timing */
+	{"Sim", required_argument, NO_LINKED_VAR, e_sim},	/* Simulated with line timing */
+	{"sim", required_argument, NO_LINKED_VAR, e_sim},	/* Simulated with line timing */
 	{"mock", required_argument, NO_LINKED_VAR, e_mock},	/* Mock */
 	{"Mock", required_argument, NO_LINKED_VAR, e_mock},	/* Mock */
 	{"MOCK", required_argument, NO_LINKED_VAR, e_mock},	/* Mock */
@@ -234,6 +257,8 @@ const struct option owopts_long[] = {
 	{"timeout_ha7net", required_argument, NO_LINKED_VAR, e_timeout_ha7,},	// timeout -- HA7Net wait
 	{"timeout_w1", required_argument, NO_LINKED_VAR, e_timeout_w1,},	// timeout -- w1 netlink
 	{"timeout_W1", required_argument, NO_LINKED_VAR, e_timeout_w1,},	// timeout -- w1 netlink
+	{"timeout_detect", required_argument, NO_LINKED_VAR, e_timeout_detect,},	// timeout -- bus master detection at startup
+	{"timeout_external", required_argument, NO_LINKED_VAR, e_timeout_external,},	// timeout -- external helper reply
 	{"timeout_persistent_low", required_argument, NO_LINKED_VAR, e_timeout_persistent_low,},
 	{"timeout_persistent_high", required_argument, NO_LINKED_VAR, e_timeout_persistent_high,},
 	{"clients_persistent_low", required_argument, NO_LINKED_VAR, e_clients_persistent_low,},
@@ -460,6 +485,12 @@ static void ParseTheLine(struct lineparse *lp)
 							lp->prog = NULL ;
 							AddProperty(current_char+1,et_script) ;
 							return ;
+						} else if (strstr(lp->prog, "coprocess") != NULL) {
+							// property line for external device, long-lived helper
+							LEVEL_DEBUG("COPROCESS entry found <%s>", current_char+1);
+							lp->prog = NULL ;
+							AddProperty(current_char+1,et_coprocess) ;
+							return ;
 					}
 					parse_state = ps_pre_opt;
 					break;
@@ -752,14 +783,61 @@ GOOD_OR_BAD owopt(const int option_char, const char *arg)
 		RETURN_BAD_IF_BAD(OW_parsevalue_I(&arg_to_integer, arg)) ;
 		Globals.cache_size = (size_t) arg_to_integer;
 		break;
+	case e_parse_cache:
+		RETURN_BAD_IF_BAD(OW_parsevalue_I(&arg_to_integer, arg)) ;
+		Globals.parse_cache_size = (int) arg_to_integer;
+		break;
+	case e_cache_snapshot:
+		if (arg == NULL || strlen(arg) == 0) {
+			LEVEL_DEFAULT("No cache_snapshot file specified");
+			return gbBAD;
+		}
+		SAFEFREE(Globals.cache_snapshot);
+		if ((Globals.cache_snapshot = owstrdup(arg)) == NULL) {
+			LEVEL_DEBUG("Out of memory.");
+			return gbBAD;
+		}
+		break;
+	case e_cache_snapshot_period:
+		RETURN_BAD_IF_BAD(OW_parsevalue_I(&arg_to_integer, arg)) ;
+		Globals.cache_snapshot_period = (int) arg_to_integer;
+		break;
+	case e_full_search:
+		RETURN_BAD_IF_BAD(OW_parsevalue_I(&arg_to_integer, arg)) ;
+		Globals.full_search = (int) arg_to_integer;
+		break;
 	case e_fuse_opt:			/* fuse_opt, handled in owfs.c */
 		break;
 	case e_fuse_open_opt:		/* fuse_open_opt, handled in owfs.c */
 		break;
+	case e_fuse_threads:
+		RETURN_BAD_IF_BAD(OW_parsevalue_I(&arg_to_integer, arg)) ;
+		Globals.fuse_threads = (int) arg_to_integer;
+		break;
 	case e_max_clients:
 		RETURN_BAD_IF_BAD(OW_parsevalue_I(&arg_to_integer, arg)) ;
 		Globals.max_clients = (int) arg_to_integer;
 		break;
+	case e_server_threads:
+		RETURN_BAD_IF_BAD(OW_parsevalue_I(&arg_to_integer, arg)) ;
+		Globals.server_threads = (int) arg_to_integer;
+		break;
+	case e_server_pool:
+		RETURN_BAD_IF_BAD(OW_parsevalue_I(&arg_to_integer, arg)) ;
+		Globals.server_pool = (int) arg_to_integer;
+		break;
+	case e_http_keepalive:
+		RETURN_BAD_IF_BAD(OW_parsevalue_I(&arg_to_integer, arg)) ;
+		Globals.http_keepalive = (int) arg_to_integer;
+		break;
+	case e_http_max_requests:
+		RETURN_BAD_IF_BAD(OW_parsevalue_I(&arg_to_integer, arg)) ;
+		Globals.http_max_requests = (int) arg_to_integer;
+		break;
+	case e_poll:
+		return Poll_Add(arg);
+	case e_stale:
+		return Stale_Add(arg);
 	case e_want_background:
 		switch (Globals.daemon_status) {
 			case e_daemon_sd:
@@ -814,6 +892,8 @@ GOOD_OR_BAD owopt(const int option_char, const char *arg)
 		return ARG_Tester(arg);
 	case e_mock:
 		return ARG_Mock(arg);
+	case e_sim:
+		return ARG_Sim(arg);
 	case e_etherweather:
 		return ARG_EtherWeather(arg);
 	case e_masterhub:
@@ -866,6 +946,8 @@ GOOD_OR_BAD owopt(const int option_char, const char *arg)
 	case e_timeout_ftp:
 	case e_timeout_ha7:
 	case e_timeout_w1:
+	case e_timeout_detect:
+	case e_timeout_external:
 	case e_timeout_persistent_low:
 	case e_timeout_persistent_high:
 	case e_clients_persistent_low:
@@ -24,7 +24,7 @@ enum parse_pass {
 };
 
 struct parsedname_pointers {
-	char pathcpy[PATH_MAX+1];
+	char *pathcpy;
 	char *pathnow;
 	char *pathnext;
 	char *pathlast;
@@ -49,6 +49,10 @@ static void ReplaceAliasInPath( char * filename, struct parsedname * pn);
 static ZERO_OR_ERROR FS_ParsedName_anywhere(const char *path, enum parse_pass remote_status, struct parsedname *pn);
 static ZERO_OR_ERROR FS_ParsedName_setup(struct parsedname_pointers *pp, const char *path, struct parsedname *pn);
 static char * find_segment_in_path( char * segment, char * path ) ;
+static void Set_path_to_server( char * to_server, struct parsedname * pn ) ;
+
+/* path for the minimal (path==NULL) structure */
+static char empty_path[] = "" ;
 
 #define BRANCH_INCR (9)
 
@@ -65,6 +69,11 @@ void FS_ParsedName_destroy(struct parsedname *pn)
 	Detail_Free( pn ) ;
 	SAFEFREE(pn->sparse_name);
 	SAFEFREE(pn->bp) ;
+	Set_path_to_server( empty_path, pn ) ;
+	if ( pn->path != empty_path ) {
+		SAFEFREE(pn->path) ;
+	}
+	pn->path = empty_path ;
 }
 
 /* 
@@ -74,13 +83,26 @@ void FS_ParsedName_destroy(struct parsedname *pn)
  * The Path passed in isn't altered, but 2 copies are made -- one with the full path, the other (to_server) has the first bus.n removed.
  * An initial / is added to the path, and the full length has to be less than MAX_PATH (2048)
  * 
- * For efficiency, the two path copies are allocated in the same memory allocation call, and so can be removed together.
+ * For efficiency, the path and the scratch copy used for parsing are allocated to fit in a single memory allocation call.
+ * path_to_server is the same string as path unless a bus.n or alias makes it differ, and only then gets its own allocation.
  * */
 
 /* Parse a path to check it's validity and attach to the propery data structures */
 ZERO_OR_ERROR FS_ParsedName(const char *path, struct parsedname *pn)
 {
-	return FS_ParsedName_anywhere(path, parse_pass_pre_remote, pn);
+	struct parse_cache_ticket ticket = { 0, 0, } ;
+	ZERO_OR_ERROR parse_error_status ;
+
+	// same path parsed before?
+	if ( GOOD( ParseCache_Get(path, pn, &ticket) ) ) {
+		return 0 ;
+	}
+
+	parse_error_status = FS_ParsedName_anywhere(path, parse_pass_pre_remote, pn);
+	if ( parse_error_status == 0 ) {
+		ParseCache_Add(path, pn, &ticket) ;
+	}
+	return parse_error_status ;
 }
 
 /* Parse a path from a remote source back -- so don't check presence */
@@ -238,6 +260,8 @@ static ZERO_OR_ERROR FS_ParsedName_anywhere(const char *path, enum parse_pass re
 /* Initial memory allocation and pn setup */
 static ZERO_OR_ERROR FS_ParsedName_setup(struct parsedname_pointers *pp, const char *path, struct parsedname *pn)
 {
+	size_t path_length ;
+
 	if (pn == NO_PARSEDNAME) {
 		RETURN_CODE_RETURN( 78 ); // unexpected null pointer
 	}
@@ -284,21 +308,33 @@ static ZERO_OR_ERROR FS_ParsedName_setup(struct parsedname_pointers *pp, const c
 
 	/* minimal structure for initial bus "detect" use -- really has connection and LocalControlFlags only */
 	pn->dirlength = -1 ;
+	pn->path = empty_path ;
+	pn->path_to_server = empty_path ;
 	if (path == NO_PATH) {
 		return 0; // success
 	}
 
-	if (strlen(path) > PATH_MAX) {
+	path_length = strlen(path) ;
+	if (path_length > PATH_MAX) {
 		RETURN_CODE_RETURN( 26 ) ; // path too long
 	}
 
+	/* room for the initial slash and null, plus the parsing copy */
+	pn->path = owmalloc( 2 * (path_length + 2) ) ;
+	if ( pn->path == NO_PATH ) {
+		pn->path = empty_path ;
+		pn->path_to_server = empty_path ;
+		RETURN_CODE_RETURN( 79 ) ; // unable to allocate memory
+	}
+
 	/* Have to save pn->path at once */
 	strcpy(pn->path, "/"); // initial slash
 	strcpy(pn->path+1, path[0]=='/'?path+1:path);
-	strcpy(pn->path_to_server, pn->path);
+	pn->path_to_server = pn->path ;
 
 	/* make a copy for destructive parsing  without initial '/'*/
-	strcpy(pp->pathcpy,&pn->path[1]);
+	pp->pathcpy = pn->path + path_length + 2 ;
+	strcpy(pp->pathcpy, path[0]=='/'?path+1:path);
 	/* pointer to rest of path after current token peeled off */
 	pp->pathnext = pp->pathcpy;
 	pn->dirlength = strlen(pn->path) ;
@@ -546,14 +582,28 @@ static enum parse_enum Parse_Bus( INDEX_OR_ERROR bus_number, struct parsedname *
 
 	/* Create the path without the "bus.x" part in pn->path_to_server */
 	if ( ow_regexec( &rx_p_bus, pn->path, &orm ) == 0 ) {
-		strcpy( pn->path_to_server, orm.pre[0] ) ;
-		strcat( pn->path_to_server, "/" ) ;
-		strcat( pn->path_to_server, orm.post[0] ) ;
+		char * to_server = owmalloc( strlen(orm.pre[0]) + strlen(orm.post[0]) + 2 ) ;
+		if ( to_server != NULL ) {
+			strcpy( to_server, orm.pre[0] ) ;
+			strcat( to_server, "/" ) ;
+			strcat( to_server, orm.post[0] ) ;
+			Set_path_to_server( to_server, pn ) ;
+		}
 		ow_regexec_free( &orm ) ;
 	}
 	return parse_first;
 }
 
+/* Give path_to_server a new string (or none),
+ * freeing the old one if it wasn't just sharing path */
+static void Set_path_to_server( char * to_server, struct parsedname * pn )
+{
+	if ( pn->path_to_server != pn->path && pn->path_to_server != empty_path ) {
+		SAFEFREE( pn->path_to_server ) ;
+	}
+	pn->path_to_server = to_server ;
+}
+
 // search path for this exact matching path segment
 static char * find_segment_in_path( char * segment, char * path )
 {
@@ -585,20 +635,27 @@ static void ReplaceAliasInPath( char * filename, struct parsedname * pn)
 {
 	int alias_len = strlen(filename) ;
 	
+	int to_server_len = strlen(pn->path_to_server) + 14 - alias_len ;
+	
 	// check total length
-	if ( strlen(pn->path_to_server) + 14 - alias_len <= PATH_MAX ) {
+	if ( to_server_len <= PATH_MAX ) {
 		// find the alias
 		char * alias_loc = find_segment_in_path( filename, pn->path_to_server ) ;
 		
 		if ( alias_loc != NULL ) {
-			char * post_alias_loc ;
-
-			post_alias_loc = alias_loc + alias_len ;
+			char * to_server = owmalloc( to_server_len + 1 ) ;
+			int pre_alias_len = alias_loc - pn->path_to_server ;
 
-			// move rest of path
-			memmove( &alias_loc[14], post_alias_loc, strlen(post_alias_loc)+1 ) ;
+			if ( to_server == NULL ) {
+				return ;
+			}
+			// path up to the alias
+			memcpy( to_server, pn->path_to_server, pre_alias_len ) ;
 			//write in serial number for alias
-			bytes2string( alias_loc, pn->sn, 7 ) ;
+			bytes2string( &to_server[pre_alias_len], pn->sn, 7 ) ;
+			// rest of path
+			strcpy( &to_server[pre_alias_len+14], alias_loc + alias_len ) ;
+			Set_path_to_server( to_server, pn ) ;
 		}
 	}
 }
@@ -860,11 +917,7 @@ static enum parse_enum Parse_Property(char *filename, struct parsedname *pn)
 			return parse_error;
 		}
 		/* STATISTICS */
-		STATLOCK;
-		if (pn->ds2409_depth > dir_depth) {
-			dir_depth = pn->ds2409_depth;
-		}
-		STATUNLOCK;
+		STAT_MAX(dir_depth, pn->ds2409_depth);
 		return parse_branch;
 	case ft_subdir:
 		//printf("PN %s is a subdirectory\n", filename);
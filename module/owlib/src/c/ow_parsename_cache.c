@@ -0,0 +1,413 @@
+/*
+    OWFS -- One-Wire filesystem
+    OWHTTPD -- One-Wire Web Server
+    Written 2003 Paul H Alfille
+    email: paul.alfille@gmail.com
+    Released under the GPL
+    See the header file: ow.h for full attribution
+    1wire/iButton system from Dallas Semiconductor
+*/
+
+#include <config.h>
+#include "owfs_config.h"
+#include "ow.h"
+#include "ow_counters.h"
+#include "ow_connection.h"
+
+/* Parsed path cache
+	Clients ask for the same paths over and over, and each FS_ParsedName
+	splits the path, looks up aliases, the device and the property, and the bus.
+	-- successful parses are kept by path and control flags
+	-- the bus found for a device is part of the parse, so entries last only as
+	   long as the presence cache (timeout_presence), and uncached paths aren't kept
+	-- a hit is a copy of the stored parsedname with its own allocations,
+	   so it is destroyed with FS_ParsedName_destroy like any other
+	-- PARSE_CACHE_SHARDS shards, each with its own mutex, hash chains and LRU list
+	-- Globals.parse_cache_size entries (split among the shards), 0 to turn off
+	-- ParseCache_Flush empties everything: aliases changed, a bus went away,
+	   or the cache flipped (device locations expire)
+	-- ParseCache_Flush_Device drops just one device's paths (it moved or is gone)
+	   by moving on the generation of its slot, entries of an older generation are misses
+	-- each shard counts its flushes, so a parse that started before a flush
+	   isn't added after it, and a parse during any device flush isn't added either
+*/
+
+#define PARSE_CACHE_SHARDS   16
+#define PARSE_CACHE_BUCKETS  64
+#define PARSE_CACHE_DEVICE_SLOTS 256
+
+struct parse_cache_entry {
+	struct parse_cache_entry *chain;	// next in hash bucket
+	struct parse_cache_entry *newer;	// LRU list
+	struct parse_cache_entry *older;	// LRU list
+	UINT hash;
+	uint32_t control_flags;
+	time_t expires;
+	UINT device_generation;			// of the slot for pn.sn when added
+	struct parsedname pn;			// own copies of path, path_to_server and sparse_name
+	// path key follows
+};
+
+#define PARSE_CACHE_KEY(pce)    ( (char *)(pce) + sizeof(struct parse_cache_entry) )
+
+struct parse_cache_shard {
+	pthread_mutex_t mutex;
+	struct parse_cache_entry *bucket[PARSE_CACHE_BUCKETS];
+	struct parse_cache_entry *newest;	// LRU head
+	struct parse_cache_entry *oldest;	// LRU tail
+	UINT count;
+	UINT flushes;				// ticket for ParseCache_Add
+};
+
+static struct parse_cache_shard parse_cache[PARSE_CACHE_SHARDS];
+
+/* Generations for ParseCache_Flush_Device, serial numbers share slots */
+static struct {
+	pthread_mutex_t mutex;
+	UINT flushes;				// device flushes of any slot
+	UINT generation[PARSE_CACHE_DEVICE_SLOTS];
+} parse_cache_device;
+
+static UINT ParseCache_Hash(const char *path, uint32_t control_flags);
+static UINT ParseCache_Device_Slot(const BYTE * sn);
+static struct parse_cache_entry *ParseCache_Find(struct parse_cache_shard *shard, const char *path, UINT hash, uint32_t control_flags);
+static void ParseCache_Unlink(struct parse_cache_shard *shard, struct parse_cache_entry *pce);
+static void ParseCache_Unlink_LRU(struct parse_cache_shard *shard, struct parse_cache_entry *pce);
+static void ParseCache_Link_LRU(struct parse_cache_shard *shard, struct parse_cache_entry *pce);
+static void ParseCache_Free(struct parse_cache_entry *pce);
+static GOOD_OR_BAD ParseCache_Copy(struct parsedname *pn_to, const struct parsedname *pn_from);
+static void ParseCache_Copy_Free(struct parsedname *pn);
+
+void ParseCache_Open(void)
+{
+	int shard_index;
+
+	memset(parse_cache, 0, sizeof(parse_cache));
+	for (shard_index = 0; shard_index < PARSE_CACHE_SHARDS; ++shard_index) {
+		_MUTEX_INIT(parse_cache[shard_index].mutex);
+	}
+	memset(&parse_cache_device, 0, sizeof(parse_cache_device));
+	_MUTEX_INIT(parse_cache_device.mutex);
+}
+
+void ParseCache_Close(void)
+{
+	int shard_index;
+
+	ParseCache_Flush();
+	for (shard_index = 0; shard_index < PARSE_CACHE_SHARDS; ++shard_index) {
+		_MUTEX_DESTROY(parse_cache[shard_index].mutex);
+	}
+	_MUTEX_DESTROY(parse_cache_device.mutex);
+}
+
+/* Empty the cache -- something a parse depends on has changed */
+void ParseCache_Flush(void)
+{
+	int shard_index;
+
+	for (shard_index = 0; shard_index < PARSE_CACHE_SHARDS; ++shard_index) {
+		struct parse_cache_shard *shard = &parse_cache[shard_index];
+		struct parse_cache_entry *list;
+
+		_MUTEX_LOCK(shard->mutex);
+		list = shard->newest;
+		memset(shard->bucket, 0, sizeof(shard->bucket));
+		shard->newest = shard->oldest = NULL;
+		shard->count = 0;
+		++shard->flushes;
+		_MUTEX_UNLOCK(shard->mutex);
+
+		// free outside the lock
+		while (list != NULL) {
+			struct parse_cache_entry *older = list->older;
+			ParseCache_Free(list);
+			list = older;
+		}
+	}
+	STAT_ADD1(parse_cache_flushes);
+}
+
+/* Forget the parsed paths of one device -- its location changed
+ * Other devices' entries in the same slot go too, which is only a miss */
+void ParseCache_Flush_Device(const BYTE * sn)
+{
+	_MUTEX_LOCK(parse_cache_device.mutex);
+	++parse_cache_device.flushes;
+	++parse_cache_device.generation[ParseCache_Device_Slot(sn)];
+	_MUTEX_UNLOCK(parse_cache_device.mutex);
+	STAT_ADD1(parse_cache_device_flushes);
+}
+
+static UINT ParseCache_Device_Slot(const BYTE * sn)
+{
+	UINT h = 0;
+	int i;
+
+	for (i = 0; i < SERIAL_NUMBER_SIZE - 1; ++i) {	// CRC byte adds nothing
+		h = h * 31 + sn[i];
+	}
+	return h % PARSE_CACHE_DEVICE_SLOTS;
+}
+
+/* Fill pn from the cache (CONNIN_RLOCK taken as FS_ParsedName_setup does)
+ * On a miss, ticket is what ParseCache_Add needs to store the fresh parse */
+GOOD_OR_BAD ParseCache_Get(const char *path, struct parsedname *pn, struct parse_cache_ticket * ticket)
+{
+	uint32_t control_flags;
+	UINT hash;
+	struct parse_cache_shard *shard;
+	struct parse_cache_entry *pce;
+	struct parse_cache_entry *expired = NULL;
+
+	if (Globals.parse_cache_size <= 0 || path == NO_PATH) {
+		return gbBAD;
+	}
+
+	// the flags FS_ParsedName_setup starts from
+	CONTROLFLAGSLOCK;
+	control_flags = LocalControlFlags & ~SHOULD_RETURN_BUS_LIST;
+	CONTROLFLAGSUNLOCK;
+
+	hash = ParseCache_Hash(path, control_flags);
+	shard = &parse_cache[(hash >> 24) % PARSE_CACHE_SHARDS];
+
+	// before the lookup, so a device flush during the parse that follows a miss is noticed
+	_MUTEX_LOCK(parse_cache_device.mutex);
+	ticket->device_flushes = parse_cache_device.flushes;
+	_MUTEX_UNLOCK(parse_cache_device.mutex);
+
+	// bus list can't change while the copy is made or used
+	CONNIN_RLOCK;
+	_MUTEX_LOCK(shard->mutex);
+	pce = ParseCache_Find(shard, path, hash, control_flags);
+	if (pce != NULL && (pce->expires < NOW_TIME || pce->device_generation != parse_cache_device.generation[ParseCache_Device_Slot(pce->pn.sn)])) {
+		// device location may be stale
+		ParseCache_Unlink(shard, pce);
+		expired = pce;
+		pce = NULL;
+	}
+	if (pce == NULL || BAD(ParseCache_Copy(pn, &pce->pn))) {
+		ticket->flushes = shard->flushes;
+		_MUTEX_UNLOCK(shard->mutex);
+		CONNIN_RUNLOCK;
+		if (expired != NULL) {
+			ParseCache_Free(expired);
+		}
+		STAT_ADD1(parse_cache_misses);
+		return gbBAD;
+	}
+	// most recently used
+	ParseCache_Unlink_LRU(shard, pce);
+	ParseCache_Link_LRU(shard, pce);
+	_MUTEX_UNLOCK(shard->mutex);
+
+	STAT_ADD1(parse_cache_hits);
+	// per-request debugging, as at the end of a parse
+	Detail_Test(pn);
+	return gbGOOD;
+}
+
+/* Keep a successful parse of path */
+void ParseCache_Add(const char *path, const struct parsedname *pn, const struct parse_cache_ticket * ticket)
+{
+	size_t path_length;
+	UINT hash;
+	struct parse_cache_shard *shard;
+	struct parse_cache_entry *pce;
+	struct parse_cache_entry *evict = NULL;
+	UINT limit;
+	time_t duration = Globals.timeout_presence;
+
+	if (Globals.parse_cache_size <= 0 || path == NO_PATH || duration <= 0) {
+		return;
+	}
+	if (IsUncachedDir(pn)) {
+		// asked for a fresh look at the bus
+		return;
+	}
+	if (pn->ds2409_depth > 0) {
+		// branch list isn't copied
+		return;
+	}
+
+	path_length = strlen(path);
+	pce = owmalloc(sizeof(struct parse_cache_entry) + path_length + 1);
+	if (pce == NULL) {
+		return;
+	}
+	if (BAD(ParseCache_Copy(&pce->pn, pn))) {
+		owfree(pce);
+		return;
+	}
+	pce->pn.detail_flag = 0;
+	pce->expires = NOW_TIME + duration;
+
+	_MUTEX_LOCK(parse_cache_device.mutex);
+	if (ticket->device_flushes != parse_cache_device.flushes) {
+		// a device moved while parsing, maybe this one
+		_MUTEX_UNLOCK(parse_cache_device.mutex);
+		ParseCache_Free(pce);
+		return;
+	}
+	pce->device_generation = parse_cache_device.generation[ParseCache_Device_Slot(pn->sn)];
+	_MUTEX_UNLOCK(parse_cache_device.mutex);
+	memcpy(PARSE_CACHE_KEY(pce), path, path_length + 1);
+
+	// parsing only ever clears the bus list flag
+	pce->control_flags = pn->control_flags & ~SHOULD_RETURN_BUS_LIST;
+	hash = pce->hash = ParseCache_Hash(path, pce->control_flags);
+	shard = &parse_cache[(hash >> 24) % PARSE_CACHE_SHARDS];
+	limit = Globals.parse_cache_size / PARSE_CACHE_SHARDS + 1;
+
+	_MUTEX_LOCK(shard->mutex);
+	if (ticket->flushes != shard->flushes || ParseCache_Find(shard, path, hash, pce->control_flags) != NULL) {
+		// flushed while parsing, or another thread got there first
+		evict = pce;
+	} else {
+		pce->chain = shard->bucket[hash % PARSE_CACHE_BUCKETS];
+		shard->bucket[hash % PARSE_CACHE_BUCKETS] = pce;
+		ParseCache_Link_LRU(shard, pce);
+		++shard->count;
+		STAT_ADD1(parse_cache_adds);
+		if (shard->count > limit) {
+			evict = shard->oldest;
+			ParseCache_Unlink(shard, evict);
+			STAT_ADD1(parse_cache_evictions);
+		}
+	}
+	_MUTEX_UNLOCK(shard->mutex);
+
+	if (evict != NULL) {
+		ParseCache_Free(evict);
+	}
+}
+
+/* FNV-1a of the path and flags with a final mix (high bits pick the shard) */
+static UINT ParseCache_Hash(const char *path, uint32_t control_flags)
+{
+	UINT h = 2166136261u;
+	int i;
+
+	for (; *path; ++path) {
+		h ^= (BYTE) * path;
+		h *= 16777619u;
+	}
+	for (i = 0; i < 4; ++i) {
+		h ^= (control_flags >> (8 * i)) & 0xFF;
+		h *= 16777619u;
+	}
+	h ^= h >> 16;
+	h *= 0x85EBCA6Bu;
+	h ^= h >> 13;
+	return h;
+}
+
+/* Shard locked */
+static struct parse_cache_entry *ParseCache_Find(struct parse_cache_shard *shard, const char *path, UINT hash, uint32_t control_flags)
+{
+	struct parse_cache_entry *pce;
+
+	for (pce = shard->bucket[hash % PARSE_CACHE_BUCKETS]; pce != NULL; pce = pce->chain) {
+		if (pce->hash == hash && pce->control_flags == control_flags && strcmp(PARSE_CACHE_KEY(pce), path) == 0) {
+			return pce;
+		}
+	}
+	return NULL;
+}
+
+/* Take out of hash chain and LRU list (shard locked) */
+static void ParseCache_Unlink(struct parse_cache_shard *shard, struct parse_cache_entry *pce)
+{
+	struct parse_cache_entry **link = &shard->bucket[pce->hash % PARSE_CACHE_BUCKETS];
+
+	while (*link != NULL) {
+		if (*link == pce) {
+			*link = pce->chain;
+			break;
+		}
+		link = &((*link)->chain);
+	}
+	pce->chain = NULL;
+	ParseCache_Unlink_LRU(shard, pce);
+	--shard->count;
+}
+
+static void ParseCache_Unlink_LRU(struct parse_cache_shard *shard, struct parse_cache_entry *pce)
+{
+	if (pce->newer != NULL) {
+		pce->newer->older = pce->older;
+	} else {
+		shard->newest = pce->older;
+	}
+	if (pce->older != NULL) {
+		pce->older->newer = pce->newer;
+	} else {
+		shard->oldest = pce->newer;
+	}
+	pce->newer = pce->older = NULL;
+}
+
+/* Put at the most recently used end */
+static void ParseCache_Link_LRU(struct parse_cache_shard *shard, struct parse_cache_entry *pce)
+{
+	pce->newer = NULL;
+	pce->older = shard->newest;
+	if (shard->newest != NULL) {
+		shard->newest->newer = pce;
+	}
+	shard->newest = pce;
+	if (shard->oldest == NULL) {
+		shard->oldest = pce;
+	}
+}
+
+static void ParseCache_Free(struct parse_cache_entry *pce)
+{
+	ParseCache_Copy_Free(&pce->pn);
+	owfree(pce);
+}
+
+/* Copy a parsedname including the strings it owns.
+ * The parse scratch area after path isn't needed */
+static GOOD_OR_BAD ParseCache_Copy(struct parsedname *pn_to, const struct parsedname *pn_from)
+{
+	memcpy(pn_to, pn_from, sizeof(struct parsedname));
+	pn_to->path_to_server = NULL;
+	pn_to->sparse_name = NULL;
+
+	pn_to->path = owstrdup(pn_from->path);
+	if (pn_to->path == NULL) {
+		return gbBAD;
+	}
+	if (pn_from->path_to_server == pn_from->path) {
+		pn_to->path_to_server = pn_to->path;
+	} else {
+		pn_to->path_to_server = owstrdup(pn_from->path_to_server);
+		if (pn_to->path_to_server == NULL) {
+			ParseCache_Copy_Free(pn_to);
+			return gbBAD;
+		}
+	}
+	if (pn_from->device_name != NULL) {
+		// points into path
+		pn_to->device_name = pn_to->path + (pn_from->device_name - pn_from->path);
+	}
+	if (pn_from->sparse_name != NULL) {
+		pn_to->sparse_name = owstrdup(pn_from->sparse_name);
+		if (pn_to->sparse_name == NULL) {
+			ParseCache_Copy_Free(pn_to);
+			return gbBAD;
+		}
+	}
+	return gbGOOD;
+}
+
+static void ParseCache_Copy_Free(struct parsedname *pn)
+{
+	if (pn->path_to_server != pn->path) {
+		SAFEFREE(pn->path_to_server);
+	}
+	SAFEFREE(pn->path);
+	SAFEFREE(pn->sparse_name);
+}
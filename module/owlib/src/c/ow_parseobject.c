@@ -100,6 +100,11 @@ struct one_wire_query * OWQ_create_sibling(const char *sibling, struct one_wire_
 		// Make uncached as restrictive as original
 		// Make unaliased as restrictive as original
 		PN(owq_sib)->state |= (pn_original->state & (ePS_uncached|ePS_unaliased) ) ;
+		// A stale value is as acceptable as for the original
+		PN(owq_sib)->stale_grace = Stale_Grace( pn_original ) ;
+		if ( PN(owq_sib)->stale_grace > 0 ) {
+			PN(owq_sib)->control_flags |= STALE_OK ;
+		}
 		return owq_sib ;
 	}
 	return NO_ONE_WIRE_QUERY ;
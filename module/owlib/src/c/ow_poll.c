@@ -0,0 +1,611 @@
+/*
+    OWFS -- One-Wire filesystem
+    OWHTTPD -- One-Wire Web Server
+    Written 2003 Paul H Alfille
+    email: paul.alfille@gmail.com
+    Released under the GPL
+    See the header file: ow.h for full attribution
+    1wire/iButton system from Dallas Semiconductor
+*/
+
+/* Background polling
+ * --poll=GLOB[,SECONDS] keeps matching properties fresh in the cache.
+ * The glob is matched against "/device/property" (e.g. "/28.*\/temperature")
+ * with the device in the plain FF.IIIIIIIIIIII form.
+ *
+ * Each local bus gets one poll thread. When a job is due the thread
+ *   lists the bus devices (directory cache is fine),
+ *   starts a simultaneous conversion if any match needs one,
+ *   and reads each match uncached (temperatures and voltages read through the
+ *   cache instead, to pick up the conversion), which stores the new value in the cache.
+ * Interactive requests come first -- before each read the thread waits
+ * (a bounded time) for the bus to be quiet.
+ *
+ * Statistics are in /statistics/poll, one element per job.
+ * */
+
+#include <config.h>
+#include "owfs_config.h"
+#include "ow.h"
+#include "ow_connection.h"
+#include "ow_stats.h"
+#include <fnmatch.h>
+
+/* Quiet bus: no one else has used it during the last POLL_IDLE_GAP msec */
+#define POLL_IDLE_GAP      20
+/* but don't defer a refresh more than this many gaps */
+#define POLL_IDLE_TRIES    50
+
+struct poll_job {
+	struct poll_job * next ;
+	char * pattern ;			// glob for "/device/property"
+	int period ;				// seconds between refreshes
+	int index ;					// element in /statistics/poll
+	// statistics, all buses together
+	UINT runs ;
+	UINT overruns ;				// next run was already due when this one finished
+	UINT lag ;					// msec late starting the last run
+	UINT lag_max ;
+	UINT reads ;
+	UINT errors ;
+};
+
+struct poll_bus {
+	struct poll_bus * next ;
+	int bus_nr ;
+	pthread_t thread ;
+};
+
+static struct {
+	struct poll_job * head ;
+	struct poll_job * tail ;
+	int jobs ;
+	struct poll_bus * buses ;
+	pthread_mutex_t mutex ;
+	pthread_cond_t cond ;
+	int started ;
+	int stopping ;
+} poll_control ;
+
+static void * Poll_Thread( void * v ) ;
+static void Poll_Run( struct poll_job * job, int bus_nr ) ;
+static void Poll_Match( struct poll_job * job, int bus_nr, const BYTE * sn, struct charblob * matches, int * temperature, int * voltage ) ;
+static void Poll_Match_Name( struct poll_job * job, const char * device, const char * name, struct charblob * matches ) ;
+static int Poll_Sleep_Until( const struct timeval * until ) ;
+static int Poll_Bus_Busy( int bus_nr, UINT * locks ) ;
+static void Poll_Wait_Idle( int bus_nr, UINT * locks ) ;
+static void Poll_Dir_Callback( void * v, const struct parsedname * pn_entry ) ;
+static struct poll_job * Poll_Job( int index ) ;
+static ZERO_OR_ERROR FS_poll_stat( struct one_wire_query * owq ) ;
+static ZERO_OR_ERROR FS_poll_pattern( struct one_wire_query * owq ) ;
+static ZERO_OR_ERROR FS_poll_period( struct one_wire_query * owq ) ;
+
+/* ------- Statistics ------------ */
+
+/* elements set as jobs are added */
+static struct aggregate Apoll = { 0, ag_numbers, ag_separate, };
+static struct filetype stats_poll[] = {
+	{"pattern", 128, &Apoll, ft_vascii, fc_statistic, FS_poll_pattern, NO_WRITE_FUNCTION, VISIBLE, NO_FILETYPE_DATA, },
+	{"period", PROPERTY_LENGTH_UNSIGNED, &Apoll, ft_unsigned, fc_statistic, FS_poll_period, NO_WRITE_FUNCTION, VISIBLE, NO_FILETYPE_DATA, },
+	{"runs", PROPERTY_LENGTH_UNSIGNED, &Apoll, ft_unsigned, fc_statistic, FS_poll_stat, NO_WRITE_FUNCTION, VISIBLE, {.s=offsetof(struct poll_job,runs)}, },
+	{"overruns", PROPERTY_LENGTH_UNSIGNED, &Apoll, ft_unsigned, fc_statistic, FS_poll_stat, NO_WRITE_FUNCTION, VISIBLE, {.s=offsetof(struct poll_job,overruns)}, },
+	{"lag", PROPERTY_LENGTH_UNSIGNED, &Apoll, ft_unsigned, fc_statistic, FS_poll_stat, NO_WRITE_FUNCTION, VISIBLE, {.s=offsetof(struct poll_job,lag)}, },
+	{"lag_max", PROPERTY_LENGTH_UNSIGNED, &Apoll, ft_unsigned, fc_statistic, FS_poll_stat, NO_WRITE_FUNCTION, VISIBLE, {.s=offsetof(struct poll_job,lag_max)}, },
+	{"reads", PROPERTY_LENGTH_UNSIGNED, &Apoll, ft_unsigned, fc_statistic, FS_poll_stat, NO_WRITE_FUNCTION, VISIBLE, {.s=offsetof(struct poll_job,reads)}, },
+	{"errors", PROPERTY_LENGTH_UNSIGNED, &Apoll, ft_unsigned, fc_statistic, FS_poll_stat, NO_WRITE_FUNCTION, VISIBLE, {.s=offsetof(struct poll_job,errors)}, },
+};
+
+struct device d_stats_poll = { "poll", "poll", 0, COUNT_OF_FILETYPES(stats_poll), stats_poll, NO_GENERIC_READ, NO_GENERIC_WRITE };
+
+static struct poll_job * Poll_Job( int index )
+{
+	struct poll_job * job ;
+
+	for ( job = poll_control.head ; job != NULL ; job = job->next ) {
+		if ( job->index == index ) {
+			return job ;
+		}
+	}
+	return NULL ;
+}
+
+static ZERO_OR_ERROR FS_poll_stat( struct one_wire_query * owq )
+{
+	struct poll_job * job = Poll_Job( PN(owq)->extension ) ;
+
+	if ( job == NULL ) {
+		return -ENOENT ;
+	}
+	OWQ_U(owq) = STAT_GET( *(UINT *) ( ((char *) job) + PN(owq)->selected_filetype->data.s ) ) ;
+	return 0 ;
+}
+
+static ZERO_OR_ERROR FS_poll_pattern( struct one_wire_query * owq )
+{
+	struct poll_job * job = Poll_Job( PN(owq)->extension ) ;
+
+	if ( job == NULL ) {
+		return -ENOENT ;
+	}
+	return OWQ_format_output_offset_and_size_z( job->pattern, owq ) ;
+}
+
+static ZERO_OR_ERROR FS_poll_period( struct one_wire_query * owq )
+{
+	struct poll_job * job = Poll_Job( PN(owq)->extension ) ;
+
+	if ( job == NULL ) {
+		return -ENOENT ;
+	}
+	OWQ_U(owq) = job->period ;
+	return 0 ;
+}
+
+/* ------- Configuration ------------ */
+
+/* --poll=GLOB[,SECONDS]
+ * Called during option parsing (single threaded) */
+GOOD_OR_BAD Poll_Add( const char * arg )
+{
+	struct poll_job * job ;
+	char * comma ;
+
+	if ( arg == NULL || arg[0] == '\0' ) {
+		LEVEL_DEFAULT("No path pattern given to poll") ;
+		return gbBAD ;
+	}
+
+	job = owcalloc( 1, sizeof(struct poll_job) ) ;
+	if ( job == NULL ) {
+		return gbBAD ;
+	}
+	job->pattern = owstrdup( arg ) ;
+	if ( job->pattern == NULL ) {
+		owfree( job ) ;
+		return gbBAD ;
+	}
+
+	comma = strrchr( job->pattern, ',' ) ;
+	if ( comma != NULL ) {
+		char * end ;
+		long int seconds ;
+		comma[0] = '\0' ;
+		errno = 0 ;
+		seconds = strtol( &comma[1], &end, 10 ) ;
+		if ( errno != 0 || end == &comma[1] || end[0] != '\0' || seconds < 0 ) {
+			LEVEL_DEFAULT("Bad poll period in %s", arg) ;
+			owfree( job->pattern ) ;
+			owfree( job ) ;
+			return gbBAD ;
+		}
+		job->period = (int) seconds ;
+	}
+
+	job->index = poll_control.jobs++ ;
+	if ( poll_control.tail == NULL ) {
+		poll_control.head = job ;
+	} else {
+		poll_control.tail->next = job ;
+	}
+	poll_control.tail = job ;
+	Apoll.elements = poll_control.jobs ;
+
+	LEVEL_DEBUG("Poll job %d: %s every %d seconds", job->index, job->pattern, job->period) ;
+	return gbGOOD ;
+}
+
+/* Number of poll jobs configured */
+int Poll_Jobs( void )
+{
+	return poll_control.jobs ;
+}
+
+/* ------- Threads ------------ */
+
+/* Start a poll thread for each local bus
+ * Called once we are in the background (threads don't survive a fork) */
+void Poll_Start( void )
+{
+	struct port_in * pin ;
+	struct poll_job * job ;
+
+	if ( poll_control.head == NULL || poll_control.started ) {
+		return ;
+	}
+
+	_MUTEX_INIT( poll_control.mutex ) ;
+	my_pthread_cond_init( &(poll_control.cond), NULL ) ;
+	poll_control.stopping = 0 ;
+	poll_control.started = 1 ;
+
+	// no period given: keep ahead of the volatile cache timeout
+	for ( job = poll_control.head ; job != NULL ; job = job->next ) {
+		if ( job->period <= 0 ) {
+			job->period = Globals.timeout_volatile > 1 ? Globals.timeout_volatile - 1 : 1 ;
+		}
+	}
+
+	CONNIN_RLOCK ;
+	for ( pin = Inbound_Control.head_port ; pin != NULL ; pin = pin->next ) {
+		struct connection_in * in ;
+		for ( in = pin->first ; in != NO_CONNECTION ; in = in->next ) {
+			struct poll_bus * pb ;
+			if ( BusIsServer( in ) ) {
+				// the owserver upstream does its own polling
+				continue ;
+			}
+			pb = owcalloc( 1, sizeof(struct poll_bus) ) ;
+			if ( pb == NULL ) {
+				continue ;
+			}
+			pb->bus_nr = in->index ;
+			if ( pthread_create( &(pb->thread), DEFAULT_THREAD_ATTR, Poll_Thread, pb ) != 0 ) {
+				LEVEL_DEBUG("Cannot create poll thread for bus.%d", pb->bus_nr) ;
+				owfree( pb ) ;
+				continue ;
+			}
+			pb->next = poll_control.buses ;
+			poll_control.buses = pb ;
+		}
+	}
+	CONNIN_RUNLOCK ;
+}
+
+/* End and join the poll threads */
+void Poll_Stop( void )
+{
+	if ( ! poll_control.started ) {
+		return ;
+	}
+
+	_MUTEX_LOCK( poll_control.mutex ) ;
+	poll_control.stopping = 1 ;
+	my_pthread_cond_broadcast( &(poll_control.cond) ) ;
+	_MUTEX_UNLOCK( poll_control.mutex ) ;
+
+	while ( poll_control.buses != NULL ) {
+		struct poll_bus * pb = poll_control.buses ;
+		poll_control.buses = pb->next ;
+		pthread_join( pb->thread, NULL ) ;
+		owfree( pb ) ;
+	}
+
+	my_pthread_cond_destroy( &(poll_control.cond) ) ;
+	_MUTEX_DESTROY( poll_control.mutex ) ;
+	poll_control.started = 0 ;
+}
+
+/* Sleep until the given time, return 1 if polling is stopping */
+static int Poll_Sleep_Until( const struct timeval * until )
+{
+	struct timespec ts ;
+	int stopping ;
+
+	ts.tv_sec = until->tv_sec ;
+	ts.tv_nsec = until->tv_usec * 1000 ;
+
+	_MUTEX_LOCK( poll_control.mutex ) ;
+	while ( ! poll_control.stopping ) {
+		struct timeval now ;
+		timernow( &now ) ;
+		if ( ! timercmp( &now, until, < ) ) {
+			break ;
+		}
+		// ETIMEDOUT is the usual wakeup
+		pthread_cond_timedwait( &(poll_control.cond), &(poll_control.mutex), &ts ) ;
+	}
+	stopping = poll_control.stopping ;
+	_MUTEX_UNLOCK( poll_control.mutex ) ;
+	return stopping ;
+}
+
+/* One thread per local bus, runs each job when it comes due */
+static void * Poll_Thread( void * v )
+{
+	struct poll_bus * pb = v ;
+	struct timeval * due = owcalloc( poll_control.jobs, sizeof(struct timeval) ) ;
+	struct poll_job * job ;
+
+	if ( due == NULL ) {
+		return VOID_RETURN ;
+	}
+
+	LEVEL_DEBUG("Polling bus.%d", pb->bus_nr) ;
+	for ( job = poll_control.head ; job != NULL ; job = job->next ) {
+		timernow( &due[job->index] ) ; // first run right away
+	}
+
+	while ( 1 ) {
+		struct poll_job * next = poll_control.head ;
+		struct timeval start, finish, period ;
+		UINT lag ;
+
+		for ( job = next->next ; job != NULL ; job = job->next ) {
+			if ( timercmp( &due[job->index], &due[next->index], < ) ) {
+				next = job ;
+			}
+		}
+		if ( Poll_Sleep_Until( &due[next->index] ) ) {
+			break ;
+		}
+
+		timernow( &start ) ;
+		timersub( &start, &due[next->index], &finish ) ;
+		lag = finish.tv_sec * 1000 + finish.tv_usec / 1000 ;
+		STAT_SET( next->lag, lag ) ;
+		STAT_MAX( next->lag_max, lag ) ;
+		STAT_ADD1( next->runs ) ;
+
+		Poll_Run( next, pb->bus_nr ) ;
+
+		period.tv_sec = next->period ;
+		period.tv_usec = 0 ;
+		timeradd( &due[next->index], &period, &due[next->index] ) ;
+		timernow( &finish ) ;
+		if ( timercmp( &due[next->index], &finish, < ) ) {
+			// took too long (or the bus was too busy) -- don't try to catch up
+			STAT_ADD1( next->overruns ) ;
+			due[next->index] = finish ;
+		}
+	}
+
+	owfree( due ) ;
+	LEVEL_DEBUG("Stop polling bus.%d", pb->bus_nr) ;
+	return VOID_RETURN ;
+}
+
+/* ------- Refresh ------------ */
+
+static void Poll_Dir_Callback( void * v, const struct parsedname * pn_entry )
+{
+	struct dirblob * db = v ;
+
+	if ( IsRealDir( pn_entry ) && pn_entry->sn[0] != '\0' ) {
+		DirblobAdd( pn_entry->sn, db ) ;
+	}
+}
+
+/* Refresh the job's properties on this bus */
+static void Poll_Run( struct poll_job * job, int bus_nr )
+{
+	ASCII path[PATH_MAX] ;
+	struct parsedname pn_bus ;
+	struct dirblob db ;
+	struct charblob matches ;
+	BYTE sn[SERIAL_NUMBER_SIZE] ;
+	int device_number ;
+	int temperature = 0 ;
+	int voltage = 0 ;
+	UINT locks = 0 ;
+	const ASCII * match ;
+	const ASCII * comma ;
+	const ASCII * end ;
+
+	UCLIBCLOCK;
+		snprintf( path, PATH_MAX, "/bus.%d", bus_nr ) ;
+	UCLIBCUNLOCK;
+	if ( FS_ParsedName( path, &pn_bus ) != 0 ) {
+		LEVEL_DEBUG("Cannot poll %s (bus gone?)", path) ;
+		return ;
+	}
+	DirblobInit( &db ) ;
+	FS_dir( Poll_Dir_Callback, &db, &pn_bus ) ;
+	FS_ParsedName_destroy( &pn_bus ) ;
+
+	CharblobInit( &matches ) ;
+	for ( device_number = 0 ; DirblobGet( device_number, sn, &db ) == 0 ; ++device_number ) {
+		Poll_Match( job, bus_nr, sn, &matches, &temperature, &voltage ) ;
+	}
+	DirblobClear( &db ) ;
+
+	if ( CharblobLength( &matches ) == 0 ) {
+		CharblobClear( &matches ) ;
+		return ;
+	}
+	end = CharblobData( &matches ) + CharblobLength( &matches ) ;
+
+	// one conversion for the whole bus, the reads below pick it up
+	if ( temperature ) {
+		UCLIBCLOCK;
+			snprintf( path, PATH_MAX, "/bus.%d/simultaneous/temperature", bus_nr ) ;
+		UCLIBCUNLOCK;
+		Poll_Wait_Idle( bus_nr, &locks ) ;
+		if ( FS_write( path, "1", 1, 0 ) < 0 ) {
+			STAT_ADD1( job->errors ) ;
+		}
+		Poll_Bus_Busy( bus_nr, &locks ) ; // our own use doesn't count
+	}
+	if ( voltage ) {
+		UCLIBCLOCK;
+			snprintf( path, PATH_MAX, "/bus.%d/simultaneous/voltage", bus_nr ) ;
+		UCLIBCUNLOCK;
+		Poll_Wait_Idle( bus_nr, &locks ) ;
+		if ( FS_write( path, "1", 1, 0 ) < 0 ) {
+			STAT_ADD1( job->errors ) ;
+		}
+		Poll_Bus_Busy( bus_nr, &locks ) ; // our own use doesn't count
+	}
+
+	// matches are a comma-separated list of paths
+	for ( match = CharblobData( &matches ) ; match < end ; match = comma + 1 ) {
+		struct one_wire_query * owq ;
+		size_t length ;
+
+		comma = memchr( match, ',', end - match ) ;
+		if ( comma == NULL ) {
+			comma = end ;
+		}
+		length = comma - match ;
+		if ( length >= PATH_MAX ) {
+			continue ;
+		}
+		memcpy( path, match, length ) ;
+		path[length] = '\0' ;
+
+		Poll_Wait_Idle( bus_nr, &locks ) ;
+		if ( poll_control.stopping ) {
+			break ;
+		}
+		owq = OWQ_create_from_path( path ) ; // for read
+		if ( owq == NULL ) {
+			STAT_ADD1( job->errors ) ;
+			continue ;
+		}
+		// the read adds the new value to the cache
+		if ( GOOD( OWQ_allocate_read_buffer( owq ) ) && FS_read_postparse( owq ) >= 0 ) {
+			STAT_ADD1( job->reads ) ;
+		} else {
+			LEVEL_DEBUG("Poll read of %s failed", path) ;
+			STAT_ADD1( job->errors ) ;
+		}
+		OWQ_destroy( owq ) ;
+		Poll_Bus_Busy( bus_nr, &locks ) ; // our own use doesn't count
+	}
+	CharblobClear( &matches ) ;
+}
+
+/* Add this device's matching properties to the list */
+static void Poll_Match( struct poll_job * job, int bus_nr, const BYTE * sn, struct charblob * matches, int * temperature, int * voltage )
+{
+	ASCII device_path[PATH_MAX] ;
+	ASCII cached_path[PATH_MAX] ;
+	ASCII device[OW_FULLNAME_MAX] ;
+	struct parsedname pn_device ;
+	struct device * dev ;
+	int ft_index ;
+
+	UCLIBCLOCK;
+		snprintf( device, OW_FULLNAME_MAX, "%02X.%02X%02X%02X%02X%02X%02X", sn[0], sn[1], sn[2], sn[3], sn[4], sn[5], sn[6] ) ;
+		snprintf( device_path, PATH_MAX, "/uncached/bus.%d/%s", bus_nr, device ) ;
+		snprintf( cached_path, PATH_MAX, "/bus.%d/%s", bus_nr, device ) ;
+	UCLIBCUNLOCK;
+	if ( FS_ParsedName( device_path, &pn_device ) != 0 ) {
+		return ;
+	}
+	dev = pn_device.selected_device ;
+	FS_ParsedName_destroy( &pn_device ) ;
+	if ( dev == NO_DEVICE ) {
+		return ;
+	}
+
+	for ( ft_index = 0 ; ft_index < dev->count_of_filetypes ; ++ft_index ) {
+		struct filetype * ft = &( dev->filetype_array[ft_index] ) ;
+		size_t before = CharblobLength( matches ) ;
+		// DS18x20 temperature links also end up at a simultaneous property
+		int temperature_link = ( ft->change == fc_link && ft->format == ft_temperature ) ;
+		const char * prefix = device_path ;
+
+		if ( ft->read == NO_READ_FUNCTION || ft->format == ft_directory || ft->format == ft_subdir ) {
+			continue ;
+		}
+		switch ( ft->change ) {
+			case fc_simultaneous_temperature:
+			case fc_simultaneous_voltage:
+				// Read through the cache: the new conversion makes the cached value stale,
+				// and only a cached read knows to use the conversion instead of starting its own
+				prefix = cached_path ;
+				break ;
+			default:
+				if ( temperature_link ) {
+					prefix = cached_path ;
+				}
+				break ;
+		}
+		if ( ft->ag == NON_AGGREGATE ) {
+			Poll_Match_Name( job, prefix, ft->name, matches ) ;
+		} else if ( ft->ag->combined != ag_sparse ) {
+			ASCII name[OW_FULLNAME_MAX] ;
+			int extension ;
+			for ( extension = ( ft->format == ft_bitfield ) ? EXTENSION_BYTE : EXTENSION_ALL ; extension < ft->ag->elements ; ++extension ) {
+				UCLIBCLOCK;
+				if ( extension == EXTENSION_BYTE ) {
+					snprintf( name, OW_FULLNAME_MAX, "%s.BYTE", ft->name ) ;
+				} else if ( extension == EXTENSION_ALL ) {
+					snprintf( name, OW_FULLNAME_MAX, "%s.ALL", ft->name ) ;
+				} else if ( ft->ag->letters == ag_letters ) {
+					snprintf( name, OW_FULLNAME_MAX, "%s.%c", ft->name, 'A' + extension ) ;
+				} else {
+					snprintf( name, OW_FULLNAME_MAX, "%s.%d", ft->name, extension ) ;
+				}
+				UCLIBCUNLOCK;
+				Poll_Match_Name( job, prefix, name, matches ) ;
+			}
+		}
+		if ( CharblobLength( matches ) > before ) {
+			switch ( ft->change ) {
+				case fc_simultaneous_temperature:
+					temperature[0] = 1 ;
+					break ;
+				case fc_link:
+					temperature[0] |= temperature_link ;
+					break ;
+				case fc_simultaneous_voltage:
+					voltage[0] = 1 ;
+					break ;
+				default:
+					break ;
+			}
+		}
+	}
+}
+
+/* Compare "/device/property" to the glob, add the full path if it matches */
+static void Poll_Match_Name( struct poll_job * job, const char * device_path, const char * name, struct charblob * matches )
+{
+	ASCII path[PATH_MAX] ;
+	// "/uncached/bus.n" or "/bus.n" is not part of the match, and the leading slash is optional
+	const char * device = strrchr( device_path, '/' ) ;
+	const char * pattern = job->pattern ;
+
+	UCLIBCLOCK;
+		snprintf( path, PATH_MAX, "%s/%s", device, name ) ;
+	UCLIBCUNLOCK;
+	if ( fnmatch( pattern, ( pattern[0] == '/' ) ? path : &path[1], FNM_PATHNAME ) != 0 ) {
+		return ;
+	}
+
+	UCLIBCLOCK;
+		snprintf( path, PATH_MAX, "%s/%s", device_path, name ) ;
+	UCLIBCUNLOCK;
+	CharblobAdd( path, strlen( path ), matches ) ;
+}
+
+/* ------- Bus activity ------------ */
+
+/* Is anyone else using the bus? locks is the lock count we saw last time (and is updated) */
+static int Poll_Bus_Busy( int bus_nr, UINT * locks )
+{
+	struct connection_in * in ;
+	int busy = 0 ;
+
+	CONNIN_RLOCK ;
+	in = find_connection_in( bus_nr ) ;
+	if ( in != NO_CONNECTION ) {
+		UINT now_locks = STAT_GET( in->bus_stat[e_bus_locks] ) ;
+		busy = ( now_locks != STAT_GET( in->bus_stat[e_bus_unlocks] ) ) || ( now_locks != locks[0] ) ;
+		locks[0] = now_locks ;
+	}
+	CONNIN_RUNLOCK ;
+	return busy ;
+}
+
+/* Let interactive requests go first
+ * Returns when the bus has been quiet for POLL_IDLE_GAP, or after waiting POLL_IDLE_TRIES gaps.
+ * A bus no one else is using doesn't wait at all */
+static void Poll_Wait_Idle( int bus_nr, UINT * locks )
+{
+	int tries ;
+
+	for ( tries = 0 ; tries < POLL_IDLE_TRIES ; ++tries ) {
+		struct timeval until, gap = { 0, POLL_IDLE_GAP * 1000 } ;
+		if ( ! Poll_Bus_Busy( bus_nr, locks ) ) {
+			return ;
+		}
+		timernow( &until ) ;
+		timeradd( &until, &gap, &until ) ;
+		if ( Poll_Sleep_Until( &until ) ) {
+			return ;
+		}
+	}
+	LEVEL_DEBUG("bus.%d still busy, poll anyway", bus_nr) ;
+}
@@ -0,0 +1,238 @@
+/*
+    OWFS -- One-Wire filesystem
+    OWHTTPD -- One-Wire Web Server
+    Written 2003 Paul H Alfille
+    email: paul.alfille@gmail.com
+    Released under the GPL
+    See the header file: ow.h for full attribution
+    1wire/iButton system from Dallas Semiconductor
+*/
+
+/* Multi-bus fan-out
+ * Directory listings, presence checks and remote alias lookups query every port at once.
+ * Rather than create (and join) a chain of threads on every request,
+ * each port has long-lived worker threads with a job queue.
+ * The requester submits one job per port to a batch and waits for the batch to finish.
+ * A local bus has a single worker, its bus lock would serialize more anyway.
+ * A remote owserver takes no bus lock, so it gets up to server_pool workers
+ * and one slow upstream request doesn't hold up every other request on the port.
+ * */
+
+#include <config.h>
+#include "owfs_config.h"
+#include "ow.h"
+#include "ow_connection.h"
+
+static pthread_key_t port_worker_key ;
+static pthread_once_t port_worker_once = PTHREAD_ONCE_INIT ;
+
+static void PortWorker_Key( void ) ;
+static void * PortWorker_Thread( void * v ) ;
+static void PortJob_Run( struct port_job * job ) ;
+static int PortWorker_Limit( struct port_in * pin ) ;
+
+/* Marks worker threads, so nested fan-out runs in place instead of waiting on itself */
+static void PortWorker_Key( void )
+{
+	pthread_key_create( &port_worker_key, NULL ) ;
+}
+
+/* Called when the port is linked in -- thread is started later, on first use
+ * (not before a possible fork into the background) */
+void PortWorker_Init( struct port_in * pin )
+{
+	struct port_worker * pw = &(pin->worker) ;
+
+	pthread_once( &port_worker_once, PortWorker_Key ) ;
+	memset( pw, 0, sizeof(struct port_worker) ) ;
+	_MUTEX_INIT( pw->mutex ) ;
+	my_pthread_cond_init( &(pw->cond), NULL ) ;
+	pw->ready = 1 ;
+}
+
+/* Threads allowed for this port */
+static int PortWorker_Limit( struct port_in * pin )
+{
+	int limit = Globals.server_pool ;
+
+	if ( pin->first == NO_CONNECTION || ! BusIsServer( pin->first ) ) {
+		return 1 ;
+	}
+	if ( limit < 1 ) {
+		return 1 ;
+	}
+	return limit < PORT_WORKERS_MAX ? limit : PORT_WORKERS_MAX ;
+}
+
+/* Finish queued jobs and end the worker threads */
+void PortWorker_Stop( struct port_in * pin )
+{
+	struct port_worker * pw = &(pin->worker) ;
+	int started ;
+	int index ;
+
+	if ( ! pw->ready ) {
+		return ;
+	}
+
+	_MUTEX_LOCK( pw->mutex ) ;
+	pw->stopping = 1 ;
+	started = pw->started ;
+	my_pthread_cond_broadcast( &(pw->cond) ) ;
+	_MUTEX_UNLOCK( pw->mutex ) ;
+
+	for ( index = 0 ; index < started ; ++index ) {
+		pthread_join( pw->thread[index], NULL ) ;
+	}
+
+	my_pthread_cond_destroy( &(pw->cond) ) ;
+	_MUTEX_DESTROY( pw->mutex ) ;
+	pw->ready = 0 ;
+}
+
+static void * PortWorker_Thread( void * v )
+{
+	struct port_in * pin = v ;
+	struct port_worker * pw = &(pin->worker) ;
+
+	pthread_setspecific( port_worker_key, pin ) ;
+
+	_MUTEX_LOCK( pw->mutex ) ;
+	while ( 1 ) {
+		struct port_job * job = pw->head ;
+		if ( job == NULL ) {
+			if ( pw->stopping ) {
+				break ;
+			}
+			++pw->idle ;
+			my_pthread_cond_wait( &(pw->cond), &(pw->mutex) ) ;
+			--pw->idle ;
+			continue ;
+		}
+		pw->head = job->next ;
+		if ( pw->head == NULL ) {
+			pw->tail = NULL ;
+		}
+		--pw->queued ;
+		_MUTEX_UNLOCK( pw->mutex ) ;
+
+		PortJob_Run( job ) ;
+
+		_MUTEX_LOCK( pw->mutex ) ;
+	}
+	_MUTEX_UNLOCK( pw->mutex ) ;
+	return VOID_RETURN ;
+}
+
+/* Do the job and tell the batch */
+static void PortJob_Run( struct port_job * job )
+{
+	struct port_batch * batch = job->batch ;
+
+	job->routine( job ) ;
+
+	_MUTEX_LOCK( batch->mutex ) ;
+	if ( --batch->pending == 0 ) {
+		my_pthread_cond_signal( &(batch->cond) ) ;
+	}
+	_MUTEX_UNLOCK( batch->mutex ) ;
+}
+
+void PortBatch_Init( struct port_batch * batch )
+{
+	_MUTEX_INIT( batch->mutex ) ;
+	my_pthread_cond_init( &(batch->cond), NULL ) ;
+	batch->pending = 0 ;
+	batch->found = 0 ;
+}
+
+/* Queue routine(job) on the port's worker
+ * job memory belongs to the caller and must last until PortBatch_Wait returns */
+void PortBatch_Submit( struct port_batch * batch, struct port_job * job, struct port_in * pin, void (*routine) (struct port_job * job) )
+{
+	struct port_worker * pw = &(pin->worker) ;
+
+	job->next = NULL ;
+	job->batch = batch ;
+	job->pin = pin ;
+	job->routine = routine ;
+
+	_MUTEX_LOCK( batch->mutex ) ;
+	++batch->pending ;
+	_MUTEX_UNLOCK( batch->mutex ) ;
+
+	if ( ! pw->ready || pthread_getspecific( port_worker_key ) != NULL ) {
+		// port not linked, or already on a worker (don't wait for ourselves)
+		PortJob_Run( job ) ;
+		return ;
+	}
+
+	_MUTEX_LOCK( pw->mutex ) ;
+	// another thread if this job would otherwise wait
+	if ( pw->queued >= pw->idle && pw->started < PortWorker_Limit( pin ) && ! pw->stopping ) {
+		if ( pthread_create( &(pw->thread[pw->started]), DEFAULT_THREAD_ATTR, PortWorker_Thread, pin ) == 0 ) {
+			++pw->started ;
+		} else {
+			LEVEL_DEBUG("Cannot create port worker thread");
+		}
+	}
+	if ( pw->started == 0 || pw->stopping ) {
+		_MUTEX_UNLOCK( pw->mutex ) ;
+		// do it in this thread instead
+		PortJob_Run( job ) ;
+		return ;
+	}
+	if ( pw->tail == NULL ) {
+		pw->head = job ;
+	} else {
+		pw->tail->next = job ;
+	}
+	pw->tail = job ;
+	++pw->queued ;
+	my_pthread_cond_signal( &(pw->cond) ) ;
+	_MUTEX_UNLOCK( pw->mutex ) ;
+}
+
+/* Wait for every job in the batch, then release the batch */
+void PortBatch_Wait( struct port_batch * batch )
+{
+	_MUTEX_LOCK( batch->mutex ) ;
+	while ( batch->pending > 0 ) {
+		my_pthread_cond_wait( &(batch->cond), &(batch->mutex) ) ;
+	}
+	_MUTEX_UNLOCK( batch->mutex ) ;
+
+	my_pthread_cond_destroy( &(batch->cond) ) ;
+	_MUTEX_DESTROY( batch->mutex ) ;
+}
+
+/* A search job found its answer */
+void PortBatch_Found( struct port_batch * batch )
+{
+	_MUTEX_LOCK( batch->mutex ) ;
+	batch->found = 1 ;
+	_MUTEX_UNLOCK( batch->mutex ) ;
+}
+
+/* Has another job already found the answer? */
+int PortBatch_Done( struct port_batch * batch )
+{
+	int found ;
+
+	_MUTEX_LOCK( batch->mutex ) ;
+	found = batch->found ;
+	_MUTEX_UNLOCK( batch->mutex ) ;
+	return found ;
+}
+
+/* Number of linked ports (size for per-port job arrays) */
+int PortCount( void )
+{
+	struct port_in * pin ;
+	int count = 0 ;
+
+	for ( pin = Inbound_Control.head_port ; pin != NULL ; pin = pin->next ) {
+		++count ;
+	}
+	return count ;
+}
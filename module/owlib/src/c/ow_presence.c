@@ -124,82 +124,70 @@ INDEX_OR_ERROR ReCheckPresence(struct parsedname *pn)
 
 /* Check if device exists -- -1 no, >=0 yes (bus number) */
 /* lower level, cycle through the devices */
+/* One job per port, run on the port's worker. First bus found wins. */
 struct checkpresence_struct {
-	struct port_in * pin;
-	struct connection_in * cin;
+	struct port_job job ;	// must be first
 	struct parsedname *pn;
 	INDEX_OR_ERROR bus_nr;
 };
 
-static void * CheckPresence_callback_conn(void * v)
+/* Check each channel of this port in turn */
+static void CheckPresence_callback_port(struct port_job * job)
 {
-	struct checkpresence_struct * cps = (struct checkpresence_struct *) v ;
-	struct checkpresence_struct cps_next ;
-	pthread_t thread;
-	int threadbad = 0 ;
+	struct checkpresence_struct * cps = (struct checkpresence_struct *) job ;
+	struct connection_in * cin ;
 	
-	cps_next.cin = cps->cin->next ;
-	if ( cps_next.cin == NO_CONNECTION ) {
-		threadbad = 1 ;
-	} else {
-		cps_next.pin = cps->pin ;
-		cps_next.pn = cps->pn ;
-		cps_next.bus_nr = INDEX_BAD ;
-		threadbad = pthread_create(&thread, DEFAULT_THREAD_ATTR, CheckPresence_callback_conn, (void *) (&cps_next)) ;
-	}
-	
-	cps->bus_nr = CheckThisConnection( cps->cin->index, cps->pn ) ;
-	
-	if (threadbad == 0) {		/* was a thread created? */
-		if (pthread_join(thread, NULL)==0) {
-			if ( INDEX_VALID(cps_next.bus_nr) ) {
-				cps->bus_nr = cps_next.bus_nr ;
-			}
+	for ( cin = job->pin->first ; cin != NO_CONNECTION ; cin = cin->next ) {
+		INDEX_OR_ERROR bus_nr ;
+
+		if ( PortBatch_Done( job->batch ) ) {
+			// another port already has it
+			return ;
+		}
+		bus_nr = CheckThisConnection( cin->index, cps->pn ) ;
+		if ( INDEX_VALID(bus_nr) ) {
+			cps->bus_nr = bus_nr ;
+			PortBatch_Found( job->batch ) ;
+			return ;
 		}
 	}
-	return VOID_RETURN ;
 }
 
-static void * CheckPresence_callback_port(void * v)
+static INDEX_OR_ERROR CheckPresence_low(struct parsedname *pn)
 {
-	struct checkpresence_struct * cps = (struct checkpresence_struct *) v ;
-	struct checkpresence_struct cps_next ;
-	pthread_t thread;
-	int threadbad = 0 ;
-	
-	cps_next.pin = cps->pin->next ;
-	if ( cps_next.pin == NULL ) {
-		threadbad = 1 ;
-	} else {
-		cps_next.pn = cps->pn ;
-		cps_next.bus_nr = INDEX_BAD ;
-		threadbad = pthread_create(&thread, DEFAULT_THREAD_ATTR, CheckPresence_callback_port, (void *) (&cps_next)) ;
+	int ports = PortCount() ;
+	int port ;
+	struct port_in * pin ;
+	struct port_batch batch ;
+	struct checkpresence_struct * cps ;
+	INDEX_OR_ERROR bus_nr = INDEX_BAD ;
+		
+	if ( ports == 0 ) {
+		return INDEX_BAD ;
 	}
-	
-	cps->cin = cps->pin->first ;
-	if ( cps->cin != NO_CONNECTION ) {
-		CheckPresence_callback_conn(v) ;
+
+	cps = owcalloc( ports, sizeof(struct checkpresence_struct) ) ;
+	if ( cps == NULL ) {
+		return INDEX_BAD ;
 	}
-			
-	if (threadbad == 0) {		/* was a thread created? */
-		if (pthread_join(thread, NULL)==0) {
-			if ( INDEX_VALID(cps_next.bus_nr) ) {
-				cps->bus_nr = cps_next.bus_nr ;
-			}
-		}
+
+	PortBatch_Init( &batch ) ;
+	for ( pin = Inbound_Control.head_port, port = 0 ; pin != NULL && port < ports ; pin = pin->next, ++port ) {
+		cps[port].pn = pn ;
+		cps[port].bus_nr = INDEX_BAD ;
+		PortBatch_Submit( &batch, &(cps[port].job), pin, CheckPresence_callback_port ) ;
 	}
-	return VOID_RETURN ;
-}
+	PortBatch_Wait( &batch ) ;
 
-static INDEX_OR_ERROR CheckPresence_low(struct parsedname *pn)
-{
-	struct checkpresence_struct cps = { Inbound_Control.head_port, NULL, pn, INDEX_BAD };
-		
-	if ( cps.pin != NULL ) {
-		CheckPresence_callback_port( (void *) (&cps) ) ;
+	for ( port = 0 ; port < ports ; ++port ) {
+		if ( INDEX_VALID( cps[port].bus_nr ) ) {
+			bus_nr = cps[port].bus_nr ;
+			break ;
+		}
 	}
+	owfree( cps ) ;
 
-	return cps.bus_nr;
+	return bus_nr;
 }
 
 ZERO_OR_ERROR FS_present(struct one_wire_query *owq)
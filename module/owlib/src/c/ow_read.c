@@ -14,11 +14,34 @@
 #include "ow_counters.h"
 #include "ow_connection.h"
 
+/* A local read in progress -- identical reads arriving meanwhile wait for its result
+ * Each entry lives on the stack of the thread doing the read */
+struct read_flight {
+	struct read_flight *next;
+	struct connection_in *in;
+	BYTE sn[SERIAL_NUMBER_SIZE];
+	struct filetype *ft;
+	int extension;
+	int uncached;
+	int done;
+	int waiters;
+	pthread_cond_t cond;
+	ZERO_OR_ERROR read_error;
+	union value_object val;
+};
+
+/* List of reads in progress, protected by READFLIGHTLOCK */
+static struct read_flight *read_flight_head = NULL;
+
 /* ------- Prototypes ----------- */
 static SIZE_OR_ERROR FS_r_virtual(struct one_wire_query *owq);
 static SIZE_OR_ERROR FS_read_real(struct one_wire_query *owq);
 static SIZE_OR_ERROR FS_r_given_bus(struct one_wire_query *owq);
 static SIZE_OR_ERROR FS_r_local(struct one_wire_query *owq);
+static ZERO_OR_ERROR FS_r_device(struct one_wire_query *owq);
+static int FS_r_can_share(struct one_wire_query *owq);
+static GOOD_OR_BAD FS_r_stale(struct one_wire_query *owq);
+static ZERO_OR_ERROR FS_r_shared(struct one_wire_query *owq);
 static ZERO_OR_ERROR FS_read_owq(struct one_wire_query *owq);
 static ZERO_OR_ERROR FS_structure(struct one_wire_query *owq);
 static ZERO_OR_ERROR FS_read_all_bits(struct one_wire_query *owq_byte);
@@ -29,6 +52,10 @@ static SIZE_OR_ERROR FS_read_distribute(struct one_wire_query *owq) ;
 static ZERO_OR_ERROR FS_read_all( struct one_wire_query *owq_all ); 
 static ZERO_OR_ERROR FS_read_a_part( struct one_wire_query *owq_part );
 static ZERO_OR_ERROR FS_read_in_parts( struct one_wire_query *owq_all );
+static int FS_read_many_remote(const struct parsedname *pn);
+static int FS_read_many_order(const void * a, const void * b);
+static int FS_read_many_batch(struct one_wire_query *owq_first, struct one_wire_query *owq);
+static void *FS_read_many_local_thread(void *v);
 
 /*
 Change in strategy 6/2006:
@@ -67,13 +94,14 @@ SIZE_OR_ERROR FS_read_postparse(struct one_wire_query *owq)
 {
 	struct parsedname *pn = PN(owq);
 	SIZE_OR_ERROR read_or_error;
+	struct timeval start;
+	UINT usec;
 
 	/* Normal read. Try three times */
 	LEVEL_DEBUG("%s", pn->path);
-	STATLOCK;
+	timernow( &start );
 	AVERAGE_IN(&read_avg);
 	AVERAGE_IN(&all_avg);
-	STATUNLOCK;
 
 	/* First try */
 	STAT_ADD1(read_tries[0]);
@@ -92,18 +120,382 @@ SIZE_OR_ERROR FS_read_postparse(struct one_wire_query *owq)
 		read_or_error = (pn->type == ePN_real) ? FS_read_real(owq) : FS_r_virtual(owq);
 	}
 
-	STATLOCK;
 	if (read_or_error >= 0) {
-		++read_success;			/* statistics */
-		read_bytes += read_or_error;	/* statistics */
+		STAT_ADD1(read_success);			/* statistics */
+		STAT_ADD(read_bytes, read_or_error);	/* statistics */
 	}
 	AVERAGE_OUT(&read_avg);
 	AVERAGE_OUT(&all_avg);
-	STATUNLOCK;
+	usec = Latency_since( &start );
+	Latency_bus( e_latency_read, usec, pn->selected_connection );
+	Latency_device( e_latency_read, usec, pn );
 	LEVEL_DEBUG("%s return %d", pn->path, read_or_error);
 	return read_or_error;
 }
 
+/* One entry of FS_read_many, sorted by bus and device */
+struct read_many_entry {
+	struct one_wire_query *owq;
+	int index;					// position in the caller's list
+};
+
+/* Local reads of FS_read_many, shared by the caller and the pool threads helping it */
+struct read_many_local {
+	struct read_many_entry *entry;
+	SIZE_OR_ERROR *result;
+	int count;
+	int next;					// next entry to take
+	pthread_mutex_t mutex;
+	// the rest is protected by read_pool.mutex
+	struct read_many_local *queue_next;
+	int queued;					// still on the pool queue
+	int wanted;					// helpers it can still take
+	int helpers;				// pool threads working on it
+	pthread_cond_t cond;		// last helper done
+};
+
+/* Local reads of one FS_read_many kept in flight at once
+ * A powered DS18x20 lets the bus go while it converts,
+ * so with several reads going the conversions overlap instead of following each other */
+#define READ_MANY_IN_FLIGHT 8
+
+/* Long-lived helper threads for the local reads of FS_read_many
+ * started on first use and shared by every caller */
+static struct {
+	pthread_mutex_t mutex;
+	pthread_cond_t cond;
+	pthread_t thread[READ_MANY_IN_FLIGHT - 1];
+	struct read_many_local *head;
+	struct read_many_local *tail;
+	int started;
+	int idle;
+	int stopping;
+} read_pool;
+static pthread_once_t read_pool_once = PTHREAD_ONCE_INIT;
+
+static void FS_read_many_local(struct read_many_entry *entry, SIZE_OR_ERROR * result, int count);
+static void FS_read_pool_init(void);
+static void FS_read_pool_submit(struct read_many_local *rml);
+static void FS_read_pool_withdraw(struct read_many_local *rml);
+static void *FS_read_pool_thread(void *v);
+
+/* Several reads at once (owserver READMANY message)
+ * result[i] gets what FS_read_postparse(owq[i]) would return.
+ * Reads are done in bus and device order, local reads a few at a time,
+ * and consecutive reads on the same remote owserver are sent to it in a single message */
+void FS_read_many(struct one_wire_query **owq, SIZE_OR_ERROR * result, int count)
+{
+	struct read_many_entry *entry;
+	struct one_wire_query **batch_owq;
+	SIZE_OR_ERROR *batch_result;
+	int i;
+
+	if (count <= 0) {
+		return;
+	}
+
+	entry = owmalloc(count * sizeof(struct read_many_entry));
+	batch_owq = owmalloc(count * sizeof(struct one_wire_query *));
+	batch_result = owmalloc(count * sizeof(SIZE_OR_ERROR));
+	if (entry == NULL || batch_owq == NULL || batch_result == NULL) {
+		// no room to sort, just read in turn
+		SAFEFREE(entry);
+		SAFEFREE(batch_owq);
+		SAFEFREE(batch_result);
+		for (i = 0; i < count; ++i) {
+			result[i] = FS_read_postparse(owq[i]);
+		}
+		return;
+	}
+
+	for (i = 0; i < count; ++i) {
+		entry[i].owq = owq[i];
+		entry[i].index = i;
+	}
+	qsort(entry, count, sizeof(struct read_many_entry), FS_read_many_order);
+
+	FS_read_many_local(entry, result, count);
+
+	for (i = 0; i < count;) {
+		struct parsedname *pn_first = PN(entry[i].owq);
+		int batch_count = 0;
+		int j;
+
+		if (!FS_read_many_remote(pn_first)) {
+			// already read
+			++i;
+			continue;
+		}
+
+		// gather the run of reads for the same owserver
+		while (i + batch_count < count && FS_read_many_batch(entry[i].owq, entry[i + batch_count].owq)) {
+			batch_owq[batch_count] = entry[i + batch_count].owq;
+			++batch_count;
+		}
+
+		LEVEL_DEBUG("%d reads for bus.%d together", batch_count, pn_first->selected_connection->index);
+		ServerReadMany(batch_owq, batch_result, batch_count);
+		for (j = 0; j < batch_count; ++j) {
+			struct one_wire_query *owq_one = batch_owq[j];
+			SIZE_OR_ERROR read_or_error = batch_result[j];
+
+			if (read_or_error < 0) {
+				// full treatment for the failures (presence recheck and retries)
+				read_or_error = FS_read_postparse(owq_one);
+			} else {
+				STAT_ADD1(read_tries[0]);
+				STAT_ADD1(read_success);			/* statistics */
+				STAT_ADD(read_bytes, read_or_error);	/* statistics */
+			}
+			result[entry[i + j].index] = read_or_error;
+		}
+		i += batch_count;
+	}
+
+	owfree(entry);
+	owfree(batch_owq);
+	owfree(batch_result);
+}
+
+/* Do the local (non-owserver) reads, up to READ_MANY_IN_FLIGHT at a time
+ * The caller reads too, pool threads join in as they come free */
+static void FS_read_many_local(struct read_many_entry *entry, SIZE_OR_ERROR * result, int count)
+{
+	struct read_many_local rml;
+	int local = 0;
+	int pooled;
+	int i;
+
+	for (i = 0; i < count; ++i) {
+		if (!FS_read_many_remote(PN(entry[i].owq))) {
+			++local;
+		}
+	}
+	if (local == 0) {
+		return;
+	}
+
+	rml.entry = entry;
+	rml.result = result;
+	rml.count = count;
+	rml.next = 0;
+	_MUTEX_INIT(rml.mutex);
+	rml.queue_next = NULL;
+	rml.queued = 0;
+	rml.wanted = (local - 1 < READ_MANY_IN_FLIGHT - 1) ? local - 1 : READ_MANY_IN_FLIGHT - 1;
+	rml.helpers = 0;
+	my_pthread_cond_init(&(rml.cond), NULL);
+
+	pooled = (rml.wanted > 0);
+	if (pooled) {
+		FS_read_pool_submit(&rml);
+	}
+	// this thread takes part too
+	FS_read_many_local_thread(&rml);
+	if (pooled) {
+		// every entry is taken, wait for the helpers still reading
+		FS_read_pool_withdraw(&rml);
+	}
+
+	my_pthread_cond_destroy(&(rml.cond));
+	_MUTEX_DESTROY(rml.mutex);
+}
+
+static void FS_read_pool_init(void)
+{
+	_MUTEX_INIT(read_pool.mutex);
+	my_pthread_cond_init(&(read_pool.cond), NULL);
+}
+
+/* Offer rml to the pool, starting threads (up to the limit) if none are free */
+static void FS_read_pool_submit(struct read_many_local *rml)
+{
+	pthread_once(&read_pool_once, FS_read_pool_init);
+
+	_MUTEX_LOCK(read_pool.mutex);
+	if (read_pool.stopping) {
+		_MUTEX_UNLOCK(read_pool.mutex);
+		return;
+	}
+	while (read_pool.idle < rml->wanted && read_pool.started < READ_MANY_IN_FLIGHT - 1) {
+		if (pthread_create(&(read_pool.thread[read_pool.started]), DEFAULT_THREAD_ATTR, FS_read_pool_thread, NULL) != 0) {
+			LEVEL_DEBUG("Cannot create read pool thread");
+			break;
+		}
+		++read_pool.started;
+		++read_pool.idle;			// counts as free until it takes a job
+	}
+	rml->queued = 1;
+	if (read_pool.tail == NULL) {
+		read_pool.head = rml;
+	} else {
+		read_pool.tail->queue_next = rml;
+	}
+	read_pool.tail = rml;
+	my_pthread_cond_broadcast(&(read_pool.cond));
+	_MUTEX_UNLOCK(read_pool.mutex);
+}
+
+/* Take rml off the queue (no more helpers) and wait for the ones working on it */
+static void FS_read_pool_withdraw(struct read_many_local *rml)
+{
+	_MUTEX_LOCK(read_pool.mutex);
+	if (rml->queued) {
+		struct read_many_local **link;
+		struct read_many_local *previous = NULL;
+
+		for (link = &read_pool.head; *link != rml; link = &((*link)->queue_next)) {
+			previous = *link;
+		}
+		*link = rml->queue_next;
+		if (read_pool.tail == rml) {
+			read_pool.tail = previous;
+		}
+		rml->queued = 0;
+	}
+	while (rml->helpers > 0) {
+		my_pthread_cond_wait(&(rml->cond), &(read_pool.mutex));
+	}
+	_MUTEX_UNLOCK(read_pool.mutex);
+}
+
+static void *FS_read_pool_thread(void *v)
+{
+	(void) v;
+
+	_MUTEX_LOCK(read_pool.mutex);
+	while (1) {
+		struct read_many_local *rml = read_pool.head;
+
+		if (rml == NULL) {
+			if (read_pool.stopping) {
+				break;
+			}
+			my_pthread_cond_wait(&(read_pool.cond), &(read_pool.mutex));
+			continue;
+		}
+		if (--rml->wanted == 0) {
+			// enough helpers, off the queue
+			read_pool.head = rml->queue_next;
+			if (read_pool.head == NULL) {
+				read_pool.tail = NULL;
+			}
+			rml->queued = 0;
+		}
+		++rml->helpers;
+		--read_pool.idle;
+		_MUTEX_UNLOCK(read_pool.mutex);
+
+		FS_read_many_local_thread(rml);
+
+		_MUTEX_LOCK(read_pool.mutex);
+		++read_pool.idle;
+		if (--rml->helpers == 0) {
+			my_pthread_cond_signal(&(rml->cond));
+		}
+	}
+	_MUTEX_UNLOCK(read_pool.mutex);
+	return VOID_RETURN;
+}
+
+/* End the read pool threads (library shutdown) */
+void FS_read_many_stop(void)
+{
+	int started;
+	int i;
+
+	pthread_once(&read_pool_once, FS_read_pool_init);
+
+	_MUTEX_LOCK(read_pool.mutex);
+	read_pool.stopping = 1;
+	started = read_pool.started;
+	my_pthread_cond_broadcast(&(read_pool.cond));
+	_MUTEX_UNLOCK(read_pool.mutex);
+
+	for (i = 0; i < started; ++i) {
+		pthread_join(read_pool.thread[i], NULL);
+	}
+
+	_MUTEX_LOCK(read_pool.mutex);
+	read_pool.started = 0;
+	read_pool.idle = 0;
+	read_pool.stopping = 0;
+	_MUTEX_UNLOCK(read_pool.mutex);
+}
+
+static void *FS_read_many_local_thread(void *v)
+{
+	struct read_many_local *rml = v;
+
+	while (1) {
+		int i;
+
+		_MUTEX_LOCK(rml->mutex);
+		while (rml->next < rml->count && FS_read_many_remote(PN(rml->entry[rml->next].owq))) {
+			++rml->next;
+		}
+		i = rml->next++;
+		_MUTEX_UNLOCK(rml->mutex);
+
+		if (i >= rml->count) {
+			break;
+		}
+		rml->result[rml->entry[i].index] = FS_read_postparse(rml->entry[i].owq);
+	}
+	return VOID_RETURN;
+}
+
+/* Would FS_read_postparse hand this read straight to ServerRead? */
+static int FS_read_many_remote(const struct parsedname *pn)
+{
+	if (!KnownBus(pn) || !BusIsServer(pn->selected_connection)) {
+		return 0;
+	}
+	if (pn->selected_device == NO_DEVICE || pn->selected_filetype == NO_FILETYPE) {
+		return 1;
+	}
+	if (pn->selected_device == DeviceSimultaneous || pn->selected_filetype->format == ft_alias) {
+		// special local handling
+		return 0;
+	}
+	return (pn->type == ePN_real) || SpecifiedRemoteBus(pn);
+}
+
+/* Can owq go in the same READMANY message as owq_first? */
+static int FS_read_many_batch(struct one_wire_query *owq_first, struct one_wire_query *owq)
+{
+	struct parsedname *pn_first = PN(owq_first);
+	struct parsedname *pn = PN(owq);
+
+	// one offset goes in the message for the whole batch
+	return FS_read_many_remote(pn)
+		&& pn->selected_connection == pn_first->selected_connection
+		&& pn->control_flags == pn_first->control_flags
+		&& SpecifiedBus(pn) == SpecifiedBus(pn_first)
+		&& OWQ_offset(owq) == OWQ_offset(owq_first);
+}
+
+/* qsort order: bus, then device, then original position */
+static int FS_read_many_order(const void * a, const void * b)
+{
+	const struct read_many_entry *entry_a = a;
+	const struct read_many_entry *entry_b = b;
+	const struct parsedname *pn_a = PN(entry_a->owq);
+	const struct parsedname *pn_b = PN(entry_b->owq);
+	int bus_a = KnownBus(pn_a) ? pn_a->selected_connection->index : -1;
+	int bus_b = KnownBus(pn_b) ? pn_b->selected_connection->index : -1;
+	int sn_order;
+
+	if (bus_a != bus_b) {
+		return bus_a < bus_b ? -1 : 1;
+	}
+	sn_order = memcmp(pn_a->sn, pn_b->sn, SERIAL_NUMBER_SIZE);
+	if (sn_order != 0) {
+		return sn_order;
+	}
+	return entry_a->index - entry_b->index;
+}
+
 /* Read real device (Non-virtual). Will repeat 3 times if needed */
 static SIZE_OR_ERROR FS_read_real(struct one_wire_query *owq)
 {
@@ -202,10 +594,8 @@ static SIZE_OR_ERROR FS_read_distribute(struct one_wire_query *owq)
 	SIZE_OR_ERROR read_or_error = 0;
 
 	LEVEL_DEBUG("%s", PN(owq)->path);
-	STATLOCK;
 	AVERAGE_IN(&read_avg);
 	AVERAGE_IN(&all_avg);
-	STATUNLOCK;
 
 	/* handle DeviceSimultaneous */
 	if (PN(owq)->selected_device == DeviceSimultaneous) {
@@ -214,14 +604,12 @@ static SIZE_OR_ERROR FS_read_distribute(struct one_wire_query *owq)
 		read_or_error = FS_r_given_bus(owq);
 	}
 
-	STATLOCK;
 	if (read_or_error >= 0) {
-		++read_success;			/* statistics */
-		read_bytes += read_or_error;		/* statistics */
+		STAT_ADD1(read_success);			/* statistics */
+		STAT_ADD(read_bytes, read_or_error);		/* statistics */
 	}
 	AVERAGE_OUT(&read_avg);
 	AVERAGE_OUT(&all_avg);
-	STATUNLOCK;
 
 	LEVEL_DEBUG("%s returns %d", PN(owq)->path, read_or_error);
 	//printf("FS_read_distribute: pid=%ld return %d\n", pthread_self(), read_or_error);
@@ -247,17 +635,17 @@ static SIZE_OR_ERROR FS_r_given_bus(struct one_wire_query *owq)
 		//printf("FS_r_given_bus pid=%ld r=%d\n",pthread_self(), read_or_error);
 	} else {
 		STAT_ADD1(read_calls);	/* statistics */
-		if (DeviceLockGet(pn) == 0) {
-			read_or_error = FS_r_local(owq);	// this returns status
-			DeviceLockRelease(pn);
-			LEVEL_DEBUG("return=%d", read_or_error);
-			if (read_or_error >= 0) {
-				// local success -- now format in buffer
-				read_or_error = OWQ_parse_output(owq);	// this returns nr. bytes
-			}
+		if ( GOOD( FS_r_stale(owq) ) ) {
+			// cached (maybe expired) value taken without waiting for the device
+			read_or_error = 0 ;
 		} else {
-			LEVEL_DEBUG("Cannot lock bus to perform read") ;
-			read_or_error = -EADDRINUSE;
+			// identical reads already under way are joined rather than repeated
+			read_or_error = FS_r_can_share(owq) ? FS_r_shared(owq) : FS_r_device(owq);	// this returns status
+		}
+		LEVEL_DEBUG("return=%d", read_or_error);
+		if (read_or_error >= 0) {
+			// local success -- now format in buffer
+			read_or_error = OWQ_parse_output(owq);	// this returns nr. bytes
 		}
 	}
 	LEVEL_DEBUG("After read is performed (bytes or error %d)", read_or_error);
@@ -265,6 +653,144 @@ static SIZE_OR_ERROR FS_r_given_bus(struct one_wire_query *owq)
 	return read_or_error;
 }
 
+/* Lock the device and read (returns status) */
+static ZERO_OR_ERROR FS_r_device(struct one_wire_query *owq)
+{
+	struct parsedname *pn = PN(owq);
+	ZERO_OR_ERROR read_error;
+
+	if (DeviceLockGet(pn) != 0) {
+		LEVEL_DEBUG("Cannot lock bus to perform read") ;
+		return -EADDRINUSE;
+	}
+	read_error = FS_r_local(owq);
+	DeviceLockRelease(pn);
+	return read_error;
+}
+
+/* Only single values (kept in OWQ_val before formatting) are shared
+ * Text, binary and whole-array reads fill the caller's own buffer */
+static int FS_r_can_share(struct one_wire_query *owq)
+{
+	struct parsedname *pn = PN(owq);
+	struct filetype *ft = pn->selected_filetype;
+
+	if (OWQ_offset(owq) != 0 || pn->extension == EXTENSION_ALL) {
+		return 0;
+	}
+	if (ft->ag != NON_AGGREGATE && ft->ag->combined == ag_sparse) {
+		return 0;
+	}
+	switch (ft->format) {
+	case ft_integer:
+	case ft_unsigned:
+	case ft_float:
+	case ft_temperature:
+	case ft_tempgap:
+	case ft_pressure:
+	case ft_yesno:
+	case ft_date:
+	case ft_bitfield:
+		return 1;
+	default:
+		return 0;
+	}
+}
+
+/* A request that accepts a stale value looks in the cache before locking the device
+ * so it isn't held up behind the background refresh (see ow_stale.c)
+ * Only plain single values -- linked properties find theirs under the lock */
+static GOOD_OR_BAD FS_r_stale(struct one_wire_query *owq)
+{
+	struct parsedname *pn = PN(owq);
+	struct filetype *ft = pn->selected_filetype;
+
+	if ( (pn->control_flags & STALE_OK) == 0 || IsUncachedDir(pn) ) {
+		return gbBAD;
+	}
+	if ( ft->ag != NON_AGGREGATE || ft->change == fc_link || ! FS_r_can_share(owq) ) {
+		return gbBAD;
+	}
+	switch (pn->selected_connection->Adapter) {
+		case adapter_fake:
+		case adapter_tester:
+		case adapter_mock:
+			return gbBAD;
+		default:
+			break;
+	}
+	return OWQ_Cache_Get(owq);
+}
+
+/* Join an identical read in progress, or do the read and share the result
+ * Returns status, like FS_r_local */
+static ZERO_OR_ERROR FS_r_shared(struct one_wire_query *owq)
+{
+	struct parsedname *pn = PN(owq);
+	int uncached = (pn->state & ePS_uncached) != 0;
+	struct read_flight flight;
+	struct read_flight **link;
+	struct read_flight *match;
+
+	READFLIGHTLOCK;
+	for (match = read_flight_head; match != NULL; match = match->next) {
+		if (match->in == pn->selected_connection && match->ft == pn->selected_filetype && match->extension == pn->extension
+			&& memcmp(match->sn, pn->sn, SERIAL_NUMBER_SIZE) == 0
+			&& (match->uncached || !uncached)) {	// an uncached read mustn't take a possibly cached value
+			break;
+		}
+	}
+
+	if (match != NULL) {
+		ZERO_OR_ERROR read_error;
+
+		++match->waiters;
+		while (!match->done) {
+			my_pthread_cond_wait(&(match->cond), &(Mutex.readflight_mutex));
+		}
+		read_error = match->read_error;
+		OWQ_val(owq) = match->val;
+		if (--match->waiters == 0) {
+			// the reader is waiting for us to finish with its result
+			my_pthread_cond_broadcast(&(match->cond));
+		}
+		READFLIGHTUNLOCK;
+		STAT_ADD1(read_coalesced);
+		LEVEL_DEBUG("Shared read result for %s", pn->path);
+		return read_error;
+	}
+
+	// first one -- list this read so others can wait for it
+	memset(&flight, 0, sizeof(struct read_flight));
+	flight.in = pn->selected_connection;
+	flight.ft = pn->selected_filetype;
+	flight.extension = pn->extension;
+	memcpy(flight.sn, pn->sn, SERIAL_NUMBER_SIZE);
+	flight.uncached = uncached;
+	my_pthread_cond_init(&(flight.cond), NULL);
+	flight.next = read_flight_head;
+	read_flight_head = &flight;
+	READFLIGHTUNLOCK;
+
+	flight.read_error = FS_r_device(owq);
+
+	READFLIGHTLOCK;
+	for (link = &read_flight_head; *link != &flight; link = &((*link)->next)) {
+	}
+	*link = flight.next;
+	flight.val = OWQ_val(owq);
+	flight.done = 1;
+	my_pthread_cond_broadcast(&(flight.cond));
+	// flight is on our stack, so wait until every waiter has its copy
+	while (flight.waiters > 0) {
+		my_pthread_cond_wait(&(flight.cond), &(Mutex.readflight_mutex));
+	}
+	READFLIGHTUNLOCK;
+	my_pthread_cond_destroy(&(flight.cond));
+
+	return flight.read_error;
+}
+
 // This function should return number of bytes read... not status.
 // Works for all the virtual directories, like statistics, interface, ...
 // Doesn't need three-peat and bus was already set or not needed.
@@ -615,7 +1141,19 @@ static ZERO_OR_ERROR FS_read_all( struct one_wire_query *owq_all)
 static ZERO_OR_ERROR FS_read_owq(struct one_wire_query *owq)
 {
 	// Bus and device already locked
-	if ( BAD( OWQ_Cache_Get(owq)) ) {	// not found
+	struct parsedname *pn = PN(owq);
+	struct timeval start;
+	GOOD_OR_BAD cached;
+	UINT usec;
+
+	timernow( &start );
+	cached = OWQ_Cache_Get(owq);
+	if ( ! IsUncachedDir(pn) ) {
+		usec = Latency_since( &start );
+		Latency_bus( e_latency_cache, usec, pn->selected_connection );
+		Latency_device( e_latency_cache, usec, pn );
+	}
+	if ( BAD( cached ) ) {	// not found
 		ZERO_OR_ERROR read_error = (OWQ_pn(owq).selected_filetype->read) (owq);
 		LEVEL_DEBUG("Read %s Extension %d Gives result %d",PN(owq)->path,PN(owq)->extension,read_error);
 		if (read_error < 0) {
@@ -29,6 +29,8 @@ static ZERO_OR_ERROR OW_read_external_script( struct sensor_node * sensor_n, str
 
 static ZERO_OR_ERROR OW_script_read( FILE * script_f, struct one_wire_query * owq ) ;
 
+static ZERO_OR_ERROR OW_read_external_coprocess( struct sensor_node * sensor_n, struct property_node * property_n, struct one_wire_query * owq ) ;
+
 // ------------------------
 
 
@@ -70,6 +72,8 @@ static ZERO_OR_ERROR OW_trees_for_read( char * device, char * property, struct o
 					return OWQ_format_output_offset_and_size_z( property_n->data, owq ) ;
 				case et_script:
 					return OW_read_external_script( sense_n, property_n, owq ) ;
+				case et_coprocess:
+					return OW_read_external_coprocess( sense_n, property_n, owq ) ;
 				default:
 					return -ENOTSUP ;
 			}
@@ -148,3 +152,42 @@ static ZERO_OR_ERROR OW_script_read( FILE * script_f, struct one_wire_query * ow
 	
 	return OWQ_parse_input( owq ) ;
 }
+
+/* Same arguments as the script, as a request to the long-lived helper */
+static ZERO_OR_ERROR OW_read_external_coprocess( struct sensor_node * sensor_n, struct property_node * property_n, struct one_wire_query * owq )
+{
+	char fields[PATH_MAX+1] ;
+	struct parsedname * pn = PN(owq) ;
+	size_t length = OWQ_size(owq) ;
+	int snp_return ;
+	ZERO_OR_ERROR zoe ;
+
+	if ( pn->sparse_name == NULL ) {
+		snp_return =
+		snprintf( fields, PATH_MAX+1, "%s %s %d %s %d %d %s %s",
+			sensor_n->name, property_n->property, pn->extension, "read",
+			(int) OWQ_size(owq), (int) OWQ_offset(owq), sensor_n->data, property_n->data ) ;
+	} else {
+		snp_return =
+		snprintf( fields, PATH_MAX+1, "%s %s %s %s %d %d %s %s",
+			sensor_n->name, property_n->property, pn->sparse_name, "read",
+			(int) OWQ_size(owq), (int) OWQ_offset(owq), sensor_n->data, property_n->data ) ;
+	}
+
+	if ( snp_return < 0 ) {
+		LEVEL_DEBUG("Problem creating request for %s/%s",sensor_n->name,property_n->property) ;
+		return -EINVAL ;
+	}
+
+	memset( OWQ_buffer(owq), 0, OWQ_size(owq) ) ;
+	zoe = Coprocess_request( property_n->read, fields, NULL, 0, (BYTE *) OWQ_buffer(owq), &length ) ;
+	switch ( zoe ) {
+		case 0:
+			return OWQ_parse_input( owq ) ;
+		case -ECHILD:
+			// helper not running, one-shot instead
+			return OW_read_external_script( sensor_n, property_n, owq ) ;
+		default:
+			return zoe ;
+	}
+}
@@ -80,104 +80,77 @@ static INDEX_OR_ERROR ServerAlias( BYTE * sn, struct connection_in * in, struct
 	return INDEX_BAD ;
 }	
 
+/* One job per port, run on the port's worker. First server with the alias wins. */
 struct remotealias_struct {
-	struct port_in * pin;
-	struct connection_in *cin;
+	struct port_job job ;	// must be first
 	struct parsedname *pn;
 	BYTE sn[SERIAL_NUMBER_SIZE] ;
 	INDEX_OR_ERROR bus_nr;
 };
 
-static void * RemoteAlias_callback_conn(void * v)
+/* Ask each server connection of this port in turn */
+static void RemoteAlias_callback_port(struct port_job * job)
 {
-	struct remotealias_struct * ras = (struct remotealias_struct *) v ;
-	struct remotealias_struct ras_next ;
-	pthread_t thread;
-	int threadbad = 0;
+	struct remotealias_struct * ras = (struct remotealias_struct *) job ;
+	struct connection_in * cin ;
 	
-	// set up for next server connection
-	ras_next.cin = NextServer(ras->cin->next) ;
-	if ( ras_next.cin == NO_CONNECTION ) {
-		threadbad = 1 ;
-	} else {
-		ras_next.pin = ras->pin ;
-		ras_next.pn = ras->pn ;
-		ras_next.bus_nr = INDEX_BAD ;
-		memset( ras_next.sn, 0, SERIAL_NUMBER_SIZE) ;
-		threadbad = pthread_create(&thread, DEFAULT_THREAD_ATTR, RemoteAlias_callback_conn, (void *) (&ras_next)) ;
-	}
-	
-	// Result for this server connection (while next one is processing)
-	ras->bus_nr = ServerAlias( ras->sn, ras->cin, ras->pn ) ;
-	
-	if (threadbad == 0) {		/* was a thread created? */
-		if (pthread_join(thread, NULL)==0) {
-			// Set answer to the next bus if it's found
-			// else use current answer
-			if ( INDEX_VALID(ras_next.bus_nr) ) {
-				ras->bus_nr = ras_next.bus_nr ;
-				memcpy( ras->sn, ras_next.sn, SERIAL_NUMBER_SIZE ) ;
-			}
-		}
-	}
-	return VOID_RETURN ;
-}
+	for ( cin = NextServer( job->pin->first ) ; cin != NO_CONNECTION ; cin = NextServer( cin->next ) ) {
+		BYTE sn[SERIAL_NUMBER_SIZE] ;
+		INDEX_OR_ERROR bus_nr ;
 
-static void * RemoteAlias_callback_port(void * v)
-{
-	struct remotealias_struct * ras = (struct remotealias_struct *) v ;
-	struct remotealias_struct ras_next ;
-	pthread_t thread;
-	int threadbad = 0;
-	
-	// set up for next server connection
-	ras_next.pin = ras->pin->next ;
-	if ( ras_next.pin == NULL ) {
-		threadbad = 1 ;
-	} else {
-		ras_next.pn = ras->pn ;
-		ras_next.bus_nr = INDEX_BAD ;
-		memset( ras_next.sn, 0, SERIAL_NUMBER_SIZE) ;
-		threadbad = pthread_create(&thread, DEFAULT_THREAD_ATTR, RemoteAlias_callback_port, (void *) (&ras_next)) ;
-	}
-	
-	ras->cin = NextServer( ras->pin->first ) ;
-	if ( ras->cin != NO_CONNECTION ) {
-		RemoteAlias_callback_conn(v) ;
-	}
-	
-	if (threadbad == 0) {		/* was a thread created? */
-		if (pthread_join(thread, NULL)==0) {
-			// Set answer to the next bus if it's found
-			// else use current answer
-			if ( INDEX_VALID(ras_next.bus_nr) ) {
-				ras->bus_nr = ras_next.bus_nr ;
-				memcpy( ras->sn, ras_next.sn, SERIAL_NUMBER_SIZE ) ;
-			}
+		if ( PortBatch_Done( job->batch ) ) {
+			// another port already has it
+			return ;
+		}
+		memset( sn, 0, SERIAL_NUMBER_SIZE) ;
+		bus_nr = ServerAlias( sn, cin, ras->pn ) ;
+		if ( INDEX_VALID(bus_nr) ) {
+			ras->bus_nr = bus_nr ;
+			memcpy( ras->sn, sn, SERIAL_NUMBER_SIZE ) ;
+			PortBatch_Found( job->batch ) ;
+			return ;
 		}
 	}
-	return VOID_RETURN ;
 }
 
 INDEX_OR_ERROR RemoteAlias(struct parsedname *pn)
 {
-	struct remotealias_struct ras ; 
+	int ports = PortCount() ;
+	int port ;
+	struct port_in * pin ;
+	struct port_batch batch ;
+	struct remotealias_struct * ras ;
+	BYTE sn[SERIAL_NUMBER_SIZE] ;
+	INDEX_OR_ERROR bus_nr = INDEX_BAD ;
 	
-	ras.pin = Inbound_Control.head_port ;
-	ras.pn = pn ;
-	ras.bus_nr = INDEX_BAD ;
-	memset( ras.sn, 0, SERIAL_NUMBER_SIZE) ;
+	memset( sn, 0, SERIAL_NUMBER_SIZE) ;
+
+	ras = ( ports > 0 ) ? owcalloc( ports, sizeof(struct remotealias_struct) ) : NULL ;
+	if ( ras != NULL ) {
+		PortBatch_Init( &batch ) ;
+		for ( pin = Inbound_Control.head_port, port = 0 ; pin != NULL && port < ports ; pin = pin->next, ++port ) {
+			ras[port].pn = pn ;
+			ras[port].bus_nr = INDEX_BAD ;
+			PortBatch_Submit( &batch, &(ras[port].job), pin, RemoteAlias_callback_port ) ;
+		}
+		PortBatch_Wait( &batch ) ;
 
-	if ( ras.pin != NULL ) {
-		RemoteAlias_callback_port( (void *) (&ras) ) ;
+		for ( port = 0 ; port < ports ; ++port ) {
+			if ( INDEX_VALID( ras[port].bus_nr ) ) {
+				bus_nr = ras[port].bus_nr ;
+				memcpy( sn, ras[port].sn, SERIAL_NUMBER_SIZE ) ;
+				break ;
+			}
+		}
+		owfree( ras ) ;
 	}
 	
-	memcpy( pn->sn, ras.sn, SERIAL_NUMBER_SIZE ) ;
+	memcpy( pn->sn, sn, SERIAL_NUMBER_SIZE ) ;
 
-	if ( INDEX_VALID( ras.bus_nr ) ) {
-		LEVEL_DEBUG("Remote alias for %s bus=%d "SNformat,pn->path_to_server,ras.bus_nr,SNvar(ras.sn));
+	if ( INDEX_VALID( bus_nr ) ) {
+		LEVEL_DEBUG("Remote alias for %s bus=%d "SNformat,pn->path_to_server,bus_nr,SNvar(sn));
 	} else {
 		LEVEL_DEBUG("Remote alias for %s not found",pn->path_to_server);
 	}
-	return ras.bus_nr;		
+	return bus_nr;		
 }
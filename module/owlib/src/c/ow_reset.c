@@ -55,3 +55,26 @@ RESET_TYPE BUS_reset(const struct parsedname *pn)
 		return BUS_RESET_ERROR ;
 	}
 }
+
+/* Account for a reset the adapter did as part of a larger exchange (select_and_sendback) */
+GOOD_OR_BAD BUS_reset_bundled(RESET_TYPE reset, struct connection_in *in)
+{
+	STAT_ADD1_BUS(e_bus_resets, in);
+
+	switch ( reset ) {
+	case BUS_RESET_OK:
+		in->reconnect_state = reconnect_ok;	// Flag as good!
+		return gbGOOD ;
+	case BUS_RESET_SHORT:
+		in->AnyDevices = anydevices_unknown;
+		LEVEL_CONNECT("1-wire bus short circuit.");
+		STAT_ADD1_BUS(e_bus_short_errors, in);
+		return gbBAD ;
+	case BUS_RESET_ERROR:
+	default:
+		in->reconnect_state++;	// Flag for eventual reconnection
+		LEVEL_DEBUG("Reset error. Reconnection %d/%d",in->reconnect_state,reconnect_error); 
+		STAT_ADD1_BUS(e_bus_reset_errors, in);
+		return gbBAD ;
+	}
+}
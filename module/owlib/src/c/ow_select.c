@@ -119,6 +119,22 @@ GOOD_OR_BAD BUS_select(const struct parsedname *pn)
 	return gbGOOD;
 }
 
+/* Would BUS_select be just a reset and a match ROM of this device?
+ * Adapters that do reset, select and data in one exchange (select_and_sendback)
+ * check this first and fall back to BUS_select for everything else */
+int BUS_select_plain(const struct parsedname *pn)
+{
+	struct connection_in * in = pn->selected_connection ;
+
+	return ! BusIsServer(in)
+		&& ! Globals.one_device
+		&& RootNotBranch(pn)
+		&& in->iroutines.select == NO_SELECT_ROUTINE
+		&& in->branch.branch == eBranch_cleared
+		&& pn->selected_device != NO_DEVICE
+		&& pn->selected_device != DeviceThermostat ;
+}
+
 static GOOD_OR_BAD BUS_Skip_Rom(const struct parsedname *pn)
 {
 	BYTE skip[1];
@@ -76,6 +76,7 @@ GOOD_OR_BAD Zero_detect(struct port_in *pin)
 	in->Adapter = adapter_tcp;
 	in->adapter_name = "tcp";
 	Zero_setroutines(&(in->iroutines));
+	ServerPool_Init(in);
 	return gbGOOD;
 }
 
@@ -96,6 +97,7 @@ GOOD_OR_BAD Server_detect(struct port_in *pin)
 	in->adapter_name = "tcp";
 	pin->busmode = bus_server;
 	Server_setroutines(&(in->iroutines));
+	ServerPool_Init(in);
 	return gbGOOD;
 }
 
@@ -103,6 +105,7 @@ GOOD_OR_BAD Server_detect(struct port_in *pin)
 // actual connections opened and closed independently
 static void Server_close(struct connection_in *in)
 {
+	ServerPool_Close(in) ;
 	SAFEFREE(in->master.server.type) ;
 	SAFEFREE(in->master.server.domain) ;
 	SAFEFREE(in->master.server.name) ;
@@ -17,6 +17,9 @@
 #include "ow_connection.h"
 #include "ow_standard.h" // for FS_?_alias
 
+/* Idle pooled connections younger than this (seconds) skip the liveness check */
+#define SERVER_POOL_FRESH 1
+
 struct server_connection_state {
 	FILE_DESCRIPTOR_OR_ERROR file_descriptor ;
 	enum persistent_state { persistent_yes, persistent_no, } persistence ;
@@ -34,6 +37,7 @@ static uint32_t SetupControlFlags(const struct parsedname *pn);
 
 static ZERO_OR_ERROR ServerDIRALL(void (*dirfunc) (void *, const struct parsedname * const), void *v, const struct parsedname *pn_whole_directory, uint32_t * flags);
 static ZERO_OR_ERROR ServerDIR(void (*dirfunc) (void *, const struct parsedname * const), void *v, const struct parsedname *pn_whole_directory, uint32_t * flags);
+static ZERO_OR_ERROR ServerREADMANY(struct one_wire_query **owq, SIZE_OR_ERROR * result, int count);
 
 static void Directory_Element_Init( struct directory_element_structure * des );
 static void Directory_Element_Finish( struct directory_element_structure * des );
@@ -42,6 +46,10 @@ static ZERO_OR_ERROR Directory_Element( char * current_file, struct directory_el
 static void Close_Persistent( struct server_connection_state * scs) ;
 static void Release_Persistent( struct server_connection_state * scs, int granted ) ;
 
+static GOOD_OR_BAD Pool_Alive( FILE_DESCRIPTOR_OR_ERROR file_descriptor ) ;
+static FILE_DESCRIPTOR_OR_ERROR Pool_Take( struct connection_in * in ) ;
+static void Pool_Put( struct connection_in * in, FILE_DESCRIPTOR_OR_ERROR file_descriptor ) ;
+
 static GOOD_OR_BAD To_Server( struct server_connection_state * scs, struct server_msg * sm, struct serverpackage *sp) ;
 static SIZE_OR_ERROR WriteToServer(int file_descriptor, struct server_msg *sm, struct serverpackage *sp);
 
@@ -89,9 +97,145 @@ SIZE_OR_ERROR ServerRead(struct one_wire_query *owq)
 		return -EIO ;
 	}
 	Release_Persistent( &scs, cm.control_flags & PERSISTENT_MASK);
+	if ( cm.ret >= 0 && (cm.control_flags & STALE_SERVED) ) {
+		// the upstream owserver gave an expired value
+		PN(owq)->control_flags |= STALE_SERVED ;
+	}
 	return cm.ret;
 }
 
+// Send several reads to one owserver
+// every owq uses the same connection, result[i] gets what ServerRead(owq[i]) would return
+// Older owservers without READMANY get the paths one at a time instead
+void ServerReadMany(struct one_wire_query **owq, SIZE_OR_ERROR * result, int count)
+{
+	struct connection_in * in = PN(owq[0])->selected_connection ;
+	int i ;
+
+	if ( count > 1 && in->master.server.no_readmany == 0 ) {
+		ZERO_OR_ERROR zero_or_error = ServerREADMANY( owq, result, count ) ;
+
+		if ( zero_or_error == 0 ) {
+			return ;
+		}
+		if ( zero_or_error != -ENOMSG ) {
+			// nothing was unpacked, every path failed the same way
+			for ( i = 0 ; i < count ; ++i ) {
+				result[i] = zero_or_error ;
+			}
+			return ;
+		}
+		LEVEL_DEBUG("SERVER(%d) doesn't support READMANY",in->index) ;
+		in->master.server.no_readmany = 1 ;
+	}
+
+	for ( i = 0 ; i < count ; ++i ) {
+		result[i] = ServerRead( owq[i] ) ;
+	}
+}
+
+// Send to an owserver using the READMANY message
+// returns 0 (results filled in) or an error for the whole request
+static ZERO_OR_ERROR ServerREADMANY(struct one_wire_query **owq, SIZE_OR_ERROR * result, int count)
+{
+	struct server_msg sm;
+	struct client_msg cm;
+	struct parsedname *pn_first = PN(owq[0]);
+	// the path list goes as data -- the path slot is for a single string
+	struct serverpackage sp = { NULL, NULL, 0, pn_first->tokenstring, pn_first->tokens, };
+	struct server_connection_state scs ;
+	size_t list_length = 0 ;
+	size_t largest = 0 ;
+	BYTE * path_list ;
+	BYTE * record ;
+	BYTE * reply ;
+	BYTE * reply_end ;
+	int i ;
+
+	for ( i = 0 ; i < count ; ++i ) {
+		list_length += strlen( PN(owq[i])->path_to_server ) + 1 ;
+		if ( OWQ_size(owq[i]) > largest ) {
+			largest = OWQ_size(owq[i]) ;
+		}
+	}
+	if ( list_length > MAX_OWSERVER_PROTOCOL_PAYLOAD_SIZE ) {
+		return -ENOMSG ; // too long for one message, send singly
+	}
+
+	path_list = owmalloc( list_length ) ;
+	if ( path_list == NULL ) {
+		return -ENOMEM ;
+	}
+	record = path_list ;
+	for ( i = 0 ; i < count ; ++i ) {
+		size_t path_length = strlen( PN(owq[i])->path_to_server ) + 1 ;
+		memcpy( record, PN(owq[i])->path_to_server, path_length ) ;
+		record += path_length ;
+	}
+	sp.data = path_list ;
+	sp.datasize = list_length ;
+
+	// initialization
+	scs.in = pn_first->selected_connection ;
+	memset(&sm, 0, sizeof(struct server_msg));
+	memset(&cm, 0, sizeof(struct client_msg));
+	sm.type = msg_readmany;
+	sm.size = largest;
+	sm.offset = OWQ_offset(owq[0]);
+
+	LEVEL_CALL("SERVER(%d) %d paths, first=%s", scs.in->index, count, SAFESTRING(pn_first->path_to_server));
+
+	// Send to owserver
+	sm.control_flags = SetupControlFlags(pn_first);
+	if ( BAD( To_Server( &scs, &sm, &sp) ) ) {
+		owfree( path_list ) ;
+		Release_Persistent( &scs, 0);
+		return -EIO ;
+	}
+	owfree( path_list ) ;
+
+	// Receive from owserver
+	reply = From_ServerAlloc( &scs, &cm ) ;
+	if ( reply == NO_PATH ) {
+		// unread payload would confuse the next message on this connection
+		Release_Persistent( &scs, (cm.payload == 0) ? (cm.control_flags & PERSISTENT_MASK) : 0 );
+		return ( cm.ret < 0 ) ? cm.ret : -EIO ;
+	}
+	Release_Persistent( &scs, cm.control_flags & PERSISTENT_MASK);
+
+	// Unpack one record per path
+	record = reply ;
+	reply_end = reply + cm.payload ;
+	for ( i = 0 ; i < count ; ++i ) {
+		int32_t header[2] ;
+		SIZE_OR_ERROR read_or_error ;
+		int32_t length ;
+
+		if ( record + READMANY_RECORD_HEADER > reply_end ) {
+			result[i] = -EIO ;
+			continue ;
+		}
+		memcpy( header, record, READMANY_RECORD_HEADER ) ;
+		record += READMANY_RECORD_HEADER ;
+		read_or_error = (int32_t) ntohl( header[0] ) ;
+		length = (int32_t) ntohl( header[1] ) ;
+		if ( length < 0 || length > reply_end - record ) {
+			result[i] = -EIO ;
+			record = reply_end ;
+			continue ;
+		}
+		if ( read_or_error >= 0 ) {
+			// keep within the caller's buffer
+			read_or_error = ( (size_t) length > OWQ_size(owq[i]) ) ? (SIZE_OR_ERROR) OWQ_size(owq[i]) : length ;
+			memcpy( OWQ_buffer(owq[i]), record, read_or_error ) ;
+		}
+		result[i] = read_or_error ;
+		record += length ;
+	}
+	owfree( reply ) ;
+	return 0 ;
+}
+
 // Send to an owserver using the PRESENT message
 INDEX_OR_ERROR ServerPresence( struct parsedname *pn_file_entry)
 {
@@ -169,7 +313,7 @@ ZERO_OR_ERROR ServerWrite(struct one_wire_query *owq)
 		return -EIO ;
 	}
 	{
-		int32_t control_flags = cm.control_flags & ~(SHOULD_RETURN_BUS_LIST | PERSISTENT_MASK | SAFEMODE);
+		int32_t control_flags = cm.control_flags & ~(SHOULD_RETURN_BUS_LIST | PERSISTENT_MASK | SAFEMODE | STALE_OK | STALE_SERVED);
 		// keep current safemode
 		control_flags |=  LocalControlFlags & SAFEMODE ;
 		CONTROLFLAGSLOCK;
@@ -512,89 +656,135 @@ static SIZE_OR_ERROR From_Server( struct server_connection_state * scs, struct c
 	return cm->payload;
 }
 
-static GOOD_OR_BAD To_Server( struct server_connection_state * scs, struct server_msg * sm, struct serverpackage *sp)
+/* Is an idle pooled connection still usable?
+ * One non-blocking peek: nothing to read means the server is still waiting for us.
+ * End-of-file, an error, or leftover bytes (which would be mistaken for our reply) all mean no.
+ * This idea was contributed by Jacob Joseph to fix a timeout problem.
+ * http://permalink.gmane.org/gmane.comp.file-systems.owfs.devel/7306
+ * */
+static GOOD_OR_BAD Pool_Alive( FILE_DESCRIPTOR_OR_ERROR file_descriptor )
 {
-	struct connection_in * in = scs->in ; // for convenience
-	struct port_in * pin = in->pown ;
 	BYTE test_read[1] ;
-	int old_flags ;
 	ssize_t rcv_value ;
-	int saved_errno ;
-	
-	// initialize the variables
-	scs->file_descriptor = FILE_DESCRIPTOR_BAD ;
-	scs->persistence = Globals.no_persistence ? persistent_no : persistent_yes ;
 
-	// First set up the file descriptor based on persistent state
-	if (scs->persistence == persistent_no) {		
-		// no persistence wanted
-		scs->file_descriptor = ClientConnect(in);
-	} else {
-		// Persistence desired
+#ifdef MSG_DONTWAIT
+	rcv_value = recv( file_descriptor, test_read, 1, MSG_DONTWAIT | MSG_PEEK ) ;
+#else /* MSG_DONTWAIT */
+	int old_flags = fcntl( file_descriptor, F_GETFL, 0 ) ; // save socket flags
+	if ( old_flags == -1 || fcntl( file_descriptor, F_SETFL, old_flags | O_NONBLOCK ) == -1 ) {
+		return gbBAD ;
+	}
+	rcv_value = recv( file_descriptor, test_read, 1, MSG_PEEK ) ;
+	if ( fcntl( file_descriptor, F_SETFL, old_flags ) == -1 ) { // restore socket flags
+		return gbBAD ;
+	}
+#endif /* MSG_DONTWAIT */
+
+	if ( rcv_value < 0 && ( errno == EAGAIN || errno == EWOULDBLOCK ) ) {
+		// No data to be read -- so connection healthy
+		return gbGOOD ;
+	}
+	return gbBAD ;
+}
+
+/* Take an idle connection from the pool (most recently used first)
+ * Connections idle for less than SERVER_POOL_FRESH seconds are used without a check,
+ * a stale one is caught by the failed write in To_Server instead.
+ * */
+static FILE_DESCRIPTOR_OR_ERROR Pool_Take( struct connection_in * in )
+{
+	struct master_server * ms = &(in->master.server) ;
+
+	while (1) {
+		FILE_DESCRIPTOR_OR_ERROR file_descriptor ;
+		time_t idle_since ;
+
 		BUSLOCKIN(in);
-		switch ( pin->file_descriptor ) {
-			case FILE_DESCRIPTOR_PERSISTENT_IN_USE:
-				// Currently in use, so make new non-persistent connection
-				scs->file_descriptor = ClientConnect(in);
-				scs->persistence = persistent_no ;
-				break ;
-			case FILE_DESCRIPTOR_BAD:
-				// no conection currently, so make a new one
-				scs->file_descriptor = ClientConnect(in);
-				if ( FILE_DESCRIPTOR_VALID( scs->file_descriptor ) ) {
-					pin->file_descriptor = FILE_DESCRIPTOR_PERSISTENT_IN_USE ;
-				}	
-				break ;
-			default:
-				// persistent connection idle and waiting for use
-				// connection_in is locked so this is safe
-				scs->file_descriptor = pin->file_descriptor;
-				pin->file_descriptor = FILE_DESCRIPTOR_PERSISTENT_IN_USE;
-			break ;
+		if ( ms->pool_idle == 0 ) {
+			BUSUNLOCKIN(in);
+			return FILE_DESCRIPTOR_BAD ;
 		}
+		--ms->pool_idle ;
+		file_descriptor = ms->pool[ms->pool_idle] ;
+		idle_since = ms->pool_time[ms->pool_idle] ;
 		BUSUNLOCKIN(in);
+
+		if ( NOW_TIME - idle_since < SERVER_POOL_FRESH || GOOD( Pool_Alive( file_descriptor ) ) ) {
+			STAT_ADD1(server_pool_hits);
+			return file_descriptor ;
+		}
+
+		LEVEL_DEBUG("Server connection was closed.  Reconnecting.");
+		STAT_ADD1(server_pool_reconnects);
+		Test_and_Close( &file_descriptor ) ;
 	}
-	
-	// Check if the server closed the connection
-	// This is contributed by Jacob Joseph to fix a timeout problem.
-	// http://permalink.gmane.org/gmane.comp.file-systems.owfs.devel/7306
-	//rcv_value = recv(scs->file_descriptor, test_read, 1, MSG_DONTWAIT | MSG_PEEK) ;
-	old_flags = fcntl( scs->file_descriptor, F_GETFL, 0 ) ; // save socket flags
-	if ( old_flags == -1 ) {
-		rcv_value = -2 ;
-	} else if ( fcntl( scs->file_descriptor, F_SETFL, old_flags | O_NONBLOCK ) == -1 ) { // set non-blocking
-		rcv_value = -2 ;
+}
+
+/* Return a connection to the pool, or close it if the pool is full */
+static void Pool_Put( struct connection_in * in, FILE_DESCRIPTOR_OR_ERROR file_descriptor )
+{
+	struct master_server * ms = &(in->master.server) ;
+	int pool_size = Globals.server_pool < SERVER_POOL_MAX ? Globals.server_pool : SERVER_POOL_MAX ;
+
+	BUSLOCKIN(in);
+	if ( ms->pool_idle < pool_size ) {
+		ms->pool[ms->pool_idle] = file_descriptor ;
+		ms->pool_time[ms->pool_idle] = NOW_TIME ;
+		++ms->pool_idle ;
+		file_descriptor = FILE_DESCRIPTOR_BAD ;
+	}
+	BUSUNLOCKIN(in);
+
+	Test_and_Close( &file_descriptor ) ;
+}
+
+/* Start the pool with the connection opened at detection */
+void ServerPool_Init( struct connection_in * in )
+{
+	struct port_in * pin = in->pown ;
+
+	in->master.server.pool_idle = 0 ;
+	if ( FILE_DESCRIPTOR_VALID( pin->file_descriptor ) && Globals.no_persistence == 0 ) {
+		Pool_Put( in, pin->file_descriptor ) ;
 	} else {
-		rcv_value = recv(scs->file_descriptor, test_read, 1, MSG_PEEK) ; // test read the socket to see if closed
-		saved_errno = errno ;
-		if ( fcntl( scs->file_descriptor, F_SETFL, old_flags ) == -1 ) { // restore  socket flags
-			rcv_value = -2 ;
-		}
+		Test_and_Close( &(pin->file_descriptor) ) ;
+	}
+	pin->file_descriptor = FILE_DESCRIPTOR_BAD ;
+}
+
+/* Close every idle connection
+ * Part of BUS_close, so either the bus is already locked (reconnection) or no longer in use */
+void ServerPool_Close( struct connection_in * in )
+{
+	struct master_server * ms = &(in->master.server) ;
+
+	while ( ms->pool_idle > 0 ) {
+		--ms->pool_idle ;
+		Test_and_Close( &(ms->pool[ms->pool_idle]) ) ;
 	}
+}
 
-	switch ( rcv_value ) {
-		case -1:
-			if ( saved_errno==EAGAIN || saved_errno==EWOULDBLOCK ) {
-				// No data to be read -- so connection healthy
-				break ;
-			}
-			// real error, fall through to close connection case
-			__attribute__ ((fallthrough));
-		case -2:
-			// fnctl error, fall through again
-			;
-			__attribute__ ((fallthrough));
-		case 0:
-			LEVEL_DEBUG("Server connection was closed.  Reconnecting.");
-			Close_Persistent( scs);
-			scs->file_descriptor = ClientConnect(in);
-			if ( FILE_DESCRIPTOR_VALID( scs->file_descriptor ) ) {
-				in->pown->file_descriptor = FILE_DESCRIPTOR_PERSISTENT_IN_USE ;
-			}
-			break ;
-		default:
-			// data to be read, so a good connection
-			break ;
+static GOOD_OR_BAD To_Server( struct server_connection_state * scs, struct server_msg * sm, struct serverpackage *sp)
+{
+	struct connection_in * in = scs->in ; // for convenience
+	int from_pool = 0 ;
+
+	// initialize the variables
+	scs->file_descriptor = FILE_DESCRIPTOR_BAD ;
+	scs->persistence = Globals.no_persistence ? persistent_no : persistent_yes ;
+
+	// First set up the file descriptor based on persistent state
+	if (scs->persistence == persistent_yes) {
+		// Persistence desired -- each concurrent request gets its own connection
+		scs->file_descriptor = Pool_Take(in) ;
+		if ( FILE_DESCRIPTOR_VALID( scs->file_descriptor ) ) {
+			from_pool = 1 ;
+		} else {
+			STAT_ADD1(server_pool_misses);
+		}
+	}
+	if ( FILE_DESCRIPTOR_NOT_VALID( scs->file_descriptor ) ) {
+		scs->file_descriptor = ClientConnect(in);
 	}
 
 	// Now test
@@ -610,15 +800,17 @@ static GOOD_OR_BAD To_Server( struct server_connection_state * scs, struct serve
 		return gbGOOD;
 	}
 
-	// This is where it gets a bit tricky. For non-persistent conections we're done'
-	if ( scs->persistence == persistent_no ) {
-		// not persistent, so no reconnection needed
+	// This is where it gets a bit tricky. For new conections we're done'
+	if ( ! from_pool ) {
+		// fresh connection failed, so no reconnection
 		Close_Persistent( scs ) ;
 		return gbBAD ;
 	}
 	
-	// perhaps the persistent connection is stale?
+	// perhaps the pooled connection is stale?
 	// Make a new one
+	STAT_ADD1(server_pool_reconnects);
+	Test_and_Close( &(scs->file_descriptor) ) ;
 	scs->file_descriptor = ClientConnect(in) ;
 
 	// Now retest
@@ -629,8 +821,6 @@ static GOOD_OR_BAD To_Server( struct server_connection_state * scs, struct serve
 		return gbBAD ;
 	}
 	
-	// Leave in->file_descriptor = FILE_DESCRIPTOR_PERSISTENT_IN_USE
-
 	// Second attempt at the write, now with new connection
 	if (WriteToServer(scs->file_descriptor, sm, sp) >= 0) {
 		// successful message
@@ -642,16 +832,9 @@ static GOOD_OR_BAD To_Server( struct server_connection_state * scs, struct serve
 	return gbBAD ;
 }
 
+/* This connection will not be reused */
 static void Close_Persistent( struct server_connection_state * scs)
 {
-	// First set up the file descriptor based on persistent state
-	if (scs->persistence == persistent_yes) {
-		// no persistence wanted
-		BUSLOCKIN(scs->in);
-			scs->in->pown->file_descriptor = FILE_DESCRIPTOR_BAD ;
-		BUSUNLOCKIN(scs->in);
-	}
-	
 	scs->persistence = persistent_no ;
 	Test_and_Close( &(scs->file_descriptor) ) ;
 }
@@ -750,8 +933,10 @@ static SIZE_OR_ERROR WriteToServer(int file_descriptor, struct server_msg *sm, s
 		int traffic_counter ;
 		traffic_counter = 0 ;
 		TrafficOutFD("write header" ,io[traffic_counter].iov_base,io[traffic_counter].iov_len,file_descriptor);
-		++traffic_counter;
-		TrafficOutFD("write path"  ,io[traffic_counter].iov_base,io[traffic_counter].iov_len,file_descriptor);
+		if (sp->path != 0) {
+			++traffic_counter;
+			TrafficOutFD("write path"  ,io[traffic_counter].iov_base,io[traffic_counter].iov_len,file_descriptor);
+		}
 		if ((sp->datasize>0) && (sp->data!=NULL)) {	// send data only for writes (if datasize not zero)
 			++traffic_counter;
 			TrafficOutFD("write data" ,io[traffic_counter].iov_base,io[traffic_counter].iov_len,file_descriptor);
@@ -784,7 +969,7 @@ static uint32_t SetupControlFlags(const struct parsedname *pn)
 	/* from owlib to owserver never wants alias */
 	control_flags &= ~ALIAS_REQUEST ;
 
-	control_flags &= ~SHOULD_RETURN_BUS_LIST;
+	control_flags &= ~(SHOULD_RETURN_BUS_LIST | STALE_SERVED);
 	if (SpecifiedBus(pn)) {
 		control_flags |= SHOULD_RETURN_BUS_LIST;
 	}
@@ -793,7 +978,7 @@ static uint32_t SetupControlFlags(const struct parsedname *pn)
 }
 
 /* Clean up at end of routine,
-   either leave connection open and persistent flag available,
+   either return the connection to the pool,
    or close
 */
 static void Release_Persistent( struct server_connection_state * scs, int granted )
@@ -815,9 +1000,7 @@ static void Release_Persistent( struct server_connection_state * scs, int grante
 	}
 
 	// mark as available
-	BUSLOCKIN(scs->in);
-	scs->in->pown->file_descriptor = scs->file_descriptor;
-	BUSUNLOCKIN(scs->in);
+	Pool_Put( scs->in, scs->file_descriptor ) ;
 	scs->persistence = persistent_no ; // we no longer own this connection
 	scs->file_descriptor = FILE_DESCRIPTOR_BAD ;
 }
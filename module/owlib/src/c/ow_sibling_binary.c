@@ -59,6 +59,8 @@ ZERO_OR_ERROR FS_r_sibling_binary(BYTE * data, size_t * size, const char * sibli
 			memset(data, 0, size[0] ) ;
 			size[0] = OWQ_length(owq_sibling) ;
 			memcpy( data, OWQ_buffer(owq_sibling), size[0] ) ;
+			// pass a stale answer on
+			PN(owq)->control_flags |= PN(owq_sibling)->control_flags & STALE_SERVED ;
 			sib_status = 0 ;
 		} else {
 			sib_status = -ENOMEM ;
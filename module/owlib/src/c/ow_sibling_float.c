@@ -54,6 +54,8 @@ ZERO_OR_ERROR FS_r_sibling_F(_FLOAT *F, const char * sibling, struct one_wire_qu
 	}
 	sib_status = FS_read_local(owq_sibling) ;
 	F[0] = OWQ_F(owq_sibling) ;
+	// pass a stale answer on
+	PN(owq)->control_flags |= PN(owq_sibling)->control_flags & STALE_SERVED ;
 	OWQ_destroy(owq_sibling) ;
 	return sib_status >= 0 ? 0 : -EINVAL ;
 }
@@ -53,6 +53,8 @@ ZERO_OR_ERROR FS_r_sibling_Y(INT *Y, const char * sibling, struct one_wire_query
 	}
 	sib_status = FS_read_local(owq_sibling) ;
 	Y[0] = OWQ_Y(owq_sibling) ;
+	// pass a stale answer on
+	PN(owq)->control_flags |= PN(owq_sibling)->control_flags & STALE_SERVED ;
 	OWQ_destroy(owq_sibling) ;
 	return sib_status >= 0 ? 0 : -EINVAL ;
 }
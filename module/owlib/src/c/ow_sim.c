@@ -0,0 +1,948 @@
+/*
+    OWFS -- One-Wire filesystem
+    OWHTTPD -- One-Wire Web Server
+    Written 2003 Paul H Alfille
+    email: paul.alfille@gmail.com
+    Released under the GPL
+    See the header file: ow.h for full attribution
+    1wire/iButton system from Dallas Semiconductor
+*/
+
+/* Simulated bus master that goes all the way down to the wire.
+ *
+ * Unlike fake/tester/mock (which answer reads without any bus traffic) the
+ * sim bus runs the real device code. Every bit goes through a wired-AND line
+ * model where each slave runs its own ROM layer (search triplets, match,
+ * skip, resume) and a model of its function commands, with real scratchpads
+ * and CRCs. Every adapter exchange then sleeps for the modeled 1-wire time
+ * -- reset, time slots at standard or overdrive speed, strong pull-up --
+ * plus a per-bus latency that stands in for the serial or USB round trip.
+ *
+ * The values are a random walk seeded from the device ID, so runs are
+ * reproducible.
+ *
+ * --sim=DS18B20*8,DS2438,29,23.0102030405,latency=200,overdrive
+ * */
+
+#include <config.h>
+#include "owfs_config.h"
+#include "ow.h"
+#include "ow_connection.h"
+#include "ow_codes.h"
+
+#include <math.h>
+
+/* Line timing in usec, recovery included */
+#define SIM_SLOT_STANDARD     70
+#define SIM_SLOT_OVERDRIVE    10
+#define SIM_RESET_STANDARD   960
+#define SIM_RESET_OVERDRIVE  146
+
+#define SIM_FRAME       40		// bytes of a function command kept (for CRC16)
+#define SIM_QUEUE       (512+8)	// longest answer (DS2433 memory)
+#define SIM_MEMORY      512
+#define SIM_SCRATCHPAD  64
+
+enum sim_rom_state {
+	sim_rom_off,				// not addressed, waits for reset
+	sim_rom_command,			// receiving the ROM command
+	sim_rom_read,				// sending its ID (READ ROM)
+	sim_rom_match,				// comparing an ID (MATCH ROM)
+	sim_rom_search,				// search triplets
+	sim_rom_function,			// addressed, running function commands
+};
+
+struct sim_device ;
+
+struct sim_model {
+	const ASCII * name ;
+	BYTE family ;
+	void (*setup) (struct sim_device * d) ;
+	void (*function) (struct sim_device * d, BYTE b) ; // after each function byte
+	int (*alarm) (struct sim_device * d) ; // conditional search
+};
+
+struct sim_device {
+	BYTE sn[SERIAL_NUMBER_SIZE] ;
+	const struct sim_model * model ;
+
+	/* ROM layer */
+	enum sim_rom_state state ;
+	int bit ;					// bit within the current state
+	BYTE shift ;				// byte being received
+	BYTE drive ;				// byte being driven
+	int resume ;				// last device addressed
+
+	/* function layer */
+	int pos ;					// byte number since the function command
+	BYTE frame[SIM_FRAME] ;		// bytes of this command seen on the line
+	BYTE queue[SIM_QUEUE] ;		// bytes to drive next
+	int queue_next ;
+	int queue_length ;
+
+	/* contents */
+	BYTE memory[SIM_MEMORY] ;
+	BYTE scratchpad[SIM_SCRATCHPAD] ;
+	UINT address ;
+	BYTE es ;
+	_FLOAT temperature ;
+	_FLOAT voltage ;
+	_FLOAT vdd ;
+	UINT seed ;
+};
+
+static void Sim_setroutines(struct connection_in *in);
+static RESET_TYPE Sim_reset(const struct parsedname *pn);
+static GOOD_OR_BAD Sim_sendback_data(const BYTE * data, BYTE * resp, const size_t len, const struct parsedname *pn);
+static GOOD_OR_BAD Sim_sendback_bits(const BYTE * databits, BYTE * respbits, const size_t len, const struct parsedname *pn);
+static GOOD_OR_BAD Sim_PowerByte(const BYTE data, BYTE * resp, const UINT delay, const struct parsedname *pn);
+static GOOD_OR_BAD Sim_PowerBit(const BYTE data, BYTE * resp, const UINT delay, const struct parsedname *pn);
+static void Sim_close(struct connection_in *in);
+
+static void SimWait( const struct connection_in * in, UINT slots, UINT resets, UINT msec ) ;
+static int SimSlot( struct master_sim * sim, int master_bit ) ;
+static BYTE SimByte( struct master_sim * sim, BYTE data ) ;
+static int SimDeviceDrive( struct sim_device * d ) ;
+static void SimDeviceSample( struct sim_device * d, int line ) ;
+static void SimRomCommand( struct sim_device * d, BYTE command ) ;
+static void SimSelected( struct sim_device * d, int resume ) ;
+static void SimFunctionByte( struct sim_device * d, BYTE b ) ;
+static void SimQueue( struct sim_device * d, const BYTE * data, int length ) ;
+static void SimQueueCRC16( struct sim_device * d, const BYTE * data, int length ) ;
+static int SimQueueEmpty( const struct sim_device * d ) ;
+static _FLOAT SimWalk( struct sim_device * d, _FLOAT value, _FLOAT step, _FLOAT low, _FLOAT high ) ;
+
+static void SimParseList( struct port_in * pin ) ;
+static void SimAddDevices( ASCII * token, struct connection_in * in ) ;
+static const struct sim_model * SimModel( const ASCII * name, BYTE family ) ;
+
+static void Sim1820_setup( struct sim_device * d ) ;
+static void Sim1820_function( struct sim_device * d, BYTE b ) ;
+static int Sim1820_alarm( struct sim_device * d ) ;
+static void Sim2438_setup( struct sim_device * d ) ;
+static void Sim2438_function( struct sim_device * d, BYTE b ) ;
+static void Sim2408_setup( struct sim_device * d ) ;
+static void Sim2408_function( struct sim_device * d, BYTE b ) ;
+static int Sim2408_alarm( struct sim_device * d ) ;
+static void Sim2433_function( struct sim_device * d, BYTE b ) ;
+
+/* Devices with a model. Any other family code is a ROM-only slave (like a DS2401) */
+static const struct sim_model sim_models[] = {
+	{ "DS2401", 0x01, NULL, NULL, NULL, },
+	{ "DS18B20", 0x28, Sim1820_setup, Sim1820_function, Sim1820_alarm, },
+	{ "DS1822", 0x22, Sim1820_setup, Sim1820_function, Sim1820_alarm, },
+	{ "DS2438", 0x26, Sim2438_setup, Sim2438_function, NULL, },
+	{ "DS2408", 0x29, Sim2408_setup, Sim2408_function, Sim2408_alarm, },
+	{ "DS2433", 0x23, NULL, Sim2433_function, NULL, },
+};
+#define SIM_MODELS ( (int) (sizeof(sim_models) / sizeof(struct sim_model)) )
+
+static void Sim_setroutines(struct connection_in *in)
+{
+	in->iroutines.detect = Sim_detect;
+	in->iroutines.reset = Sim_reset;
+	in->iroutines.next_both = NO_NEXT_BOTH_ROUTINE; // bit-banged search triplets
+	in->iroutines.PowerByte = Sim_PowerByte;
+	in->iroutines.PowerBit = Sim_PowerBit;
+	in->iroutines.ProgramPulse = NO_PROGRAMPULSE_ROUTINE;
+	in->iroutines.sendback_data = Sim_sendback_data;
+	in->iroutines.sendback_bits = Sim_sendback_bits;
+	in->iroutines.select = NO_SELECT_ROUTINE;
+	in->iroutines.select_and_sendback = NO_SELECTANDSENDBACK_ROUTINE;
+	in->iroutines.set_config = NO_SET_CONFIG_ROUTINE;
+	in->iroutines.get_config = NO_GET_CONFIG_ROUTINE;
+	in->iroutines.reconnect = NO_RECONNECT_ROUTINE;
+	in->iroutines.close = Sim_close;
+	in->iroutines.verify = NO_VERIFY_ROUTINE ;
+	in->iroutines.flags = ADAP_FLAG_overdrive | ADAP_FLAG_no2409path ;
+}
+
+/* Device-specific functions */
+/* Since this is simulated bus master, it's creation cannot fail */
+GOOD_OR_BAD Sim_detect(struct port_in *pin)
+{
+	struct connection_in * in = pin->first ;
+	int index = Inbound_Control.next_sim++ ;
+	char name[20] ;
+
+	Sim_setroutines(in);
+
+	in->adapter_name = "Simulated-Timed";
+	in->Adapter = adapter_sim;
+	pin->file_descriptor = index;
+	pin->type = ct_none ;
+	in->master.sim.index = index ;
+	in->master.sim.latency = 0 ;
+	in->master.sim.devices = 0 ;
+	in->master.sim.device = NULL ;
+	LEVEL_CONNECT("Setting up %s Bus Master (%d)", "sim", index);
+
+	UCLIBCLOCK ;
+	snprintf(name, 18, "sim.%d", index);
+	UCLIBCUNLOCK ;
+
+	SimParseList( pin ) ;
+
+	// Device name and init_data diverge now
+	SAFEFREE(DEVICENAME(in)) ;
+	DEVICENAME(in) = owstrdup(name);
+
+	return gbGOOD;
+}
+
+static void Sim_close(struct connection_in *in)
+{
+	SAFEFREE( in->master.sim.device ) ;
+	in->master.sim.devices = 0 ;
+}
+
+/* ---------------------------------------------- */
+/* Bus master                                     */
+/* ---------------------------------------------- */
+
+/* The only place time passes: one sleep per adapter exchange */
+static void SimWait( const struct connection_in * in, UINT slots, UINT resets, UINT msec )
+{
+	unsigned long usec = in->master.sim.latency ;
+
+	usec += slots * ( in->overdrive ? SIM_SLOT_OVERDRIVE : SIM_SLOT_STANDARD ) ;
+	usec += resets * ( in->overdrive ? SIM_RESET_OVERDRIVE : SIM_RESET_STANDARD ) ;
+	usec += msec * 1000 ;
+	UT_delay_us( usec ) ;
+}
+
+static RESET_TYPE Sim_reset(const struct parsedname *pn)
+{
+	struct connection_in * in = pn->selected_connection ;
+	struct master_sim * sim = &(in->master.sim) ;
+	int i ;
+
+	for ( i = 0 ; i < sim->devices ; ++i ) {
+		struct sim_device * d = &(sim->device[i]) ;
+		d->state = sim_rom_command ;
+		d->bit = 0 ;
+		d->queue_next = d->queue_length = 0 ;
+	}
+	in->AnyDevices = ( sim->devices > 0 ) ? anydevices_yes : anydevices_no ;
+	SimWait( in, 0, 1, 0 ) ;
+	return BUS_RESET_OK;
+}
+
+static GOOD_OR_BAD Sim_sendback_data(const BYTE * data, BYTE * resp, const size_t len, const struct parsedname *pn)
+{
+	struct connection_in * in = pn->selected_connection ;
+	size_t i ;
+
+	for ( i = 0 ; i < len ; ++i ) {
+		BYTE line = SimByte( &(in->master.sim), data[i] ) ;
+		if ( resp != NULL ) {
+			resp[i] = line ;
+		}
+	}
+	SimWait( in, 8 * len, 0, 0 ) ;
+	return gbGOOD;
+}
+
+static GOOD_OR_BAD Sim_sendback_bits(const BYTE * databits, BYTE * respbits, const size_t len, const struct parsedname *pn)
+{
+	struct connection_in * in = pn->selected_connection ;
+	size_t i ;
+
+	for ( i = 0 ; i < len ; ++i ) {
+		int line = SimSlot( &(in->master.sim), databits[i] ? 1 : 0 ) ;
+		if ( respbits != NULL ) {
+			respbits[i] = line ? 0xFF : 0x00 ;
+		}
+	}
+	SimWait( in, len, 0, 0 ) ;
+	return gbGOOD;
+}
+
+/* Strong pull-up: the line is held high for the delay, no slots */
+static GOOD_OR_BAD Sim_PowerByte(const BYTE data, BYTE * resp, const UINT delay, const struct parsedname *pn)
+{
+	struct connection_in * in = pn->selected_connection ;
+
+	resp[0] = SimByte( &(in->master.sim), data ) ;
+	SimWait( in, 8, 0, delay ) ;
+	return gbGOOD;
+}
+
+static GOOD_OR_BAD Sim_PowerBit(const BYTE data, BYTE * resp, const UINT delay, const struct parsedname *pn)
+{
+	struct connection_in * in = pn->selected_connection ;
+
+	resp[0] = SimSlot( &(in->master.sim), data ? 1 : 0 ) ? 0xFF : 0x00 ;
+	SimWait( in, 1, 0, delay ) ;
+	return gbGOOD;
+}
+
+/* ---------------------------------------------- */
+/* Line and ROM layer                             */
+/* ---------------------------------------------- */
+
+/* One time slot: wired-AND of the master and every slave, then all sample */
+static int SimSlot( struct master_sim * sim, int master_bit )
+{
+	int line = master_bit ;
+	int i ;
+
+	for ( i = 0 ; i < sim->devices ; ++i ) {
+		line &= SimDeviceDrive( &(sim->device[i]) ) ;
+	}
+	for ( i = 0 ; i < sim->devices ; ++i ) {
+		SimDeviceSample( &(sim->device[i]), line ) ;
+	}
+	return line ;
+}
+
+/* Least significant bit first */
+static BYTE SimByte( struct master_sim * sim, BYTE data )
+{
+	BYTE line = 0 ;
+	int b ;
+
+	for ( b = 0 ; b < 8 ; ++b ) {
+		UT_setbit( &line, b, SimSlot( sim, UT_getbit( &data, b ) ) ) ;
+	}
+	return line ;
+}
+
+static int SimDeviceDrive( struct sim_device * d )
+{
+	switch ( d->state ) {
+		case sim_rom_read:
+			return UT_getbit( d->sn, d->bit ) ;
+		case sim_rom_search:
+			switch ( d->bit % 3 ) {
+				case 0:
+					return UT_getbit( d->sn, d->bit / 3 ) ;
+				case 1:
+					return UT_getbit( d->sn, d->bit / 3 ) ^ 1 ;
+				default:
+					return 1 ;
+			}
+		case sim_rom_function:
+			if ( d->bit == 0 ) {
+				d->drive = SimQueueEmpty( d ) ? 0xFF : d->queue[d->queue_next++] ;
+			}
+			return UT_getbit( &(d->drive), d->bit ) ;
+		default:
+			return 1 ;
+	}
+}
+
+static void SimDeviceSample( struct sim_device * d, int line )
+{
+	switch ( d->state ) {
+		case sim_rom_command:
+			UT_setbit( &(d->shift), d->bit, line ) ;
+			if ( ++d->bit == 8 ) {
+				SimRomCommand( d, d->shift ) ;
+			}
+			break ;
+		case sim_rom_read:
+			if ( ++d->bit == 64 ) {
+				SimSelected( d, 0 ) ;
+			}
+			break ;
+		case sim_rom_match:
+			if ( line != UT_getbit( d->sn, d->bit ) ) {
+				d->state = sim_rom_off ;
+			} else if ( ++d->bit == 64 ) {
+				SimSelected( d, 1 ) ;
+			}
+			break ;
+		case sim_rom_search:
+			// third slot of the triplet is the master's choice
+			if ( d->bit % 3 == 2 && line != UT_getbit( d->sn, d->bit / 3 ) ) {
+				d->state = sim_rom_off ;
+			} else if ( ++d->bit == 3 * 64 ) {
+				SimSelected( d, 1 ) ;
+			}
+			break ;
+		case sim_rom_function:
+			UT_setbit( &(d->shift), d->bit, line ) ;
+			if ( ++d->bit == 8 ) {
+				d->bit = 0 ;
+				SimFunctionByte( d, d->shift ) ;
+			}
+			break ;
+		case sim_rom_off:
+			break ;
+	}
+}
+
+static void SimRomCommand( struct sim_device * d, BYTE command )
+{
+	int resume = d->resume ;
+
+	d->bit = 0 ;
+	d->resume = 0 ;
+	switch ( command ) {
+		case _1W_READ_ROM:
+			d->state = sim_rom_read ;
+			break ;
+		case _1W_MATCH_ROM:
+		case _1W_OVERDRIVE_MATCH_ROM:
+			d->state = sim_rom_match ;
+			break ;
+		case _1W_SEARCH_ROM:
+			d->state = sim_rom_search ;
+			break ;
+		case _1W_CONDITIONAL_SEARCH_ROM:
+			if ( d->model != NULL && d->model->alarm != NULL && d->model->alarm(d) ) {
+				d->state = sim_rom_search ;
+			} else {
+				d->state = sim_rom_off ;
+			}
+			break ;
+		case _1W_SKIP_ROM:
+		case _1W_OVERDRIVE_SKIP_ROM:
+			SimSelected( d, 0 ) ;
+			break ;
+		case _1W_RESUME:
+			if ( resume ) {
+				SimSelected( d, 1 ) ;
+			} else {
+				d->state = sim_rom_off ;
+			}
+			break ;
+		default:
+			d->state = sim_rom_off ;
+			break ;
+	}
+}
+
+static void SimSelected( struct sim_device * d, int resume )
+{
+	d->state = sim_rom_function ;
+	d->resume = resume ;
+	d->bit = 0 ;
+	d->pos = 0 ;
+	d->queue_next = d->queue_length = 0 ;
+}
+
+static void SimFunctionByte( struct sim_device * d, BYTE b )
+{
+	if ( d->pos < SIM_FRAME ) {
+		d->frame[d->pos] = b ;
+	}
+	if ( d->model != NULL && d->model->function != NULL ) {
+		d->model->function( d, b ) ;
+	}
+	++d->pos ;
+}
+
+static int SimQueueEmpty( const struct sim_device * d )
+{
+	return d->queue_next >= d->queue_length ;
+}
+
+/* Bytes the slave drives on the following read slots */
+static void SimQueue( struct sim_device * d, const BYTE * data, int length )
+{
+	if ( SimQueueEmpty( d ) ) {
+		d->queue_next = d->queue_length = 0 ;
+	}
+	if ( length > SIM_QUEUE - d->queue_length ) {
+		length = SIM_QUEUE - d->queue_length ;
+	}
+	memcpy( &(d->queue[d->queue_length]), data, length ) ;
+	d->queue_length += length ;
+}
+
+/* Inverted CRC16, low byte first -- what CRC16() in the library checks */
+static void SimQueueCRC16( struct sim_device * d, const BYTE * data, int length )
+{
+	UINT crc = CRC16compute( data, length, 0 ) ;
+	BYTE c[2] = { BYTE_INVERSE(crc), BYTE_INVERSE(crc >> 8), } ;
+
+	SimQueue( d, c, 2 ) ;
+}
+
+/* Reproducible random walk */
+static _FLOAT SimWalk( struct sim_device * d, _FLOAT value, _FLOAT step, _FLOAT low, _FLOAT high )
+{
+	d->seed = d->seed * 1103515245 + 12345 ;
+	value += step * ( ( (_FLOAT) ( ( d->seed >> 16 ) & 0x7FFF ) ) / 16384. - 1. ) ;
+	if ( value < low ) {
+		value = low ;
+	} else if ( value > high ) {
+		value = high ;
+	}
+	return value ;
+}
+
+/* ---------------------------------------------- */
+/* Device list                                    */
+/* ---------------------------------------------- */
+
+/* Comma or space separated: a name (DS18B20) or family code (28), optionally
+ * followed by ID bytes (28.0102030405) and a count (DS18B20*16).
+ * "latency=usec" and "overdrive" set up the bus itself. */
+static void SimParseList( struct port_in * pin )
+{
+	struct connection_in * in = pin->first ;
+	ASCII * remaining_device_list = owstrdup( pin->init_data ) ;
+	ASCII * remember_location = remaining_device_list ;
+
+	while (remaining_device_list != NULL) {
+		ASCII * token = strsep(&remaining_device_list, " ,") ;
+		if ( token[0] == '\0' ) {
+			continue ;
+		} else if ( strncasecmp( token, "latency=", 8 ) == 0 ) {
+			in->master.sim.latency = strtoul( &token[8], NULL, 10 ) ;
+		} else if ( strcasecmp( token, "overdrive" ) == 0 ) {
+			in->overdrive = 1 ;
+		} else {
+			SimAddDevices( token, in ) ;
+		}
+	}
+	SAFEFREE( remember_location ) ;
+	in->AnyDevices = ( in->master.sim.devices > 0 ) ? anydevices_yes : anydevices_no ;
+	LEVEL_CONNECT("sim.%d has %d devices and %u usec latency", in->master.sim.index, in->master.sim.devices, in->master.sim.latency ) ;
+}
+
+static void SimAddDevices( ASCII * token, struct connection_in * in )
+{
+	struct master_sim * sim = &(in->master.sim) ;
+	const struct sim_model * model ;
+	BYTE id[SERIAL_NUMBER_SIZE] ;
+	int given = 0 ;				// ID bytes specified
+	int count = 1 ;
+	ASCII * star = strchr( token, '*' ) ;
+	struct sim_device * devices ;
+	int i ;
+
+	if ( star != NULL ) {
+		star[0] = '\0' ;
+		count = atoi( &star[1] ) ;
+		if ( count < 1 ) {
+			LEVEL_DEFAULT("Bad count for <%s> on sim.%d -- ignored", token, sim->index ) ;
+			return ;
+		}
+	}
+
+	model = SimModel( token, 0 ) ;
+	if ( model != NULL ) {
+		id[0] = model->family ;
+	} else if ( isxdigit(token[0]) && isxdigit(token[1]) ) {
+		const ASCII * p = &token[2] ;
+		id[0] = string2num( token ) ;
+		model = SimModel( NULL, id[0] ) ;	// NULL is a ROM-only slave
+		while ( given < SERIAL_NUMBER_SIZE - 2 ) {
+			if ( p[0] == '.' ) {
+				++p ;
+			}
+			if ( ! isxdigit(p[0]) || ! isxdigit(p[1]) ) {
+				break ;
+			}
+			id[++given] = string2num( p ) ;
+			p += 2 ;
+		}
+	} else {
+		LEVEL_DEFAULT("Device <%s> not recognized for sim.%d -- ignored", token, sim->index ) ;
+		return ;
+	}
+
+	devices = owrealloc( sim->device, ( sim->devices + count ) * sizeof( struct sim_device ) ) ;
+	if ( devices == NULL ) {
+		LEVEL_DEFAULT("No memory for %d more devices on sim.%d", count, sim->index ) ;
+		return ;
+	}
+	sim->device = devices ;
+
+	for ( i = 0 ; i < count ; ++i ) {
+		struct sim_device * d = &(sim->device[sim->devices]) ;
+		int b ;
+
+		memset( d, 0, sizeof( struct sim_device ) ) ;
+		// predictable ID: family, bus, device number
+		d->sn[0] = id[0] ;
+		d->sn[1] = BYTE_MASK( sim->index ) ;
+		d->sn[2] = BYTE_MASK( sim->index >> 8 ) ;
+		d->sn[3] = BYTE_MASK( sim->devices ) ;
+		d->sn[4] = BYTE_MASK( sim->devices >> 8 ) ;
+		d->sn[5] = BYTE_INVERSE( id[0] ) ;
+		d->sn[6] = 0x00 ;
+		for ( b = 1 ; b <= given ; ++b ) {
+			d->sn[b] = id[b] ;
+		}
+		d->sn[SERIAL_NUMBER_SIZE-1] = CRC8compute( d->sn, SERIAL_NUMBER_SIZE-1, 0 ) ;
+		d->model = model ;
+		d->state = sim_rom_off ;
+		d->seed = ( (UINT) d->sn[0] << 24 ) ^ ( (UINT) d->sn[1] << 16 ) ^ ( (UINT) d->sn[3] << 8 ) ^ d->sn[7] ;
+		d->temperature = SimWalk( d, ( Globals.templow + Globals.temphigh ) / 2., ( Globals.temphigh - Globals.templow ) / 2., Globals.templow, Globals.temphigh ) ;
+		d->voltage = SimWalk( d, 2.5, 2.5, 0., 5. ) ;
+		d->vdd = SimWalk( d, 5.0, .2, 4.8, 5.2 ) ;
+		if ( model != NULL && model->setup != NULL ) {
+			model->setup( d ) ;
+		}
+		++sim->devices ;
+	}
+}
+
+static const struct sim_model * SimModel( const ASCII * name, BYTE family )
+{
+	int i ;
+
+	for ( i = 0 ; i < SIM_MODELS ; ++i ) {
+		if ( name != NULL ) {
+			if ( strcasecmp( name, sim_models[i].name ) == 0 ) {
+				return &sim_models[i] ;
+			}
+		} else if ( family == sim_models[i].family ) {
+			return &sim_models[i] ;
+		}
+	}
+	return NULL ;
+}
+
+/* ---------------------------------------------- */
+/* DS18B20 / DS1822 (see ow_1820.c)               */
+/* ---------------------------------------------- */
+/* memory: EEPROM TH TL config */
+/* scratchpad: temperature LSB MSB, TH, TL, config, 0xFF, 0x0C, 0x10, CRC8 */
+
+static void Sim1820_setup( struct sim_device * d )
+{
+	BYTE * sp = d->scratchpad ;
+
+	d->memory[0] = 0x7D ;		// TH 125C
+	d->memory[1] = 0xC9 ;		// TL -55C, so no alarm until set
+	d->memory[2] = 0x7F ;		// 12 bit
+	sp[0] = 0x50 ;				// power-on 85C
+	sp[1] = 0x05 ;
+	memcpy( &sp[2], d->memory, 3 ) ;
+	sp[5] = 0xFF ;
+	sp[6] = 0x0C ;
+	sp[7] = 0x10 ;
+}
+
+static void Sim1820_convert( struct sim_device * d )
+{
+	BYTE * sp = d->scratchpad ;
+	int lsb = 1 << ( 3 - ( ( sp[4] >> 5 ) & 0x03 ) ) ; // 9..12 bit
+	int raw ;
+
+	d->temperature = SimWalk( d, d->temperature, .25, Globals.templow, Globals.temphigh ) ;
+	raw = ( (int) floor( d->temperature * 16. ) ) & ~( lsb - 1 ) ;
+	if ( raw == 0x0550 ) {
+		// never a real conversion that looks like the power-on value
+		raw += lsb ;
+	}
+	sp[0] = BYTE_MASK( raw ) ;
+	sp[1] = BYTE_MASK( raw >> 8 ) ;
+}
+
+static void Sim1820_function( struct sim_device * d, BYTE b )
+{
+	BYTE * sp = d->scratchpad ;
+
+	if ( d->pos == 0 ) {
+		switch ( b ) {
+			case 0x44: // convert T
+				Sim1820_convert( d ) ;
+				break ;
+			case 0xBE: // read scratchpad
+				sp[8] = CRC8compute( sp, 8, 0 ) ;
+				SimQueue( d, sp, 9 ) ;
+				break ;
+			case 0x48: // copy scratchpad
+				memcpy( d->memory, &sp[2], 3 ) ;
+				break ;
+			case 0xB8: // recall EEPROM
+				memcpy( &sp[2], d->memory, 3 ) ;
+				break ;
+			case 0xB4: // read power supply -- powered slaves leave the line high
+			default:
+				break ;
+		}
+	} else if ( d->frame[0] == 0x4E && d->pos <= 3 ) {
+		// write scratchpad: TH TL config
+		sp[1 + d->pos] = ( d->pos == 3 ) ? ( ( b & 0x60 ) | 0x1F ) : b ;
+	}
+}
+
+static int Sim1820_alarm( struct sim_device * d )
+{
+	BYTE * sp = d->scratchpad ;
+	int t = ( (int) (short) ( sp[1] << 8 | sp[0] ) ) >> 4 ;
+
+	return t >= (signed char) sp[2] || t <= (signed char) sp[3] ;
+}
+
+/* ---------------------------------------------- */
+/* DS2438 (see ow_2438.c)                         */
+/* ---------------------------------------------- */
+/* 8 pages of 8 bytes in memory, each with a scratchpad page */
+/* page 0: status/config, temperature, voltage, current, threshold */
+
+static void Sim2438_setup( struct sim_device * d )
+{
+	d->memory[0] = 0x0F ;		// IAD CA EE AD
+	memcpy( d->scratchpad, d->memory, SIM_SCRATCHPAD ) ;
+}
+
+static void Sim2438_function( struct sim_device * d, BYTE b )
+{
+	BYTE * page0 = d->memory ;
+	UINT page ;
+
+	if ( d->pos == 0 ) {
+		switch ( b ) {
+			case 0x44: // convert T, 13 bit
+				{
+					int raw ;
+					d->temperature = SimWalk( d, d->temperature, .25, Globals.templow, Globals.temphigh ) ;
+					raw = ( (int) floor( d->temperature * 32. ) ) << 3 ;
+					page0[1] = BYTE_MASK( raw ) ;
+					page0[2] = BYTE_MASK( raw >> 8 ) ;
+				}
+				break ;
+			case 0xB4: // convert V, VDD or VAD by the AD bit
+				{
+					int raw ;
+					if ( UT_getbit( page0, 3 ) ) {
+						d->vdd = SimWalk( d, d->vdd, .01, 4.8, 5.2 ) ;
+						raw = (int) floor( d->vdd * 100. + .5 ) ;
+					} else {
+						d->voltage = SimWalk( d, d->voltage, .02, 0., 5. ) ;
+						raw = (int) floor( d->voltage * 100. + .5 ) ;
+					}
+					if ( raw > 0x3FF ) {
+						raw = 0x3FF ;
+					}
+					page0[3] = BYTE_MASK( raw ) ;
+					page0[4] = BYTE_MASK( raw >> 8 ) ;
+				}
+				break ;
+			default:
+				break ;
+		}
+		return ;
+	}
+
+	page = ( d->frame[1] & 0x07 ) * 8 ;
+	switch ( d->frame[0] ) {
+		case 0x4E: // write scratchpad page
+			if ( d->pos >= 2 && d->pos < 10 ) {
+				d->scratchpad[page + d->pos - 2] = b ;
+				if ( page == 0 && d->pos == 2 ) {
+					// configuration takes effect without a copy (OW_set_AD relies on it)
+					page0[0] = ( page0[0] & 0xF0 ) | ( b & 0x0F ) ;
+				}
+			}
+			break ;
+		case 0xBE: // read scratchpad page
+			if ( d->pos == 1 ) {
+				BYTE crc = CRC8compute( &(d->scratchpad[page]), 8, 0 ) ;
+				SimQueue( d, &(d->scratchpad[page]), 8 ) ;
+				SimQueue( d, &crc, 1 ) ;
+			}
+			break ;
+		case 0x48: // copy scratchpad page
+			if ( d->pos == 1 ) {
+				if ( page == 0 ) {
+					// measurements are read-only
+					page0[0] = ( page0[0] & 0xF0 ) | ( d->scratchpad[0] & 0x0F ) ;
+					page0[7] = d->scratchpad[7] ;
+				} else {
+					memcpy( &(d->memory[page]), &(d->scratchpad[page]), 8 ) ;
+				}
+			}
+			break ;
+		case 0xB8: // recall memory page
+			if ( d->pos == 1 ) {
+				memcpy( &(d->scratchpad[page]), &(d->memory[page]), 8 ) ;
+			}
+			break ;
+		default:
+			break ;
+	}
+}
+
+/* ---------------------------------------------- */
+/* DS2408 (see ow_2408.c)                         */
+/* ---------------------------------------------- */
+/* memory holds registers 0x88 to 0x8F */
+#define SIM2408_STATE     0
+#define SIM2408_LATCH     1
+#define SIM2408_ACTIVITY  2
+#define SIM2408_MASK      3
+#define SIM2408_POLARITY  4
+#define SIM2408_CONTROL   5
+
+static void Sim2408_setup( struct sim_device * d )
+{
+	BYTE * reg = d->memory ;
+
+	reg[SIM2408_STATE] = 0xFF ;	// pulled up
+	reg[SIM2408_LATCH] = 0xFF ;
+	reg[SIM2408_CONTROL] = 0x88 ; // VCC powered, power-on reset latch
+	reg[6] = reg[7] = 0xFF ;
+}
+
+static void Sim2408_function( struct sim_device * d, BYTE b )
+{
+	BYTE * reg = d->memory ;
+
+	switch ( d->frame[0] ) {
+		case 0xF0: // read PIO registers to 0x8F, then CRC16
+			if ( d->pos == 2 ) {
+				BYTE p[3 + 8] ;
+				UINT address = d->frame[1] | ( d->frame[2] << 8 ) ;
+				int length = 3 ;
+
+				memcpy( p, d->frame, 3 ) ;
+				if ( address < 0x88 ) {
+					address = 0x88 ;
+				}
+				for ( ; address <= 0x8F ; ++address ) {
+					p[length++] = reg[address - 0x88] ;
+				}
+				SimQueue( d, &p[3], length - 3 ) ;
+				SimQueueCRC16( d, p, length ) ;
+			}
+			break ;
+		case 0xF5: // channel access read: 32 samples then CRC16, repeated
+			if ( SimQueueEmpty( d ) ) {
+				BYTE p[1 + 32] = { 0xF5, } ;
+				memset( &p[1], reg[SIM2408_STATE], 32 ) ;
+				SimQueue( d, &p[1], 32 ) ;
+				if ( d->pos == 0 ) {
+					SimQueueCRC16( d, p, 33 ) ;
+				} else {
+					SimQueueCRC16( d, &p[1], 32 ) ;
+				}
+			}
+			break ;
+		case 0x5A: // channel access write: data, inverse, then 0xAA and the new state
+			switch ( ( d->pos - 1 ) % 4 ) {
+				case 0:
+					d->address = b ;
+					break ;
+				case 1:
+					if ( b == BYTE_INVERSE( d->address ) ) {
+						BYTE p[2] = { 0xAA, } ;
+						BYTE old = reg[SIM2408_STATE] ;
+						reg[SIM2408_LATCH] = reg[SIM2408_STATE] = BYTE_MASK( d->address ) ;
+						reg[SIM2408_ACTIVITY] |= old ^ reg[SIM2408_STATE] ;
+						p[1] = reg[SIM2408_STATE] ;
+						SimQueue( d, p, 2 ) ;
+					} else {
+						d->frame[0] = 0x00 ; // ignore until reset
+					}
+					break ;
+				default:
+					break ;
+			}
+			break ;
+		case 0xCC: // write conditional search registers 0x8B to 0x8D
+			if ( d->pos >= 3 ) {
+				UINT address = ( d->frame[1] | ( d->frame[2] << 8 ) ) + d->pos - 3 ;
+				switch ( address ) {
+					case 0x8B:
+						reg[SIM2408_MASK] = b ;
+						break ;
+					case 0x8C:
+						reg[SIM2408_POLARITY] = b ;
+						break ;
+					case 0x8D:
+						// PLS CT ROS writable, PORL only cleared
+						reg[SIM2408_CONTROL] = ( reg[SIM2408_CONTROL] & 0xF0 ) | ( b & 0x07 ) | ( b & reg[SIM2408_CONTROL] & 0x08 ) ;
+						break ;
+					default:
+						break ;
+				}
+			}
+			break ;
+		case 0xC3: // reset activity latches, then 0xAA forever
+			if ( d->pos == 0 ) {
+				reg[SIM2408_ACTIVITY] = 0x00 ;
+			}
+			if ( SimQueueEmpty( d ) ) {
+				BYTE aa = 0xAA ;
+				SimQueue( d, &aa, 1 ) ;
+			}
+			break ;
+		default:
+			break ;
+	}
+}
+
+static int Sim2408_alarm( struct sim_device * d )
+{
+	BYTE * reg = d->memory ;
+	BYTE control = reg[SIM2408_CONTROL] ;
+	BYTE source = ( control & 0x01 ) ? reg[SIM2408_ACTIVITY] : reg[SIM2408_STATE] ;
+	BYTE match = BYTE_INVERSE( source ^ reg[SIM2408_POLARITY] ) & reg[SIM2408_MASK] ;
+
+	if ( reg[SIM2408_MASK] == 0 ) {
+		return 0 ;
+	}
+	return ( control & 0x02 ) ? ( match == reg[SIM2408_MASK] ) : ( match != 0 ) ;
+}
+
+/* ---------------------------------------------- */
+/* DS2433 (see ow_2433.c)                         */
+/* ---------------------------------------------- */
+/* 512 byte EEPROM in 32 byte pages, one page of scratchpad */
+/* address is TA, es is E/S (ending offset, AA flag) */
+
+static void Sim2433_function( struct sim_device * d, BYTE b )
+{
+	switch ( d->frame[0] ) {
+		case 0x0F: // write scratchpad, CRC16 when the page end is reached
+			if ( d->pos == 2 ) {
+				d->address = ( d->frame[1] | ( d->frame[2] << 8 ) ) & 0x1FF ;
+				d->es = d->address & 0x1F ;
+			} else if ( d->pos > 2 ) {
+				UINT offset = ( d->address & 0x1F ) + d->pos - 3 ;
+				if ( offset < 32 ) {
+					d->scratchpad[offset] = b ;
+					d->es = offset ;
+					if ( offset == 31 ) {
+						SimQueueCRC16( d, d->frame, d->pos + 1 ) ;
+					}
+				}
+			}
+			break ;
+		case 0xAA: // read scratchpad: TA1 TA2 E/S data
+			if ( d->pos == 0 ) {
+				BYTE p[3] = { LOW_HIGH_ADDRESS( d->address ), d->es, } ;
+				UINT start = d->address & 0x1F ;
+				UINT end = d->es & 0x1F ;
+				SimQueue( d, p, 3 ) ;
+				if ( end >= start ) {
+					SimQueue( d, &(d->scratchpad[start]), end - start + 1 ) ;
+				}
+			}
+			break ;
+		case 0x55: // copy scratchpad, authorized by TA1 TA2 E/S
+			if ( d->pos == 3 ) {
+				if ( d->frame[1] == BYTE_MASK( d->address ) && d->frame[2] == BYTE_MASK( d->address >> 8 ) && d->frame[3] == d->es ) {
+					UINT start = d->address & 0x1F ;
+					UINT end = d->es & 0x1F ;
+					BYTE done = 0xAA ;
+					if ( end >= start ) {
+						memcpy( &(d->memory[d->address]), &(d->scratchpad[start]), end - start + 1 ) ;
+					}
+					d->es |= 0x80 ;
+					SimQueue( d, &done, 1 ) ;
+				}
+			}
+			break ;
+		case 0xF0: // read memory to the end
+			if ( d->pos == 2 ) {
+				UINT address = d->frame[1] | ( d->frame[2] << 8 ) ;
+				if ( address < SIM_MEMORY ) {
+					SimQueue( d, &(d->memory[address]), SIM_MEMORY - address ) ;
+				}
+			}
+			break ;
+		default:
+			break ;
+	}
+}
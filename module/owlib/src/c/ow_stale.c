@@ -0,0 +1,321 @@
+/*
+    OWFS -- One-Wire filesystem
+    OWHTTPD -- One-Wire Web Server
+    Written 2003 Paul H Alfille
+    email: paul.alfille@gmail.com
+    Released under the GPL
+    See the header file: ow.h for full attribution
+    1wire/iButton system from Dallas Semiconductor
+*/
+
+/* Stale-while-revalidate
+ * --stale=GLOB[,SECONDS] gives matching properties a grace window after
+ * their cached value expires. The glob is matched against "/device/property"
+ * the same way as --poll (e.g. "/28.*\/temperature").
+ *
+ * A request that allows it (the STALE_OK control flag, or ?stale in owhttpd)
+ * gets an expired value still inside the window at once, marked STALE_SERVED,
+ * and the property is queued to be read again in the background.
+ * A property is only queued once until its refresh is done. Properties read
+ * through a sibling (e.g. DS18B20 temperature) pass the window on to it.
+ *
+ * Statistics are in /statistics/cache/stale
+ * */
+
+#include <config.h>
+#include "owfs_config.h"
+#include "ow.h"
+#include "ow_counters.h"
+#include <fnmatch.h>
+
+/* Refreshes waiting (or being read) at once, more are dropped */
+#define STALE_QUEUE_MAX    256
+
+struct stale_rule {
+	struct stale_rule * next ;
+	char * pattern ;			// glob for "/device/property"
+	int grace ;					// seconds past expiry, 0 for timeout_volatile
+};
+
+struct stale_refresh {
+	struct stale_refresh * next ;
+	BYTE sn[SERIAL_NUMBER_SIZE] ;	// cache key
+	const struct filetype * ft ;
+	int extension ;
+	char * path ;				// as the client asked for it
+};
+
+static struct {
+	struct stale_rule * head ;
+	struct stale_rule * tail ;
+	struct stale_refresh * queue_head ;	// the first is being read
+	struct stale_refresh * queue_tail ;
+	int queued ;
+	pthread_mutex_t mutex ;
+	pthread_cond_t cond ;
+	pthread_t thread ;
+	int started ;
+	int stopping ;
+} stale_control ;
+
+static void * Stale_Thread( void * v ) ;
+static int Stale_Rule_Grace( const struct stale_rule * rule ) ;
+
+/* ------- Configuration ------------ */
+
+/* --stale=GLOB[,SECONDS]
+ * Called during option parsing (single threaded) */
+GOOD_OR_BAD Stale_Add( const char * arg )
+{
+	struct stale_rule * rule ;
+	char * comma ;
+
+	if ( arg == NULL || arg[0] == '\0' ) {
+		LEVEL_DEFAULT("No path pattern given for stale values") ;
+		return gbBAD ;
+	}
+
+	rule = owcalloc( 1, sizeof(struct stale_rule) ) ;
+	if ( rule == NULL ) {
+		return gbBAD ;
+	}
+	rule->pattern = owstrdup( arg ) ;
+	if ( rule->pattern == NULL ) {
+		owfree( rule ) ;
+		return gbBAD ;
+	}
+
+	comma = strrchr( rule->pattern, ',' ) ;
+	if ( comma != NULL ) {
+		char * end ;
+		long int seconds ;
+		comma[0] = '\0' ;
+		errno = 0 ;
+		seconds = strtol( &comma[1], &end, 10 ) ;
+		if ( errno != 0 || end == &comma[1] || end[0] != '\0' || seconds < 0 ) {
+			LEVEL_DEFAULT("Bad stale window in %s", arg) ;
+			owfree( rule->pattern ) ;
+			owfree( rule ) ;
+			return gbBAD ;
+		}
+		rule->grace = (int) seconds ;
+	}
+
+	if ( stale_control.tail == NULL ) {
+		_MUTEX_INIT( stale_control.mutex ) ;
+		my_pthread_cond_init( &(stale_control.cond), NULL ) ;
+		stale_control.head = rule ;
+	} else {
+		stale_control.tail->next = rule ;
+	}
+	stale_control.tail = rule ;
+
+	LEVEL_DEBUG("Stale values of %s served up to %d seconds", rule->pattern, Stale_Rule_Grace( rule ) ) ;
+	return gbGOOD ;
+}
+
+static int Stale_Rule_Grace( const struct stale_rule * rule )
+{
+	return rule->grace > 0 ? rule->grace : Globals.timeout_volatile ;
+}
+
+/* Longest window of any rule -- the cache keeps expired values this long */
+time_t Stale_Grace_Max( void )
+{
+	struct stale_rule * rule ;
+	int grace = 0 ;
+
+	for ( rule = stale_control.head ; rule != NULL ; rule = rule->next ) {
+		if ( Stale_Rule_Grace( rule ) > grace ) {
+			grace = Stale_Rule_Grace( rule ) ;
+		}
+	}
+	return grace ;
+}
+
+/* Seconds past expiry a value may be served for this request, 0 for none */
+time_t Stale_Grace( const struct parsedname * pn )
+{
+	ASCII path[PATH_MAX] ;
+	const struct filetype * ft = pn->selected_filetype ;
+	struct stale_rule * rule ;
+	int length ;
+
+	if ( stale_control.head == NULL || ( pn->control_flags & STALE_OK ) == 0 ) {
+		return 0 ;
+	}
+	if ( pn->selected_device == NO_DEVICE || ft == NO_FILETYPE || ! IsRealDir( pn ) ) {
+		return 0 ;
+	}
+	if ( pn->stale_grace > 0 ) {
+		// read for a linked property that matched (e.g. temperature -> temperature12)
+		return pn->stale_grace ;
+	}
+
+	// "/device/property" with the device in the plain FF.IIIIIIIIIIII form, as --poll uses
+	UCLIBCLOCK;
+		length = snprintf( path, PATH_MAX, "/%02X.%02X%02X%02X%02X%02X%02X/%s", pn->sn[0], pn->sn[1], pn->sn[2], pn->sn[3], pn->sn[4], pn->sn[5], pn->sn[6], ft->name ) ;
+		if ( length > 0 && length < PATH_MAX && ft->ag != NON_AGGREGATE ) {
+			if ( pn->extension == EXTENSION_BYTE ) {
+				snprintf( &path[length], PATH_MAX - length, ".BYTE" ) ;
+			} else if ( pn->extension == EXTENSION_ALL ) {
+				snprintf( &path[length], PATH_MAX - length, ".ALL" ) ;
+			} else if ( ft->ag->letters == ag_letters ) {
+				snprintf( &path[length], PATH_MAX - length, ".%c", 'A' + pn->extension ) ;
+			} else {
+				snprintf( &path[length], PATH_MAX - length, ".%d", pn->extension ) ;
+			}
+		}
+	UCLIBCUNLOCK;
+
+	// the leading slash is optional
+	for ( rule = stale_control.head ; rule != NULL ; rule = rule->next ) {
+		if ( fnmatch( rule->pattern, ( rule->pattern[0] == '/' ) ? path : &path[1], FNM_PATHNAME ) == 0 ) {
+			return Stale_Rule_Grace( rule ) ;
+		}
+	}
+	return 0 ;
+}
+
+/* ------- Refresh ------------ */
+
+/* A stale value was just served -- read the property again in the background
+ * unless it's already waiting */
+void Stale_Refresh( const struct parsedname * pn )
+{
+	struct stale_refresh * refresh ;
+
+	STAT_ADD1( cache_stale_served ) ;
+
+	_MUTEX_LOCK( stale_control.mutex ) ;
+	if ( stale_control.stopping ) {
+		_MUTEX_UNLOCK( stale_control.mutex ) ;
+		return ;
+	}
+	for ( refresh = stale_control.queue_head ; refresh != NULL ; refresh = refresh->next ) {
+		if ( refresh->ft == pn->selected_filetype && refresh->extension == pn->extension && memcmp( refresh->sn, pn->sn, SERIAL_NUMBER_SIZE ) == 0 ) {
+			// already on its way
+			_MUTEX_UNLOCK( stale_control.mutex ) ;
+			return ;
+		}
+	}
+	if ( stale_control.queued >= STALE_QUEUE_MAX ) {
+		_MUTEX_UNLOCK( stale_control.mutex ) ;
+		STAT_ADD1( cache_stale_dropped ) ;
+		return ;
+	}
+
+	refresh = owcalloc( 1, sizeof(struct stale_refresh) ) ;
+	if ( refresh != NULL ) {
+		refresh->path = owstrdup( pn->path ) ;
+	}
+	if ( refresh == NULL || refresh->path == NULL ) {
+		_MUTEX_UNLOCK( stale_control.mutex ) ;
+		SAFEFREE( refresh ) ;
+		STAT_ADD1( cache_stale_dropped ) ;
+		return ;
+	}
+	memcpy( refresh->sn, pn->sn, SERIAL_NUMBER_SIZE ) ;
+	refresh->ft = pn->selected_filetype ;
+	refresh->extension = pn->extension ;
+
+	// started on first use, so owfs is already in the background
+	if ( ! stale_control.started ) {
+		if ( pthread_create( &(stale_control.thread), DEFAULT_THREAD_ATTR, Stale_Thread, NULL ) != 0 ) {
+			_MUTEX_UNLOCK( stale_control.mutex ) ;
+			LEVEL_DEBUG("Cannot create stale refresh thread") ;
+			owfree( refresh->path ) ;
+			owfree( refresh ) ;
+			STAT_ADD1( cache_stale_dropped ) ;
+			return ;
+		}
+		stale_control.started = 1 ;
+	}
+
+	if ( stale_control.queue_tail == NULL ) {
+		stale_control.queue_head = refresh ;
+	} else {
+		stale_control.queue_tail->next = refresh ;
+	}
+	stale_control.queue_tail = refresh ;
+	++stale_control.queued ;
+	my_pthread_cond_signal( &(stale_control.cond) ) ;
+	_MUTEX_UNLOCK( stale_control.mutex ) ;
+}
+
+/* Reads each queued property, which puts the new value in the cache */
+static void * Stale_Thread( void * v )
+{
+	(void) v ;
+
+	_MUTEX_LOCK( stale_control.mutex ) ;
+	while ( ! stale_control.stopping ) {
+		struct stale_refresh * refresh = stale_control.queue_head ;
+		struct one_wire_query * owq ;
+		SIZE_OR_ERROR read_or_error = -ENOENT ;
+
+		if ( refresh == NULL ) {
+			my_pthread_cond_wait( &(stale_control.cond), &(stale_control.mutex) ) ;
+			continue ;
+		}
+		_MUTEX_UNLOCK( stale_control.mutex ) ;
+
+		// a plain request, so the expired value isn't good enough
+		owq = OWQ_create_from_path( refresh->path ) ; // for read
+		if ( owq != NULL ) {
+			PN(owq)->control_flags &= ~STALE_OK ;
+			if ( GOOD( OWQ_allocate_read_buffer( owq ) ) ) {
+				read_or_error = FS_read_postparse( owq ) ;
+			}
+			OWQ_destroy( owq ) ;
+		}
+		if ( read_or_error < 0 ) {
+			LEVEL_DEBUG("Stale refresh of %s failed", refresh->path) ;
+			STAT_ADD1( cache_stale_errors ) ;
+		} else {
+			STAT_ADD1( cache_stale_refreshed ) ;
+		}
+
+		// only now can the same property be queued again
+		_MUTEX_LOCK( stale_control.mutex ) ;
+		stale_control.queue_head = refresh->next ;
+		if ( stale_control.queue_head == NULL ) {
+			stale_control.queue_tail = NULL ;
+		}
+		--stale_control.queued ;
+		owfree( refresh->path ) ;
+		owfree( refresh ) ;
+	}
+	_MUTEX_UNLOCK( stale_control.mutex ) ;
+	return VOID_RETURN ;
+}
+
+/* End the refresh thread and drop waiting refreshes */
+void Stale_Stop( void )
+{
+	if ( stale_control.head == NULL ) {
+		return ;
+	}
+
+	_MUTEX_LOCK( stale_control.mutex ) ;
+	stale_control.stopping = 1 ;
+	my_pthread_cond_broadcast( &(stale_control.cond) ) ;
+	_MUTEX_UNLOCK( stale_control.mutex ) ;
+
+	if ( stale_control.started ) {
+		pthread_join( stale_control.thread, NULL ) ;
+		stale_control.started = 0 ;
+	}
+
+	_MUTEX_LOCK( stale_control.mutex ) ;
+	while ( stale_control.queue_head != NULL ) {
+		struct stale_refresh * refresh = stale_control.queue_head ;
+		stale_control.queue_head = refresh->next ;
+		owfree( refresh->path ) ;
+		owfree( refresh ) ;
+	}
+	stale_control.queue_tail = NULL ;
+	stale_control.queued = 0 ;
+	stale_control.stopping = 0 ;
+	_MUTEX_UNLOCK( stale_control.mutex ) ;
+}
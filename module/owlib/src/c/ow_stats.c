@@ -51,6 +51,13 @@
 /* ----------------- */
 UINT cache_flips = 0;
 UINT cache_adds = 0;
+UINT cache_evictions = 0;
+UINT cache_reaped = 0;
+UINT cache_flip_max = 0;
+UINT cache_stale_served = 0;
+UINT cache_stale_refreshed = 0;
+UINT cache_stale_errors = 0;
+UINT cache_stale_dropped = 0;
 struct average old_avg = { 0L, 0L, 0L, 0L, };
 struct average new_avg = { 0L, 0L, 0L, 0L, };
 struct average store_avg = { 0L, 0L, 0L, 0L, };
@@ -60,6 +67,13 @@ struct cache_stats cache_dir = { 0L, 0L, 0L, 0L, 0L, };
 struct cache_stats cache_pst = { 0L, 0L, 0L, 0L, 0L, };
 struct cache_stats cache_dev = { 0L, 0L, 0L, 0L, 0L, };
 
+UINT parse_cache_hits = 0;
+UINT parse_cache_misses = 0;
+UINT parse_cache_adds = 0;
+UINT parse_cache_evictions = 0;
+UINT parse_cache_flushes = 0;
+UINT parse_cache_device_flushes = 0;
+
 UINT read_calls = 0;
 UINT read_cache = 0;
 UINT read_bytes = 0;
@@ -67,6 +81,7 @@ UINT read_cachebytes = 0;
 UINT read_array = 0;
 UINT read_tries[3] = { 0, 0, 0, };
 UINT read_success = 0;
+UINT read_coalesced = 0;
 struct average read_avg = { 0L, 0L, 0L, 0L, };
 
 UINT write_calls = 0;
@@ -78,6 +93,10 @@ struct average write_avg = { 0L, 0L, 0L, 0L, };
 
 struct directory dir_main = { 0L, 0L, };
 struct directory dir_dev = { 0L, 0L, };
+UINT dir_verified = 0;
+UINT dir_verify_failures = 0;
+UINT dir_arrivals = 0;
+UINT dir_departures = 0;
 UINT dir_depth = 0;
 struct average dir_avg = { 0L, 0L, 0L, 0L, };
 
@@ -99,6 +118,11 @@ UINT NET_accept_errors = 0;
 UINT NET_connection_errors = 0;
 UINT NET_read_errors = 0;
 
+// ow_server_message.c
+UINT server_pool_hits = 0;
+UINT server_pool_misses = 0;
+UINT server_pool_reconnects = 0;
+
 // ow_bus.c
 UINT BUS_send_data_errors = 0;
 UINT BUS_send_data_memcmp_errors = 0;
@@ -127,11 +151,24 @@ struct average all_avg = { 0L, 0L, 0L, 0L, };
 READ_FUNCTION(FS_stat);
 READ_FUNCTION(FS_time);
 READ_FUNCTION(FS_return_code);
+READ_FUNCTION(FS_latency);
+READ_FUNCTION(FS_latency_dump);
+READ_FUNCTION(FS_detect_startup);
+READ_FUNCTION(FS_detect_buses);
 
 /* -------- Structures ---------- */
 static struct filetype stats_cache[] = {
 	{"flips", PROPERTY_LENGTH_UNSIGNED, NON_AGGREGATE, ft_unsigned, fc_statistic, FS_stat, NO_WRITE_FUNCTION, VISIBLE, {.v=&cache_flips}, },
 	{"additions", PROPERTY_LENGTH_UNSIGNED, NON_AGGREGATE, ft_unsigned, fc_statistic, FS_stat, NO_WRITE_FUNCTION, VISIBLE, {.v=&cache_adds}, },
+	{"evictions", PROPERTY_LENGTH_UNSIGNED, NON_AGGREGATE, ft_unsigned, fc_statistic, FS_stat, NO_WRITE_FUNCTION, VISIBLE, {.v=&cache_evictions}, },
+	{"reaped", PROPERTY_LENGTH_UNSIGNED, NON_AGGREGATE, ft_unsigned, fc_statistic, FS_stat, NO_WRITE_FUNCTION, VISIBLE, {.v=&cache_reaped}, },
+	{"flip_max_usec", PROPERTY_LENGTH_UNSIGNED, NON_AGGREGATE, ft_unsigned, fc_statistic, FS_stat, NO_WRITE_FUNCTION, VISIBLE, {.v=&cache_flip_max}, },
+
+	{"stale", PROPERTY_LENGTH_SUBDIR, NON_AGGREGATE, ft_subdir, fc_subdir, NO_READ_FUNCTION, NO_WRITE_FUNCTION, VISIBLE, NO_FILETYPE_DATA, },
+	{"stale/served", PROPERTY_LENGTH_UNSIGNED, NON_AGGREGATE, ft_unsigned, fc_statistic, FS_stat, NO_WRITE_FUNCTION, VISIBLE, {.v=&cache_stale_served}, },
+	{"stale/refreshed", PROPERTY_LENGTH_UNSIGNED, NON_AGGREGATE, ft_unsigned, fc_statistic, FS_stat, NO_WRITE_FUNCTION, VISIBLE, {.v=&cache_stale_refreshed}, },
+	{"stale/refresh_errors", PROPERTY_LENGTH_UNSIGNED, NON_AGGREGATE, ft_unsigned, fc_statistic, FS_stat, NO_WRITE_FUNCTION, VISIBLE, {.v=&cache_stale_errors}, },
+	{"stale/dropped", PROPERTY_LENGTH_UNSIGNED, NON_AGGREGATE, ft_unsigned, fc_statistic, FS_stat, NO_WRITE_FUNCTION, VISIBLE, {.v=&cache_stale_dropped}, },
 
 	{"primary", PROPERTY_LENGTH_SUBDIR, NON_AGGREGATE, ft_subdir, fc_subdir, NO_READ_FUNCTION, NO_WRITE_FUNCTION, VISIBLE, NO_FILETYPE_DATA, },
 	{"primary/now", PROPERTY_LENGTH_UNSIGNED, NON_AGGREGATE, ft_unsigned, fc_statistic, FS_stat, NO_WRITE_FUNCTION, VISIBLE, {.v=&new_avg.current}, },
@@ -178,6 +215,14 @@ static struct filetype stats_cache[] = {
 	{"device/added", PROPERTY_LENGTH_UNSIGNED, NON_AGGREGATE, ft_unsigned, fc_statistic, FS_stat, NO_WRITE_FUNCTION, VISIBLE, {.v=&cache_dev.adds}, },
 	{"device/expired", PROPERTY_LENGTH_UNSIGNED, NON_AGGREGATE, ft_unsigned, fc_statistic, FS_stat, NO_WRITE_FUNCTION, VISIBLE, {.v=&cache_dev.expires,}, },
 	{"device/deleted", PROPERTY_LENGTH_UNSIGNED, NON_AGGREGATE, ft_unsigned, fc_statistic, FS_stat, NO_WRITE_FUNCTION, VISIBLE, {.v=&cache_dev.deletes,}, },
+
+	{"parse", PROPERTY_LENGTH_SUBDIR, NON_AGGREGATE, ft_subdir, fc_subdir, NO_READ_FUNCTION, NO_WRITE_FUNCTION, VISIBLE, NO_FILETYPE_DATA, },
+	{"parse/hits", PROPERTY_LENGTH_UNSIGNED, NON_AGGREGATE, ft_unsigned, fc_statistic, FS_stat, NO_WRITE_FUNCTION, VISIBLE, {.v=&parse_cache_hits}, },
+	{"parse/misses", PROPERTY_LENGTH_UNSIGNED, NON_AGGREGATE, ft_unsigned, fc_statistic, FS_stat, NO_WRITE_FUNCTION, VISIBLE, {.v=&parse_cache_misses}, },
+	{"parse/added", PROPERTY_LENGTH_UNSIGNED, NON_AGGREGATE, ft_unsigned, fc_statistic, FS_stat, NO_WRITE_FUNCTION, VISIBLE, {.v=&parse_cache_adds}, },
+	{"parse/evictions", PROPERTY_LENGTH_UNSIGNED, NON_AGGREGATE, ft_unsigned, fc_statistic, FS_stat, NO_WRITE_FUNCTION, VISIBLE, {.v=&parse_cache_evictions}, },
+	{"parse/flushes", PROPERTY_LENGTH_UNSIGNED, NON_AGGREGATE, ft_unsigned, fc_statistic, FS_stat, NO_WRITE_FUNCTION, VISIBLE, {.v=&parse_cache_flushes}, },
+	{"parse/device_flushes", PROPERTY_LENGTH_UNSIGNED, NON_AGGREGATE, ft_unsigned, fc_statistic, FS_stat, NO_WRITE_FUNCTION, VISIBLE, {.v=&parse_cache_device_flushes}, },
 };
 
 struct device d_stats_cache = { "cache", "cache", 0, COUNT_OF_FILETYPES(stats_cache), stats_cache, NO_GENERIC_READ, NO_GENERIC_WRITE };
@@ -192,6 +237,7 @@ static struct filetype stats_read[] = {
 	{"success", PROPERTY_LENGTH_UNSIGNED, NON_AGGREGATE, ft_unsigned, fc_statistic, FS_stat, NO_WRITE_FUNCTION, VISIBLE, {.v=&read_success}, },
 	{"bytes", PROPERTY_LENGTH_UNSIGNED, NON_AGGREGATE, ft_unsigned, fc_statistic, FS_stat, NO_WRITE_FUNCTION, VISIBLE, {.v=&read_bytes}, },
 	{"tries", PROPERTY_LENGTH_UNSIGNED, &Aread, ft_unsigned, fc_statistic, FS_stat, NO_WRITE_FUNCTION, VISIBLE, {.v=&read_tries}, },
+	{"coalesced", PROPERTY_LENGTH_UNSIGNED, NON_AGGREGATE, ft_unsigned, fc_statistic, FS_stat, NO_WRITE_FUNCTION, VISIBLE, {.v=&read_coalesced}, },
 };
 
 struct device d_stats_read = { "read", "read", 0, COUNT_OF_FILETYPES(stats_read), stats_read, NO_GENERIC_READ, NO_GENERIC_WRITE };
@@ -211,6 +257,10 @@ static struct filetype stats_directory[] = {
 	{"bus", PROPERTY_LENGTH_SUBDIR, NON_AGGREGATE, ft_subdir, fc_subdir, NO_READ_FUNCTION, NO_WRITE_FUNCTION, VISIBLE, NO_FILETYPE_DATA, },
 	{"bus/calls", PROPERTY_LENGTH_UNSIGNED, NON_AGGREGATE, ft_unsigned, fc_statistic, FS_stat, NO_WRITE_FUNCTION, VISIBLE, {.v=&dir_main.calls}, },
 	{"bus/entries", PROPERTY_LENGTH_UNSIGNED, NON_AGGREGATE, ft_unsigned, fc_statistic, FS_stat, NO_WRITE_FUNCTION, VISIBLE, {.v=&dir_main.entries}, },
+	{"bus/verified", PROPERTY_LENGTH_UNSIGNED, NON_AGGREGATE, ft_unsigned, fc_statistic, FS_stat, NO_WRITE_FUNCTION, VISIBLE, {.v=&dir_verified}, },
+	{"bus/verify_failures", PROPERTY_LENGTH_UNSIGNED, NON_AGGREGATE, ft_unsigned, fc_statistic, FS_stat, NO_WRITE_FUNCTION, VISIBLE, {.v=&dir_verify_failures}, },
+	{"bus/arrivals", PROPERTY_LENGTH_UNSIGNED, NON_AGGREGATE, ft_unsigned, fc_statistic, FS_stat, NO_WRITE_FUNCTION, VISIBLE, {.v=&dir_arrivals}, },
+	{"bus/departures", PROPERTY_LENGTH_UNSIGNED, NON_AGGREGATE, ft_unsigned, fc_statistic, FS_stat, NO_WRITE_FUNCTION, VISIBLE, {.v=&dir_departures}, },
 
 	{"device", PROPERTY_LENGTH_SUBDIR, NON_AGGREGATE, ft_subdir, fc_subdir, NO_READ_FUNCTION, NO_WRITE_FUNCTION, VISIBLE, NO_FILETYPE_DATA, },
 	{"device/calls", PROPERTY_LENGTH_UNSIGNED, NON_AGGREGATE, ft_unsigned, fc_statistic, FS_stat, NO_WRITE_FUNCTION, VISIBLE, {.v=&dir_dev.calls}, },
@@ -261,6 +311,34 @@ struct device d_stats_return_code = { "return_codes", "return_codes", 0, COUNT_O
 	stats_return_code, NO_GENERIC_READ, NO_GENERIC_WRITE
 };
 
+static struct filetype stats_server[] = {
+	{"pool", PROPERTY_LENGTH_SUBDIR, NON_AGGREGATE, ft_subdir, fc_subdir, NO_READ_FUNCTION, NO_WRITE_FUNCTION, VISIBLE, NO_FILETYPE_DATA, },
+	{"pool/hits", PROPERTY_LENGTH_UNSIGNED, NON_AGGREGATE, ft_unsigned, fc_statistic, FS_stat, NO_WRITE_FUNCTION, VISIBLE, {.v=&server_pool_hits}, },
+	{"pool/misses", PROPERTY_LENGTH_UNSIGNED, NON_AGGREGATE, ft_unsigned, fc_statistic, FS_stat, NO_WRITE_FUNCTION, VISIBLE, {.v=&server_pool_misses}, },
+	{"pool/reconnects", PROPERTY_LENGTH_UNSIGNED, NON_AGGREGATE, ft_unsigned, fc_statistic, FS_stat, NO_WRITE_FUNCTION, VISIBLE, {.v=&server_pool_reconnects}, },
+};
+
+struct device d_stats_server = { "server", "server", 0, COUNT_OF_FILETYPES(stats_server), stats_server, NO_GENERIC_READ, NO_GENERIC_WRITE };
+
+/* Whole program histograms as "count= p50= p90= p99= p999= max=" (microseconds), dump has every key and bucket */
+static struct filetype stats_latency[] = {
+	{"read", 128, NON_AGGREGATE, ft_vascii, fc_statistic, FS_latency, NO_WRITE_FUNCTION, VISIBLE, {.i=e_latency_read}, },
+	{"lock_wait", 128, NON_AGGREGATE, ft_vascii, fc_statistic, FS_latency, NO_WRITE_FUNCTION, VISIBLE, {.i=e_latency_lock_wait}, },
+	{"lock_held", 128, NON_AGGREGATE, ft_vascii, fc_statistic, FS_latency, NO_WRITE_FUNCTION, VISIBLE, {.i=e_latency_lock_held}, },
+	{"cache", 128, NON_AGGREGATE, ft_vascii, fc_statistic, FS_latency, NO_WRITE_FUNCTION, VISIBLE, {.i=e_latency_cache}, },
+	{"dump", 65536, NON_AGGREGATE, ft_vascii, fc_statistic, FS_latency_dump, NO_WRITE_FUNCTION, VISIBLE, NO_FILETYPE_DATA, },
+};
+
+struct device d_stats_latency = { "latency", "latency", 0, COUNT_OF_FILETYPES(stats_latency), stats_latency, NO_GENERIC_READ, NO_GENERIC_WRITE };
+
+/* Bus master detection: msec before serving started, and a line per configured adapter */
+static struct filetype stats_detect[] = {
+	{"startup", PROPERTY_LENGTH_UNSIGNED, NON_AGGREGATE, ft_unsigned, fc_statistic, FS_detect_startup, NO_WRITE_FUNCTION, VISIBLE, NO_FILETYPE_DATA, },
+	{"buses", 16384, NON_AGGREGATE, ft_vascii, fc_statistic, FS_detect_buses, NO_WRITE_FUNCTION, VISIBLE, NO_FILETYPE_DATA, },
+};
+
+struct device d_stats_detect = { "detect", "detect", 0, COUNT_OF_FILETYPES(stats_detect), stats_detect, NO_GENERIC_READ, NO_GENERIC_WRITE };
+
 #define FS_stat_ROW(var) {"" #var "",PROPERTY_LENGTH_UNSIGNED, NON_AGGREGATE  , ft_unsigned, fc_statistic,   FS_stat, NO_WRITE_FUNCTION, VISIBLE, {.v= & var,}, }
 
 static struct filetype stats_errors[] = {
@@ -324,9 +402,7 @@ static ZERO_OR_ERROR FS_stat(struct one_wire_query *owq)
 	if (pn->selected_filetype->data.v == NULL) {
 		return -ENOENT;
 	}
-	STATLOCK;
-	OWQ_U(owq) = ((UINT *) pn->selected_filetype->data.v)[dindex];
-	STATUNLOCK;
+	OWQ_U(owq) = STAT_GET( ((UINT *) pn->selected_filetype->data.v)[dindex] );
 	return 0;
 }
 
@@ -357,3 +433,40 @@ static ZERO_OR_ERROR FS_return_code( struct one_wire_query * owq)
 	OWQ_U(owq) = return_code_calls[PN(owq)->extension] ;
 	return 0 ;
 }
+
+static ZERO_OR_ERROR FS_latency( struct one_wire_query * owq)
+{
+	char summary[128] ;
+	Latency_summary( summary, sizeof(summary), &latency_all.h[PN(owq)->selected_filetype->data.i] ) ;
+	return OWQ_format_output_offset_and_size_z( summary, owq ) ;
+}
+
+static ZERO_OR_ERROR FS_latency_dump( struct one_wire_query * owq)
+{
+	struct memblob mb ;
+	ZERO_OR_ERROR z_or_e ;
+
+	MemblobInit( &mb, 4096 ) ;
+	Latency_dump( &mb ) ;
+	z_or_e = OWQ_format_output_offset_and_size( (const char *) MemblobData( &mb ), MemblobLength( &mb ), owq ) ;
+	MemblobClear( &mb ) ;
+	return z_or_e ;
+}
+
+static ZERO_OR_ERROR FS_detect_startup( struct one_wire_query * owq)
+{
+	OWQ_U(owq) = Detect_startup_msec() ;
+	return 0 ;
+}
+
+static ZERO_OR_ERROR FS_detect_buses( struct one_wire_query * owq)
+{
+	struct memblob mb ;
+	ZERO_OR_ERROR z_or_e ;
+
+	MemblobInit( &mb, 1024 ) ;
+	Detect_report( &mb ) ;
+	z_or_e = OWQ_format_output_offset_and_size( (const char *) MemblobData( &mb ), MemblobLength( &mb ), owq ) ;
+	MemblobClear( &mb ) ;
+	return z_or_e ;
+}
@@ -28,6 +28,7 @@ struct transaction_bundle {
 	size_t max_size;
 	struct memblob mb;
 	int select_first;
+	int bytes_only;				// ADAP_FLAG_bundle_bytes
 };
 
 // static int BUS_transaction_length( const struct transaction_log * tl, const struct parsedname * pn ) ;
@@ -235,6 +236,7 @@ static void Bundle_init(struct transaction_bundle *tb, const struct parsedname *
 	memset(tb, 0, sizeof(struct transaction_bundle));
 	MemblobInit(&tb->mb, TRANSACTION_INCREMENT);
 	tb->max_size = pn->selected_connection->bundling_length;
+	tb->bytes_only = ( pn->selected_connection->iroutines.flags & ADAP_FLAG_bundle_bytes ) != 0 ;
 }
 
 static GOOD_OR_BAD Bundle_pack(const struct transaction_log *tl, const struct parsedname *pn)
@@ -321,6 +323,9 @@ static GOOD_OR_BAD Pack_item(const struct transaction_log *tl, struct transactio
 	case trxn_read:
 	case trxn_bitread:
 		LEVEL_DEBUG(" pack=READ");
+		if (tb->bytes_only && tl->type == trxn_bitread) {
+			return gbBAD;		// bits done natively
+		}
 		if (tl->size > tb->max_size) {
 			return gbBAD;		// too big for any bundle
 		}
@@ -337,6 +342,9 @@ static GOOD_OR_BAD Pack_item(const struct transaction_log *tl, struct transactio
 	case trxn_bitmodify:			// write data and read response. No match needed
 	case trxn_blind:			// write data and ignore response
 		LEVEL_DEBUG("pack=MATCH MODIFY BLIND");
+		if (tb->bytes_only && (tl->type == trxn_bitmatch || tl->type == trxn_bitmodify)) {
+			return gbBAD;		// bits done natively
+		}
 		if (tl->size > tb->max_size) {
 			return gbBAD;		// too big for any bundle
 		}
@@ -351,6 +359,9 @@ static GOOD_OR_BAD Pack_item(const struct transaction_log *tl, struct transactio
 	case trxn_bitpower:
 	case trxn_program:
 		LEVEL_DEBUG("pack=POWER PROGRAM");
+		if (tb->bytes_only) {
+			return gbBAD;		// strong pullup or pulse done natively
+		}
 		if (1 > tb->max_size) {
 			return gbBAD;		// too big for any bundle
 		}
@@ -371,6 +382,9 @@ static GOOD_OR_BAD Pack_item(const struct transaction_log *tl, struct transactio
 	case trxn_delay:
 	case trxn_udelay:
 		LEVEL_DEBUG("pack=(U)DELAYS");
+		if (tb->bytes_only) {
+			return gbBAD;		// keep the delay between the bytes around it
+		}
 		ret = gbGOOD;
 		break;
 	case trxn_reset:
@@ -180,6 +180,12 @@ void DeviceSort(void)
 	Device2Tree( & d_stats_thread,         ePN_statistics);
 	Device2Tree( & d_stats_write,          ePN_statistics);
 	Device2Tree( & d_stats_return_code,    ePN_statistics);
+	Device2Tree( & d_stats_server,         ePN_statistics);
+	Device2Tree( & d_stats_latency,        ePN_statistics);
+	Device2Tree( & d_stats_detect,         ePN_statistics);
+	if ( Poll_Jobs() > 0 ) {
+		Device2Tree( & d_stats_poll,       ePN_statistics);
+	}
 
 	Device2Tree( & d_set_timeout,          ePN_settings);
 	Device2Tree( & d_set_units,            ePN_settings);
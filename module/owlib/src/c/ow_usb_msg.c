@@ -73,6 +73,7 @@ RESET_TYPE DS9490_getstatus(BYTE * buffer, int * readlen, const struct parsednam
 	int loops = 0;
 	struct connection_in * in = pn->selected_connection ;
 	int transferred ;
+	int no_presence = 0 ;
 	
 	memset(buffer, 0, DS9490_getstatus_BUFFER_LENGTH );		// should not be needed
 
@@ -104,9 +105,16 @@ RESET_TYPE DS9490_getstatus(BYTE * buffer, int * readlen, const struct parsednam
 					LEVEL_DATA("short detected");
 					return BUS_RESET_SHORT;
 				}
+				if (val != ONEWIREDEVICEDETECT && (val & COMMCMDERRORRESULT_NRS)) {
+					no_presence = 1 ;
+				}
 			}
 		}
 
+		if (no_presence && readlen[0] > 0) {
+			break;				/* queued reset found no device, the data will never come */
+		}
+
 		if (readlen[0] < 0) {
 			break;				/* Don't wait for STATUSFLAGS_IDLE if length==-1 */
 		}
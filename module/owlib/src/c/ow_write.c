@@ -96,15 +96,12 @@ SIZE_OR_ERROR FS_write_postparse(struct one_wire_query *owq)
 		return -EISDIR;			// not a file
 	}
 
-	STATLOCK;
 	AVERAGE_IN(&write_avg);
 	AVERAGE_IN(&all_avg);
-	++write_calls;				/* statistics */
-	STATUNLOCK;
+	STAT_ADD1(write_calls);				/* statistics */
 
 	write_or_error = FS_write_post_stats( owq ) ;
 
-	STATLOCK;
 	// write_or_error is still ZERO_OR_ERROR mode
 	if ( write_or_error == 0 ) {
 		LEVEL_DEBUG("Successful write to %s",pn->path) ;
@@ -112,14 +109,13 @@ SIZE_OR_ERROR FS_write_postparse(struct one_wire_query *owq)
 		LEVEL_DEBUG("Error writing to %s",pn->path) ;
 	}
 	if (write_or_error == 0) {
-		++write_success;		/* statistics */
-		write_bytes += OWQ_size(owq);	/* statistics */
+		STAT_ADD1(write_success);		/* statistics */
+		STAT_ADD(write_bytes, OWQ_size(owq));	/* statistics */
 		// write_or_error now SIZE_OR_ERROR mode
 		write_or_error = OWQ_size(owq);	/* here's where the size is used! */
 	}
 	AVERAGE_OUT(&write_avg);
 	AVERAGE_OUT(&all_avg);
-	STATUNLOCK;
 
 	return write_or_error;
 }
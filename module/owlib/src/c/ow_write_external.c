@@ -29,6 +29,8 @@ static ZERO_OR_ERROR OW_write_external_script( struct sensor_node * sensor_n, st
 
 static ZERO_OR_ERROR OW_script_write( FILE * script_f, struct one_wire_query * owq ) ;
 
+static ZERO_OR_ERROR OW_write_external_coprocess( struct sensor_node * sensor_n, struct property_node * property_n, struct one_wire_query * owq ) ;
+
 // ------------------------
 
 
@@ -70,6 +72,8 @@ static ZERO_OR_ERROR OW_trees_for_write( char * device, char * property, struct
 					return -ENOTSUP ;
 				case et_script:
 					return OW_write_external_script( sense_n, property_n, owq ) ;
+				case et_coprocess:
+					return OW_write_external_coprocess( sense_n, property_n, owq ) ;
 				default:
 					return -ENOTSUP ;
 			}
@@ -153,3 +157,37 @@ static ZERO_OR_ERROR OW_script_write( FILE * script_f, struct one_wire_query * o
 	
 	return 0 ;
 }
+
+/* Same arguments as the script, as a request to the long-lived helper with the data attached */
+static ZERO_OR_ERROR OW_write_external_coprocess( struct sensor_node * sensor_n, struct property_node * property_n, struct one_wire_query * owq )
+{
+	char fields[PATH_MAX+1] ;
+	struct parsedname * pn = PN(owq) ;
+	int snp_return ;
+	ZERO_OR_ERROR zoe ;
+
+	if ( pn->sparse_name == NULL ) {
+		snp_return =
+		snprintf( fields, PATH_MAX+1, "%s %s %d %s %d %d %s %s",
+			sensor_n->name, property_n->property, pn->extension, "write",
+			(int) OWQ_size(owq), (int) OWQ_offset(owq), sensor_n->data, property_n->data ) ;
+	} else {
+		snp_return =
+		snprintf( fields, PATH_MAX+1, "%s %s %s %s %d %d %s %s",
+			sensor_n->name, property_n->property, pn->sparse_name, "write",
+			(int) OWQ_size(owq), (int) OWQ_offset(owq), sensor_n->data, property_n->data ) ;
+	}
+
+	if ( snp_return < 0 ) {
+		LEVEL_DEBUG("Problem creating request for %s/%s",sensor_n->name,property_n->property) ;
+		return -EINVAL ;
+	}
+
+	// the buffer still has the text as written
+	zoe = Coprocess_request( property_n->write, fields, (BYTE *) OWQ_buffer(owq), OWQ_size(owq), NULL, NULL ) ;
+	if ( zoe == -ECHILD ) {
+		// helper not running, one-shot instead
+		return OW_write_external_script( sensor_n, property_n, owq ) ;
+	}
+	return zoe ;
+}
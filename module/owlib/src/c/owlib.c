@@ -19,6 +19,56 @@ static void SetupTemperatureLimits( void );
 static void SetupInboundConnections(void);
 static GOOD_OR_BAD SetupSingleInboundConnection( struct port_in * pin ) ;
 
+/* Bus master detection
+ * Adapters reached through a serial port or the network are detected in parallel,
+ * one thread each, since detection can take seconds (or never succeed).
+ * Those ports are taken off the bus list until detected so nothing uses a half-open adapter.
+ * Startup waits up to timeout_detect seconds, then goes on with the buses it has.
+ * Late adapters, and failed ones (retried with backoff), join the list when they come up.
+ * Everything else (in-process, discovery, kernel and usb) is detected in line as before. */
+
+#define DETECT_BACKOFF_MIN	1	// seconds
+#define DETECT_BACKOFF_MAX	64
+
+enum detect_state { detect_running, detect_found, detect_retrying, detect_failed, } ;
+
+struct detect_record {
+	struct detect_record * next ;
+	struct port_in * pin ;		// detecting port (NULL for in line detection)
+	pthread_t thread ;
+	int joinable ;
+	int bus_nr ;
+	char * name ;
+	const char * adapter ;
+	enum detect_state state ;
+	int attempts ;
+	UINT last_msec ;			// most recent attempt
+	UINT total_msec ;			// until detected or given up
+	struct timeval start ;
+} ;
+
+static struct {
+	pthread_mutex_t mutex ;
+	pthread_cond_t cond ;
+	struct detect_record * head ;
+	int started ;
+	int stopping ;
+	int listed ;				// in line pass done, detected ports can be linked
+	int unsettled ;				// threads not yet detected or given up
+	UINT startup_msec ;
+	struct timeval start ;
+} detect_control ;
+
+static struct detect_record * Detect_record( struct port_in * pin ) ;
+static void Detect_settle( struct detect_record * dr, struct port_in * pin, GOOD_OR_BAD result ) ;
+static int Detect_in_parallel( enum bus_mode busmode ) ;
+static void Detect_unlink( struct port_in * pin ) ;
+static void Detect_link( struct port_in * pin ) ;
+static void * Detect_thread( void * v ) ;
+static int Detect_retry_wait( int seconds ) ;
+static void Detect_startup_wait( void ) ;
+static UINT Detect_msec_since( const struct timeval * start ) ;
+
 /* Start the owlib process -- already in background */
 GOOD_OR_BAD LibStart(void* v)
 {
@@ -45,13 +95,23 @@ GOOD_OR_BAD LibStart(void* v)
 	SetupInboundConnections();
 	MONITOR_WUNLOCK ;
 
+	// Warm start from the last run's device locations and directories
+	Cache_Snapshot_Load();
+
 	// Signal handlers
 	IgnoreSignals();
 	
-	if ( Inbound_Control.head_port == NULL ) {
+	if ( Inbound_Control.head_port == NULL && Detect_pending() == 0 ) {
 		LEVEL_DEFAULT("No valid 1-wire buses found");
 		return gbBAD ;
 	}
+
+	// owfs isn't in the background yet (fuse does that), it starts polling in FS_init
+	if ( Globals.program_type != program_type_filesystem ) {
+		Poll_Start() ;
+		Cache_Snapshot_Start() ;
+		Cache_Reaper_Start() ;
+	}
 	return gbGOOD ;
 }
 
@@ -81,14 +141,362 @@ static void SetupInboundConnections(void)
 {
 	struct port_in *pin = Inbound_Control.head_port;
 
+	_MUTEX_INIT( detect_control.mutex ) ;
+	my_pthread_cond_init( &(detect_control.cond), NULL ) ;
+	detect_control.stopping = 0 ;
+	detect_control.listed = 0 ;
+	detect_control.started = 1 ;
+	timernow( &(detect_control.start) ) ;
+
 	// cycle through connections analyzing them
 	while (pin != NULL) {
 		struct port_in * next = pin->next ; // read before potential delete
+		struct detect_record * dr = Detect_record( pin ) ;
+
+		if ( dr != NULL && Detect_in_parallel( pin->busmode ) ) {
+			dr->pin = pin ;
+			_MUTEX_LOCK( detect_control.mutex ) ;
+			++detect_control.unsettled ;
+			_MUTEX_UNLOCK( detect_control.mutex ) ;
+			if ( pthread_create( &(dr->thread), DEFAULT_THREAD_ATTR, Detect_thread, dr ) == 0 ) {
+				dr->joinable = 1 ;
+				Detect_unlink( pin ) ;
+				pin = next ;
+				continue ;
+			}
+			LEVEL_DEBUG("Cannot create a detection thread for %s", SAFESTRING(dr->name)) ;
+			_MUTEX_LOCK( detect_control.mutex ) ;
+			--detect_control.unsettled ;
+			_MUTEX_UNLOCK( detect_control.mutex ) ;
+			dr->pin = NULL ;
+		}
+
+		// in line
 		if ( BAD( SetupSingleInboundConnection(pin) ) ) {				
+			Detect_settle( dr, pin, gbBAD ) ;
 			RemovePort( pin ) ;
+		} else {
+			Detect_settle( dr, pin, gbGOOD ) ;
 		}
 		pin = next ;
 	}
+
+	// the list is no longer walked here, detected ports can be added
+	_MUTEX_LOCK( detect_control.mutex ) ;
+	detect_control.listed = 1 ;
+	my_pthread_cond_broadcast( &(detect_control.cond) ) ;
+	_MUTEX_UNLOCK( detect_control.mutex ) ;
+
+	Detect_startup_wait() ;
+}
+
+/* Keep a record of each port's detection for /statistics/detect */
+static struct detect_record * Detect_record( struct port_in * pin )
+{
+	struct detect_record * dr = owcalloc( 1, sizeof(struct detect_record) ) ;
+	if ( dr == NULL ) {
+		return NULL ;
+	}
+	dr->bus_nr = pin->first->index ;
+	dr->name = owstrdup( SAFESTRING( DEVICENAME( pin->first ) ) ) ;
+	dr->state = detect_running ;
+	timernow( &(dr->start) ) ;
+
+	_MUTEX_LOCK( detect_control.mutex ) ;
+	dr->next = detect_control.head ;
+	detect_control.head = dr ;
+	_MUTEX_UNLOCK( detect_control.mutex ) ;
+	return dr ;
+}
+
+/* Note the outcome of an in line detection (one attempt) */
+static void Detect_settle( struct detect_record * dr, struct port_in * pin, GOOD_OR_BAD result )
+{
+	if ( dr == NULL ) {
+		return ;
+	}
+	_MUTEX_LOCK( detect_control.mutex ) ;
+	dr->attempts = 1 ;
+	dr->last_msec = dr->total_msec = Detect_msec_since( &(dr->start) ) ;
+	if ( GOOD( result ) ) {
+		dr->adapter = pin->first->adapter_name ;
+		dr->state = detect_found ;
+	} else {
+		dr->state = detect_failed ;
+	}
+	_MUTEX_UNLOCK( detect_control.mutex ) ;
+}
+
+/* Adapters whose detection only touches their own port
+ * (no new ports, no shared scanning state) and may be slow */
+static int Detect_in_parallel( enum bus_mode busmode )
+{
+	switch ( busmode ) {
+		case bus_server:
+		case bus_serial:
+		case bus_passive:
+		case bus_xport:
+		case bus_link:
+		case bus_ha5:
+		case bus_ha7e:
+		case bus_ha7net:
+		case bus_etherweather:
+		case bus_masterhub:
+		case bus_pbm:
+		case bus_ds1wm:
+		case bus_k1wm:
+			return 1 ;
+		default:
+			return 0 ;
+	}
+}
+
+/* Take a port off the bus list while it's detected */
+static void Detect_unlink( struct port_in * pin )
+{
+	CONNIN_WLOCK ;
+	if ( Inbound_Control.head_port == pin ) {
+		Inbound_Control.head_port = pin->next ;
+	} else {
+		struct port_in * now ;
+		for ( now = Inbound_Control.head_port ; now != NULL ; now = now->next ) {
+			if ( now->next == pin ) {
+				now->next = pin->next ;
+				break ;
+			}
+		}
+	}
+	pin->next = NULL ;
+	CONNIN_WUNLOCK ;
+}
+
+/* Put a detected port back at the end of the bus list
+ * (already set up by LinkPort, just not in the list) */
+static void Detect_link( struct port_in * pin )
+{
+	CONNIN_WLOCK ;
+	pin->next = NULL ;
+	if ( Inbound_Control.head_port == NULL ) {
+		Inbound_Control.head_port = pin ;
+	} else {
+		struct port_in * now = Inbound_Control.head_port ;
+		while ( now->next != NULL ) {
+			now = now->next ;
+		}
+		now->next = pin ;
+	}
+	CONNIN_WUNLOCK ;
+}
+
+static void * Detect_thread( void * v )
+{
+	struct detect_record * dr = v ;
+	struct port_in * pin = dr->pin ;
+	int backoff = DETECT_BACKOFF_MIN ;
+	GOOD_OR_BAD result ;
+
+	while (1) {
+		struct timeval start ;
+		int retry ;
+
+		timernow( &start ) ;
+		result = SetupSingleInboundConnection( pin ) ;
+
+		_MUTEX_LOCK( detect_control.mutex ) ;
+		++dr->attempts ;
+		dr->last_msec = Detect_msec_since( &start ) ;
+		dr->total_msec = Detect_msec_since( &(dr->start) ) ;
+		if ( GOOD( result ) ) {
+			dr->adapter = pin->first->adapter_name ;
+			retry = 0 ;
+		} else if ( detect_control.stopping || Globals.timeout_detect <= 0 ) {
+			retry = 0 ;
+		} else if ( Globals.program_type == program_type_filesystem ) {
+			// owfs goes to the background (fork) after startup, the thread wouldn't survive
+			retry = dr->total_msec + 1000 * backoff < 1000U * Globals.timeout_detect ;
+		} else {
+			retry = 1 ;
+		}
+		dr->state = GOOD( result ) ? detect_found : retry ? detect_retrying : detect_failed ;
+		_MUTEX_UNLOCK( detect_control.mutex ) ;
+
+		if ( ! retry ) {
+			break ;
+		}
+		LEVEL_CONNECT("Cannot detect %s yet -- retry in %d seconds", SAFESTRING(dr->name), backoff ) ;
+		if ( Detect_retry_wait( backoff ) ) {
+			// stopping
+			result = gbBAD ;
+			_MUTEX_LOCK( detect_control.mutex ) ;
+			dr->state = detect_failed ;
+			_MUTEX_UNLOCK( detect_control.mutex ) ;
+			break ;
+		}
+		// reopen from scratch, as a reconnection does
+		BUS_close( pin->first ) ;
+		if ( backoff < DETECT_BACKOFF_MAX ) {
+			backoff *= 2 ;
+		}
+	}
+
+	// the startup pass may still be walking the bus list
+	_MUTEX_LOCK( detect_control.mutex ) ;
+	while ( ! detect_control.listed ) {
+		my_pthread_cond_wait( &(detect_control.cond), &(detect_control.mutex) ) ;
+	}
+	_MUTEX_UNLOCK( detect_control.mutex ) ;
+
+	if ( GOOD( result ) ) {
+		LEVEL_CONNECT("Detected %s (%s) in %u msec, %d attempts", SAFESTRING(dr->name), SAFESTRING(dr->adapter), dr->total_msec, dr->attempts ) ;
+		Detect_link( pin ) ;
+	} else {
+		LEVEL_CONNECT("Giving up on %s after %d attempts", SAFESTRING(dr->name), dr->attempts ) ;
+		// taken off the list by Detect_unlink, other detections may be changing it
+		RemoveUnlinkedPort( pin ) ;
+	}
+
+	_MUTEX_LOCK( detect_control.mutex ) ;
+	dr->pin = NULL ;
+	--detect_control.unsettled ;
+	my_pthread_cond_broadcast( &(detect_control.cond) ) ;
+	_MUTEX_UNLOCK( detect_control.mutex ) ;
+	return VOID_RETURN ;
+}
+
+/* Sleep between attempts, return 1 if detection is stopping */
+static int Detect_retry_wait( int seconds )
+{
+	struct timeval until ;
+	struct timespec ts ;
+	int stopping ;
+
+	timernow( &until ) ;
+	until.tv_sec += seconds ;
+	ts.tv_sec = until.tv_sec ;
+	ts.tv_nsec = until.tv_usec * 1000 ;
+
+	_MUTEX_LOCK( detect_control.mutex ) ;
+	while ( ! detect_control.stopping ) {
+		struct timeval now ;
+		timernow( &now ) ;
+		if ( ! timercmp( &now, &until, < ) ) {
+			break ;
+		}
+		pthread_cond_timedwait( &(detect_control.cond), &(detect_control.mutex), &ts ) ;
+	}
+	stopping = detect_control.stopping ;
+	_MUTEX_UNLOCK( detect_control.mutex ) ;
+	return stopping ;
+}
+
+/* Wait for the parallel detections, up to timeout_detect seconds
+ * (all of them for owfs or timeout_detect=0, since there is no retrying then) */
+static void Detect_startup_wait( void )
+{
+	struct timeval until = detect_control.start ;
+	struct timespec ts ;
+	int wait_all = ( Globals.timeout_detect <= 0 || Globals.program_type == program_type_filesystem ) ;
+
+	until.tv_sec += Globals.timeout_detect ;
+	ts.tv_sec = until.tv_sec ;
+	ts.tv_nsec = until.tv_usec * 1000 ;
+
+	_MUTEX_LOCK( detect_control.mutex ) ;
+	while ( detect_control.unsettled > 0 ) {
+		if ( wait_all ) {
+			my_pthread_cond_wait( &(detect_control.cond), &(detect_control.mutex) ) ;
+		} else {
+			struct timeval now ;
+			timernow( &now ) ;
+			if ( ! timercmp( &now, &until, < ) ) {
+				LEVEL_CONNECT("Starting with %d bus master(s) still being detected", detect_control.unsettled ) ;
+				break ;
+			}
+			pthread_cond_timedwait( &(detect_control.cond), &(detect_control.mutex), &ts ) ;
+		}
+	}
+	detect_control.startup_msec = Detect_msec_since( &(detect_control.start) ) ;
+	_MUTEX_UNLOCK( detect_control.mutex ) ;
+}
+
+static UINT Detect_msec_since( const struct timeval * start )
+{
+	struct timeval now ;
+	timernow( &now ) ;
+	timersub( &now, start, &now ) ;
+	return now.tv_sec * 1000 + now.tv_usec / 1000 ;
+}
+
+/* Bus masters still being detected (or retried) */
+int Detect_pending( void )
+{
+	int pending ;
+	if ( ! detect_control.started ) {
+		return 0 ;
+	}
+	_MUTEX_LOCK( detect_control.mutex ) ;
+	pending = detect_control.unsettled ;
+	_MUTEX_UNLOCK( detect_control.mutex ) ;
+	return pending ;
+}
+
+UINT Detect_startup_msec( void )
+{
+	return detect_control.startup_msec ;
+}
+
+/* One line per configured port: bus, device name, adapter, state, attempts and timing */
+void Detect_report( struct memblob * mb )
+{
+	struct detect_record * dr ;
+	char line[PATH_MAX] ;
+
+	if ( ! detect_control.started ) {
+		return ;
+	}
+	_MUTEX_LOCK( detect_control.mutex ) ;
+	for ( dr = detect_control.head ; dr != NULL ; dr = dr->next ) {
+		static const char * state_name[] = { "detecting", "detected", "retrying", "failed", } ;
+		UCLIBCLOCK ;
+		snprintf( line, sizeof(line), "bus.%d %s %s: %s, %d attempts, last %u msec, total %u msec\n",
+			dr->bus_nr, SAFESTRING(dr->name), dr->adapter != NULL ? dr->adapter : "-",
+			state_name[dr->state], dr->attempts, dr->last_msec, dr->total_msec ) ;
+		UCLIBCUNLOCK ;
+		MemblobAdd( (BYTE *) line, strlen(line), mb ) ;
+	}
+	_MUTEX_UNLOCK( detect_control.mutex ) ;
+}
+
+/* End the detection threads (adapters still missing are dropped) and the records */
+void Detect_Stop( void )
+{
+	struct detect_record * dr ;
+
+	if ( ! detect_control.started ) {
+		return ;
+	}
+
+	_MUTEX_LOCK( detect_control.mutex ) ;
+	detect_control.stopping = 1 ;
+	my_pthread_cond_broadcast( &(detect_control.cond) ) ;
+	_MUTEX_UNLOCK( detect_control.mutex ) ;
+
+	for ( dr = detect_control.head ; dr != NULL ; dr = dr->next ) {
+		if ( dr->joinable ) {
+			pthread_join( dr->thread, NULL ) ;
+		}
+	}
+	while ( detect_control.head != NULL ) {
+		dr = detect_control.head ;
+		detect_control.head = dr->next ;
+		SAFEFREE( dr->name ) ;
+		owfree( dr ) ;
+	}
+
+	my_pthread_cond_destroy( &(detect_control.cond) ) ;
+	_MUTEX_DESTROY( detect_control.mutex ) ;
+	detect_control.unsettled = 0 ;
+	detect_control.started = 0 ;
 }
 	
 static GOOD_OR_BAD SetupSingleInboundConnection( struct port_in * pin )
@@ -104,13 +512,9 @@ static GOOD_OR_BAD SetupSingleInboundConnection( struct port_in * pin )
 		break;
 
 	case bus_server:
+		// retried with backoff by the detection thread (owserver may not be listening yet)
 		if (BAD( Server_detect(pin)) ) {
-			LEVEL_CONNECT("Cannot open server at %s -- first attempt.", DEVICENAME(in));
-			sleep(5); // delay to allow owserver to open it's listen socket
-			if ( GOOD( Server_detect(pin)) ) {
-				break ;
-			}
-			LEVEL_CONNECT("Cannot open server at %s -- second (and final) attempt.", DEVICENAME(in));
+			LEVEL_CONNECT("Cannot open server at %s", DEVICENAME(in));
 			return gbBAD ;
 		}
 		break;
@@ -255,6 +659,10 @@ static GOOD_OR_BAD SetupSingleInboundConnection( struct port_in * pin )
 		Mock_detect(pin);	// never fails
 		break;
 
+	case bus_sim:
+		Sim_detect(pin);	// never fails
+		break;
+
 	case bus_w1_monitor:
 		RETURN_BAD_IF_BAD( W1_monitor_detect(pin) ) ;
 		break;
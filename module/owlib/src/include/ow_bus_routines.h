@@ -118,6 +118,9 @@ struct interface_routines {
 // Adapter benefits from coalescing reads and writes into a longer string
 #define ADAP_FLAG_bundle        0x00001000
 
+// Bundle only byte transfers -- power, program pulses, bit transfers and delays are done natively in order
+#define ADAP_FLAG_bundle_bytes  0x00020000
+
 // Adapter automatically performs a reset before read/writes
 #define ADAP_FLAG_dir_auto_reset 0x00002000
 
@@ -136,8 +139,10 @@ struct interface_routines {
 GOOD_OR_BAD BUS_detect( struct port_in * pin ) ;
 
 RESET_TYPE BUS_reset(const struct parsedname *pn);
+GOOD_OR_BAD BUS_reset_bundled(RESET_TYPE reset, struct connection_in *in);
 
 GOOD_OR_BAD BUS_select(const struct parsedname *pn);
+int BUS_select_plain(const struct parsedname *pn);
 GOOD_OR_BAD BUS_select_and_sendback(const BYTE * data, BYTE * resp, const size_t len, const struct parsedname *pn);
 
 GOOD_OR_BAD BUS_sendback_bits( const BYTE * databits, BYTE * respbits, const size_t len, const struct parsedname * pn );
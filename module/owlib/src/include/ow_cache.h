@@ -93,4 +93,30 @@ void Cache_Del_Alias(const BYTE * sn);
 
 void Aliaslist( struct memblob * mb  ) ;
 
+/* Warm restart snapshot of device locations, directories and aliases */
+enum cache_snapshot_kind { cache_snapshot_bus, cache_snapshot_device, cache_snapshot_directory, cache_snapshot_aliases, } ;
+void Cache_Snapshot_Walk( void (*record)(void * v, enum cache_snapshot_kind kind, const BYTE * sn, int bus_nr, const BYTE * data, size_t length), void * v ) ;
+GOOD_OR_BAD Cache_Snapshot_Add_Dir(const BYTE * sn, int bus_nr, const BYTE * snlist, size_t length) ;
+void Cache_Snapshot_Load(void) ;
+GOOD_OR_BAD Cache_Snapshot_Write(void) ;
+void Cache_Snapshot_Start(void) ;
+void Cache_Snapshot_Stop(void) ;
+
+void Cache_Reaper_Start(void) ;
+void Cache_Reaper_Stop(void) ;
+
+/* Parsed path cache (in front of FS_ParsedName) */
+void ParseCache_Open(void);
+void ParseCache_Close(void);
+/* What the cache had seen when a parse started (see ParseCache_Add) */
+struct parse_cache_ticket {
+	UINT flushes;				// of the path's shard
+	UINT device_flushes;		// of any device
+};
+
+void ParseCache_Flush(void);
+void ParseCache_Flush_Device(const BYTE * sn);
+GOOD_OR_BAD ParseCache_Get(const char *path, struct parsedname *pn, struct parse_cache_ticket * ticket);
+void ParseCache_Add(const char *path, const struct parsedname *pn, const struct parse_cache_ticket * ticket);
+
 #endif							/* OWCACHE_H */
@@ -66,6 +66,7 @@ enum adapter_type {
 	adapter_fake,
 	adapter_tester,
 	adapter_mock,
+	adapter_sim,
 	adapter_w1,
 	adapter_w1_monitor,
 	adapter_browse_monitor,
@@ -115,6 +116,10 @@ enum e_bus_stat {
 	e_bus_select_errors,
 	e_bus_try_overdrive,
 	e_bus_failed_overdrive,
+	e_bus_devlock_slots,
+	e_bus_devlock_in_use,
+	e_bus_devlock_peak,
+	e_bus_devlock_overflows,
 	e_bus_stat_last_marker
 };
 
@@ -133,13 +138,16 @@ struct connection_in {
 
 	pthread_mutex_t bus_mutex;
 	pthread_mutex_t dev_mutex;
-	void *dev_db;				// dev-lock tree
+	void *dev_db;				// dev-lock tree (overflow from dev_table)
+	struct devlock_table *dev_table;	// preallocated dev-lock slots
 	enum e_reconnect reconnect_state;
 	struct timeval last_lock;	/* statistics */
 
 	UINT bus_stat[e_bus_stat_last_marker];
 
 	struct timeval bus_time;
+	UINT lock_wait;				// microseconds the bus holder waited for it
+	struct latency_set latency;	/* statistics */
 
 	struct interface_routines iroutines;
 	enum adapter_type Adapter;
@@ -151,6 +159,8 @@ struct connection_in {
 	int ds2404_found;
 	int ProgramAvailable;
 	size_t last_root_devs;
+	struct dirblob last_root_dir;	// devices found by the last full root search
+	time_t last_full_search;		// when (0 for never)
 	struct ds2409_hubs branch;		// ds2409 branch currently selected
 			// or the special eBranch_bad and eBranch_cleared
 
@@ -180,6 +190,7 @@ extern struct inbound_control {
 	int next_fake ; // count of fake buses
 	int next_tester ; // count tester buses
 	int next_mock ; // count mock buses
+	int next_sim ; // count simulated (timed) buses
 
 	struct connection_in * w1_monitor ;
 	struct connection_in * external ;
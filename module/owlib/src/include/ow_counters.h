@@ -76,13 +76,72 @@ struct directory {
 	UINT entries;
 };
 
-#define AVERAGE_IN(pA)  ++(pA)->current; ++(pA)->count; (pA)->sum+=(pA)->current; if ((pA)->current>(pA)->max)++(pA)->max;
-#define AVERAGE_OUT(pA) --(pA)->current;
-#define AVERAGE_MARK(pA)  ++(pA)->count; (pA)->sum+=(pA)->current;
-#define AVERAGE_CLEAR(pA)  (pA)->current=0;
+/* Latency histograms, see ow_latency.c
+ * bucket by microseconds: exact below LATENCY_SUB, then LATENCY_SUB per power of 2 */
+#define LATENCY_SUB_BITS	2
+#define LATENCY_SUB	(1 << LATENCY_SUB_BITS)
+#define LATENCY_BUCKETS	((32 - LATENCY_SUB_BITS + 1) * LATENCY_SUB)
+
+enum e_latency {
+	e_latency_read,				// whole read, cache or bus
+	e_latency_lock_wait,		// waiting for the bus lock
+	e_latency_lock_held,		// holding the bus lock
+	e_latency_cache,			// cache lookup
+	e_latency_last_marker
+};
+
+struct latency_histogram {
+	UINT count;
+	UINT max;
+	UINT bucket[LATENCY_BUCKETS];
+};
+
+struct latency_set {
+	struct latency_histogram h[e_latency_last_marker];
+	struct device *device;		// per property sets: device to name it by
+};
+
+/* Statistics counters are updated with atomic operations instead of under STATLOCK
+ * so busy threads don't serialize on a single mutex just to count.
+ * Each value is exact, but related values (e.g. the fields of an average)
+ * may be momentarily out of step when read.
+ * Compilers without the __atomic builtins fall back to the mutex.
+ * */
+#ifdef __ATOMIC_RELAXED
+#define STAT_ADD(x,n)       ((void) __atomic_add_fetch( &(x), (n), __ATOMIC_RELAXED ))
+#define STAT_SUB(x,n)       ((void) __atomic_sub_fetch( &(x), (n), __ATOMIC_RELAXED ))
+#define STAT_GET(x)         __atomic_load_n( &(x), __ATOMIC_RELAXED )
+#define STAT_SET(x,v)       __atomic_store_n( &(x), (v), __ATOMIC_RELAXED )
+#define STAT_MAX(x,v)       do { UINT _stat_old = STAT_GET(x) ; \
+                                 while ( (UINT)(v) > _stat_old && ! __atomic_compare_exchange_n( &(x), &_stat_old, (UINT)(v), 0, __ATOMIC_RELAXED, __ATOMIC_RELAXED ) ) ; \
+                            } while (0)
+#define AVERAGE_IN(pA)      do { UINT _stat_current = __atomic_add_fetch( &((pA)->current), 1, __ATOMIC_RELAXED ) ; \
+                                 STAT_ADD1((pA)->count) ; STAT_ADD((pA)->sum,_stat_current) ; STAT_MAX((pA)->max,_stat_current) ; \
+                            } while (0)
+#define AVERAGE_MARK(pA)    do { STAT_ADD1((pA)->count) ; STAT_ADD((pA)->sum,STAT_GET((pA)->current)) ; } while (0)
+#else /* __ATOMIC_RELAXED */
+#define STAT_ADD(x,n)       do { STATLOCK ; (x) += (n) ; STATUNLOCK ; } while (0)
+#define STAT_SUB(x,n)       do { STATLOCK ; (x) -= (n) ; STATUNLOCK ; } while (0)
+#define STAT_GET(x)         (x)
+#define STAT_SET(x,v)       do { STATLOCK ; (x) = (v) ; STATUNLOCK ; } while (0)
+#define STAT_MAX(x,v)       do { STATLOCK ; if ( (UINT)(v) > (x) ) { (x) = (v) ; } ; STATUNLOCK ; } while (0)
+#define AVERAGE_IN(pA)      do { STATLOCK ; ++(pA)->current; ++(pA)->count; (pA)->sum+=(pA)->current; if ((pA)->current>(pA)->max)++(pA)->max; STATUNLOCK ; } while (0)
+#define AVERAGE_MARK(pA)    do { STATLOCK ; ++(pA)->count; (pA)->sum+=(pA)->current; STATUNLOCK ; } while (0)
+#endif /* __ATOMIC_RELAXED */
+
+#define STAT_ADD1(x)        STAT_ADD(x,1)
+#define AVERAGE_OUT(pA)     STAT_SUB((pA)->current,1)
+#define AVERAGE_CLEAR(pA)   STAT_SET((pA)->current,0)
 
 extern UINT cache_flips;
 extern UINT cache_adds;
+extern UINT cache_evictions;
+extern UINT cache_reaped;
+extern UINT cache_flip_max;
+extern UINT cache_stale_served;
+extern UINT cache_stale_refreshed;
+extern UINT cache_stale_errors;
+extern UINT cache_stale_dropped;
 extern struct average new_avg;
 extern struct average old_avg;
 extern struct average store_avg;
@@ -92,6 +151,13 @@ extern struct cache_stats cache_dir;
 extern struct cache_stats cache_dev;
 extern struct cache_stats cache_pst;
 
+extern UINT parse_cache_hits;
+extern UINT parse_cache_misses;
+extern UINT parse_cache_adds;
+extern UINT parse_cache_evictions;
+extern UINT parse_cache_flushes;
+extern UINT parse_cache_device_flushes;
+
 extern UINT read_calls;
 extern UINT read_cache;
 extern UINT read_cachebytes;
@@ -99,6 +165,7 @@ extern UINT read_bytes;
 extern UINT read_array;
 extern UINT read_tries[3];
 extern UINT read_success;
+extern UINT read_coalesced;
 extern struct average read_avg;
 
 extern UINT write_calls;
@@ -110,11 +177,26 @@ extern struct average write_avg;
 
 extern struct directory dir_main;
 extern struct directory dir_dev;
+extern UINT dir_verified;
+extern UINT dir_verify_failures;
+extern UINT dir_arrivals;
+extern UINT dir_departures;
 extern UINT dir_depth;
 extern struct average dir_avg;
 
 extern struct average all_avg;
 
+// ow_latency.c
+extern struct latency_set latency_all;
+struct connection_in;
+struct memblob;
+UINT Latency_usec(const struct timeval *tv);
+UINT Latency_since(const struct timeval *start);
+void Latency_bus(enum e_latency kind, UINT usec, struct connection_in *in);
+void Latency_device(enum e_latency kind, UINT usec, const struct parsedname *pn);
+void Latency_summary(char *buffer, size_t size, const struct latency_histogram *h);
+void Latency_dump(struct memblob *mb);
+
 extern struct timeval max_delay;
 
 // ow_locks.c
@@ -132,6 +214,11 @@ extern UINT NET_accept_errors;
 extern UINT NET_connection_errors;
 extern UINT NET_read_errors;
 
+// ow_server_message.c
+extern UINT server_pool_hits;	// request used an idle persistent connection
+extern UINT server_pool_misses;	// no idle connection, new one opened
+extern UINT server_pool_reconnects;	// idle connection found closed and replaced
+
 // ow_bus.c
 extern UINT BUS_readin_data_errors;
 extern UINT BUS_level_errors;
@@ -151,6 +238,4 @@ extern UINT DS2480_read_read;
 extern UINT DS2480_level_docheck_errors;
 extern UINT DS2480_databit_errors;
 
-#define STAT_ADD1(x)    STATLOCK ; ++x ; STATUNLOCK
-
 #endif							/* OW_COUNTERS_H */
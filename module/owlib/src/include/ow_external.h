@@ -41,6 +41,7 @@ enum external_type {
 	et_none,
 	et_internal,
 	et_script,
+	et_coprocess,
 	et_tcp,
 	et_udp,
 } ;
@@ -83,6 +84,10 @@ struct sensor_node * Find_External_Sensor( char * sensor ) ;
 struct family_node * Find_External_Family( char * family ) ;
 struct property_node * Find_External_Property( char * family, char * property ) ;
 
+/* Long-lived helper for COPROCESS lines (ow_external_coprocess.c) */
+ZERO_OR_ERROR Coprocess_request( const char * command, const char * fields, const BYTE * out, size_t out_length, BYTE * in, size_t * in_length ) ;
+void Coprocess_close_all( void ) ;
+
 int sensor_compare( const void * a , const void * b ) ;
 int family_compare( const void * a , const void * b ) ;
 int property_compare( const void * a , const void * b ) ;
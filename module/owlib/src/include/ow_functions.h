@@ -56,6 +56,25 @@ void LibStop(void);
 void LibClose(void);
 GOOD_OR_BAD EnterBackground(void);
 
+/* Bus master detection at startup (owlib.c) */
+int Detect_pending( void ) ;
+UINT Detect_startup_msec( void ) ;
+void Detect_report( struct memblob * mb ) ;
+void Detect_Stop( void ) ;
+
+/* Background polling (ow_poll.c) */
+GOOD_OR_BAD Poll_Add( const char * arg ) ;
+int Poll_Jobs( void ) ;
+void Poll_Start( void ) ;
+void Poll_Stop( void ) ;
+
+/* Stale-while-revalidate (ow_stale.c) */
+GOOD_OR_BAD Stale_Add( const char * arg ) ;
+time_t Stale_Grace( const struct parsedname * pn ) ;
+time_t Stale_Grace_Max( void ) ;
+void Stale_Refresh( const struct parsedname * pn ) ;
+void Stale_Stop( void ) ;
+
 /* Initial sorting or the device and filetype lists */
 void DeviceSort(void);
 void DeviceDestroy(void);
@@ -84,6 +103,7 @@ const char *FS_DirName(const struct parsedname *pn);
 BYTE CRC8(const BYTE * bytes, const size_t length);
 BYTE CRC8seeded(const BYTE * bytes, const size_t length, const UINT seed);
 BYTE CRC8compute(const BYTE * bytes, const size_t length, const UINT seed);
+UINT CRC16compute(const BYTE * bytes, const size_t length, const UINT seed);
 int CRC16(const BYTE * bytes, const size_t length);
 int CRC16seeded(const BYTE * bytes, const size_t length, const UINT seed);
 BYTE char2num(const char *s);
@@ -119,6 +139,8 @@ GOOD_OR_BAD FS_Test_Simultaneous( const struct internal_prop *ip, UINT delay, co
 void LockSetup(void);
 ZERO_OR_ERROR DeviceLockGet(struct parsedname *pn);
 void DeviceLockRelease(struct parsedname *pn);
+void DeviceLockTableInit(struct connection_in *in);
+void DeviceLockTableClear(struct connection_in *in);
 
 /* 1-wire lowlevel */
 void UT_delay(const UINT len);
@@ -134,8 +156,10 @@ FILE_DESCRIPTOR_OR_ERROR ClientConnect(struct connection_in *in);
 void FreeClientAddr(struct connection_in *in);
 
 void ServerProcess(void (*HandlerRoutine) (FILE_DESCRIPTOR_OR_ERROR file_descriptor));
+void ServerProcessEvents(void (*EventLoop) (void));
 GOOD_OR_BAD ServerOutSetup(struct connection_out *out);
 void InterruptListening( void ) ;
+int ListeningInterrupted( void ) ;
 
 void Setup_Systemd( void ) ;
 void Announce_Systemd( void ) ;
@@ -151,8 +175,11 @@ void FS_help(const char *arg);
 
 INDEX_OR_ERROR ServerPresence( struct parsedname *pn);
 SIZE_OR_ERROR ServerRead(struct one_wire_query *owq);
+void ServerReadMany(struct one_wire_query **owq, SIZE_OR_ERROR * result, int count);
 ZERO_OR_ERROR ServerWrite(struct one_wire_query *owq);
 ZERO_OR_ERROR ServerDir(void (*dirfunc) (void *, const struct parsedname *), void *v, const struct parsedname *pn, uint32_t * flags);
+void ServerPool_Init( struct connection_in * in ) ;
+void ServerPool_Close( struct connection_in * in ) ;
 
 /* High-level callback functions */
 ZERO_OR_ERROR FS_dir(void (*dirfunc) (void *, const struct parsedname *), void *v, struct parsedname *pn);
@@ -167,6 +194,8 @@ SIZE_OR_ERROR FS_get(const char *path, char **return_buffer, size_t * buffer_len
 
 SIZE_OR_ERROR FS_read(const char *path, char *buf, const size_t size, const off_t offset);
 SIZE_OR_ERROR FS_read_postparse(struct one_wire_query *owq);
+void FS_read_many(struct one_wire_query **owq, SIZE_OR_ERROR * result, int count);
+void FS_read_many_stop(void);
 ZERO_OR_ERROR FS_read_fake(struct one_wire_query *owq);
 ZERO_OR_ERROR FS_read_tester(struct one_wire_query *owq);
 ZERO_OR_ERROR FS_r_aggregate_all(struct one_wire_query *owq);
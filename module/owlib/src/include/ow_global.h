@@ -99,7 +99,16 @@ struct global {
 	ASCII *fatal_debug_file;
 	int readonly;
 	int max_clients;			// for ftp
+	int fuse_threads;			// owfs threads answering the kernel (libfuse3)
+	int server_threads;			// owserver worker pool size (event-driven server)
+	int server_pool;			// idle persistent connections kept per remote owserver
+	int http_keepalive;			// owhttpd idle seconds between requests on one connection (0 = close after each)
+	int http_max_requests;		// owhttpd requests served on one connection
 	size_t cache_size;			// max cache size (or 0 for no max) ;
+	int parse_cache_size;		// parsed paths kept (0 for none)
+	int full_search;			// seconds between full root searches, verify known devices in between (0 = always search)
+	ASCII *cache_snapshot;		// warm restart file (or NULL)
+	int cache_snapshot_period;	// seconds between snapshot writes (0 for only at exit)
 	int one_device;				// Single device, use faster ROM comands
 	/* Special parameter to trigger William Robison <ibutton@n952.dyndns.ws> timings */
 	int altUSB;
@@ -119,6 +128,8 @@ struct global {
 	int timeout_ftp;
 	int timeout_ha7;
 	int timeout_w1;
+	int timeout_detect; // startup wait for each bus master, 0 for a single try
+	int timeout_external; // reply from a long-lived external helper
 	int timeout_persistent_low;
 	int timeout_persistent_high;
 	int clients_persistent_low;
@@ -25,11 +25,18 @@
 
 /* included in ow_connection.h as the bus-master specific portion of the connection_in structure */
 
+#define SERVER_POOL_MAX 16
+
 struct master_server {
 	char *type;					// for zeroconf
 	char *domain;				// for zeroconf
 	char *name;					// zeroconf name
 	int no_dirall;				// flag that server doesn't support DIRALL
+	int no_readmany;			// flag that server doesn't support READMANY
+	/* idle persistent connections (ow_server_message.c), protected by the bus lock */
+	int pool_idle;				// number of idle connections waiting in pool
+	FILE_DESCRIPTOR_OR_ERROR pool[SERVER_POOL_MAX];
+	time_t pool_time[SERVER_POOL_MAX];	// when each connection was last returned
 } ;
 
 struct master_serial {
@@ -47,6 +54,15 @@ struct master_fake {
 	struct dirblob alarm;       /* alarm directory */
 };
 
+// Simulated bus with modeled line timing (ow_sim.c)
+struct sim_device ;
+struct master_sim {
+	int index;
+	UINT latency;               /* usec added to every adapter exchange */
+	int devices;                /* number of simulated slaves */
+	struct sim_device * device; /* slave models, private to ow_sim.c */
+};
+
 // DS2490R (usb) hub
 struct master_usb {
 #if OW_USB
@@ -214,6 +230,7 @@ union master_union {
 	struct master_fake fake;
 	struct master_fake tester;
 	struct master_fake mock;
+	struct master_sim sim;
 	struct master_enet enet;
 	struct master_enet_monitor enet_monitor ;
 	struct master_ha5 ha5;
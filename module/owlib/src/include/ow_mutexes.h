@@ -70,6 +70,8 @@ extern struct mutexes {
 	pthread_mutex_t externalcount_mutex;
 	pthread_mutex_t timegm_mutex;
 	pthread_mutex_t detail_mutex;
+	pthread_mutex_t readflight_mutex;
+	pthread_mutex_t inbound_mutex; // Inbound_Control counters (adapters are detected in parallel)
 	
 	pthread_mutexattr_t mattr; // mutex attribute -- used for all mutexes
 	my_rwlock_t lib;
@@ -168,6 +170,12 @@ extern struct mutexes {
 #define DETAILLOCK   		_MUTEX_LOCK(  Mutex.detail_mutex)
 #define DETAILUNLOCK 		_MUTEX_UNLOCK(Mutex.detail_mutex)
 
+#define READFLIGHTLOCK   	_MUTEX_LOCK(  Mutex.readflight_mutex)
+#define READFLIGHTUNLOCK 	_MUTEX_UNLOCK(Mutex.readflight_mutex)
+
+#define INBOUNDLOCK   		_MUTEX_LOCK(  Mutex.inbound_mutex)
+#define INBOUNDUNLOCK 		_MUTEX_UNLOCK(Mutex.inbound_mutex)
+
 #define BUSLOCK(pn)       	BUS_lock(pn)
 #define BUSUNLOCK(pn)     	BUS_unlock(pn)
 #define BUSLOCKIN(in)     	BUS_lock_in(in)
@@ -126,8 +126,8 @@ enum ePS_state {
 };
 
 struct parsedname {
-	char path[2*PATH_MAX+2];				// full device name
-	char path_to_server[PATH_MAX+2];			// path without first bus
+	char * path;				// full device name (allocated to fit, freed by FS_ParsedName_destroy)
+	char * path_to_server;			// path without first bus (same string as path unless they differ)
 	char * device_name ;		// for external name
 	struct connection_in *known_bus;	// where this device is located
 	enum ePN_type type;			// real? settings? ...
@@ -146,6 +146,7 @@ struct parsedname {
 	struct devlock *lock;			// pointer to a device-specific lock
 	int return_code ; // return (error) code
 	int detail_flag ; // matches a detail request
+	int stale_grace ;	// stale window inherited by a linked property, see ow_stale.c
 	int tokens;				// for anti-loop work
 	BYTE *tokenstring;			// List of tokens from owservers passed
 };
@@ -158,7 +159,9 @@ struct parsedname {
 #define SAFEMODE                    ( (UINT) 0x00000010 )
 #define UNCACHED                    ( (UINT) 0x00000020 )
 #define TRIM                        ( (UINT) 0x00000040 )
+#define STALE_OK                    ( (UINT) 0x00000080 )
 #define OWNET                       ( (UINT) 0x00000100 )
+#define STALE_SERVED                ( (UINT) 0x00000200 )
 #define TEMPSCALE_MASK              ( (UINT) 0x00030000 )
 #define TEMPSCALE_BIT      16
 #define PRESSURESCALE_MASK          ( (UINT) 0x001C0000 )
@@ -47,6 +47,7 @@ enum bus_mode {
 	bus_fake,
 	bus_tester,
 	bus_mock,
+	bus_sim,
 	bus_link,
 	bus_masterhub,
 	bus_pbm,
@@ -94,6 +95,41 @@ struct com_tcp {
 struct connection_in;
 struct port_in ;
 
+/* Multi-bus fan-out (directory, presence, remote alias)
+ * Each port has its own long-lived worker threads (started on first use)
+ * that run the jobs submitted for it: one for a local bus, several for
+ * a remote owserver (see PORT_WORKERS_MAX). The submitter waits on the batch. */
+struct port_batch {
+	pthread_mutex_t mutex ;
+	pthread_cond_t cond ;
+	int pending ;			// jobs not yet finished
+	int found ;				// first-result-wins searches can skip the rest
+} ;
+
+struct port_job {
+	struct port_job * next ;
+	struct port_batch * batch ;
+	struct port_in * pin ;
+	void (*routine) (struct port_job * job) ;
+} ;
+
+/* Local buses have one worker (BUSLOCK serializes them anyway)
+ * remote owservers up to server_pool, one per pooled connection */
+#define PORT_WORKERS_MAX 16
+
+struct port_worker {
+	pthread_t thread[PORT_WORKERS_MAX] ;
+	pthread_mutex_t mutex ;
+	pthread_cond_t cond ;
+	struct port_job * head ;
+	struct port_job * tail ;
+	int queued ;			// jobs waiting in the list
+	int idle ;				// threads waiting for a job
+	int ready ;				// mutex and cond set up (port linked)
+	int started ;			// threads running
+	int stopping ;
+} ;
+
 struct port_in {
 	struct port_in * next ;
 	struct connection_in *first;
@@ -119,6 +155,7 @@ struct port_in {
 	struct timeval timeout ; // for serial or tcp read
 	
 	pthread_mutex_t port_mutex;
+	struct port_worker worker ;
 };
 
 /* This bug-fix/workaround function seem to be fixed now... At least on
@@ -127,9 +164,19 @@ struct port_in {
 enum bus_mode get_busmode(const struct connection_in *c);
 
 void RemovePort( struct port_in * pin ) ;
+void RemoveUnlinkedPort( struct port_in * pin ) ;
 struct port_in * AllocPort( const struct port_in * old_pin ) ;
 struct port_in *LinkPort(struct port_in *pin) ;
 struct port_in *NewPort(const struct port_in *pin) ;
 struct connection_in * AddtoPort( struct port_in * pin ) ;
 
+void PortWorker_Init( struct port_in * pin ) ;
+void PortWorker_Stop( struct port_in * pin ) ;
+void PortBatch_Init( struct port_batch * batch ) ;
+void PortBatch_Submit( struct port_batch * batch, struct port_job * job, struct port_in * pin, void (*routine) (struct port_job * job) ) ;
+void PortBatch_Wait( struct port_batch * batch ) ;
+void PortBatch_Found( struct port_batch * batch ) ;
+int PortBatch_Done( struct port_batch * batch ) ;
+int PortCount( void ) ;
+
 #endif							/* OW_PORT_IN_H */
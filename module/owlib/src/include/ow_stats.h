@@ -25,5 +25,9 @@ DeviceHeader(stats_directory);
 DeviceHeader(stats_errors);
 DeviceHeader(stats_thread);
 DeviceHeader(stats_return_code);
+DeviceHeader(stats_server);
+DeviceHeader(stats_latency);
+DeviceHeader(stats_detect);
+DeviceHeader(stats_poll);
 
 #endif							/* OW_STATS */
@@ -0,0 +1,222 @@
+/*
+    OWFS -- One-Wire filesystem
+    OWHTTPD -- One-Wire Web Server
+    Written 2003 Paul H Alfille
+    email: paul.alfille@gmail.com
+    Released under the GPL
+    See the header file: ow.h for full attribution
+    1wire/iButton system from Dallas Semiconductor
+*/
+
+/* Bus benchmark on the timed simulated adapter (--sim)
+ * Unlike the fake adapter, every read goes through the real device code
+ * and costs the modeled 1-wire time plus the chosen adapter latency, so the
+ * numbers follow the bus: conversions, CRC-checked scratchpads, searches.
+ * Threads run a fixed mix of operations; throughput and p50/p99/p999
+ * latency are reported for each operation and overall.
+ *
+ * Built on request, not by "make check":
+ *     make bench_sim
+ *     ./bench_sim [threads [seconds [latency_usec [buses]]]]
+ * */
+
+#include <config.h>
+#include "owfs_config.h"
+#include "ow.h"
+
+#define BENCH_DEVICES "DS18B20*4,DS2438*2,DS2408*2,DS2433*2"
+
+/* Operations, formatted with the bus number.
+ * Simulated IDs are predictable: family, bus, device number, ~family */
+static const char * bench_ops[] = {
+	"/uncached/28.%02X%02X0000D700/temperature9",
+	"/28.%02X%02X0100D700/temperature",
+	"/uncached/26.%02X%02X0400D900/VDD",
+	"/uncached/29.%02X%02X0600D600/sensed.ALL",
+	"/uncached/23.%02X%02X0800DC00/pages/page.1",
+	"/uncached/bus.%d",
+} ;
+#define BENCH_OPS ( (int) (sizeof(bench_ops) / sizeof(bench_ops[0])) )
+#define BENCH_DIR ( BENCH_OPS - 1 )
+
+struct bench_sample {
+	int op ;
+	double usec ;
+} ;
+
+struct bench_thread_data {
+	int id ;
+	int buses ;
+	struct bench_sample * sample ;
+	size_t samples ;
+	size_t allocated ;
+} ;
+
+static volatile int bench_running ;
+
+static void bench_dir_callback( void * v, const struct parsedname * pn )
+{
+	(void) pn ;
+	++ *(int *) v ;
+}
+
+static int bench_op( int op, int bus )
+{
+	char path[PATH_MAX] ;
+
+	if ( op == BENCH_DIR ) {
+		struct parsedname pn ;
+		int entries = 0 ;
+		snprintf( path, sizeof(path), bench_ops[op], bus ) ;
+		if ( FS_ParsedName( path, &pn ) != 0 ) {
+			return -1 ;
+		}
+		FS_dir( bench_dir_callback, &entries, &pn ) ;
+		FS_ParsedName_destroy( &pn ) ;
+		return entries > 0 ? 0 : -1 ;
+	} else {
+		char buffer[128] ;
+		snprintf( path, sizeof(path), bench_ops[op], bus & 0xFF, ( bus >> 8 ) & 0xFF ) ;
+		return FS_read( path, buffer, sizeof(buffer), 0 ) >= 0 ? 0 : -1 ;
+	}
+}
+
+static void * bench_thread( void * v )
+{
+	struct bench_thread_data * td = v ;
+	int op = td->id % BENCH_OPS ;
+	int bus = td->id % td->buses ;
+
+	while ( bench_running ) {
+		struct timeval start, stop ;
+
+		timernow( &start ) ;
+		if ( bench_op( op, bus ) == 0 ) {
+			timernow( &stop ) ;
+			timersub( &stop, &start, &stop ) ;
+			if ( td->samples == td->allocated ) {
+				struct bench_sample * s ;
+				td->allocated = td->allocated ? 2 * td->allocated : 1024 ;
+				s = realloc( td->sample, td->allocated * sizeof(struct bench_sample) ) ;
+				if ( s == NULL ) {
+					break ;
+				}
+				td->sample = s ;
+			}
+			td->sample[td->samples].op = op ;
+			td->sample[td->samples].usec = stop.tv_sec * 1000000. + stop.tv_usec ;
+			++td->samples ;
+		}
+		op = ( op + 1 ) % BENCH_OPS ;
+		bus = ( bus + 1 ) % td->buses ;
+	}
+	return NULL ;
+}
+
+static int bench_compare( const void * a, const void * b )
+{
+	double x = *(const double *) a ;
+	double y = *(const double *) b ;
+	return ( x > y ) - ( x < y ) ;
+}
+
+static double bench_percentile( const double * sorted, size_t n, double p )
+{
+	size_t i = (size_t) ( p * n ) ;
+	return sorted[ i < n ? i : n - 1 ] ;
+}
+
+static void bench_report( const char * name, double * usec, size_t n, double seconds )
+{
+	if ( n == 0 ) {
+		printf( "%-46s %8s\n", name, "no reads" ) ;
+		return ;
+	}
+	qsort( usec, n, sizeof(double), bench_compare ) ;
+	printf( "%-46s %8.1f/s %9.2f %9.2f %9.2f\n", name, n / seconds,
+		bench_percentile( usec, n, .50 ) / 1000., bench_percentile( usec, n, .99 ) / 1000., bench_percentile( usec, n, .999 ) / 1000. ) ;
+}
+
+int main( int argc, char ** argv )
+{
+	int threads = argc > 1 ? atoi( argv[1] ) : 4 ;
+	int seconds = argc > 2 ? atoi( argv[2] ) : 10 ;
+	int latency = argc > 3 ? atoi( argv[3] ) : 0 ;
+	int buses = argc > 4 ? atoi( argv[4] ) : 1 ;
+	char options[1024] = "--error_level=0" ;
+	pthread_t thread[threads] ;
+	struct bench_thread_data td[threads] ;
+	struct timeval start, stop ;
+	double elapsed ;
+	double * usec ;
+	size_t total = 0 ;
+	int i, op ;
+
+	if ( threads < 1 || seconds < 1 || buses < 1 ) {
+		fprintf( stderr, "Usage: %s [threads [seconds [latency_usec [buses]]]]\n", argv[0] ) ;
+		return 1 ;
+	}
+	for ( i = 0 ; i < buses ; ++i ) {
+		size_t used = strlen( options ) ;
+		snprintf( &options[used], sizeof(options) - used, " --sim=%s,latency=%d", BENCH_DEVICES, latency ) ;
+	}
+
+	API_setup( program_type_clibrary ) ;
+	if ( BAD( API_init( options, continue_if_repeat ) ) ) {
+		fprintf( stderr, "Cannot start owlib with the simulated adapter\n" ) ;
+		return 1 ;
+	}
+
+	printf( "%d threads, %d bus(es) of %s, %d usec adapter latency, %d seconds\n", threads, buses, BENCH_DEVICES, latency, seconds ) ;
+	bench_running = 1 ;
+	timernow( &start ) ;
+	for ( i = 0 ; i < threads ; ++i ) {
+		td[i].id = i ;
+		td[i].buses = buses ;
+		td[i].sample = NULL ;
+		td[i].samples = td[i].allocated = 0 ;
+		pthread_create( &thread[i], NULL, bench_thread, &td[i] ) ;
+	}
+	sleep( seconds ) ;
+	bench_running = 0 ;
+	for ( i = 0 ; i < threads ; ++i ) {
+		pthread_join( thread[i], NULL ) ;
+		total += td[i].samples ;
+	}
+	timernow( &stop ) ;
+	timersub( &stop, &start, &stop ) ;
+	elapsed = TVfloat( &stop ) ;
+
+	usec = malloc( ( total + 1 ) * sizeof(double) ) ;
+	if ( usec == NULL ) {
+		return 1 ;
+	}
+	printf( "%-46s %10s %9s %9s %9s\n", "operation (bus 0 shown)", "rate", "p50 ms", "p99 ms", "p999 ms" ) ;
+	for ( op = 0 ; op < BENCH_OPS ; ++op ) {
+		char name[PATH_MAX] ;
+		size_t n = 0 ;
+		for ( i = 0 ; i < threads ; ++i ) {
+			size_t s ;
+			for ( s = 0 ; s < td[i].samples ; ++s ) {
+				if ( td[i].sample[s].op == op ) {
+					usec[n++] = td[i].sample[s].usec ;
+				}
+			}
+		}
+		snprintf( name, sizeof(name), bench_ops[op], 0, 0 ) ;
+		bench_report( name, usec, n, elapsed ) ;
+	}
+	total = 0 ;
+	for ( i = 0 ; i < threads ; ++i ) {
+		size_t s ;
+		for ( s = 0 ; s < td[i].samples ; ++s ) {
+			usec[total++] = td[i].sample[s].usec ;
+		}
+		free( td[i].sample ) ;
+	}
+	bench_report( "all", usec, total, elapsed ) ;
+	free( usec ) ;
+
+	API_finish() ;
+	return 0 ;
+}
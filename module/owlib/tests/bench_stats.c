@@ -0,0 +1,98 @@
+/*
+    OWFS -- One-Wire filesystem
+    OWHTTPD -- One-Wire Web Server
+    Written 2003 Paul H Alfille
+    email: paul.alfille@gmail.com
+    Released under the GPL
+    See the header file: ow.h for full attribution
+    1wire/iButton system from Dallas Semiconductor
+*/
+
+/* Statistics contention benchmark
+ * Threads read the same simulated (fake adapter) properties as fast as they can.
+ * The values come from the cache, so each read is mostly parsing and statistics bookkeeping.
+ * Reads per second for 1 thread versus many shows how much the threads get in each other's way.
+ *
+ * Built on request, not by "make check":
+ *     make bench_stats
+ *     ./bench_stats [max_threads [seconds]]
+ * */
+
+#include <config.h>
+#include "owfs_config.h"
+#include "ow.h"
+
+static const char * bench_paths[] = {
+	"/10.67C6697351FF/temperature",
+	"/28.4AEC29CDBAAB/temperature",
+	"/10.67C6697351FF/type",
+	"/statistics/read/calls",
+} ;
+#define BENCH_PATHS ( sizeof(bench_paths) / sizeof(bench_paths[0]) )
+
+static volatile int bench_running ;
+
+static void * bench_thread( void * v )
+{
+	unsigned long * reads = v ;
+	char buffer[64] ;
+	size_t path_index = 0 ;
+
+	while ( bench_running ) {
+		if ( FS_read( bench_paths[path_index], buffer, sizeof(buffer), 0 ) >= 0 ) {
+			++ *reads ;
+		}
+		path_index = ( path_index + 1 ) % BENCH_PATHS ;
+	}
+	return NULL ;
+}
+
+/* Run threads for a time, return total reads per second */
+static double bench_run( int threads, int seconds )
+{
+	pthread_t thread[threads] ;
+	unsigned long reads[threads] ;
+	unsigned long total = 0 ;
+	struct timeval start, stop ;
+	int i ;
+
+	bench_running = 1 ;
+	timernow( &start ) ;
+	for ( i = 0 ; i < threads ; ++i ) {
+		reads[i] = 0 ;
+		pthread_create( &thread[i], NULL, bench_thread, &reads[i] ) ;
+	}
+	sleep( seconds ) ;
+	bench_running = 0 ;
+	for ( i = 0 ; i < threads ; ++i ) {
+		pthread_join( thread[i], NULL ) ;
+		total += reads[i] ;
+	}
+	timernow( &stop ) ;
+	timersub( &stop, &start, &stop ) ;
+	return total / TVfloat( &stop ) ;
+}
+
+int main( int argc, char ** argv )
+{
+	int max_threads = argc > 1 ? atoi( argv[1] ) : 8 ;
+	int seconds = argc > 2 ? atoi( argv[2] ) : 3 ;
+	double single ;
+	int threads ;
+
+	API_setup( program_type_clibrary ) ;
+	if ( BAD( API_init( "--fake=10.67C6697351FF,28.4AEC29CDBAAB --error_level=0", continue_if_repeat ) ) ) {
+		fprintf( stderr, "Cannot start owlib with the fake adapter\n" ) ;
+		return 1 ;
+	}
+
+	single = bench_run( 1, seconds ) ;
+	printf( "threads %2d: %10.0f reads/s\n", 1, single ) ;
+	for ( threads = 2 ; threads <= max_threads ; threads *= 2 ) {
+		double rate = bench_run( threads, seconds ) ;
+		printf( "threads %2d: %10.0f reads/s (%.2fx single thread)\n", threads, rate, rate / single ) ;
+	}
+
+	API_finish() ;
+	return 0 ;
+}
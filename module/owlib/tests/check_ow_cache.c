@@ -0,0 +1,291 @@
+#include "ow_testhelper.h"
+#include "ow_counters.h"
+
+#define CACHE_TEST_DEVICES 1000
+#define CACHE_TEST_ALIASES 100000
+#define CACHE_TEST_FLIPS 3
+
+static struct parsedname * cache_pn ;
+
+static void cache_test_setup(void) {
+	owlib_test_setup();
+	cache_pn = owcalloc(1, sizeof(struct parsedname));
+	Globals.cache_size = 0 ;
+}
+
+static void cache_test_teardown(void) {
+	Globals.cache_size = 0 ;
+	owfree(cache_pn);
+	owlib_test_teardown();
+}
+
+// Fabricate a distinct serial number for each index
+static void load_sn(BYTE * sn, int index) {
+	memset(sn, 0, SERIAL_NUMBER_SIZE);
+	sn[0] = 0x10;
+	sn[1] = index & 0xFF;
+	sn[2] = (index >> 8) & 0xFF;
+}
+
+// Look up the cached bus for the index-th serial number
+static GOOD_OR_BAD get_device(int index, int * bus_nr) {
+	load_sn(cache_pn->sn, index);
+	return Cache_Get_Device(bus_nr, cache_pn);
+}
+
+// Add and retrieve a device location
+START_TEST(test_cache_device_roundtrip)
+{
+	BYTE sn[SERIAL_NUMBER_SIZE];
+	int bus_nr = -1;
+
+	load_sn(sn, 1);
+	ck_assert_int_eq(gbGOOD, Cache_Add_Device(3, sn));
+	ck_assert_int_eq(gbGOOD, get_device(1, &bus_nr));
+	ck_assert_int_eq(3, bus_nr);
+
+	// replace in place
+	ck_assert_int_eq(gbGOOD, Cache_Add_Device(4, sn));
+	ck_assert_int_eq(gbGOOD, get_device(1, &bus_nr));
+	ck_assert_int_eq(4, bus_nr);
+
+	ck_assert_int_eq(gbBAD, get_device(2, &bus_nr));
+}
+END_TEST
+
+// Deleted entries are gone
+START_TEST(test_cache_device_delete)
+{
+	BYTE sn[SERIAL_NUMBER_SIZE];
+	int bus_nr;
+
+	load_sn(sn, 7);
+	ck_assert_int_eq(gbGOOD, Cache_Add_Device(1, sn));
+	load_sn(cache_pn->sn, 7);
+	Cache_Del_Device(cache_pn);
+	ck_assert_int_eq(gbBAD, get_device(7, &bus_nr));
+}
+END_TEST
+
+// No size limit -- everything stays
+START_TEST(test_cache_unlimited)
+{
+	BYTE sn[SERIAL_NUMBER_SIZE];
+	int bus_nr;
+	int index;
+
+	for (index = 1; index <= CACHE_TEST_DEVICES; ++index) {
+		load_sn(sn, index);
+		ck_assert_int_eq(gbGOOD, Cache_Add_Device(index % 5, sn));
+	}
+	for (index = 1; index <= CACHE_TEST_DEVICES; ++index) {
+		ck_assert_int_eq(gbGOOD, get_device(index, &bus_nr));
+		ck_assert_int_eq(index % 5, bus_nr);
+	}
+}
+END_TEST
+
+// A tiny cache_size evicts the coldest entries instead of refusing new ones
+START_TEST(test_cache_lru_eviction)
+{
+	BYTE sn[SERIAL_NUMBER_SIZE];
+	int bus_nr;
+	int index;
+	UINT evictions = cache_evictions;
+
+	Globals.cache_size = 1;
+	for (index = 1; index <= CACHE_TEST_DEVICES; ++index) {
+		load_sn(sn, index);
+		ck_assert_int_eq(gbGOOD, Cache_Add_Device(0, sn));
+	}
+	// newest always kept
+	ck_assert_int_eq(gbGOOD, get_device(CACHE_TEST_DEVICES, &bus_nr));
+	// oldest long gone
+	ck_assert_int_eq(gbBAD, get_device(1, &bus_nr));
+	ck_assert_uint_gt(cache_evictions, evictions);
+}
+END_TEST
+
+// A repeated path comes from the parse cache until it's flushed
+START_TEST(test_parse_cache_hit_and_flush)
+{
+	struct parsedname pn_first;
+	struct parsedname pn_again;
+	UINT hits = parse_cache_hits;
+
+	ck_assert_int_eq(0, FS_ParsedName("/statistics/cache/flips", &pn_first));
+	ck_assert_int_eq(0, FS_ParsedName("/statistics/cache/flips", &pn_again));
+	ck_assert_uint_eq(hits + 1, parse_cache_hits);
+	ck_assert_str_eq(pn_first.path, pn_again.path);
+	ck_assert_ptr_ne(pn_first.path, pn_again.path);
+	ck_assert_ptr_eq(pn_first.selected_device, pn_again.selected_device);
+	ck_assert_ptr_eq(pn_first.selected_filetype, pn_again.selected_filetype);
+	FS_ParsedName_destroy(&pn_again);
+
+	ParseCache_Flush();
+	ck_assert_int_eq(0, FS_ParsedName("/statistics/cache/flips", &pn_again));
+	ck_assert_uint_eq(hits + 1, parse_cache_hits);
+	FS_ParsedName_destroy(&pn_again);
+	FS_ParsedName_destroy(&pn_first);
+}
+END_TEST
+
+// A device flush drops only the paths of that device
+START_TEST(test_parse_cache_flush_device)
+{
+	struct parsedname pn_parse;
+	BYTE sn_other[SERIAL_NUMBER_SIZE];
+	BYTE sn_none[SERIAL_NUMBER_SIZE];
+	UINT hits;
+
+	load_sn(sn_other, 1);
+	memset(sn_none, 0, SERIAL_NUMBER_SIZE);	// what a path without a device carries
+
+	ck_assert_int_eq(0, FS_ParsedName("/statistics/cache/flips", &pn_parse));
+	FS_ParsedName_destroy(&pn_parse);
+
+	hits = parse_cache_hits;
+	ParseCache_Flush_Device(sn_other);
+	ck_assert_int_eq(0, FS_ParsedName("/statistics/cache/flips", &pn_parse));
+	FS_ParsedName_destroy(&pn_parse);
+	ck_assert_uint_eq(hits + 1, parse_cache_hits);
+
+	ParseCache_Flush_Device(sn_none);
+	ck_assert_int_eq(0, FS_ParsedName("/statistics/cache/flips", &pn_parse));
+	FS_ParsedName_destroy(&pn_parse);
+	ck_assert_uint_eq(hits + 1, parse_cache_hits);
+
+	// and it's kept again
+	ck_assert_int_eq(0, FS_ParsedName("/statistics/cache/flips", &pn_parse));
+	FS_ParsedName_destroy(&pn_parse);
+	ck_assert_uint_eq(hits + 2, parse_cache_hits);
+}
+END_TEST
+
+// Aliases survive a snapshot write and load
+START_TEST(test_cache_snapshot_alias)
+{
+	char file[] = "/tmp/check_ow_cache_snapshotXXXXXX";
+	BYTE sn[SERIAL_NUMBER_SIZE];
+	ASCII * alias_name;
+	int fd = mkstemp(file);
+
+	ck_assert_int_ge(fd, 0);
+	close(fd);
+	Globals.cache_snapshot = owstrdup(file);
+
+	// aliases are stored as text, so the serial number needs a valid CRC
+	load_sn(sn, 5);
+	sn[7] = CRC8compute(sn, 7, 0);
+	ck_assert_int_eq(gbGOOD, Cache_Add_Alias("snapshot_test", sn));
+	ck_assert_int_eq(gbGOOD, Cache_Snapshot_Write());
+	Cache_Del_Alias(sn);
+	ck_assert_ptr_eq(NULL, Cache_Get_Alias(sn));
+
+	Cache_Snapshot_Load();
+	alias_name = Cache_Get_Alias(sn);
+	ck_assert_ptr_ne(NULL, alias_name);
+	ck_assert_str_eq("snapshot_test", alias_name);
+	owfree(alias_name);
+
+	Cache_Del_Alias(sn);
+	SAFEFREE(Globals.cache_snapshot);
+	unlink(file);
+}
+END_TEST
+
+// Looks an alias up while the trees are flipped under it
+// It's either there with its bus or (just after a clear) not yet
+static volatile int alias_reader_stop ;
+static volatile UINT alias_reader_lookups ;
+static volatile UINT alias_reader_wrong ;
+static void * alias_reader(void * v) {
+	(void) v ;
+	while ( ! alias_reader_stop ) {
+		INDEX_OR_ERROR bus = Cache_Get_Alias_Bus("flip_probe") ;
+		if ( bus != 2 && bus != INDEX_BAD ) {
+			++alias_reader_wrong ;
+		}
+		++alias_reader_lookups ;
+	}
+	return NULL ;
+}
+
+// Big retired alias trees are freed by the reaper, while lookups carry on
+START_TEST(test_cache_flip_hold)
+{
+	char name[32];
+	pthread_t reader;
+	UINT reaped = cache_reaped;
+	int flip;
+	int index;
+
+	Cache_Reaper_Start();
+	STAT_SET(cache_flip_max, 0);
+	alias_reader_stop = 0;
+	alias_reader_lookups = 0;
+	alias_reader_wrong = 0;
+	ck_assert_int_eq(0, pthread_create(&reader, NULL, alias_reader, NULL));
+
+	for (flip = 0; flip < CACHE_TEST_FLIPS; ++flip) {
+		UINT lookups;
+
+		for (index = 0; index < CACHE_TEST_ALIASES; ++index) {
+			snprintf(name, sizeof(name), "alias_%d_%d", flip, index);
+			Cache_Add_Alias_Bus(name, index % 4);
+		}
+		Cache_Add_Alias_Bus("flip_probe", 2);
+		// flips twice, so the tree just filled is retired
+		Cache_Clear();
+		Cache_Add_Alias_Bus("flip_probe", 2);
+
+		// the reader isn't shut out while the retired tree is freed
+		lookups = alias_reader_lookups;
+		while (alias_reader_lookups == lookups) {
+			sched_yield();
+		}
+	}
+
+	// aliases added after the flips are found
+	for (index = 0; index < CACHE_TEST_DEVICES; ++index) {
+		snprintf(name, sizeof(name), "alias_after_%d", index);
+		Cache_Add_Alias_Bus(name, index % 4);
+	}
+	for (index = 0; index < CACHE_TEST_DEVICES; ++index) {
+		snprintf(name, sizeof(name), "alias_after_%d", index);
+		ck_assert_int_eq(index % 4, Cache_Get_Alias_Bus(name));
+	}
+
+	alias_reader_stop = 1;
+	pthread_join(reader, NULL);
+	// returns once everything retired is freed
+	Cache_Reaper_Stop();
+
+	ck_assert_uint_eq(0, alias_reader_wrong);
+	// each filled tree (and its probe) went to the reaper
+	ck_assert_uint_eq(reaped + CACHE_TEST_FLIPS * (CACHE_TEST_ALIASES + 1), cache_reaped);
+	// for information only, timing depends on the machine
+	LEVEL_DEBUG("Longest flip under the cache lock: %u usec", cache_flip_max);
+}
+END_TEST
+
+// Create test-suite
+Suite* ow_cache_suite(void) {
+	Suite *s;
+	TCase *tc;
+
+	s = suite_create("Owfs");
+	tc = tcase_create("cache");
+
+	tcase_add_checked_fixture(tc, cache_test_setup, cache_test_teardown);
+	suite_add_tcase (s, tc);
+	tcase_add_test(tc, test_cache_device_roundtrip);
+	tcase_add_test(tc, test_cache_device_delete);
+	tcase_add_test(tc, test_cache_unlimited);
+	tcase_add_test(tc, test_cache_lru_eviction);
+	tcase_add_test(tc, test_parse_cache_hit_and_flush);
+	tcase_add_test(tc, test_parse_cache_flush_device);
+	tcase_add_test(tc, test_cache_snapshot_alias);
+	tcase_add_test(tc, test_cache_flip_hold);
+	return s;
+}
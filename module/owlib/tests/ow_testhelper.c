@@ -26,6 +26,7 @@ void owlib_test_teardown(void) {
 		OWQ_destroy(owq);
 		owq = NULL;
 	}
+	Cache_Close();
 	LockTeardown();
 	Detail_Close();
 }
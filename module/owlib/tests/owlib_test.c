@@ -8,9 +8,11 @@
  */
 
 _DEFINE_SUITE(ow_parseinput_suite);
+_DEFINE_SUITE(ow_cache_suite);
 
 static void setup_test_suites(SRunner *runner) {
 	_INCLUDE_SUITE(ow_parseinput_suite);
+	_INCLUDE_SUITE(ow_cache_suite);
 }
 
 int main(void)
@@ -98,6 +98,206 @@ int ServerRead(struct request_packet *rp)
 	return cm.ret;
 }
 
+// Paths back to back, each null-terminated (READMANY and WATCH), must be free-ed
+static BYTE *PathList(int count, const char **paths, size_t *list_length)
+{
+	BYTE *path_list ;
+	BYTE *record ;
+	int i ;
+
+	*list_length = 0 ;
+	for ( i = 0 ; i < count ; ++i ) {
+		*list_length += strlen( (paths[i] == NULL) ? "/" : paths[i] ) + 1 ;
+	}
+	path_list = malloc( *list_length ) ;
+	if ( path_list == NULL ) {
+		return NULL ;
+	}
+	record = path_list ;
+	for ( i = 0 ; i < count ; ++i ) {
+		const char * path = (paths[i] == NULL) ? "/" : paths[i] ;
+		size_t path_length = strlen(path) + 1 ;
+		memcpy( record, path, path_length ) ;
+		record += path_length ;
+	}
+	return path_list ;
+}
+
+// Send to an owserver using the READMANY message
+// return_strings[i] gets a null-terminated copy of each answer, return_values[i] its length or error
+// -ENOMSG means the owserver doesn't understand READMANY
+int ServerReadMany(struct request_packet *rp, int count, const char **paths, char **return_strings, int *return_values)
+{
+	struct server_msg sm;
+	struct client_msg cm;
+	struct serverpackage sp = { NULL, NULL, 0, rp->tokenstring, rp->tokens, };
+	int persistent = 1;
+	struct server_connection_state scs ;
+	size_t list_length ;
+	BYTE *path_list ;
+	BYTE *record ;
+	BYTE *reply ;
+	BYTE *reply_end ;
+	int i ;
+
+	path_list = PathList( count, paths, &list_length ) ;
+	if ( path_list == NULL ) {
+		return -ENOMEM ;
+	}
+	// the path list goes as data -- the path slot is for a single string
+	sp.data = path_list ;
+	sp.datasize = list_length ;
+
+	memset(&sm, 0, sizeof(struct server_msg));
+	memset(&cm, 0, sizeof(struct client_msg));
+	sm.type = msg_readmany;
+	sm.size = rp->data_length;
+	sm.offset = rp->data_offset;
+	scs.persistence = persistent_yes ;
+	scs.in =rp->owserver ;
+
+	LEVEL_CALL("SERVER READMANY %d paths\n", count);
+
+	// Send to owserver
+	sm.control_flags = SetupSemi(persistent);
+	if ( To_Server( &scs, &sm, &sp) == 1 ) {
+		free(path_list);
+		Release_Persistent( &scs, 0);
+		return -EIO ;
+	}
+	free(path_list);
+
+	// Receive from owserver
+	reply = From_ServerAlloc(&scs, &cm);
+	if ( reply == NULL ) {
+		// unread payload would confuse the next message on this connection
+		Release_Persistent( &scs, (cm.payload == 0) ? (cm.control_flags & PERSISTENT_MASK) : 0 );
+		return ( cm.ret < 0 ) ? cm.ret : -EIO ;
+	}
+	Release_Persistent( &scs, cm.control_flags & PERSISTENT_MASK);
+
+	// Unpack one record per path
+	record = reply ;
+	reply_end = reply + cm.payload ;
+	for ( i = 0 ; i < count ; ++i ) {
+		int32_t header[2] ;
+		int32_t length ;
+
+		return_strings[i] = NULL ;
+		return_values[i] = -EIO ;
+		if ( record + READMANY_RECORD_HEADER > reply_end ) {
+			continue ;
+		}
+		memcpy( header, record, READMANY_RECORD_HEADER ) ;
+		record += READMANY_RECORD_HEADER ;
+		length = (int32_t) ntohl( header[1] ) ;
+		if ( length < 0 || length > reply_end - record ) {
+			record = reply_end ;
+			continue ;
+		}
+		return_values[i] = (int32_t) ntohl( header[0] ) ;
+		if ( return_values[i] >= 0 ) {
+			return_strings[i] = malloc( length + 1 ) ;
+			if ( return_strings[i] == NULL ) {
+				return_values[i] = -ENOMEM ;
+			} else {
+				memcpy( return_strings[i], record, length ) ;
+				return_strings[i][length] = '\0' ;
+				return_values[i] = length ;
+			}
+		}
+		record += length ;
+	}
+	free(reply);
+	return 0;
+}
+
+// Send to an owserver using the WATCH message, on a connection of its own
+// returns that connection for ServerWatchLoop, or <0 error
+// -ENOMSG means the owserver doesn't understand WATCH
+int ServerWatch(struct request_packet *rp, int count, const char **paths, int interval, int threshold)
+{
+	struct server_msg sm;
+	struct client_msg cm;
+	struct serverpackage sp = { NULL, NULL, 0, rp->tokenstring, rp->tokens, };
+	struct server_connection_state scs ;
+	size_t list_length ;
+	BYTE *path_list ;
+
+	path_list = PathList( count, paths, &list_length ) ;
+	if ( path_list == NULL ) {
+		return -ENOMEM ;
+	}
+	sp.data = path_list ;
+	sp.datasize = list_length ;
+
+	memset(&sm, 0, sizeof(struct server_msg));
+	memset(&cm, 0, sizeof(struct client_msg));
+	sm.type = msg_watch;
+	sm.size = interval;
+	sm.offset = threshold;
+	// the connection is kept busy by the pushes, so never the persistent one
+	scs.persistence = persistent_no ;
+	scs.in =rp->owserver ;
+
+	LEVEL_CALL("SERVER WATCH %d paths\n", count);
+
+	// Send to owserver
+	sm.control_flags = SetupSemi(0);
+	if ( To_Server( &scs, &sm, &sp) == 1 ) {
+		free(path_list);
+		return -EIO ;
+	}
+	free(path_list);
+
+	// Receive from owserver -- just the answer, then the pushes
+	if ( From_Server( &scs, &cm, NULL, 0) < 0 ) {
+		Close_Persistent( &scs ) ;
+		return -EIO ;
+	}
+	if ( cm.ret < 0 ) {
+		Close_Persistent( &scs ) ;
+		return cm.ret ;
+	}
+	return scs.file_descriptor ;
+}
+
+// Pass each pushed change to watchfunc until it returns non-zero (0) or the connection fails (<0)
+// No locks held: the connection belongs to this caller alone
+int ServerWatchLoop(int file_descriptor, int (*watchfunc) (void *, int, int, const char *, int), void *v)
+{
+	struct server_connection_state scs = { file_descriptor, persistent_no, NULL, } ;
+
+	while (1) {
+		struct client_msg cm;
+		fd_set readset;
+		char *value;
+		int stop;
+
+		// changes come when they come -- no timeout for the next one
+		FD_ZERO(&readset);
+		FD_SET(file_descriptor, &readset);
+		if (select(file_descriptor + 1, &readset, NULL, NULL, NULL) < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+			return -EIO;
+		}
+
+		value = From_ServerAlloc(&scs, &cm);
+		if ( cm.ret < 0 || (value == NULL && cm.payload > 0) ) {
+			LEVEL_DEBUG("Watch connection lost\n");
+			free(value);
+			return -EIO;
+		}
+		stop = watchfunc(v, cm.ret, cm.offset, value, cm.size);
+		free(value);
+		if (stop) {
+			return 0;
+		}
+	}
+}
+
 // Send to an owserver using the PRESENT message
 int ServerPresence(struct request_packet *rp)
 {
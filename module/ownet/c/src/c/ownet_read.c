@@ -15,9 +15,10 @@ $Id$
 #include "ownetapi.h"
 #include "ow_server.h"
 
+static int ReadOne(struct request_packet *rp, const char *onewire_path, char **return_string);
+
 int OWNET_read(OWNET_HANDLE h, const char *onewire_path, char **return_string)
 {
-	unsigned char buffer[MAX_READ_BUFFER_SIZE];
 	int return_value;
 
 	struct request_packet s_request_packet;
@@ -31,6 +32,62 @@ int OWNET_read(OWNET_HANDLE h, const char *onewire_path, char **return_string)
 		return -EBADF;
 	}
 
+	return_value = ReadOne(rp, onewire_path, return_string);
+
+	CONNIN_RUNLOCK;
+	return return_value;
+}
+
+int OWNET_read_many(OWNET_HANDLE h, int count, const char **onewire_paths, char **return_strings, int *return_values)
+{
+	int i;
+
+	struct request_packet s_request_packet;
+	struct request_packet *rp = &s_request_packet;
+	memset(rp, 0, sizeof(struct request_packet));
+
+	for (i = 0; i < count; ++i) {
+		return_strings[i] = NULL;
+		return_values[i] = -EIO;
+	}
+
+	CONNIN_RLOCK;
+	rp->owserver = find_connection_in(h);
+	if (rp->owserver == NULL) {
+		CONNIN_RUNLOCK;
+		return -EBADF;
+	}
+
+	// Do we know this server doesn't support READMANY?
+	if (count > 1 && rp->owserver->tcp.no_readmany == 0) {
+		int return_value;
+
+		rp->data_length = MAX_READ_BUFFER_SIZE;
+		rp->data_offset = 0;
+		// try READMANY and see if supported
+		return_value = ServerReadMany(rp, count, onewire_paths, return_strings, return_values);
+		if (return_value != -ENOMSG) {
+			CONNIN_RUNLOCK;
+			return return_value;
+		}
+		rp->owserver->tcp.no_readmany = 1;
+	}
+
+	for (i = 0; i < count; ++i) {
+		return_values[i] = ReadOne(rp, onewire_paths[i], &return_strings[i]);
+	}
+
+	CONNIN_RUNLOCK;
+	return 0;
+}
+
+/* Single read into a newly allocated, null-terminated string
+ * connection already locked */
+static int ReadOne(struct request_packet *rp, const char *onewire_path, char **return_string)
+{
+	unsigned char buffer[MAX_READ_BUFFER_SIZE];
+	int return_value;
+
 	rp->path = (onewire_path == NULL) ? "/" : onewire_path;
 	rp->read_value = buffer;
 	rp->data_length = MAX_READ_BUFFER_SIZE;
@@ -48,7 +105,6 @@ int OWNET_read(OWNET_HANDLE h, const char *onewire_path, char **return_string)
 		}
 	}
 
-	CONNIN_RUNLOCK;
 	return return_value;
 }
 
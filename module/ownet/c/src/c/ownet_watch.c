@@ -0,0 +1,52 @@
+/*
+$Id$
+    OWFS -- One-Wire filesystem
+    OWHTTPD -- One-Wire Web Server
+    Written 2003 Paul H Alfille
+    email: paul.alfille@gmail.com
+    Released under the GPL
+    See the header file: ow.h for full attribution
+    1wire/iButton system from Dallas Semiconductor
+*/
+
+/* ow_server talks to the server, sending and recieving messages */
+/* this is an alternative to direct bus communication */
+
+
+#include "ownetapi.h"
+#include "ow_server.h"
+
+int OWNET_watch(OWNET_HANDLE h, int count, const char **onewire_paths, int interval, int threshold,
+				int (*watchfunc) (void *passed_on_value, int path_index, int event, const char *value, int length),
+				void *passed_on_value)
+{
+	int file_descriptor;
+	int return_value;
+
+	struct request_packet s_request_packet;
+	struct request_packet *rp = &s_request_packet;
+	memset(rp, 0, sizeof(struct request_packet));
+
+	if (count < 1 || onewire_paths == NULL || watchfunc == NULL) {
+		return -EINVAL;
+	}
+
+	CONNIN_RLOCK;
+	rp->owserver = find_connection_in(h);
+	if (rp->owserver == NULL) {
+		CONNIN_RUNLOCK;
+		return -EBADF;
+	}
+
+	file_descriptor = ServerWatch(rp, count, onewire_paths, interval, threshold);
+
+	CONNIN_RUNLOCK;
+	if (file_descriptor < 0) {
+		return file_descriptor;
+	}
+
+	/* The subscription has its own connection, so wait without the lock */
+	return_value = ServerWatchLoop(file_descriptor, watchfunc, passed_on_value);
+	close(file_descriptor);
+	return return_value;
+}
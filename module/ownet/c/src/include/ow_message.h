@@ -41,6 +41,40 @@ enum msg_classification {
 	msg_get,
 	msg_dirallslash,
 	msg_getslash,
+	msg_readmany,				// several paths in one request, see below
+	msg_watch,					// subscribe to changes, see below
+};
+
+/* msg_readmany
+ * Request: payload is a list of null-terminated paths, back to back
+ *   size is the largest answer wanted for any one path, offset applies to each
+ * Reply: ret is the number of paths answered (or a negative error for the whole request)
+ *   payload is one record per path, in request order:
+ *   int32_t return value (bytes read or negative error), int32_t length, then length bytes of data
+ *   both integers in network order
+ * Servers that predate msg_readmany answer -ENOMSG, and clients fall back to msg_read
+ * */
+#define READMANY_RECORD_HEADER	(2*sizeof(int32_t))
+
+/* msg_watch
+ * Request: payload is a list of null-terminated paths, like msg_readmany
+ *   size is the shortest interval between updates in msec (0 for the server default)
+ *   offset is the change threshold for numeric values, in thousandths (0 for any change)
+ * Reply: ret is the number of paths watched (or a negative error), no payload
+ * The connection then carries only pushed messages, one per change:
+ *   ret is the index of the path in the request list, offset is the watch_event
+ *   watch_value: payload (and size) is the new value
+ *   watch_arrival, watch_departure: payload is the directory entry (null-terminated)
+ *   watch_error: no payload, size is the (negative) error
+ *   The first messages give the current state: every value and every entry as an arrival
+ * Sending anything, or closing the connection, ends the subscription
+ * Servers that predate msg_watch answer -ENOMSG
+ * */
+enum watch_event {
+	watch_value,
+	watch_arrival,
+	watch_departure,
+	watch_error,
 };
 /* message to owserver */
 struct server_msg {
@@ -64,6 +64,9 @@ extern struct ow_global {
 
 int ServerPresence(struct request_packet *rp);
 int ServerRead(struct request_packet *rp);
+int ServerReadMany(struct request_packet *rp, int count, const char **paths, char **return_strings, int *return_values);
+int ServerWatch(struct request_packet *rp, int count, const char **paths, int interval, int threshold);
+int ServerWatchLoop(int file_descriptor, int (*watchfunc) (void *, int, int, const char *, int), void *v);
 int ServerWrite(struct request_packet *rp);
 int ServerDir(void (*dirfunc) (void *, const char *), void *v, struct request_packet *rp);
 
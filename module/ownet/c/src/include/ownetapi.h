@@ -103,6 +103,45 @@ extern "C" {
 */
 	int OWNET_lread(OWNET_HANDLE h, const char *onewire_path, char *return_string, size_t size, off_t offset);
 
+/* int OWNET_read_many( OWNET_HANDLE h, int count, const char ** onewire_paths,
+        char ** return_strings, int * return_values )
+   Read several one-wire device properties in a single request
+   return_strings[i] has the result for onewire_paths[i] (or NULL on error)
+     and must be free-ed by the calling program.
+   return_values[i] has its length, or <0 on error
+   Older owservers are sent the paths one at a time.
+
+   returns 0 on success (check each return_values[i]),
+   returns <0 on error
+*/
+	int OWNET_read_many(OWNET_HANDLE h, int count, const char **onewire_paths, char **return_strings, int *return_values);
+
+/* int OWNET_watch( OWNET_HANDLE h, int count, const char ** onewire_paths,
+        int interval, int threshold,
+        int (*watchfunc) (void * passed_on_value, int path_index, int event, const char * value, int length),
+        void * passed_on_value )
+   Have owserver report changes instead of polling it
+   Each path is sampled at most every interval msec (0 for the owserver default)
+   and numbers must move by at least threshold thousandths (0 for any change)
+   watchfunc is called with the index into onewire_paths and one of these events:
+     OWNET_WATCH_VALUE -- value is the new (null-terminated) value
+     OWNET_WATCH_ARRIVAL, OWNET_WATCH_DEPARTURE -- value is a directory entry
+       that appeared or disappeared (watch "/" or "/alarm" for devices)
+     OWNET_WATCH_ERROR -- value is NULL, length is the negative error
+   The first calls give the current state.
+   Runs on a connection of its own and blocks until watchfunc returns non-zero
+
+   returns 0 when watchfunc ended it,
+   returns <0 on error (-ENOMSG if owserver doesn't know about watching)
+*/
+#define OWNET_WATCH_VALUE      0
+#define OWNET_WATCH_ARRIVAL    1
+#define OWNET_WATCH_DEPARTURE  2
+#define OWNET_WATCH_ERROR      3
+	int OWNET_watch(OWNET_HANDLE h, int count, const char **onewire_paths, int interval, int threshold,
+					int (*watchfunc) (void *passed_on_value, int path_index, int event, const char *value, int length),
+					void *passed_on_value);
+
 /* int OWNET_put( OWNET_HANDLE h, const char * onewire_path, 
         const unsigned char * value_string, size_t size)
    Write a value to a one-wire device property,
@@ -36,6 +36,33 @@
 
 #include "owserver.h"
 
+/* Apply the client's settings to a parsed request */
+void ClientSettings(struct handlerdata *hd, struct parsedname *pn)
+{
+	ClientFlags(hd->sm.control_flags, pn);
+
+	/* Antilooping tags */
+	pn->tokens = hd->sp.tokens;
+	pn->tokenstring = hd->sp.tokenstring;
+}
+
+/* Control flags alone (no request around, e.g. watch sampling) */
+void ClientFlags(uint32_t control_flags, struct parsedname *pn)
+{
+	/* Use client persistent settings (temp scale, display mode ...) */
+	/* STALE_SERVED is only for the answer */
+	pn->control_flags = control_flags & ~STALE_SERVED;
+	/* Override some settings from control flags */
+	if ( (pn->control_flags & UNCACHED) != 0 ) {
+		// client wants uncached
+		pn->state |= ePS_uncached;
+	}
+	if ( (pn->control_flags & ALIAS_REQUEST) == 0 ) {
+		// client wants unaliased
+		pn->state |= ePS_unaliased;
+	}
+}
+
 /*
  * lower level routine for actually handling a request
  * deals with data (ping is handled higher)
@@ -59,7 +86,7 @@ void *DataHandler(void *v)
 
 	memset(&cm, 0, sizeof(struct client_msg));
 	cm.version = MakeServerprotocol(OWSERVER_PROTOCOL_VERSION);
-	cm.control_flags = hd->sm.control_flags;			// default flag return -- includes persistence state
+	cm.control_flags = hd->sm.control_flags & ~STALE_SERVED;			// default flag return -- includes persistence state
 
 	/* Pre-handling for special testing mode to exclude certain messages */
 	switch ((enum msg_classification) hd->sm.type) {
@@ -107,22 +134,7 @@ void *DataHandler(void *v)
 				break;
 			}
 
-			/* Use client persistent settings (temp scale, display mode ...) */
-			pn->control_flags = hd->sm.control_flags;
-			/* Override some settings from control flags */
-			if ( (pn->control_flags & UNCACHED) != 0 ) {
-				// client wants uncached
-				pn->state |= ePS_uncached;
-			}
-			if ( (pn->control_flags & ALIAS_REQUEST) == 0 ) {
-				// client wants unaliased
-				pn->state |= ePS_unaliased;
-			}
-			
-
-			/* Antilooping tags */
-			pn->tokens = hd->sp.tokens;
-			pn->tokenstring = hd->sp.tokenstring;
+			ClientSettings(hd, pn);
 			//printf("Handler: sm.sg=%X pn.state=%X\n", sm.sg, pn.state);
 			//printf("Scale=%s\n", TemperatureScaleName(SGTemperatureScale(sm.sg)));
 
@@ -193,6 +205,14 @@ void *DataHandler(void *v)
 			LEVEL_DEBUG("DataHandler: FS_ParsedName_destroy done");
 		}
 		break;
+	case msg_readmany:			// good message -- a list of paths
+		LEVEL_CALL("Read many message");
+		retbuffer = ReadManyHandler(hd, &cm);
+		break;
+	case msg_watch:				// good message -- subscribe to a list of paths
+		LEVEL_CALL("Watch message");
+		WatchHandler(hd, &cm);
+		break;
 	case msg_nop:				// "bad" message
 		LEVEL_CALL("NOP message");
 		cm.ret = 0;
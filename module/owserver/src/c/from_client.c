@@ -37,24 +37,16 @@ $Id$
 
 #include "owserver.h"
 
-/* read from client, free return pointer if not Null */
-int FromClient(struct handlerdata *hd)
+/* Translate a freshly read header (network order) into hd->sm
+ * returns the length of the rest of the message (payload plus tokens)
+ * or a negative error code */
+ssize_t FromClientHeader(struct handlerdata *hd)
 {
-	BYTE *msg;
 	ssize_t trueload;
-	size_t actual_read ;
-	struct timeval tv = { Globals.timeout_server, 0, };
 
 	/* Clear return structure */
 	memset(&hd->sp, 0, sizeof(struct serverpackage));
 
-	/* read header */
-	tcp_read(hd->file_descriptor, (BYTE *) &hd->sm, sizeof(struct server_msg), &tv, &actual_read) ;
-	if (actual_read != sizeof(struct server_msg)) {
-		hd->sm.type = msg_error;
-		return -EIO;
-	}
-
 	/* translate endian state */
 	hd->sm.version = ntohl(hd->sm.version);
 	hd->sm.payload = ntohl(hd->sm.payload);
@@ -83,20 +75,13 @@ int FromClient(struct handlerdata *hd)
 		return -EMSGSIZE;
 	}
 
-	/* Can allocate space? */
-	if ((msg = owmalloc(trueload+2)) == NULL) {	/* create a buffer */
-		// Adds an extra byte for the path null
-		hd->sm.type = msg_error;
-		return -ENOMEM;
-	}
-
-	/* read in data */
-	tcp_read(hd->file_descriptor, msg, trueload, &tv, &actual_read) ;
-	if ((ssize_t)actual_read != trueload) {	/* read in the expected data */
-		hd->sm.type = msg_error;
-		goto BADDATA ;
-	}
+	return trueload;
+}
 
+/* Split the rest of the message (msg, trueload+2 bytes allocated) into path, data and tokens
+ * msg is owned by hd->sp.path afterwards, or freed on error */
+int FromClientPayload(struct handlerdata *hd, BYTE * msg)
+{
 	/* New algorithm as of 2.9p4 -- no longer use terminating null as path length
 	 * now use payload length and data size (for writes)
 	 * */
@@ -150,5 +135,45 @@ int FromClient(struct handlerdata *hd)
 	
 BADDATA:
 	owfree(msg);
+	hd->sp.path = NULL;
 	return -EINVAL;
 }
+
+/* read from client, free return pointer if not Null */
+int FromClient(struct handlerdata *hd)
+{
+	BYTE *msg;
+	ssize_t trueload;
+	size_t actual_read ;
+	struct timeval tv = { Globals.timeout_server, 0, };
+
+	/* read header */
+	tcp_read(hd->file_descriptor, (BYTE *) &hd->sm, sizeof(struct server_msg), &tv, &actual_read) ;
+	if (actual_read != sizeof(struct server_msg)) {
+		memset(&hd->sp, 0, sizeof(struct serverpackage));
+		hd->sm.type = msg_error;
+		return -EIO;
+	}
+
+	trueload = FromClientHeader(hd);
+	if (trueload <= 0) {
+		return trueload;
+	}
+
+	/* Can allocate space? */
+	if ((msg = owmalloc(trueload+2)) == NULL) {	/* create a buffer */
+		// Adds an extra byte for the path null
+		hd->sm.type = msg_error;
+		return -ENOMEM;
+	}
+
+	/* read in data */
+	tcp_read(hd->file_descriptor, msg, trueload, &tv, &actual_read) ;
+	if ((ssize_t)actual_read != trueload) {	/* read in the expected data */
+		hd->sm.type = msg_error;
+		owfree(msg);
+		return -EINVAL;
+	}
+
+	return FromClientPayload(hd, msg);
+}
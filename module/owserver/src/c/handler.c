@@ -55,54 +55,25 @@ void Handler(FILE_DESCRIPTOR_OR_ERROR file_descriptor)
 	int persistent = 0;
 
 	hd.file_descriptor = file_descriptor;
+	hd.watching = 0;
 	_MUTEX_INIT(hd.to_client);
 
 	timersub(&tv_high, &tv_low, &tv_high);	// just the delta
 
 	while (FromClient(&hd) == 0) {
-		// Was persistence requested?
-		int loop_persistent = ((hd.sm.control_flags & PERSISTENT_MASK) != 0);
-
-		/* Persistence suppression? */
-		if (Globals.no_persistence) {
-			loop_persistent = 0;
-		}
-
-		/* Persistence logic */
-		if (loop_persistent) {	/* Requested persistence */
-			LEVEL_DEBUG("Persistence requested");
-			if (persistent) {	/* already had persistence granted */
-				hd.persistent = 1;	/* so keep it */
-			} else {			/* See if available */
-
-				PERSISTENCELOCK;
-
-				if (persistent_connections < Globals.clients_persistent_high) {	/* ok */
-					++persistent_connections;	/* global count */
-					persistent = 1;	/* connection toggle */
-					hd.persistent = 1;	/* for responses */
-				} else {
-					loop_persistent = 0;	/* denied! */
-					hd.persistent = 0;	/* for responses */
-				}
-
-				PERSISTENCEUNLOCK;
-
-			}
-		} else {				/* No persistence requested this time */
-			hd.persistent = 0;	/* for responses */
-		}
-
-		/* now set the sg flag because it usually is copied back to the client */
-		if (loop_persistent) {
-			hd.sm.control_flags |= PERSISTENT_MASK;
-		} else {
-			hd.sm.control_flags &= ~PERSISTENT_MASK;
-		}
+		int loop_persistent = HandlerPersistence(&hd, &persistent);
 
 		/* Do the real work */
 		SingleHandler(&hd);
 
+		/* Subscribed: the connection now belongs to the pushes */
+		if (hd.watching) {
+			HandlerPersistenceRelease(persistent);
+			persistent = 0;
+			WatchWait(&hd);
+			break;
+		}
+
 		/* Now see if we should reloop */
 		if (loop_persistent == 0) {
 			break;				/* easiest one */
@@ -111,15 +82,7 @@ void Handler(FILE_DESCRIPTOR_OR_ERROR file_descriptor)
 		/* Shorter wait */
 		if ( BAD(tcp_wait(file_descriptor, &tv_low)) ) {	// timed out
 			/* test if below threshold for longer wait */
-
-			PERSISTENCELOCK;
-
-			/* store the test because the mutex locks the variable */
-			loop_persistent = (persistent_connections < Globals.clients_persistent_low);
-
-			PERSISTENCEUNLOCK;
-
-			if (loop_persistent == 0) {
+			if ( HandlerPersistenceExtend() == 0 ) {
 				break;			/* too many connections and we're slow */
 			}
 
@@ -135,7 +98,76 @@ void Handler(FILE_DESCRIPTOR_OR_ERROR file_descriptor)
 	LEVEL_DEBUG("OWSERVER handler done");
 	_MUTEX_DESTROY(hd.to_client);
 	// restore the persistent count
-	if (persistent) {
+	HandlerPersistenceRelease(persistent);
+}
+
+/* Persistence logic for a request just read
+ * *granted is the connection's slot toggle, set when a slot is taken
+ * returns non-zero if the connection should be kept open afterwards */
+int HandlerPersistence(struct handlerdata *hd, int *granted)
+{
+	// Was persistence requested?
+	int loop_persistent = ((hd->sm.control_flags & PERSISTENT_MASK) != 0);
+
+	/* Persistence suppression? */
+	if (Globals.no_persistence) {
+		loop_persistent = 0;
+	}
+
+	/* Persistence logic */
+	if (loop_persistent) {	/* Requested persistence */
+		LEVEL_DEBUG("Persistence requested");
+		if (*granted) {	/* already had persistence granted */
+			hd->persistent = 1;	/* so keep it */
+		} else {			/* See if available */
+
+			PERSISTENCELOCK;
+
+			if (persistent_connections < Globals.clients_persistent_high) {	/* ok */
+				++persistent_connections;	/* global count */
+				*granted = 1;	/* connection toggle */
+				hd->persistent = 1;	/* for responses */
+			} else {
+				loop_persistent = 0;	/* denied! */
+				hd->persistent = 0;	/* for responses */
+			}
+
+			PERSISTENCEUNLOCK;
+
+		}
+	} else {				/* No persistence requested this time */
+		hd->persistent = 0;	/* for responses */
+	}
+
+	/* now set the sg flag because it usually is copied back to the client */
+	if (loop_persistent) {
+		hd->sm.control_flags |= PERSISTENT_MASK;
+	} else {
+		hd->sm.control_flags &= ~PERSISTENT_MASK;
+	}
+
+	return loop_persistent;
+}
+
+/* Idle persistent connection after the short wait -- may it wait the longer one? */
+int HandlerPersistenceExtend(void)
+{
+	int extend;
+
+	PERSISTENCELOCK;
+
+	/* store the test because the mutex locks the variable */
+	extend = (persistent_connections < Globals.clients_persistent_low);
+
+	PERSISTENCEUNLOCK;
+
+	return extend;
+}
+
+/* Give back a persistence slot when the connection closes */
+void HandlerPersistenceRelease(int granted)
+{
+	if (granted) {
 
 		PERSISTENCELOCK;
 
@@ -146,7 +178,8 @@ void Handler(FILE_DESCRIPTOR_OR_ERROR file_descriptor)
 	}
 }
 
-static void SingleHandler(struct handlerdata *hd)
+/* Per-request setup before DataHandler */
+void HandlerRequestStart(struct handlerdata *hd)
 {
 	timerclear(&hd->tv);
 
@@ -154,13 +187,19 @@ static void SingleHandler(struct handlerdata *hd)
 
 	gettimeofday(&(hd->tv), NULL);
 		
+	hd->toclient = toclient_postping ;
+
 	if (Globals.pingcrazy) {	// extra pings
+		TOCLIENTLOCK(hd);
 		PingClient(hd);	// send the ping
+		TOCLIENTUNLOCK(hd);
 		LEVEL_DEBUG("Extra ping (pingcrazy mode)");
 	}
+}
 
-	PingLoop( hd ) ;
-
+/* Per-request cleanup after DataHandler */
+void HandlerRequestEnd(struct handlerdata *hd)
+{
 	if (hd->sp.path) {
 #if ( __GNUC__ > 4 ) || (__GNUC__ == 4 && __GNUC_MINOR__ > 4 )
 #pragma GCC diagnostic push
@@ -175,3 +214,12 @@ static void SingleHandler(struct handlerdata *hd)
 		hd->sp.path = NULL;
 	}
 }
+
+static void SingleHandler(struct handlerdata *hd)
+{
+	HandlerRequestStart( hd ) ;
+
+	PingLoop( hd ) ;
+
+	HandlerRequestEnd( hd ) ;
+}
@@ -93,13 +93,20 @@ int main(int argc, char **argv)
 	set_signal_handlers(NULL);
 
 	_MUTEX_INIT(persistence_mutex);
+	WatchSetup();
 
 	/* Set up "Antiloop" -- a unique token */
 	SetupAntiloop( argc, argv );
 	
 	/* Call up main processing routine -- waits for network queries */ 
-	ServerProcess( Handler );
+	if ( GOOD( ReactorSetup() ) ) {
+		ServerProcessEvents( ReactorLoop ) ;
+		ReactorClose() ;
+	} else {
+		ServerProcess( Handler );
+	}
 	LEVEL_DEBUG("ServerProcess done");
+	WatchClose();
 
 	_MUTEX_DESTROY(persistence_mutex);
 
@@ -0,0 +1,722 @@
+/*
+    OW_HTML -- OWFS used for the web
+    OW -- One-Wire filesystem
+
+    Written 2004 Paul H Alfille
+
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation; either version 2 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+/* owserver -- event driven connection handling
+ *
+ * One thread (the reactor) owns every client socket through epoll.
+ * It reads server_msg headers and payloads without blocking, applies the
+ * persistence rules, and hands complete requests to a fixed pool of workers
+ * that run DataHandler. Keep-alive pings for slow requests and the idle
+ * timeouts of persistent connections come from a single timer wheel
+ * driven by the reactor instead of a ping thread per request.
+ *
+ * The bytes on the wire are exactly those of Handler() / PingLoop()
+ * */
+
+#include "owserver.h"
+
+#ifdef HAVE_SYS_EPOLL_H
+
+#include <sys/epoll.h>
+
+#define REACTOR_TICK_MS		100		// timer wheel resolution
+#define REACTOR_WHEEL_SLOTS	256		// wheel circumference (ticks)
+#define REACTOR_EVENTS		64		// epoll events per wait
+
+#define REACTOR_PING_LONG_MS	1000	// same as tv_long in loop.c
+#define REACTOR_PING_SHORT_MS	 500	// same as tv_short in loop.c
+
+enum reactor_kind {
+	reactor_wake,		// pipe from the workers
+	reactor_listen,		// listening socket
+	reactor_client,		// client connection
+} ;
+
+/* Every epoll registration points to one of these */
+struct reactor_source {
+	enum reactor_kind kind ;
+	FILE_DESCRIPTOR_OR_ERROR file_descriptor ;
+	struct connection_out * out ;
+	struct reactor_source * next ;	// list of listening sources
+} ;
+
+enum reactor_state {
+	reactor_header,		// reading (or waiting for) the server_msg header
+	reactor_payload,	// reading path, data and tokens
+	reactor_busy,		// request in the hands of a worker
+} ;
+
+enum reactor_timer {
+	timer_none,
+	timer_read,			// partial message must complete within timeout_server
+	timer_idle_low,		// persistent connection, short wait
+	timer_idle_high,	// persistent connection, longer wait
+	timer_ping,			// keep-alive while a worker is busy
+} ;
+
+struct reactor_connection {
+	struct reactor_source source ;	// must be first
+	struct handlerdata hd ;
+	enum reactor_state state ;
+	int persistent ;		// persistence slot granted to this connection
+	int loop_persistent ;	// keep open after the current request
+	size_t have ;			// bytes of header or payload read so far
+	ssize_t trueload ;		// payload size
+	BYTE * msg ;			// payload buffer until handed to hd.sp
+
+	/* timer wheel */
+	enum reactor_timer timer ;
+	unsigned long expire ;
+	struct reactor_connection * timer_next ;
+	struct reactor_connection * timer_prev ;
+
+	/* worker queue or return list */
+	struct reactor_connection * queue_next ;
+
+	/* all open connections */
+	struct reactor_connection * all_next ;
+	struct reactor_connection * all_prev ;
+} ;
+
+static struct {
+	FILE_DESCRIPTOR_OR_ERROR epoll_fd ;
+	FILE_DESCRIPTOR_OR_ERROR wake_pipe[2] ;
+	struct reactor_source wake_source ;
+	struct reactor_source * listen ;
+
+	/* worker pool -- protected by queue_mutex */
+	pthread_mutex_t queue_mutex ;
+	pthread_cond_t queue_cond ;
+	struct reactor_connection * queue_head ;
+	struct reactor_connection * queue_tail ;
+	struct reactor_connection * done ;
+	int stopping ;
+	pthread_t * workers ;
+	int worker_count ;
+
+	/* reactor thread only */
+	struct reactor_connection * wheel[REACTOR_WHEEL_SLOTS] ;
+	unsigned long tick ;
+	struct timespec start ;
+	struct reactor_connection * all ;
+} reactor ;
+
+#define QUEUELOCK    _MUTEX_LOCK(   reactor.queue_mutex )
+#define QUEUEUNLOCK  _MUTEX_UNLOCK( reactor.queue_mutex )
+
+static void * ReactorWorker( void * v ) ;
+static unsigned long ReactorNow( void ) ;
+static void TimerSet( struct reactor_connection * rc, enum reactor_timer timer, unsigned long ms ) ;
+static void TimerCancel( struct reactor_connection * rc ) ;
+static void TimerAdvance( void ) ;
+static void TimerFire( struct reactor_connection * rc, enum reactor_timer timer ) ;
+static void ReactorArm( struct reactor_connection * rc, int op ) ;
+static void ReactorAccept( struct reactor_source * source ) ;
+static void ReactorRead( struct reactor_connection * rc ) ;
+static GOOD_OR_BAD ReactorStage( struct reactor_connection * rc ) ;
+static void ReactorDispatch( struct reactor_connection * rc ) ;
+static void ReactorWake( void ) ;
+static void ReactorFinish( struct reactor_connection * rc ) ;
+static void ReactorCloseConnection( struct reactor_connection * rc ) ;
+static GOOD_OR_BAD ReactorListen( void ) ;
+
+/* Create epoll set, wake pipe and worker pool
+ * Bad means use the thread-per-connection Handler instead */
+GOOD_OR_BAD ReactorSetup( void )
+{
+	int worker ;
+
+	memset( &reactor, 0, sizeof(reactor) ) ;
+	Init_Pipe( reactor.wake_pipe ) ;
+
+	reactor.epoll_fd = epoll_create( REACTOR_EVENTS ) ;
+	if ( FILE_DESCRIPTOR_NOT_VALID( reactor.epoll_fd ) ) {
+		ERROR_DEBUG("Cannot create epoll set -- use a thread per connection") ;
+		return gbBAD ;
+	}
+
+	if ( pipe( reactor.wake_pipe ) != 0 ) {
+		ERROR_DEBUG("Cannot create reactor wake pipe -- use a thread per connection") ;
+		Init_Pipe( reactor.wake_pipe ) ;
+		Test_and_Close( &reactor.epoll_fd ) ;
+		return gbBAD ;
+	}
+	fcntl( reactor.wake_pipe[fd_pipe_read], F_SETFL, O_NONBLOCK ) ;
+	fcntl( reactor.wake_pipe[fd_pipe_write], F_SETFL, O_NONBLOCK ) ;
+
+	reactor.wake_source.kind = reactor_wake ;
+	reactor.wake_source.file_descriptor = reactor.wake_pipe[fd_pipe_read] ;
+	{
+		struct epoll_event ev = { .events = EPOLLIN, .data.ptr = &reactor.wake_source, } ;
+		if ( epoll_ctl( reactor.epoll_fd, EPOLL_CTL_ADD, reactor.wake_pipe[fd_pipe_read], &ev ) != 0 ) {
+			ERROR_DEBUG("Cannot watch reactor wake pipe -- use a thread per connection") ;
+			Test_and_Close_Pipe( reactor.wake_pipe ) ;
+			Test_and_Close( &reactor.epoll_fd ) ;
+			return gbBAD ;
+		}
+	}
+
+	_MUTEX_INIT( reactor.queue_mutex ) ;
+	my_pthread_cond_init( &reactor.queue_cond, NULL ) ;
+
+	reactor.worker_count = Globals.server_threads > 0 ? Globals.server_threads : 1 ;
+	reactor.workers = owcalloc( reactor.worker_count, sizeof(pthread_t) ) ;
+	if ( reactor.workers == NULL ) {
+		reactor.worker_count = 0 ;
+	}
+	for ( worker = 0 ; worker < reactor.worker_count ; ++worker ) {
+		if ( pthread_create( &reactor.workers[worker], DEFAULT_THREAD_ATTR, ReactorWorker, NULL ) != 0 ) {
+			LEVEL_DEBUG("Could only start %d of %d owserver worker threads", worker, reactor.worker_count ) ;
+			reactor.worker_count = worker ;
+			break ;
+		}
+	}
+	if ( reactor.worker_count == 0 ) {
+		LEVEL_DEBUG("No owserver worker threads -- use a thread per connection") ;
+		ReactorClose() ;
+		return gbBAD ;
+	}
+
+	clock_gettime( CLOCK_MONOTONIC, &reactor.start ) ;
+	LEVEL_DEBUG("owserver event loop with %d worker threads", reactor.worker_count ) ;
+	return gbGOOD ;
+}
+
+/* Stop workers, drop all connections and release the reactor */
+void ReactorClose( void )
+{
+	int worker ;
+
+	if ( reactor.worker_count > 0 ) {
+		QUEUELOCK ;
+		reactor.stopping = 1 ;
+		my_pthread_cond_broadcast( &reactor.queue_cond ) ;
+		QUEUEUNLOCK ;
+		for ( worker = 0 ; worker < reactor.worker_count ; ++worker ) {
+			pthread_join( reactor.workers[worker], NULL ) ;
+		}
+	}
+	SAFEFREE( reactor.workers ) ;
+	reactor.worker_count = 0 ;
+
+	// workers are gone, so every connection belongs to us now
+	while ( reactor.all != NULL ) {
+		ReactorCloseConnection( reactor.all ) ;
+	}
+	reactor.queue_head = reactor.queue_tail = reactor.done = NULL ;
+
+	// listening sockets themselves are closed by ServerProcessEvents
+	while ( reactor.listen != NULL ) {
+		struct reactor_source * next = reactor.listen->next ;
+		owfree( reactor.listen ) ;
+		reactor.listen = next ;
+	}
+
+	my_pthread_cond_destroy( &reactor.queue_cond ) ;
+	_MUTEX_DESTROY( reactor.queue_mutex ) ;
+	Test_and_Close_Pipe( reactor.wake_pipe ) ;
+	Test_and_Close( &reactor.epoll_fd ) ;
+}
+
+/* Main loop, called by ServerProcessEvents once the listening sockets are open */
+void ReactorLoop( void )
+{
+	struct epoll_event events[REACTOR_EVENTS] ;
+
+	if ( BAD( ReactorListen() ) ) {
+		LEVEL_DEFAULT("No listening sockets for the event loop") ;
+		return ;
+	}
+
+	while ( ! ListeningInterrupted() ) {
+		int nevents = epoll_wait( reactor.epoll_fd, events, REACTOR_EVENTS, REACTOR_TICK_MS ) ;
+		int event ;
+
+		if ( nevents < 0 ) {
+			if ( errno == EINTR && ! StateInfo.shutting_down ) {
+				continue ;
+			}
+			// exit_handler signals this (main) thread to stop
+			ERROR_DEBUG("epoll wait interrupted -- leaving event loop") ;
+			break ;
+		}
+
+		for ( event = 0 ; event < nevents ; ++event ) {
+			struct reactor_source * source = events[event].data.ptr ;
+			switch ( source->kind ) {
+				case reactor_wake:
+					ReactorWake() ;
+					break ;
+				case reactor_listen:
+					ReactorAccept( source ) ;
+					break ;
+				case reactor_client:
+					ReactorRead( (struct reactor_connection *) source ) ;
+					break ;
+			}
+		}
+
+		TimerAdvance() ;
+	}
+}
+
+/* Add every open listening socket to the epoll set */
+static GOOD_OR_BAD ReactorListen( void )
+{
+	struct connection_out * out ;
+	GOOD_OR_BAD any_sockets = gbBAD ;
+
+	for (out = Outbound_Control.head; out; out = out->next) {
+		struct reactor_source * source ;
+		struct epoll_event ev ;
+
+		if ( FILE_DESCRIPTOR_NOT_VALID( out->file_descriptor ) ) {
+			continue ;
+		}
+		source = owmalloc( sizeof(struct reactor_source) ) ;
+		if ( source == NULL ) {
+			continue ;
+		}
+		source->kind = reactor_listen ;
+		source->file_descriptor = out->file_descriptor ;
+		source->out = out ;
+		ev.events = EPOLLIN ;
+		ev.data.ptr = source ;
+		if ( epoll_ctl( reactor.epoll_fd, EPOLL_CTL_ADD, out->file_descriptor, &ev ) != 0 ) {
+			ERROR_DEBUG("Cannot watch listening socket [%s]", SAFESTRING(out->name) ) ;
+			owfree( source ) ;
+			continue ;
+		}
+		source->next = reactor.listen ;
+		reactor.listen = source ;
+		any_sockets = gbGOOD ;
+	}
+	return any_sockets ;
+}
+
+/* New client connection */
+static void ReactorAccept( struct reactor_source * source )
+{
+	struct reactor_connection * rc ;
+	FILE_DESCRIPTOR_OR_ERROR acceptfd = accept( source->file_descriptor, NULL, NULL ) ;
+
+	if ( FILE_DESCRIPTOR_NOT_VALID( acceptfd ) ) {
+		return ;
+	}
+
+	rc = owcalloc( 1, sizeof(struct reactor_connection) ) ;
+	if ( rc == NULL ) {
+		LEVEL_DEBUG("Could not allocate memory to handle this request");
+		close( acceptfd ) ;
+		return ;
+	}
+
+	rc->source.kind = reactor_client ;
+	rc->source.file_descriptor = acceptfd ;
+	rc->source.out = source->out ;
+	rc->hd.file_descriptor = acceptfd ;
+	_MUTEX_INIT( rc->hd.to_client ) ;
+	Init_Pipe( rc->hd.ping_pipe ) ; // DataHandler has no PingLoop to signal
+	rc->state = reactor_header ;
+
+	rc->all_next = reactor.all ;
+	if ( reactor.all != NULL ) {
+		reactor.all->all_prev = rc ;
+	}
+	reactor.all = rc ;
+
+	TimerSet( rc, timer_read, 1000UL * Globals.timeout_server ) ;
+	ReactorArm( rc, EPOLL_CTL_ADD ) ;
+}
+
+/* Watch for the next readable data (one event per arming) */
+static void ReactorArm( struct reactor_connection * rc, int op )
+{
+	struct epoll_event ev = { .events = EPOLLIN | EPOLLONESHOT, .data.ptr = rc, } ;
+
+	if ( epoll_ctl( reactor.epoll_fd, op, rc->source.file_descriptor, &ev ) != 0 ) {
+		ERROR_DEBUG("Cannot watch client connection") ;
+		ReactorCloseConnection( rc ) ;
+	}
+}
+
+/* Read whatever has arrived without blocking */
+static void ReactorRead( struct reactor_connection * rc )
+{
+	if ( rc->hd.watching ) {
+		// anything from a subscribed client (including hanging up) ends it
+		LEVEL_DEBUG("Watching client spoke -- end subscription") ;
+		ReactorCloseConnection( rc ) ;
+		return ;
+	}
+
+	while ( rc->state != reactor_busy ) {
+		BYTE * buffer ;
+		size_t need ;
+		ssize_t got ;
+
+		if ( rc->state == reactor_header ) {
+			buffer = (BYTE *) &rc->hd.sm ;
+			need = sizeof(struct server_msg) ;
+		} else {
+			buffer = rc->msg ;
+			need = rc->trueload ;
+		}
+
+		got = recv( rc->source.file_descriptor, &buffer[rc->have], need - rc->have, MSG_DONTWAIT ) ;
+		if ( got == 0 ) {
+			LEVEL_DEBUG("Client closed connection") ;
+			ReactorCloseConnection( rc ) ;
+			return ;
+		}
+		if ( got < 0 ) {
+			switch ( errno ) {
+				case EINTR:
+					continue ;
+				case EAGAIN:
+#if EAGAIN != EWOULDBLOCK
+				case EWOULDBLOCK:
+#endif
+					ReactorArm( rc, EPOLL_CTL_MOD ) ;
+					return ;
+				default:
+					ERROR_DEBUG("Client read problem") ;
+					ReactorCloseConnection( rc ) ;
+					return ;
+			}
+		}
+
+		if ( rc->timer != timer_read ) {
+			// idle persistent connection woke up: now the message must finish in time
+			TimerSet( rc, timer_read, 1000UL * Globals.timeout_server ) ;
+		}
+
+		rc->have += got ;
+		if ( rc->have == need ) {
+			if ( BAD( ReactorStage( rc ) ) ) {
+				ReactorCloseConnection( rc ) ;
+				return ;
+			}
+		}
+	}
+}
+
+/* A header or payload is complete -- same parsing as FromClient */
+static GOOD_OR_BAD ReactorStage( struct reactor_connection * rc )
+{
+	rc->have = 0 ;
+
+	if ( rc->state == reactor_header ) {
+		rc->trueload = FromClientHeader( &rc->hd ) ;
+		if ( rc->trueload < 0 ) {
+			return gbBAD ;
+		}
+		if ( rc->trueload == 0 ) {
+			ReactorDispatch( rc ) ;
+			return gbGOOD ;
+		}
+		// Adds an extra byte for the path null
+		rc->msg = owmalloc( rc->trueload + 2 ) ;
+		if ( rc->msg == NULL ) {
+			return gbBAD ;
+		}
+		rc->state = reactor_payload ;
+		return gbGOOD ;
+	}
+
+	// payload -- ownership of msg passes to hd.sp (or it is freed)
+	{
+		BYTE * msg = rc->msg ;
+		rc->msg = NULL ;
+		if ( FromClientPayload( &rc->hd, msg ) != 0 ) {
+			return gbBAD ;
+		}
+	}
+	ReactorDispatch( rc ) ;
+	return gbGOOD ;
+}
+
+/* Complete request -- queue for a worker and start the keep-alive timer */
+static void ReactorDispatch( struct reactor_connection * rc )
+{
+	rc->loop_persistent = HandlerPersistence( &rc->hd, &rc->persistent ) ;
+	rc->state = reactor_busy ;
+
+	TOCLIENTLOCK( &rc->hd ) ;
+	rc->hd.toclient = toclient_postping ;
+	TOCLIENTUNLOCK( &rc->hd ) ;
+	TimerSet( rc, timer_ping, REACTOR_PING_LONG_MS ) ;
+
+	QUEUELOCK ;
+	rc->queue_next = NULL ;
+	if ( reactor.queue_tail == NULL ) {
+		reactor.queue_head = rc ;
+	} else {
+		reactor.queue_tail->queue_next = rc ;
+	}
+	reactor.queue_tail = rc ;
+	my_pthread_cond_signal( &reactor.queue_cond ) ;
+	QUEUEUNLOCK ;
+}
+
+/* Worker thread -- processes requests until the reactor closes */
+static void * ReactorWorker( void * v )
+{
+	(void) v ;
+
+	while ( 1 ) {
+		struct reactor_connection * rc ;
+
+		QUEUELOCK ;
+		while ( reactor.queue_head == NULL && ! reactor.stopping ) {
+			my_pthread_cond_wait( &reactor.queue_cond, &reactor.queue_mutex ) ;
+		}
+		rc = reactor.queue_head ;
+		if ( rc == NULL ) {
+			// stopping and nothing left
+			QUEUEUNLOCK ;
+			break ;
+		}
+		reactor.queue_head = rc->queue_next ;
+		if ( reactor.queue_head == NULL ) {
+			reactor.queue_tail = NULL ;
+		}
+		QUEUEUNLOCK ;
+
+		HandlerRequestStart( &rc->hd ) ;
+		DataHandler( &rc->hd ) ;
+		HandlerRequestEnd( &rc->hd ) ;
+
+		// hand back to the reactor
+		QUEUELOCK ;
+		rc->queue_next = reactor.done ;
+		reactor.done = rc ;
+		QUEUEUNLOCK ;
+		// a full pipe is already readable, so a lost byte doesn't matter
+		ignore_result = write( reactor.wake_pipe[fd_pipe_write], "X", 1 ) ;
+	}
+	return VOID_RETURN ;
+}
+
+/* Workers finished some requests */
+static void ReactorWake( void )
+{
+	char buffer[64] ;
+	struct reactor_connection * rc ;
+
+	while ( read( reactor.wake_pipe[fd_pipe_read], buffer, sizeof(buffer) ) > 0 ) {
+	}
+
+	QUEUELOCK ;
+	rc = reactor.done ;
+	reactor.done = NULL ;
+	QUEUEUNLOCK ;
+
+	while ( rc != NULL ) {
+		struct reactor_connection * next = rc->queue_next ;
+		ReactorFinish( rc ) ;
+		rc = next ;
+	}
+}
+
+/* Request answered -- close or wait for the next one (persistence) */
+static void ReactorFinish( struct reactor_connection * rc )
+{
+	if ( rc->hd.watching ) {
+		// the sampler pushes from now on, no idle timeout
+		LEVEL_DEBUG("OWSERVER tcp connection subscribed -- keep connection open.");
+		HandlerPersistenceRelease( rc->persistent ) ;
+		rc->persistent = 0 ;
+		rc->state = reactor_header ;
+		rc->have = 0 ;
+		TimerCancel( rc ) ;
+		ReactorArm( rc, EPOLL_CTL_MOD ) ;
+		return ;
+	}
+
+	if ( rc->loop_persistent == 0 ) {
+		ReactorCloseConnection( rc ) ;
+		return ;
+	}
+
+	LEVEL_DEBUG("OWSERVER tcp connection persistence -- keep connection open.");
+	rc->state = reactor_header ;
+	rc->have = 0 ;
+	TimerSet( rc, timer_idle_low, 1000UL * Globals.timeout_persistent_low ) ;
+	ReactorArm( rc, EPOLL_CTL_MOD ) ;
+}
+
+static void ReactorCloseConnection( struct reactor_connection * rc )
+{
+	WatchCancel( &rc->hd ) ;
+	TimerCancel( rc ) ;
+
+	if ( rc->all_prev != NULL ) {
+		rc->all_prev->all_next = rc->all_next ;
+	} else {
+		reactor.all = rc->all_next ;
+	}
+	if ( rc->all_next != NULL ) {
+		rc->all_next->all_prev = rc->all_prev ;
+	}
+
+	epoll_ctl( reactor.epoll_fd, EPOLL_CTL_DEL, rc->source.file_descriptor, NULL ) ;
+	Test_and_Close( &(rc->source.file_descriptor) ) ;
+
+	HandlerPersistenceRelease( rc->persistent ) ;
+	HandlerRequestEnd( &rc->hd ) ;
+	SAFEFREE( rc->msg ) ;
+	_MUTEX_DESTROY( rc->hd.to_client ) ;
+	owfree( rc ) ;
+	LEVEL_DEBUG("OWSERVER handler done");
+}
+
+/* Timer wheel -- ticks since the reactor started */
+static unsigned long ReactorNow( void )
+{
+	struct timespec now ;
+
+	clock_gettime( CLOCK_MONOTONIC, &now ) ;
+	return (unsigned long) ( (now.tv_sec - reactor.start.tv_sec) * 1000 + (now.tv_nsec - reactor.start.tv_nsec) / 1000000 ) / REACTOR_TICK_MS ;
+}
+
+static void TimerSet( struct reactor_connection * rc, enum reactor_timer timer, unsigned long ms )
+{
+	struct reactor_connection ** slot ;
+
+	TimerCancel( rc ) ;
+
+	rc->timer = timer ;
+	rc->expire = ReactorNow() + ( ms + REACTOR_TICK_MS - 1 ) / REACTOR_TICK_MS ;
+	if ( rc->expire <= reactor.tick ) {
+		rc->expire = reactor.tick + 1 ;
+	}
+
+	slot = &reactor.wheel[ rc->expire % REACTOR_WHEEL_SLOTS ] ;
+	rc->timer_prev = NULL ;
+	rc->timer_next = *slot ;
+	if ( *slot != NULL ) {
+		(*slot)->timer_prev = rc ;
+	}
+	*slot = rc ;
+}
+
+static void TimerCancel( struct reactor_connection * rc )
+{
+	if ( rc->timer == timer_none ) {
+		return ;
+	}
+	if ( rc->timer_prev != NULL ) {
+		rc->timer_prev->timer_next = rc->timer_next ;
+	} else {
+		reactor.wheel[ rc->expire % REACTOR_WHEEL_SLOTS ] = rc->timer_next ;
+	}
+	if ( rc->timer_next != NULL ) {
+		rc->timer_next->timer_prev = rc->timer_prev ;
+	}
+	rc->timer = timer_none ;
+	rc->timer_next = rc->timer_prev = NULL ;
+}
+
+/* Fire every timer due since the last call */
+static void TimerAdvance( void )
+{
+	unsigned long now = ReactorNow() ;
+
+	while ( reactor.tick < now ) {
+		struct reactor_connection * rc ;
+
+		++reactor.tick ;
+		rc = reactor.wheel[ reactor.tick % REACTOR_WHEEL_SLOTS ] ;
+		while ( rc != NULL ) {
+			// fired timers may be rescheduled (at the head of a list) or closed
+			struct reactor_connection * next = rc->timer_next ;
+			if ( rc->expire <= reactor.tick ) {
+				enum reactor_timer timer = rc->timer ;
+				TimerCancel( rc ) ;
+				TimerFire( rc, timer ) ;
+			}
+			rc = next ;
+		}
+	}
+}
+
+static void TimerFire( struct reactor_connection * rc, enum reactor_timer timer )
+{
+	switch ( timer ) {
+		case timer_ping:
+			// Same choices as Ping_or_Send in loop.c
+			TOCLIENTLOCK( &rc->hd ) ;
+			switch ( rc->hd.toclient ) {
+				case toclient_complete:
+					// done, waiting for the reactor to notice
+					break ;
+				case toclient_postmessage:
+					LEVEL_DEBUG("Ping forestalled by a directory element");
+					rc->hd.toclient = toclient_postping ;
+					TimerSet( rc, timer_ping, REACTOR_PING_SHORT_MS ) ;
+					break ;
+				case toclient_postping:
+					LEVEL_DEBUG("Taking too long, send a keep-alive pulse");
+					PingClient( &rc->hd ) ;
+					TimerSet( rc, timer_ping, REACTOR_PING_LONG_MS ) ;
+					break ;
+			}
+			TOCLIENTUNLOCK( &rc->hd ) ;
+			break ;
+		case timer_idle_low:
+			/* test if below threshold for longer wait */
+			if ( Globals.timeout_persistent_high > Globals.timeout_persistent_low && HandlerPersistenceExtend() ) {
+				TimerSet( rc, timer_idle_high, 1000UL * ( Globals.timeout_persistent_high - Globals.timeout_persistent_low ) ) ;
+			} else {
+				ReactorCloseConnection( rc ) ;
+			}
+			break ;
+		case timer_read:
+			LEVEL_DEBUG("Client message timed out") ;
+			ReactorCloseConnection( rc ) ;
+			break ;
+		case timer_idle_high:
+		case timer_none:
+		default:
+			ReactorCloseConnection( rc ) ;
+			break ;
+	}
+}
+
+#else /* HAVE_SYS_EPOLL_H */
+
+GOOD_OR_BAD ReactorSetup( void )
+{
+	// no epoll -- use a thread per connection
+	return gbBAD ;
+}
+
+void ReactorClose( void )
+{
+}
+
+void ReactorLoop( void )
+{
+}
+
+#endif /* HAVE_SYS_EPOLL_H */
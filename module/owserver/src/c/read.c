@@ -92,6 +92,10 @@ void *ReadHandler(struct handlerdata *hd, struct client_msg *cm, struct one_wire
 			cm->offset = hd->sm.offset;
 			cm->size = read_or_error;
 			cm->ret = read_or_error;
+			if ( pn->control_flags & STALE_SERVED ) {
+				// an expired value, being refreshed
+				cm->control_flags |= STALE_SERVED;
+			}
 			/* Move this pointer, and let owfree remove it instead of OWQ_destroy() */
 			retbuffer = (BYTE *)OWQ_buffer(owq);
 			OWQ_buffer(owq) = NULL;
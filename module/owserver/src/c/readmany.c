@@ -0,0 +1,180 @@
+/*
+    OW_HTML -- OWFS used for the web
+    OW -- One-Wire filesystem
+
+    Written 2004 Paul H Alfille
+
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation; either version 2 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+/* owserver -- responds to requests over a network socket, and processes them on the 1-wire bus/
+         Basic idea: control the 1-wire bus and answer queries over a network socket
+         Clients can be owperl, owfs, owhttpd, etc...
+         Clients can be local or remote
+                 Eventually will also allow bounce servers.
+
+         syntax:
+                 owserver
+                 -u (usb)
+                 -d /dev/ttyS1 (serial)
+                 -p tcp port
+                 e.g. 3001 or 10.183.180.101:3001 or /tmp/1wire
+*/
+
+#include "owserver.h"
+
+/* ReadMany, called from DataHandler with the following caveates: */
+/* hd->sp.path holds hd->sm.payload bytes of null-terminated paths (and a final null) */
+/* sm has been read, cm has been zeroed */
+/* ReadMany, will return: */
+/* cm fully constructed, cm->ret is the number of paths or an error <0 */
+/* a malloc'ed buffer of records (see ow_message.h), that must be free'd by Handler */
+void *ReadManyHandler(struct handlerdata *hd, struct client_msg *cm)
+{
+	const char * path_list = hd->sp.path ;
+	const char * path_end ;
+	const char * path ;
+	struct one_wire_query ** owq ;
+	SIZE_OR_ERROR * result ;
+	BYTE * retbuffer = NULL ;
+	BYTE * record ;
+	size_t reply_length ;
+	int count = 0 ;
+	int ready = 0 ;
+	int i ;
+
+	LEVEL_DEBUG("ReadManyHandler: From Client sm->payload=%d sm->size=%d sm->offset=%d", hd->sm.payload, hd->sm.size, hd->sm.offset);
+
+	if (hd->sm.payload == 0 || path_list == NULL) {
+		LEVEL_DEBUG("No payload -- ignore.") ;
+		cm->ret = -EBADMSG;
+		return NULL;
+	}
+	if ((hd->sm.size <= 0) || (hd->sm.size > MAX_OWSERVER_PROTOCOL_PAYLOAD_SIZE)) {
+		LEVEL_DEBUG("ReadManyHandler: error hd->sm.size == %d", hd->sm.size);
+		cm->ret = -EMSGSIZE;
+		return NULL;
+	}
+
+	/* Count the paths */
+	path_end = path_list + hd->sm.payload ;
+	for ( path = path_list ; path < path_end ; path += strlen(path) + 1 ) {
+		++count ;
+	}
+
+	owq = owcalloc( count, sizeof(struct one_wire_query *) ) ;
+	result = owcalloc( count, sizeof(SIZE_OR_ERROR) ) ;
+	if ( owq == NULL || result == NULL ) {
+		SAFEFREE( owq ) ;
+		SAFEFREE( result ) ;
+		cm->ret = -ENOBUFS;
+		return NULL;
+	}
+
+	/* Parse each path -- bad ones get their error now, good ones are read together */
+	for ( path = path_list, i = 0 ; i < count ; path += strlen(path) + 1, ++i ) {
+		struct one_wire_query * owq_one ;
+
+		LEVEL_CALL("ReadManyHandler: parse path=%s", path);
+		owq_one = OWQ_create_from_path( path ) ;
+		if ( owq_one == NO_ONE_WIRE_QUERY ) {
+			result[i] = -ENOENT ;
+			continue ;
+		}
+		ClientSettings( hd, PN(owq_one) ) ;
+		if ( BAD( OWQ_allocate_read_buffer(owq_one)) ) {
+			OWQ_destroy( owq_one ) ;
+			result[i] = -ENOBUFS ;
+			continue ;
+		}
+		if ( OWQ_size(owq_one) > (size_t) hd->sm.size ) {
+			OWQ_size(owq_one) = hd->sm.size ;
+		}
+		OWQ_offset(owq_one) = hd->sm.offset ;
+		owq[i] = owq_one ;
+		++ready ;
+	}
+
+	/* Read the good ones as a group (keeping their order in the list) */
+	if ( ready > 0 ) {
+		struct one_wire_query ** owq_ready = owmalloc( ready * sizeof(struct one_wire_query *) ) ;
+		SIZE_OR_ERROR * result_ready = owmalloc( ready * sizeof(SIZE_OR_ERROR) ) ;
+		int j = 0 ;
+
+		if ( owq_ready == NULL || result_ready == NULL ) {
+			for ( i = 0 ; i < count ; ++i ) {
+				if ( owq[i] != NULL ) {
+					result[i] = -ENOBUFS ;
+				}
+			}
+		} else {
+			for ( i = 0 ; i < count ; ++i ) {
+				if ( owq[i] != NULL ) {
+					owq_ready[j++] = owq[i] ;
+				}
+			}
+			FS_read_many( owq_ready, result_ready, ready ) ;
+			for ( i = 0, j = 0 ; i < count ; ++i ) {
+				if ( owq[i] != NULL ) {
+					result[i] = result_ready[j++] ;
+				}
+			}
+		}
+		SAFEFREE( owq_ready ) ;
+		SAFEFREE( result_ready ) ;
+	}
+
+	/* Pack the answers */
+	reply_length = 0 ;
+	for ( i = 0 ; i < count ; ++i ) {
+		reply_length += READMANY_RECORD_HEADER + ( (result[i] > 0) ? result[i] : 0 ) ;
+	}
+	retbuffer = owmalloc( reply_length ) ;
+	if ( retbuffer == NULL ) {
+		cm->ret = -ENOBUFS;
+	} else {
+		record = retbuffer ;
+		for ( i = 0 ; i < count ; ++i ) {
+			int32_t length = (result[i] > 0) ? result[i] : 0 ;
+			int32_t header[2] = { htonl( result[i] ), htonl( length ), } ;
+
+			memcpy( record, header, READMANY_RECORD_HEADER ) ;
+			record += READMANY_RECORD_HEADER ;
+			if ( length > 0 ) {
+				memcpy( record, OWQ_buffer(owq[i]), length ) ;
+				record += length ;
+				if ( PN(owq[i])->control_flags & STALE_SERVED ) {
+					// at least one value is expired, being refreshed
+					cm->control_flags |= STALE_SERVED ;
+				}
+			}
+			LEVEL_DEBUG("ReadManyHandler: path %d return=%d", i, result[i]);
+		}
+		cm->payload = reply_length ;
+		cm->size = reply_length ;
+		cm->offset = 0 ;
+		cm->ret = count ;
+	}
+
+	for ( i = 0 ; i < count ; ++i ) {
+		OWQ_destroy( owq[i] ) ;
+	}
+	owfree( owq ) ;
+	owfree( result ) ;
+
+	LEVEL_DEBUG("ReadManyHandler: To Client cm->payload=%d paths=%d", cm->payload, count);
+	return retbuffer;
+}
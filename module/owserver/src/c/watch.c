@@ -0,0 +1,837 @@
+/*
+    OW_HTML -- OWFS used for the web
+    OW -- One-Wire filesystem
+
+    Written 2004 Paul H Alfille
+
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation; either version 2 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+/* owserver -- responds to requests over a network socket, and processes them on the 1-wire bus/
+         Basic idea: control the 1-wire bus and answer queries over a network socket
+         Clients can be owperl, owfs, owhttpd, etc...
+         Clients can be local or remote
+                 Eventually will also allow bounce servers.
+
+         syntax:
+                 owserver
+                 -u (usb)
+                 -d /dev/ttyS1 (serial)
+                 -p tcp port
+                 e.g. 3001 or 10.183.180.101:3001 or /tmp/1wire
+*/
+
+#include "owserver.h"
+#include <math.h>
+
+
+/* Server-push subscriptions (msg_watch, format in ow_message.h)
+ * Every distinct path (with its control flags) is sampled by one background
+ * thread, at the shortest interval any of its subscribers asked for, so many
+ * watchers of the same property cost a single bus read.
+ * Each subscriber remembers what it was last sent and only gets a message
+ * when a value moved past its threshold, or directory entries came or went.
+ * Watching "/" or "/alarm" reports devices appearing and disappearing.
+ * Messages are queued on the subscriber under the lock and written after it
+ * is released, so a client that stops reading never holds up the lock
+ * (and the reactor thread closing connections).
+ * */
+
+#define WATCH_DEFAULT_MS	10000	// interval when the client asks for 0
+#define WATCH_MINIMUM_MS	  100	// fastest sampling allowed
+#define WATCH_RETRY_MS		  100	// subscriber's reply not sent yet, look again soon
+
+struct watch_path {
+	struct watch_path * next ;
+	struct watch_path * sample_next ;	// sampler's private list
+	char * path ;
+	uint32_t control_flags ;
+	int is_dir ;
+	int interval ;				// msec, shortest of the subscribers
+	struct timeval due ;		// next sample
+	int subscribers ;
+	int sampling ;				// sampler is reading it (outside the lock)
+	int sampled ;				// sample below is valid
+	SIZE_OR_ERROR length ;		// value length, entry count or error
+	char * data ;				// value, or sorted null-terminated entries
+	size_t size ;				// bytes in data
+} ;
+
+/* A pushed message waiting to be written, data follows in the same block */
+struct watch_msg {
+	struct watch_msg * next ;
+	struct client_msg cm ;
+	char * data ;
+} ;
+
+struct watch_sub {
+	struct watch_sub * next ;
+	struct handlerdata * hd ;
+	struct watch_path * wp ;
+	int index ;					// place in the client's path list
+	int interval ;				// msec
+	int threshold ;				// thousandths, 0 for any change
+	struct timeval due ;		// next look at the sample
+	int fresh ;					// nothing sent yet
+	SIZE_OR_ERROR length ;		// as last sent
+	char * data ;
+	size_t size ;
+	struct watch_msg * pending ;	// queued, not written yet
+	struct watch_msg ** pending_tail ;
+	int sending ;				// sampler is writing to hd (outside the lock)
+} ;
+
+static struct {
+	struct watch_path * paths ;
+	struct watch_sub * subs ;
+	pthread_mutex_t mutex ;
+	pthread_cond_t cond ;
+	pthread_cond_t sent ;		// a cancelled subscriber's write finished
+	pthread_t thread ;
+	int started ;
+	int stopping ;
+} watch_control ;
+
+#define WATCHLOCK    _MUTEX_LOCK(   watch_control.mutex )
+#define WATCHUNLOCK  _MUTEX_UNLOCK( watch_control.mutex )
+
+struct watch_entries {
+	char ** entry ;
+	int count ;
+	int allocated ;
+	int troubled ;
+} ;
+
+static void * WatchThread( void * v ) ;
+static void WatchSample( struct watch_path * wp, SIZE_OR_ERROR * length, char ** data, size_t * size ) ;
+static void WatchDirCallback( void * v, const struct parsedname * pn_entry ) ;
+static int WatchCompare( const void * a, const void * b ) ;
+static void WatchDeliver( struct watch_sub * sub ) ;
+static int WatchValueChanged( const struct watch_sub * sub ) ;
+static void WatchDirChanges( struct watch_sub * sub ) ;
+static void WatchPush( struct watch_sub * sub, enum watch_event event, const char * data, int length ) ;
+static void WatchSendPending( void ) ;
+static void WatchSend( struct handlerdata * hd, struct watch_msg * msg ) ;
+static void WatchFreeMessages( struct watch_msg * msg ) ;
+static void WatchFreeSub( struct watch_sub * sub ) ;
+static void WatchRelease( struct watch_path * wp ) ;
+static void WatchFreePath( struct watch_path * wp ) ;
+static void WatchAddMsec( struct timeval * result, const struct timeval * from, int msec ) ;
+
+void WatchSetup( void )
+{
+	memset( &watch_control, 0, sizeof(watch_control) ) ;
+	_MUTEX_INIT( watch_control.mutex ) ;
+	my_pthread_cond_init( &(watch_control.cond), NULL ) ;
+	my_pthread_cond_init( &(watch_control.sent), NULL ) ;
+}
+
+/* Stop the sampler and drop every subscription
+ * the mutex stays, since connection threads may still be finishing */
+void WatchClose( void )
+{
+	WATCHLOCK ;
+	watch_control.stopping = 1 ;
+	my_pthread_cond_broadcast( &(watch_control.cond) ) ;
+	WATCHUNLOCK ;
+
+	if ( watch_control.started ) {
+		pthread_join( watch_control.thread, NULL ) ;
+		watch_control.started = 0 ;
+	}
+
+	WATCHLOCK ;
+	while ( watch_control.subs != NULL ) {
+		struct watch_sub * sub = watch_control.subs ;
+		watch_control.subs = sub->next ;
+		sub->hd->watching = 0 ;
+		WatchFreeSub( sub ) ;
+	}
+	while ( watch_control.paths != NULL ) {
+		struct watch_path * wp = watch_control.paths ;
+		watch_control.paths = wp->next ;
+		WatchFreePath( wp ) ;
+	}
+	WATCHUNLOCK ;
+}
+
+/* WatchHandler, called from DataHandler with the following caveats: */
+/* hd->sp.path holds hd->sm.payload bytes of null-terminated paths (and a final null) */
+/* sm has been read, cm has been zeroed */
+/* cm->ret is the number of paths watched or an error <0 */
+/* On success the subscriptions are live, but nothing is pushed until the reply is sent */
+void WatchHandler(struct handlerdata *hd, struct client_msg *cm)
+{
+	const char * path_list = hd->sp.path ;
+	const char * path_end ;
+	const char * path ;
+	int interval ;
+	int threshold ;
+	int count = 0 ;
+	int * is_dir ;
+	int i ;
+	struct watch_sub * subs = NULL ;
+	struct timeval now ;
+
+	LEVEL_DEBUG("WatchHandler: From Client sm->payload=%d sm->size=%d sm->offset=%d", hd->sm.payload, hd->sm.size, hd->sm.offset);
+
+	if (hd->sm.payload == 0 || path_list == NULL) {
+		LEVEL_DEBUG("No payload -- ignore.") ;
+		cm->ret = -EBADMSG;
+		return;
+	}
+	if ( hd->watching ) {
+		LEVEL_DEBUG("WatchHandler: connection already watching") ;
+		cm->ret = -EBUSY;
+		return;
+	}
+
+	interval = ( hd->sm.size <= 0 ) ? WATCH_DEFAULT_MS : hd->sm.size ;
+	if ( interval < WATCH_MINIMUM_MS ) {
+		interval = WATCH_MINIMUM_MS ;
+	}
+	threshold = ( hd->sm.offset < 0 ) ? 0 : hd->sm.offset ;
+
+	/* Count the paths */
+	path_end = path_list + hd->sm.payload ;
+	for ( path = path_list ; path < path_end ; path += strlen(path) + 1 ) {
+		++count ;
+	}
+
+	/* Every path must parse, or nothing is watched */
+	is_dir = owcalloc( count, sizeof(int) ) ;
+	if ( is_dir == NULL ) {
+		cm->ret = -ENOBUFS;
+		return;
+	}
+	for ( path = path_list, i = 0 ; i < count ; path += strlen(path) + 1, ++i ) {
+		struct one_wire_query * owq = OWQ_create_from_path( path ) ;
+
+		if ( owq == NO_ONE_WIRE_QUERY ) {
+			LEVEL_DEBUG("WatchHandler: bad path %s", path) ;
+			owfree( is_dir ) ;
+			cm->ret = -ENOENT;
+			return;
+		}
+		is_dir[i] = IsDir( PN(owq) ) ;
+		OWQ_destroy( owq ) ;
+	}
+
+	/* Subscribers first, so a failure leaves nothing behind */
+	for ( i = 0 ; i < count ; ++i ) {
+		struct watch_sub * sub = owcalloc( 1, sizeof(struct watch_sub) ) ;
+		if ( sub == NULL ) {
+			while ( subs != NULL ) {
+				sub = subs ;
+				subs = sub->next ;
+				owfree( sub ) ;
+			}
+			owfree( is_dir ) ;
+			cm->ret = -ENOBUFS;
+			return;
+		}
+		sub->next = subs ;
+		subs = sub ;
+	}
+
+	timernow( &now ) ;
+	WATCHLOCK ;
+	if ( watch_control.stopping ) {
+		WATCHUNLOCK ;
+		while ( subs != NULL ) {
+			struct watch_sub * sub = subs ;
+			subs = sub->next ;
+			owfree( sub ) ;
+		}
+		owfree( is_dir ) ;
+		cm->ret = -ESHUTDOWN;
+		return;
+	}
+	for ( path = path_list, i = 0 ; i < count ; path += strlen(path) + 1, ++i ) {
+		struct watch_sub * sub = subs ;
+		struct watch_path * wp ;
+		uint32_t control_flags = hd->sm.control_flags & ~PERSISTENT_MASK ;
+
+		subs = sub->next ;
+
+		/* Share the sampling of an identical request */
+		for ( wp = watch_control.paths ; wp != NULL ; wp = wp->next ) {
+			if ( wp->control_flags == control_flags && strcmp( wp->path, path ) == 0 ) {
+				break ;
+			}
+		}
+		if ( wp == NULL ) {
+			wp = owcalloc( 1, sizeof(struct watch_path) ) ;
+			if ( wp != NULL ) {
+				wp->path = owstrdup( path ) ;
+				if ( wp->path == NULL ) {
+					SAFEFREE( wp ) ;
+				}
+			}
+			if ( wp == NULL ) {
+				// nothing will come for this one
+				LEVEL_DEBUG("WatchHandler: no memory for %s", path) ;
+				owfree( sub ) ;
+				continue ;
+			}
+			wp->control_flags = control_flags ;
+			wp->is_dir = is_dir[i] ;
+			wp->interval = interval ;
+			timercpy( &(wp->due), &now ) ;
+			wp->next = watch_control.paths ;
+			watch_control.paths = wp ;
+		} else if ( wp->subscribers == 0 ) {
+			// left over from subscribers that just went away
+			wp->interval = interval ;
+		} else if ( interval < wp->interval ) {
+			struct timeval sooner ;
+			wp->interval = interval ;
+			WatchAddMsec( &sooner, &now, interval ) ;
+			if ( timercmp( &sooner, &(wp->due), < ) ) {
+				timercpy( &(wp->due), &sooner ) ;
+			}
+		}
+		++wp->subscribers ;
+
+		sub->hd = hd ;
+		sub->wp = wp ;
+		sub->index = i ;
+		sub->interval = interval ;
+		sub->threshold = threshold ;
+		sub->fresh = 1 ;
+		sub->next = watch_control.subs ;
+		watch_control.subs = sub ;
+		LEVEL_DEBUG("WatchHandler: path %d %s (%d subscribers)", i, path, wp->subscribers) ;
+	}
+	hd->watching = 1 ;
+
+	// a client that stops reading must not stall the sampler
+	{
+		struct timeval tv = { Globals.timeout_server, 0, } ;
+		setsockopt( hd->file_descriptor, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv) ) ;
+	}
+
+	if ( ! watch_control.started ) {
+		if ( pthread_create( &(watch_control.thread), DEFAULT_THREAD_ATTR, WatchThread, NULL ) == 0 ) {
+			watch_control.started = 1 ;
+		} else {
+			ERROR_DEBUG("Cannot start the watch sampler") ;
+		}
+	}
+	my_pthread_cond_signal( &(watch_control.cond) ) ;
+	WATCHUNLOCK ;
+
+	owfree( is_dir ) ;
+	cm->ret = count ;
+}
+
+/* Remove this connection's subscriptions
+ * The connection is closing, so a write in progress is cut short rather than waited out */
+void WatchCancel( struct handlerdata * hd )
+{
+	struct watch_sub ** link ;
+	struct watch_sub * sending = NULL ;
+
+	if ( ! hd->watching ) {
+		return ;
+	}
+
+	WATCHLOCK ;
+	link = &(watch_control.subs) ;
+	while ( *link != NULL ) {
+		struct watch_sub * sub = *link ;
+		if ( sub->hd == hd ) {
+			*link = sub->next ;
+			WatchRelease( sub->wp ) ;
+			if ( sub->sending ) {
+				// the sampler still uses hd, free once it's done
+				sending = sub ;
+			} else {
+				WatchFreeSub( sub ) ;
+			}
+		} else {
+			link = &(sub->next) ;
+		}
+	}
+	if ( sending != NULL ) {
+		shutdown( hd->file_descriptor, SHUT_RDWR ) ;
+		while ( sending->sending ) {
+			my_pthread_cond_wait( &(watch_control.sent), &(watch_control.mutex) ) ;
+		}
+		WatchFreeSub( sending ) ;
+	}
+	hd->watching = 0 ;
+	WATCHUNLOCK ;
+	LEVEL_DEBUG("Watch subscriptions cancelled") ;
+}
+
+/* Thread-per-connection owserver: the pushes come from the sampler,
+ * this thread only waits for the client to speak or hang up */
+void WatchWait( struct handlerdata * hd )
+{
+	struct timeval tv = { 1, 0, } ;
+
+	while ( BAD( tcp_wait( hd->file_descriptor, &tv ) ) ) {
+		if ( StateInfo.shutting_down ) {
+			break ;
+		}
+	}
+	WatchCancel( hd ) ;
+}
+
+/* Paths no one watches any more are freed (unless being sampled) */
+static void WatchRelease( struct watch_path * wp )
+{
+	struct watch_sub * sub ;
+
+	if ( --wp->subscribers > 0 ) {
+		// interval might get longer
+		wp->interval = 0 ;
+		for ( sub = watch_control.subs ; sub != NULL ; sub = sub->next ) {
+			if ( sub->wp == wp && ( wp->interval == 0 || sub->interval < wp->interval ) ) {
+				wp->interval = sub->interval ;
+			}
+		}
+		return ;
+	}
+	if ( ! wp->sampling ) {
+		struct watch_path ** link ;
+		for ( link = &(watch_control.paths) ; *link != NULL ; link = &((*link)->next) ) {
+			if ( *link == wp ) {
+				*link = wp->next ;
+				break ;
+			}
+		}
+		WatchFreePath( wp ) ;
+	}
+}
+
+static void WatchFreePath( struct watch_path * wp )
+{
+	SAFEFREE( wp->path ) ;
+	SAFEFREE( wp->data ) ;
+	owfree( wp ) ;
+}
+
+static void WatchFreeSub( struct watch_sub * sub )
+{
+	WatchFreeMessages( sub->pending ) ;
+	SAFEFREE( sub->data ) ;
+	owfree( sub ) ;
+}
+
+static void WatchFreeMessages( struct watch_msg * msg )
+{
+	while ( msg != NULL ) {
+		struct watch_msg * next = msg->next ;
+		owfree( msg ) ;
+		msg = next ;
+	}
+}
+
+/* Sampler thread -- reads each due path once, then tells every subscriber */
+static void * WatchThread( void * v )
+{
+	(void) v ;
+
+	LEVEL_DEBUG("Watch sampler started") ;
+	WATCHLOCK ;
+	while ( ! watch_control.stopping ) {
+		struct watch_path * sample_list = NULL ;
+		struct watch_path * wp ;
+		struct watch_sub * sub ;
+		struct timeval now ;
+		struct timeval wake ;
+		int waiting = 0 ;
+		int retry = 0 ;
+
+		timerclear( &wake ) ;
+
+		/* Take the due paths */
+		timernow( &now ) ;
+		for ( wp = watch_control.paths ; wp != NULL ; wp = wp->next ) {
+			if ( wp->subscribers > 0 && ! timercmp( &now, &(wp->due), < ) ) {
+				wp->sampling = 1 ;
+				wp->sample_next = sample_list ;
+				sample_list = wp ;
+			}
+		}
+
+		/* Read them without holding up new subscribers or closing connections */
+		if ( sample_list != NULL ) {
+			WATCHUNLOCK ;
+			for ( wp = sample_list ; wp != NULL ; wp = wp->sample_next ) {
+				SIZE_OR_ERROR length ;
+				char * data ;
+				size_t size ;
+
+				WatchSample( wp, &length, &data, &size ) ;
+
+				WATCHLOCK ;
+				SAFEFREE( wp->data ) ;
+				wp->length = length ;
+				wp->data = data ;
+				wp->size = size ;
+				wp->sampled = 1 ;
+				WATCHUNLOCK ;
+			}
+			WATCHLOCK ;
+			timernow( &now ) ;
+			while ( sample_list != NULL ) {
+				wp = sample_list ;
+				sample_list = wp->sample_next ;
+				wp->sampling = 0 ;
+				WatchAddMsec( &(wp->due), &now, wp->interval ) ;
+				if ( wp->subscribers == 0 ) {
+					++wp->subscribers ; // so release takes it out
+					WatchRelease( wp ) ;
+				}
+			}
+		}
+
+		/* Tell the subscribers */
+		for ( sub = watch_control.subs ; sub != NULL ; sub = sub->next ) {
+			int ready ;
+
+			if ( ! sub->wp->sampled ) {
+				continue ;
+			}
+			if ( ! sub->fresh && timercmp( &now, &(sub->due), < ) ) {
+				continue ;
+			}
+			// the watch reply goes first
+			TOCLIENTLOCK( sub->hd ) ;
+			ready = ( sub->hd->toclient == toclient_complete ) ;
+			TOCLIENTUNLOCK( sub->hd ) ;
+			if ( ! ready ) {
+				retry = 1 ;
+				continue ;
+			}
+			WatchDeliver( sub ) ;
+			sub->fresh = 0 ;
+			WatchAddMsec( &(sub->due), &now, sub->interval ) ;
+		}
+		WatchSendPending() ;
+
+		/* Sleep until the next sample is due */
+		if ( retry ) {
+			WatchAddMsec( &wake, &now, WATCH_RETRY_MS ) ;
+			waiting = 1 ;
+		}
+		for ( wp = watch_control.paths ; wp != NULL ; wp = wp->next ) {
+			if ( wp->subscribers > 0 && ( ! waiting || timercmp( &(wp->due), &wake, < ) ) ) {
+				timercpy( &wake, &(wp->due) ) ;
+				waiting = 1 ;
+			}
+		}
+		if ( waiting ) {
+			struct timespec ts = { wake.tv_sec, wake.tv_usec * 1000, } ;
+			// ETIMEDOUT is the usual wakeup
+			pthread_cond_timedwait( &(watch_control.cond), &(watch_control.mutex), &ts ) ;
+		} else {
+			my_pthread_cond_wait( &(watch_control.cond), &(watch_control.mutex) ) ;
+		}
+	}
+	WATCHUNLOCK ;
+	LEVEL_DEBUG("Watch sampler stopped") ;
+	return VOID_RETURN ;
+}
+
+/* One read (or directory listing) of a watched path
+ * data is allocated: a null-terminated value, or sorted null-terminated entries */
+static void WatchSample( struct watch_path * wp, SIZE_OR_ERROR * length, char ** data, size_t * size )
+{
+	struct one_wire_query * owq = OWQ_create_from_path( wp->path ) ;
+
+	*data = NULL ;
+	*size = 0 ;
+
+	if ( owq == NO_ONE_WIRE_QUERY ) {
+		*length = -ENOENT ;
+		return ;
+	}
+	ClientFlags( wp->control_flags, PN(owq) ) ;
+
+	if ( wp->is_dir ) {
+		struct watch_entries we = { NULL, 0, 0, 0, } ;
+		uint32_t flags = 0 ;
+		int i ;
+
+		*length = FS_dir_remote( WatchDirCallback, &we, PN(owq), &flags ) ;
+		if ( *length == 0 && we.troubled ) {
+			*length = -ENOMEM ;
+		}
+		if ( *length == 0 ) {
+			qsort( we.entry, we.count, sizeof(char *), WatchCompare ) ;
+			for ( i = 0 ; i < we.count ; ++i ) {
+				*size += strlen( we.entry[i] ) + 1 ;
+			}
+			*data = owmalloc( *size + 1 ) ;
+			if ( *data == NULL ) {
+				*length = -ENOMEM ;
+				*size = 0 ;
+			} else {
+				char * entry = *data ;
+				for ( i = 0 ; i < we.count ; ++i ) {
+					size_t entry_length = strlen( we.entry[i] ) + 1 ;
+					memcpy( entry, we.entry[i], entry_length ) ;
+					entry += entry_length ;
+				}
+				*length = we.count ;
+			}
+		}
+		for ( i = 0 ; i < we.count ; ++i ) {
+			owfree( we.entry[i] ) ;
+		}
+		SAFEFREE( we.entry ) ;
+	} else if ( BAD( OWQ_allocate_read_buffer(owq) ) ) {
+		*length = -ENOBUFS ;
+	} else {
+		OWQ_offset(owq) = 0 ;
+		*length = FS_read_postparse( owq ) ;
+		if ( *length >= 0 ) {
+			*data = owmalloc( *length + 1 ) ;
+			if ( *data == NULL ) {
+				*length = -ENOMEM ;
+			} else {
+				memcpy( *data, OWQ_buffer(owq), *length ) ;
+				(*data)[*length] = '\0' ;
+				*size = *length ;
+			}
+		}
+	}
+	LEVEL_DEBUG("Watch sample %s = %d", wp->path, (int) *length ) ;
+	OWQ_destroy( owq ) ;
+}
+
+static void WatchDirCallback( void * v, const struct parsedname * pn_entry )
+{
+	struct watch_entries * we = v ;
+	char * entry ;
+
+	if ( we->count == we->allocated ) {
+		int allocated = we->allocated + 32 ;
+		char ** more = owrealloc( we->entry, allocated * sizeof(char *) ) ;
+		if ( more == NULL ) {
+			we->troubled = 1 ;
+			return ;
+		}
+		we->entry = more ;
+		we->allocated = allocated ;
+	}
+	entry = owstrdup( pn_entry->path ) ;
+	if ( entry == NULL ) {
+		we->troubled = 1 ;
+		return ;
+	}
+	we->entry[we->count++] = entry ;
+}
+
+static int WatchCompare( const void * a, const void * b )
+{
+	return strcmp( *(char * const *) a, *(char * const *) b ) ;
+}
+
+/* Send what changed since this subscriber last heard, and remember it */
+static void WatchDeliver( struct watch_sub * sub )
+{
+	struct watch_path * wp = sub->wp ;
+
+	if ( wp->length < 0 ) {
+		if ( sub->fresh || sub->length != wp->length ) {
+			WatchPush( sub, watch_error, NULL, wp->length ) ;
+		}
+	} else if ( wp->is_dir ) {
+		WatchDirChanges( sub ) ;
+	} else if ( sub->fresh || sub->length < 0 || WatchValueChanged( sub ) ) {
+		WatchPush( sub, watch_value, wp->data, wp->length ) ;
+	} else {
+		// too small a change -- keep the value the threshold is measured from
+		return ;
+	}
+
+	SAFEFREE( sub->data ) ;
+	sub->length = wp->length ;
+	sub->size = 0 ;
+	if ( wp->data != NULL ) {
+		sub->data = owmalloc( wp->size + 1 ) ;
+		if ( sub->data != NULL ) {
+			memcpy( sub->data, wp->data, wp->size + 1 ) ;
+			sub->size = wp->size ;
+		} else if ( wp->is_dir ) {
+			// everything will look new next time, better than missing a departure
+			sub->length = 0 ;
+		} else {
+			sub->length = -ENOMEM ;
+		}
+	}
+}
+
+/* Numbers compare against the threshold, anything else must match exactly */
+static int WatchValueChanged( const struct watch_sub * sub )
+{
+	const struct watch_path * wp = sub->wp ;
+
+	if ( sub->threshold > 0 && sub->data != NULL && wp->data != NULL ) {
+		char * old_end ;
+		char * new_end ;
+		double old_value = strtod( sub->data, &old_end ) ;
+		double new_value = strtod( wp->data, &new_end ) ;
+
+		while ( isspace( *old_end ) ) {
+			++old_end ;
+		}
+		while ( isspace( *new_end ) ) {
+			++new_end ;
+		}
+		if ( old_end != sub->data && new_end != wp->data && *old_end == '\0' && *new_end == '\0' ) {
+			return fabs( new_value - old_value ) * 1000. >= sub->threshold ;
+		}
+	}
+	return sub->length != wp->length || sub->data == NULL || memcmp( sub->data, wp->data, wp->length ) != 0 ;
+}
+
+/* Both lists are sorted, so a merge finds the departures and arrivals */
+static void WatchDirChanges( struct watch_sub * sub )
+{
+	const struct watch_path * wp = sub->wp ;
+	const char * old_entry = sub->data ;
+	const char * old_end = ( sub->data == NULL || sub->length < 0 ) ? old_entry : sub->data + sub->size ;
+	const char * new_entry = wp->data ;
+	const char * new_end = ( wp->data == NULL ) ? new_entry : wp->data + wp->size ;
+
+	while ( old_entry < old_end || new_entry < new_end ) {
+		int compare ;
+
+		if ( old_entry >= old_end ) {
+			compare = 1 ;
+		} else if ( new_entry >= new_end ) {
+			compare = -1 ;
+		} else {
+			compare = strcmp( old_entry, new_entry ) ;
+		}
+
+		if ( compare < 0 ) {
+			WatchPush( sub, watch_departure, old_entry, strlen( old_entry ) ) ;
+			old_entry += strlen( old_entry ) + 1 ;
+		} else if ( compare > 0 ) {
+			WatchPush( sub, watch_arrival, new_entry, strlen( new_entry ) ) ;
+			new_entry += strlen( new_entry ) + 1 ;
+		} else {
+			old_entry += strlen( old_entry ) + 1 ;
+			new_entry += strlen( new_entry ) + 1 ;
+		}
+	}
+}
+
+/* One pushed message -- length is the data length, or the error for watch_error */
+static void WatchPush( struct watch_sub * sub, enum watch_event event, const char * data, int length )
+{
+	struct client_msg cm ;
+	struct watch_msg * msg ;
+
+	memset( &cm, 0, sizeof(struct client_msg) ) ;
+	cm.version = MakeServerprotocol(OWSERVER_PROTOCOL_VERSION) ;
+	cm.control_flags = sub->wp->control_flags ;
+	cm.ret = sub->index ;
+	cm.offset = event ;
+	cm.size = length ;
+	switch ( event ) {
+		case watch_value:
+			cm.payload = length ;
+			break ;
+		case watch_arrival:
+		case watch_departure:
+			cm.payload = length + 1 ; // include the null, like msg_dir
+			break ;
+		case watch_error:
+			break ;
+	}
+
+	msg = owmalloc( sizeof(struct watch_msg) + ( data == NULL ? 0 : length + 1 ) ) ;
+	if ( msg == NULL ) {
+		// a lost message would leave the client wrong, better it reconnects
+		LEVEL_DEBUG("No memory for a watch push, end this connection") ;
+		shutdown( sub->hd->file_descriptor, SHUT_RDWR ) ;
+		return ;
+	}
+	msg->next = NULL ;
+	msg->cm = cm ;
+	msg->data = NULL ;
+	if ( data != NULL ) {
+		msg->data = (char *) ( msg + 1 ) ;
+		memcpy( msg->data, data, length ) ;
+		msg->data[length] = '\0' ;
+	}
+
+	LEVEL_DEBUG("Watch push path %d event %d size %d", sub->index, (int) event, length ) ;
+	if ( sub->pending == NULL ) {
+		sub->pending_tail = &(sub->pending) ;
+	}
+	*(sub->pending_tail) = msg ;
+	sub->pending_tail = &(msg->next) ;
+}
+
+/* Write the queued messages, one subscriber at a time with the lock released
+ * called (and returns) with WATCHLOCK held */
+static void WatchSendPending( void )
+{
+	while ( ! watch_control.stopping ) {
+		struct watch_sub * sub ;
+		struct watch_msg * msg ;
+
+		for ( sub = watch_control.subs ; sub != NULL ; sub = sub->next ) {
+			if ( sub->pending != NULL ) {
+				break ;
+			}
+		}
+		if ( sub == NULL ) {
+			return ;
+		}
+
+		msg = sub->pending ;
+		sub->pending = NULL ;
+		sub->sending = 1 ;
+		WATCHUNLOCK ;
+		WatchSend( sub->hd, msg ) ;
+		WatchFreeMessages( msg ) ;
+		WATCHLOCK ;
+		sub->sending = 0 ;
+		// WatchCancel may be waiting to free it
+		my_pthread_cond_broadcast( &(watch_control.sent) ) ;
+	}
+}
+
+static void WatchSend( struct handlerdata * hd, struct watch_msg * msg )
+{
+	TOCLIENTLOCK( hd ) ;
+	for ( ; msg != NULL ; msg = msg->next ) {
+		if ( ToClient( hd->file_descriptor, &(msg->cm), msg->data ) != 0 ) {
+			// gone or not reading -- the connection handler sees the shutdown and cancels
+			LEVEL_DEBUG("Watch push failed, end this connection") ;
+			shutdown( hd->file_descriptor, SHUT_RDWR ) ;
+			break ;
+		}
+	}
+	TOCLIENTUNLOCK( hd ) ;
+}
+
+static void WatchAddMsec( struct timeval * result, const struct timeval * from, int msec )
+{
+	struct timeval delta = { msec / 1000, ( msec % 1000 ) * 1000, } ;
+
+	timeradd( from, &delta, result ) ;
+}
@@ -36,6 +36,7 @@ enum toclient_state {
 struct handlerdata {
 	int file_descriptor;
 	int persistent;
+	int watching;	// subscriptions (msg_watch) push on this connection
 	pthread_mutex_t to_client;
 	int ping_pipe[2] ;
 	enum toclient_state toclient ;
@@ -47,12 +48,25 @@ struct handlerdata {
 /* read from client, free return pointer if not Null */
 int FromClient(struct handlerdata *hd);
 
+/* FromClient in two stages for non-blocking readers (header already in hd->sm) */
+ssize_t FromClientHeader(struct handlerdata *hd);
+int FromClientPayload(struct handlerdata *hd, BYTE * msg);
+
 /* Send fully configured message back to client */
 int ToClient(int file_descriptor, struct client_msg *cm, const char *data);
 
 /* Read from 1-wire bus and return file contents */
 void *ReadHandler(struct handlerdata *hd, struct client_msg *cm, struct one_wire_query *owq);
 
+/* Read a list of paths and return all the file contents */
+void *ReadManyHandler(struct handlerdata *hd, struct client_msg *cm);
+
+/* Apply the client's control flags and antiloop tokens to a parsed request */
+void ClientSettings(struct handlerdata *hd, struct parsedname *pn);
+
+/* Just the control flags part of ClientSettings */
+void ClientFlags(uint32_t control_flags, struct parsedname *pn);
+
 /* write a new value ot a 1-wire device */
 void WriteHandler(struct handlerdata *hd, struct client_msg *cm, struct one_wire_query *owq);
 
@@ -65,12 +79,37 @@ void *DirallHandler(struct handlerdata *hd, struct client_msg *cm, const struct
 /* Newer directory-at-once with directory '/' */
 void *DirallslashHandler(struct handlerdata *hd, struct client_msg *cm, const struct parsedname *pn);
 
+/* Subscribe to a list of paths (server push) */
+void WatchHandler(struct handlerdata *hd, struct client_msg *cm);
+
+/* Drop a connection's subscriptions -- no more pushes after this returns */
+void WatchCancel(struct handlerdata *hd);
+
+/* Thread-per-connection: push until the client speaks or hangs up */
+void WatchWait(struct handlerdata *hd);
+
+/* Shared sampler for all subscriptions */
+void WatchSetup(void);
+void WatchClose(void);
+
 /* Handle the actual request -- pings handled higher up */
 void *DataHandler(void *v);
 
 /* Handle a client request, including timeout pings */
 void Handler(FILE_DESCRIPTOR_OR_ERROR file_descriptor);
 
+/* Pieces of Handler shared with the event loop */
+int HandlerPersistence(struct handlerdata *hd, int *granted);
+int HandlerPersistenceExtend(void);
+void HandlerPersistenceRelease(int granted);
+void HandlerRequestStart(struct handlerdata *hd);
+void HandlerRequestEnd(struct handlerdata *hd);
+
+/* Event driven (epoll) connection handling -- setup is BAD if unavailable */
+GOOD_OR_BAD ReactorSetup(void);
+void ReactorLoop(void);
+void ReactorClose(void);
+
 /* Send a response to client of an error */
 void ErrorToClient(struct handlerdata *hd, struct client_msg * cm ) ;
 
@@ -19,6 +19,7 @@ int slashflag = 0 ;
 int size_of_data = -1 ;
 int offset_into_data = 0 ;
 int uncached = 0 ;
+int stale = 0 ;
 int unaliased = 0 ;
 int trim = 0 ;
 enum temp_type temperature_scale = temp_celsius ;
@@ -69,6 +70,7 @@ const struct option owopts_long[] = {
 
 	{"uncached", no_argument, &uncached, 1 },
 	{"cached", no_argument, &uncached, 0 },
+	{"stale", no_argument, &stale, 1 },
 
 
 	{0, 0, 0, 0},
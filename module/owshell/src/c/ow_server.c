@@ -76,6 +76,109 @@ int ServerRead(ASCII * path)
 	return ret;
 }
 
+/* Several paths in one READMANY request, values written in order
+ * return is that of the last path (as for one ServerRead per path)
+ * Older owservers don't know READMANY, so ask them one path at a time */
+int ServerReadMany(int count, ASCII ** paths)
+{
+	struct server_msg sm;
+	struct client_msg cm;
+	struct serverpackage sp = { NULL, NULL, 0, NULL, 0, };
+	size_t list_length = 0;
+	char *path_list;
+	char *record;
+	char *reply;
+	int connectfd;
+	int ret = -EIO;
+	int i;
+
+	for (i = 0; i < count; ++i) {
+		list_length += strlen(paths[i]) + 1;
+	}
+	if (count < 2 || list_length > MAX_OWSERVER_PROTOCOL_PAYLOAD_SIZE || (path_list = malloc(list_length)) == NULL) {
+		for (i = 0; i < count; ++i) {
+			ret = ServerRead(paths[i]);
+		}
+		return ret;
+	}
+	record = path_list;
+	for (i = 0; i < count; ++i) {
+		size_t path_length = strlen(paths[i]) + 1;
+		memcpy(record, paths[i], path_length);
+		record += path_length;
+	}
+	// the path list goes as data -- the path slot is for a single string
+	sp.data = (BYTE *) path_list;
+	sp.datasize = list_length;
+
+	connectfd = ClientConnect();
+	if (connectfd < 0) {
+		free(path_list);
+		return -EIO;
+	}
+	memset(&sm, 0, sizeof(struct server_msg));
+	memset(&cm, 0, sizeof(struct client_msg));
+	sm.type = msg_readmany;
+	sm.size = 65536;
+	sm.offset = offset_into_data;
+
+	if ( size_of_data >=0 && size_of_data <= 65536 ) {
+		sm.size = size_of_data ;
+	}
+
+	if (ToServer(connectfd, &sm, &sp)) {
+		PRINT_ERROR("ServerReadMany: Error sending request\n");
+		free(path_list);
+		close(connectfd);
+		return -EIO;
+	}
+	free(path_list);
+	reply = FromServerAlloc(connectfd, &cm);
+	close(connectfd);
+
+	if (reply == NULL) {
+		if (cm.ret == -ENOMSG) {
+			// older owserver
+			for (i = 0; i < count; ++i) {
+				ret = ServerRead(paths[i]);
+			}
+			return ret;
+		}
+		PRINT_ERROR("ServerReadMany: Error receiving data\n");
+		return (cm.ret < 0) ? cm.ret : -EIO;
+	}
+
+	// one record per path
+	record = reply;
+	for (i = 0; i < count; ++i) {
+		int32_t header[2];
+		int32_t length;
+
+		ret = -EIO;
+		if (record + READMANY_RECORD_HEADER > reply + cm.payload) {
+			PRINT_ERROR("ServerReadMany: Data error on %s\n", paths[i]);
+			continue;
+		}
+		memcpy(header, record, READMANY_RECORD_HEADER);
+		record += READMANY_RECORD_HEADER;
+		length = (int32_t) ntohl(header[1]);
+		if (length < 0 || length > reply + cm.payload - record) {
+			PRINT_ERROR("ServerReadMany: Data error on %s\n", paths[i]);
+			record = reply + cm.payload;
+			continue;
+		}
+		ret = (int32_t) ntohl(header[0]);
+		if (ret < 0) {
+			PRINT_ERROR("ServerRead: Data error on %s\n", paths[i]);
+		} else {
+			Write(record, length);
+		}
+		record += length;
+	}
+	free(reply);
+	return ret;
+}
+
 int ServerWrite(ASCII * path, ASCII * data, int size)
 {
 	struct server_msg sm;
@@ -351,6 +454,8 @@ static uint32_t SetupSemi(void)
 	sg |= (temperature_scale) << TEMPSCALE_BIT ;
 	// Uncached
 	sg |= uncached ? UNCACHED : 0 ;
+	// Expired values (while they're refreshed) are fine
+	sg |= stale ? STALE_OK : 0 ;
 	// Unaliased
 	sg |= unaliased ? 0 : ALIAS_REQUEST ;
 	// Trim
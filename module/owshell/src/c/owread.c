@@ -38,10 +38,9 @@ int main(int argc, char *argv[])
 	DefaultOwserver();
 	Server_detect();
 
-	/* non-option arguments */
-	while (optind < argc) {
-		rc = ServerRead(argv[optind]);
-		++optind;
+	/* non-option arguments -- all in one request */
+	if (optind < argc) {
+		rc = ServerReadMany(argc - optind, &argv[optind]);
 	}
 	if ( rc >= 0 ) {
 		errno = 0 ;
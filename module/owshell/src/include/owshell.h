@@ -216,7 +216,10 @@ enum msg_classification {
 	msg_get,
 	msg_dirallslash,
 	msg_getslash,
+	msg_readmany,				// several paths in one request
 };
+/* msg_readmany reply: per path, int32_t return value and int32_t length (network order) then the data */
+#define READMANY_RECORD_HEADER	(2*sizeof(int32_t))
 /* message to owserver */
 struct server_msg {
 	int32_t version;
@@ -259,6 +262,7 @@ extern int slashflag ; // directory with '/'?
 extern int size_of_data ;
 extern int offset_into_data ;
 extern int uncached ;
+extern int stale ;
 extern int unaliased ;
 extern int trim ;
 extern enum temp_type temperature_scale ;
@@ -277,6 +281,7 @@ void OW_Browse(void);
 
 void Server_detect(void);
 int ServerRead(ASCII * path);
+int ServerReadMany(int count, ASCII ** paths);
 int ServerWrite(ASCII * path, ASCII * data, int size);
 int ServerDir(ASCII * path);
 int ServerDirall(ASCII * path);
@@ -291,6 +296,7 @@ int ServerPresence(ASCII * path);
 #define DEVFORMAT_BIT  24
 #define UNCACHED                    ( (UINT) 0x00000020 )
 #define TRIM                        ( (UINT) 0x00000040 )
+#define STALE_OK                    ( (UINT) 0x00000080 )
 #define OWNET                       ( (UINT) 0x00000100 )
 
 #define PRINT_ERROR(...)		while ( ! Globals.quiet ) { fprintf( stderr, __VA_ARGS__ ) ; break ; }